@@ -247,6 +247,41 @@ namespace ZunTzu.Graphics
 			return newTileSet;
 		}
 
+		/// <summary>Loads several tile sets together, as LoadIncrementally would one after the other.</summary>
+		/// <param name="tileSets">Tile sets returned by LoadTileSet, the first ones are loaded first.</param>
+		/// <returns>Progress between 0 and 1.</returns>
+		/// <remarks>
+		/// The JPEG and PNG images of an archive are loaded by a single native batch loader,
+		/// so that many small images keep all the cores busy. The other tile sets, and those the
+		/// batch loader failed to load, are loaded one after the other afterwards.
+		/// </remarks>
+		public IEnumerable<float> LoadTileSetsIncrementally(IList<ITileSet> tileSets) {
+			List<DXTileSet> nativeTileSets = new List<DXTileSet>();
+			List<ITileSet> otherTileSets = new List<ITileSet>();
+			foreach(ITileSet tileSet in tileSets) {
+				DXTileSet dxTileSet = tileSet as DXTileSet;
+				if(dxTileSet != null && dxTileSet.IsNativelyLoadable)
+					nativeTileSets.Add(dxTileSet);
+				else
+					otherTileSets.Add(tileSet);
+			}
+
+			float nativeProgressShare = (float) nativeTileSets.Count / (float) Math.Max(1, tileSets.Count);
+			if(nativeTileSets.Count > 0) {
+				foreach(float progress in DXTileSet.LoadBatchIncrementally(nativeTileSets))
+					yield return progress * nativeProgressShare;
+				foreach(DXTileSet tileSet in nativeTileSets)
+					if(!tileSet.IsNativelyLoadable)
+						otherTileSets.Add(tileSet);
+			}
+
+			float progressShare = (1.0f - nativeProgressShare) / (float) Math.Max(1, otherTileSets.Count);
+			for(int i = 0; i < otherTileSets.Count; ++i) {
+				foreach(float progress in otherTileSets[i].LoadIncrementally())
+					yield return nativeProgressShare + (i + progress) * progressShare;
+			}
+		}
+
 		/// <summary>Loads a textured 3D model.</summary>
 		/// <param name="vertice">Geometry data.</param>
 		/// <param name="triangles">Geometry data.</param>
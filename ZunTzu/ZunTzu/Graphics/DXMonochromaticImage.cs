@@ -162,6 +162,13 @@ namespace ZunTzu.Graphics {
 			return 0xFFFFFFFF;
 		}
 
+		/// <summary>Returns the alpha of the texel at the given position, for hit-testing.</summary>
+		/// <param name="position">Position in model coordinates relative to the center of this image.</param>
+		/// <returns>An alpha value, 0 if transparent.</returns>
+		public byte GetAlphaAtPosition(PointF position) {
+			return 0xFF;
+		}
+
 		/// <summary>Unsupported (only for textured images)</summary>
 		public void RenderBlock(RectangleF blockPositionAndSize, float thickness, RectangleF stickerPositionAndSize, float flipProgress, float rotationAngle, uint blockOpaqueColor, float opacity, bool dropShadow)
 		{
@@ -266,6 +266,24 @@ namespace ZunTzu.Graphics
 			return 0x00000000;
 		}
 
+		/// <summary>Returns the alpha of the texel at the given position, for hit-testing.</summary>
+		/// <param name="position">Position in model coordinates relative to the center of this image.</param>
+		/// <returns>An alpha value, 0 if transparent.</returns>
+		public byte GetAlphaAtPosition(PointF position) {
+			for(int mipMapLevel = 0; mipMapLevel < _tesselation.Length; ++mipMapLevel) {
+				if(_tesselation[mipMapLevel] != null) {
+					foreach(Quad q in _tesselation[mipMapLevel]) {
+						if(q.Tile != null && q.Coordinates.Contains(position)) {
+							return q.Tile.GetTexelAlphaAtAddress(new PointF(
+								q.TextureCoordinates.X + q.TextureCoordinates.Width * (position.X - q.Coordinates.X) / q.Coordinates.Width,
+								q.TextureCoordinates.Y + q.TextureCoordinates.Height * (position.Y - q.Coordinates.Y) / q.Coordinates.Height));
+						}
+					}
+				}
+			}
+			return 0x00;
+		}
+
 		/// <summary>Renders a block with this image as a sticker at the given position and size.</summary>
 		/// <param name="blockPositionAndSize">Position of the block when lying down, in model coordinates relative to the center of this image.</param>
 		/// <param name="thickness">Thickness of the block, in model coordinates.</param>
@@ -817,17 +835,22 @@ namespace ZunTzu.Graphics
 
 							Quad quad = new Quad();
 
-							quad.Tile = _tileSet.Tiles[mipMapLevel][upperLeftTile.X + x, upperLeftTile.Y + y];
+							// while the tile set is loading, a missing tile is stood in for by a coarser one
+							int tileMipMapLevel = mipMapLevel;
+							quad.Tile = _tileSet.GetLoadedTile(ref tileMipMapLevel, upperLeftTile.X + x, upperLeftTile.Y + y);
+							float tileScale = (float) (1 << (tileMipMapLevel - mipMapLevel));
+							SizeF quadTileSize = new SizeF(tileSize.Width * tileScale, tileSize.Height * tileScale);
+							SizeF quadTextureSize = new SizeF(textureSize.Width * tileScale, textureSize.Height * tileScale);
 
 							quad.Coordinates.X = Math.Max(tileUpperLeftCorner.X, _imageLocation.Left);
 							quad.Coordinates.Width = Math.Min(tileUpperLeftCorner.X + tileSize.Width, _imageLocation.Right) - quad.Coordinates.X;
 							quad.Coordinates.Y = Math.Max(tileUpperLeftCorner.Y, _imageLocation.Top);
 							quad.Coordinates.Height = Math.Min(tileUpperLeftCorner.Y + tileSize.Height, _imageLocation.Bottom) - quad.Coordinates.Y;
 
-							quad.TextureCoordinates.X = (quad.Coordinates.X % tileSize.Width + (textureSize.Width - tileSize.Width)*0.5f) / textureSize.Width;
-							quad.TextureCoordinates.Width = quad.Coordinates.Width / textureSize.Width;
-							quad.TextureCoordinates.Y = (quad.Coordinates.Y % tileSize.Height + (textureSize.Width - tileSize.Width)*0.5f) / textureSize.Height;
-							quad.TextureCoordinates.Height = quad.Coordinates.Height / textureSize.Height;
+							quad.TextureCoordinates.X = (quad.Coordinates.X % quadTileSize.Width + (quadTextureSize.Width - quadTileSize.Width)*0.5f) / quadTextureSize.Width;
+							quad.TextureCoordinates.Width = quad.Coordinates.Width / quadTextureSize.Width;
+							quad.TextureCoordinates.Y = (quad.Coordinates.Y % quadTileSize.Height + (quadTextureSize.Width - quadTileSize.Width)*0.5f) / quadTextureSize.Height;
+							quad.TextureCoordinates.Height = quad.Coordinates.Height / quadTextureSize.Height;
 
 							quad.Coordinates.X -= _imageLocation.X + _imageLocation.Width * 0.5f;
 							quad.Coordinates.Y -= _imageLocation.Y + _imageLocation.Height * 0.5f;
@@ -21,6 +21,7 @@ namespace ZunTzu.Graphics
 		internal unsafe void Initialize(D3DTextureFormat textureFormat, D3DTexture texture) {
 			_textureFormat = textureFormat;
 			_texture = texture;
+			_decodedAlphas = null;
 		}
 
 		internal void Initialize(
@@ -28,6 +29,7 @@ namespace ZunTzu.Graphics
 			Point sourceUpperLeftCorner,
 			Point sourceLowerRightCorner)
 		{
+			_decodedAlphas = null;
 			if(pixelFormat == PixelFormat.Format24bppRgb) {
 				InitializeDxt1From24bits(bitmapBits, stride, sourceUpperLeftCorner, sourceLowerRightCorner, 1);
 			} else {
@@ -69,6 +71,22 @@ namespace ZunTzu.Graphics
 			}
 		}
 
+		/// <summary>Returns the alpha of the texel at the given address.</summary>
+		/// <param name="textureAddress">An address in the rectangle [0,0,1,1].</param>
+		/// <returns>An alpha value, 0 if transparent.</returns>
+		/// <remarks>Hit-testing over stacks asks for the same texels at every mouse move: the alphas of compressed tiles are decoded once.</remarks>
+		internal byte GetTexelAlphaAtAddress(PointF textureAddress) {
+			if(_textureFormat != D3DTextureFormat.DXT1 && _textureFormat != D3DTextureFormat.DXT5)
+				return (byte) (GetTexelColorAtAddress(textureAddress) >> 24);
+			if(_texture.Disposed)
+				return 0x00;
+			if(_decodedAlphas == null)
+				_decodedAlphas = decodeAlphas();
+			int x = Math.Min(255, (int)(textureAddress.X * 256.0f));
+			int y = Math.Min(255, (int)(textureAddress.Y * 256.0f));
+			return _decodedAlphas[y * 256 + x];
+		}
+
 		/// <summary>
 		/// Creates a 256x256 texture from a rectangular part of a bitmap.
 		/// </summary>
@@ -320,7 +338,7 @@ namespace ZunTzu.Graphics
 			_texture.Lock(out _, out byte* textureBits);
 
 			int blockAddress = (position.Y / 4) * 64 * 8 + (position.X / 4) * 8;
-			Dxtc.Decoder.DecodeDxt1Block(textureBits + blockAddress, pixels);
+			Dxtc.Decoder.DecodeDxt1Blocks(textureBits + blockAddress, 1, 1, pixels, 4 * 4);
 
 			_texture.Unlock();
 
@@ -333,21 +351,44 @@ namespace ZunTzu.Graphics
 			_texture.Lock(out _, out byte* textureBits);
 
 			int blockAddress = (position.Y / 4) * 64 * 16 + (position.X / 4) * 16;
-			Dxtc.Decoder.DecodeDxt5Block(textureBits + blockAddress, pixels);
+			Dxtc.Decoder.DecodeDxt5Blocks(textureBits + blockAddress, 1, 1, pixels, 4 * 4);
 
 			_texture.Unlock();
 
 			return *(uint*)(pixels + (position.Y % 4) * 4 * 4 + (position.X % 4) * 4);
 		}
 
+		/// <summary>Decodes the alphas of the whole tile, a row of blocks at a time.</summary>
+		private unsafe byte[] decodeAlphas() {
+			byte[] alphas = new byte[256 * 256];
+			uint* pixels = stackalloc uint[256 * 4];
+
+			_texture.LockReadOnly(out _, out byte* textureBits);
+
+			int blockSize = (_textureFormat == D3DTextureFormat.DXT1 ? 8 : 16);
+			for(int blockY = 0; blockY < 64; ++blockY) {
+				if(_textureFormat == D3DTextureFormat.DXT1)
+					Dxtc.Decoder.DecodeDxt1Blocks(textureBits + blockY * 64 * blockSize, 64, 1, (byte*) pixels, 256 * 4);
+				else
+					Dxtc.Decoder.DecodeDxt5Blocks(textureBits + blockY * 64 * blockSize, 64, 1, (byte*) pixels, 256 * 4);
+				for(int i = 0; i < 256 * 4; ++i)
+					alphas[blockY * 256 * 4 + i] = (byte) (pixels[i] >> 24);
+			}
+
+			_texture.Unlock();
+			return alphas;
+		}
+
 		public void Dispose() {
 			_texture.Dispose();
+			_decodedAlphas = null;
 		}
 
 		internal D3DTexture Texture => _texture;
 
 		D3DTexture _texture;
 		D3DTextureFormat _textureFormat;
+		byte[] _decodedAlphas;	// decoded on the first hit-test of a DXT tile
 	}
 
 }
@@ -81,12 +81,20 @@ namespace ZunTzu.Graphics
 			}
 		}
 
+		/// <summary>Native image loaders decode JPEG and PNG files stored in an archive.</summary>
+		/// <remarks>False once a native loader has failed to load the image.</remarks>
+		internal bool IsNativelyLoadable {
+			get {
+				return !_nativeLoadingFailed && _imageFile.Archive != null &&
+					(_imageFile.FileName.EndsWith(".jpg", StringComparison.OrdinalIgnoreCase) || _imageFile.FileName.EndsWith(".png", StringComparison.OrdinalIgnoreCase)) &&
+					(_maskFile == null || _maskFile.FileName.EndsWith(".jpg", StringComparison.OrdinalIgnoreCase) || _maskFile.FileName.EndsWith(".png", StringComparison.OrdinalIgnoreCase));
+			}
+		}
+
 		/// <summary>Must be called in a loop for the tile set to be fully loaded.</summary>
 		/// <returns>Progress between 0 and 1.</returns>
 		public IEnumerable<float> LoadIncrementally() {
-			if(_imageFile.Archive == null ||
-				(!_imageFile.FileName.EndsWith(".jpg", StringComparison.OrdinalIgnoreCase) && !_imageFile.FileName.EndsWith(".png", StringComparison.OrdinalIgnoreCase)) ||
-				(_maskFile != null && !_maskFile.FileName.EndsWith(".jpg", StringComparison.OrdinalIgnoreCase) && !_maskFile.FileName.EndsWith(".png", StringComparison.OrdinalIgnoreCase)))
+			if(!IsNativelyLoadable)
 				goto fallBack;
 
 			// optimized native code simd-ed multithreaded pipeline
@@ -103,45 +111,47 @@ namespace ZunTzu.Graphics
 						goto fallBack;
 					}
 
-					_size = new SizeF((float) width, (float) height);
-					for(int i = (int) _detailLevel; i > 0; --i)
-						_size = new SizeF(_size.Width * 2, _size.Height * 2);
-
-					int mipMapLevelCount =
-						Math.Max(
-							3,	// at least 3 mip-maps
-							Math.Max(
-								(int) Math.Ceiling(Math.Log(width / 254, 2) + 1),
-								(int) Math.Ceiling(Math.Log(height / 254, 2) + 1)));
-					_tiles = new DXTile[mipMapLevelCount + (int) _detailLevel][,];
-
-					uint tileCount = 0;
-					for(int mipMapLevel = (int) _detailLevel; mipMapLevel < mipMapLevelCount + (int) _detailLevel; ++mipMapLevel) {
-						uint columnCount = (width + 253) / 254;
-						uint rowCount = (height + 253) / 254;
-						_tiles[mipMapLevel] = new DXTile[columnCount, rowCount];
-						tileCount += columnCount * rowCount;
-						width = (width + 1) / 2;
-						height = (height + 1) / 2;
-					}
-
-					uint mipmapLevel;	// regardless of detailLevel (i.e. first mipmap is always zero)
-					uint x;
-					uint y;
-					for(uint i = 0; i < tileCount; ++i) {
-						var texture = D3DTexture.Create(256, 256, (_maskFile == null ? D3DTextureFormat.DXT1 : D3DTextureFormat.DXT5));
-						if(0 != (error = loadNextTexture(imageLoader, texture, out mipmapLevel, out x, out y))) {
-							texture.Unlock();
+					uint tileCount = initializeNativeTiles(width, height);
+
+					// tiles are compressed by native threads straight into the locked textures, a batch at a time
+					uint batchSize = (uint) Math.Max(1, 2 * Environment.ProcessorCount);
+					var textures = new D3DTexture[batchSize];
+					var textureBits = new IntPtr[batchSize];
+					var mipmapLevels = new uint[batchSize];	// regardless of detailLevel (i.e. first mipmap is always zero)
+					var xs = new uint[batchSize];
+					var ys = new uint[batchSize];
+					for(uint i = 0; i < tileCount; ) {
+						uint priorityMipMapLevel, left, top, right, bottom;
+						if(getPriorityTiles(out priorityMipMapLevel, out left, out top, out right, out bottom))
+							ZunTzuLib.PrioritizeTiles(imageLoader, priorityMipMapLevel, left, top, right, bottom);
+
+						uint batchTileCount = Math.Min(batchSize, tileCount - i);
+						for(uint j = 0; j < batchTileCount; ++j) {
+							textures[j] = D3DTexture.Create(256, 256, (_maskFile == null ? D3DTextureFormat.DXT1 : D3DTextureFormat.DXT5));
+							textureBits[j] = lockTexture(textures[j]);
+						}
+						error = ZunTzuLib.LoadNextTiles(imageLoader, textureBits, batchTileCount, mipmapLevels, xs, ys);
+						for(uint j = 0; j < batchTileCount; ++j)
+							textures[j].Unlock();
+						if(0 != error) {
 							//throw new ApplicationException(string.Format("Error while loading image: code {0}", error));
+
+							// the fallback starts over: the textures of this batch and the tiles already loaded are released
+							for(uint j = 0; j < batchTileCount; ++j)
+								textures[j].Dispose();
+							Dispose();
+							_tiles = null;
 							goto fallBack;
 						}
-						texture.Unlock();
 
-						DXTile tile = new DXTile();
-						_tiles[mipmapLevel + (int) _detailLevel][x, y] = tile;
-						tile.Initialize(_maskFile == null ? D3DTextureFormat.DXT1 : D3DTextureFormat.DXT5, texture);
+						for(uint j = 0; j < batchTileCount; ++j) {
+							DXTile tile = new DXTile();
+							_tiles[mipmapLevels[j] + (int) _detailLevel][xs[j], ys[j]] = tile;
+							tile.Initialize(_maskFile == null ? D3DTextureFormat.DXT1 : D3DTextureFormat.DXT5, textures[j]);
+						}
+						i += batchTileCount;
 
-						yield return (float) (i + 1) / (float) tileCount;
+						yield return (float) i / (float) tileCount;
 					}
 				} finally {
 					ZunTzuLib.FreeImageLoader(imageLoader);
@@ -181,9 +191,202 @@ namespace ZunTzu.Graphics
 			}
 		}
 
-		private static unsafe int loadNextTexture(IntPtr imageLoader, D3DTexture texture, out uint mipmapLevel, out uint x, out uint y) {
+		/// <summary>Loads several natively loadable tile sets with a single native batch loader.</summary>
+		/// <returns>Progress between 0 and 1.</returns>
+		/// <remarks>
+		/// The tiles of all the images come interleaved, as they are compressed straight into locked textures.
+		/// The loader holds textures of the formats of the images (DXT1 if opaque, DXT5 if masked),
+		/// each texture yielded back with a tile is replaced by a new one of the same format.
+		/// A tile set that fails to load is left empty and no longer natively loadable.
+		/// </remarks>
+		internal static IEnumerable<float> LoadBatchIncrementally(IList<DXTileSet> tileSets) {
+			int imageCount = tileSets.Count;
+			string[] archiveNames = new string[imageCount];
+			string[] imageEntryNames = new string[imageCount];
+			string[] maskEntryNames = new string[imageCount];
+			bool hasOpaqueImages = false;
+			bool hasMaskedImages = false;
+			for(int i = 0; i < imageCount; ++i) {
+				archiveNames[i] = tileSets[i]._imageFile.Archive.FileName;
+				imageEntryNames[i] = tileSets[i]._imageFile.FileName;
+				maskEntryNames[i] = (tileSets[i]._maskFile != null ? tileSets[i]._maskFile.FileName : "");
+				if(tileSets[i]._maskFile != null)
+					hasMaskedImages = true;
+				else
+					hasOpaqueImages = true;
+			}
+
+			uint skippedMipMapLevels = 0;
+			IntPtr batchLoader = ZunTzuLib.CreateBatchImageLoader((uint) imageCount, archiveNames, imageEntryNames, maskEntryNames, skippedMipMapLevels, 1);
+			var lockedTextures = new Dictionary<IntPtr, D3DTexture>();	// held by the loader, by address of their bits
+			try {
+				uint[] tileCounts = new uint[imageCount];	// 0 until the first tile of the image
+				uint[] loadedTileCounts = new uint[imageCount];
+
+				uint batchSize = (uint) Math.Max(1, 2 * Environment.ProcessorCount);
+				var destinations = new IntPtr[2 * batchSize];
+				var masked = new int[2 * batchSize];
+				var tiles = new IntPtr[batchSize];
+				var images = new uint[batchSize];
+				var mipmapLevels = new uint[batchSize];	// regardless of detailLevel (i.e. first mipmap is always zero)
+				var xs = new uint[batchSize];
+				var ys = new uint[batchSize];
+
+				// a batch of textures of each format to start with
+				uint destinationCount = 0;
+				for(uint j = 0; j < batchSize; ++j) {
+					if(hasOpaqueImages) {
+						masked[destinationCount] = 0;
+						destinations[destinationCount++] = createNativeDestination(false, lockedTextures);
+					}
+					if(hasMaskedImages) {
+						masked[destinationCount] = 1;
+						destinations[destinationCount++] = createNativeDestination(true, lockedTextures);
+					}
+				}
+
+				uint batchTileCount;
+				while(0 != (batchTileCount = ZunTzuLib.LoadNextBatchTiles(batchLoader, destinations, masked, destinationCount, tiles, batchSize, images, mipmapLevels, xs, ys))) {
+					destinationCount = 0;
+					for(uint j = 0; j < batchTileCount; ++j) {
+						uint image = images[j];
+						DXTileSet tileSet = tileSets[(int) image];
+						if(tileCounts[image] == 0) {
+							uint width, height;
+							ZunTzuLib.GetBatchImageDimensions(batchLoader, image, out width, out height);
+							tileCounts[image] = tileSet.initializeNativeTiles(width, height);
+						}
+						D3DTexture texture = lockedTextures[tiles[j]];
+						lockedTextures.Remove(tiles[j]);
+						texture.Unlock();
+						tileSet.setNativeTile(texture, mipmapLevels[j], xs[j], ys[j]);
+						++loadedTileCounts[image];
+
+						masked[destinationCount] = (tileSet._maskFile != null ? 1 : 0);
+						destinations[destinationCount++] = createNativeDestination(tileSet._maskFile != null, lockedTextures);
+					}
+
+					float progress = 0.0f;
+					for(int i = 0; i < imageCount; ++i) {
+						uint priorityMipMapLevel, left, top, right, bottom;
+						if(tileCounts[i] != 0) {
+							progress += (float) loadedTileCounts[i] / (float) tileCounts[i];
+							if(tileSets[i].getPriorityTiles(out priorityMipMapLevel, out left, out top, out right, out bottom))
+								ZunTzuLib.PrioritizeBatchTiles(batchLoader, (uint) i, priorityMipMapLevel, left, top, right, bottom);
+						}
+					}
+					yield return progress / (float) imageCount;
+				}
+
+				for(int i = 0; i < imageCount; ++i) {
+					uint width, height;
+					if(0 != ZunTzuLib.GetBatchImageDimensions(batchLoader, (uint) i, out width, out height)) {
+						//throw new ApplicationException(string.Format("Error while loading image: code {0}", error));
+						tileSets[i]._nativeLoadingFailed = true;
+						tileSets[i].Dispose();
+						tileSets[i]._tiles = null;
+						tileSets[i]._size = new SizeF(0.0f, 0.0f);
+					}
+				}
+			} finally {
+				// the loader no longer writes into the textures it holds
+				ZunTzuLib.FreeBatchImageLoader(batchLoader);
+				foreach(D3DTexture texture in lockedTextures.Values) {
+					texture.Unlock();
+					texture.Dispose();
+				}
+			}
+		}
+
+		/// <summary>Sizes the tile set for an image decoded by a native loader.</summary>
+		/// <returns>Number of tiles to load.</returns>
+		private uint initializeNativeTiles(uint width, uint height) {
+			int mipMapLevelCount =
+				Math.Max(
+					3,	// at least 3 mip-maps
+					Math.Max(
+						(int) Math.Ceiling(Math.Log(width / 254, 2) + 1),
+						(int) Math.Ceiling(Math.Log(height / 254, 2) + 1)));
+			_tiles = new DXTile[mipMapLevelCount + (int) _detailLevel][,];
+
+			_size = new SizeF((float) width, (float) height);
+			for(int i = (int) _detailLevel; i > 0; --i)
+				_size = new SizeF(_size.Width * 2, _size.Height * 2);
+
+			// same tiles as the native loaders (see ztt_index::init): no row starts on the last scanline
+			uint tileCount = 0;
+			for(int mipMapLevel = (int) _detailLevel; mipMapLevel < mipMapLevelCount + (int) _detailLevel; ++mipMapLevel) {
+				uint columnCount = (width + 253) / 254;
+				uint rowCount = Math.Max(1u, (height + 252) / 254);
+				_tiles[mipMapLevel] = new DXTile[columnCount, rowCount];
+				tileCount += columnCount * rowCount;
+				width = (width + 1) / 2;
+				height = (height + 1) / 2;
+			}
+			return tileCount;
+		}
+
+		/// <summary>Creates and locks a texture for a native batch loader to compress a tile into.</summary>
+		/// <param name="masked">True for the DXT5 tiles of masked images, false for the DXT1 tiles of opaque images.</param>
+		/// <param name="lockedTextures">Textures held by the loader, by address of their bits.</param>
+		private static IntPtr createNativeDestination(bool masked, Dictionary<IntPtr, D3DTexture> lockedTextures) {
+			D3DTexture texture = D3DTexture.Create(256, 256, masked ? D3DTextureFormat.DXT5 : D3DTextureFormat.DXT1);
+			IntPtr bits = lockTexture(texture);
+			lockedTextures.Add(bits, texture);
+			return bits;
+		}
+
+		/// <summary>Creates a tile from a texture a native loader has compressed a tile into.</summary>
+		private void setNativeTile(D3DTexture texture, uint mipMapLevel, uint x, uint y) {
+			DXTile tile = new DXTile();
+			_tiles[mipMapLevel + (int) _detailLevel][x, y] = tile;
+			tile.Initialize(_maskFile == null ? D3DTextureFormat.DXT1 : D3DTextureFormat.DXT5, texture);
+		}
+
+		/// <summary>While loading, the tiles needed to render this area are loaded first, when the image source allows it.</summary>
+		/// <param name="area">Area of the image, in image coordinates.</param>
+		/// <param name="areaWidthInPixels">Width of the area once rendered, to determine the mipmap level needed.</param>
+		/// <remarks>Tile sets precompiled in an archive are read in sequence, they cannot be loaded out of order.</remarks>
+		public void PrioritizeArea(RectangleF area, float areaWidthInPixels) {
+			if(area != _priorityArea || areaWidthInPixels != _priorityAreaWidthInPixels) {
+				_priorityArea = area;
+				_priorityAreaWidthInPixels = areaWidthInPixels;
+				_priorityAreaChanged = true;
+			}
+		}
+
+		/// <summary>Tiles of the priority area for a native loader, if it has changed since the last call.</summary>
+		/// <param name="mipMapLevel">Mipmap level, regardless of detailLevel.</param>
+		/// <returns>False if there is no new priority area.</returns>
+		private bool getPriorityTiles(out uint mipMapLevel, out uint left, out uint top, out uint right, out uint bottom) {
+			mipMapLevel = left = top = right = bottom = 0;
+			if(!_priorityAreaChanged)
+				return false;
+			_priorityAreaChanged = false;
+			if(_priorityArea.Width <= 0.0f || _priorityArea.Height <= 0.0f || _priorityAreaWidthInPixels <= 0.0f)
+				return false;
+
+			// same mipmap level as DXTexturedImage.Render
+			int level = 0;
+			float mipMapFactor = _priorityAreaWidthInPixels / _priorityArea.Width;
+			while(level < (int) _detailLevel || (mipMapFactor <= 0.5f && level < _tiles.Length - 1)) {
+				++level;
+				mipMapFactor *= 2.0f;
+			}
+
+			// native coordinates are texels of the first mipmap level, regardless of detailLevel
+			float scale = (float) (1 << (int) _detailLevel);
+			mipMapLevel = (uint) (level - (int) _detailLevel);
+			left = (uint) Math.Max(0.0f, Math.Floor(_priorityArea.Left / scale));
+			top = (uint) Math.Max(0.0f, Math.Floor(_priorityArea.Top / scale));
+			right = (uint) Math.Max(0.0f, Math.Ceiling(Math.Min(_size.Width, _priorityArea.Right) / scale));
+			bottom = (uint) Math.Max(0.0f, Math.Ceiling(Math.Min(_size.Height, _priorityArea.Bottom) / scale));
+			return true;
+		}
+
+		private static unsafe IntPtr lockTexture(D3DTexture texture) {
 			texture.Lock(out _, out byte* textureBits);
-			return ZunTzuLib.LoadNextTile(imageLoader, (IntPtr) textureBits, out mipmapLevel, out x, out y);
+			return (IntPtr) textureBits;
 		}
 
 		private IEnumerable<float> createMipMappedTilesIncrements(BitmapResource image) {
@@ -445,10 +648,29 @@ namespace ZunTzu.Graphics
 		}
 
 		public void Dispose() {
-			foreach(DXTile[,] tileArray in _tiles)
-				if(tileArray != null)
-					foreach(DXTile tile in tileArray)
-						tile.Dispose();
+			if(_tiles != null)
+				foreach(DXTile[,] tileArray in _tiles)
+					if(tileArray != null)
+						foreach(DXTile tile in tileArray)
+							if(tile != null)
+								tile.Dispose();
+		}
+
+		/// <summary>Returns a tile, or the nearest coarser tile covering it while the tile set is loading.</summary>
+		/// <param name="mipMapLevel">Mipmap level of the tile, updated with the mipmap level of the tile returned.</param>
+		/// <returns>Null if no tile covering it is loaded yet.</returns>
+		internal DXTile GetLoadedTile(ref int mipMapLevel, int x, int y) {
+			for(int level = mipMapLevel; level < _tiles.Length; ++level) {
+				DXTile[,] tiles = _tiles[level];
+				if(tiles != null && x < tiles.GetLength(0) && y < tiles.GetLength(1) && tiles[x, y] != null) {
+					mipMapLevel = level;
+					return tiles[x, y];
+				}
+				// tiles of a coarser level cover twice as many texels
+				x /= 2;
+				y /= 2;
+			}
+			return null;
 		}
 
 		public SizeF Size => _size;
@@ -463,5 +685,9 @@ namespace ZunTzu.Graphics
 		DetailLevelType _detailLevel;
 		DXTile[][,] _tiles;
 		SizeF _size = new SizeF(0.0f, 0.0f);
+		RectangleF _priorityArea = RectangleF.Empty;
+		float _priorityAreaWidthInPixels = 0.0f;
+		bool _priorityAreaChanged = false;
+		bool _nativeLoadingFailed = false;
 	}
 }
@@ -77,6 +77,11 @@ namespace ZunTzu.Graphics {
 		/// <param name="detailLevel">Resolution at which the image and the mask was scanned.</param>
 		/// <returns>A tile set.</returns>
 		ITileSet LoadTileSet(IFile imageFile, IFile maskFile, DetailLevelType detailLevel);
+		/// <summary>Loads several tile sets together, as LoadIncrementally would one after the other.</summary>
+		/// <param name="tileSets">Tile sets returned by LoadTileSet, the first ones are loaded first.</param>
+		/// <returns>Progress between 0 and 1.</returns>
+		/// <remarks>Must be called in a loop for the tile sets to be fully loaded.</remarks>
+		IEnumerable<float> LoadTileSetsIncrementally(IList<ITileSet> tileSets);
 		/// <summary>Loads a textured 3D model.</summary>
 		/// <param name="vertice">Geometry data.</param>
 		/// <param name="triangles">Geometry data.</param>
@@ -137,6 +142,10 @@ namespace ZunTzu.Graphics {
 		/// <summary>Must be called in a loop for the tile set to be fully loaded.</summary>
 		/// <returns>Progress between 0 and 1.</returns>
 		IEnumerable<float> LoadIncrementally();
+		/// <summary>While loading, the tiles needed to render this area are loaded first, when the image source allows it.</summary>
+		/// <param name="area">Area of the image, in image coordinates.</param>
+		/// <param name="areaWidthInPixels">Width of the area once rendered, to determine the mipmap level needed.</param>
+		void PrioritizeArea(RectangleF area, float areaWidthInPixels);
 		SizeF Size { get; }
 		IImage ExtractImage(RectangleF imageLocation);
 		IImage ExtractImage(RectangleF imageLocation, RectangleF renderingPositionAndSize);
@@ -176,6 +185,11 @@ namespace ZunTzu.Graphics {
 		/// <returns>A color in A8R8G8B8 format.</returns>
 		uint GetColorAtPosition(PointF position);
 
+		/// <summary>Returns the alpha of the texel at the given position, for hit-testing.</summary>
+		/// <param name="position">Position in model coordinates relative to the center of this image.</param>
+		/// <returns>An alpha value, 0 if transparent.</returns>
+		byte GetAlphaAtPosition(PointF position);
+
 		/// <summary>Renders a block with this image as a sticker at the given position and size.</summary>
 		/// <param name="blockPositionAndSize">Position of the block when lying down, in model coordinates relative to the center of this image.</param>
 		/// <param name="thickness">Thickness of the block, in model coordinates.</param>
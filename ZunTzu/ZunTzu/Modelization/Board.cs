@@ -142,8 +142,7 @@ namespace ZunTzu.Modelization {
 											size.Height).Contains(transformedPosition)) {
 											// is the piece completely transparent at that location?
 											if(piece.Graphics != null) {
-												uint color = piece.Graphics.GetColorAtPosition(transformedPosition);
-												if((color & 0xFF000000) != 0x00000000) {
+												if(piece.Graphics.GetAlphaAtPosition(transformedPosition) != 0x00) {
 													// no it is not
 													if(!stack.Unfolded && piece is ICard)
 														return pieces[pieces.Length - 1];
@@ -209,8 +208,7 @@ namespace ZunTzu.Modelization {
 									size.Height).Contains(transformedPosition)) {
 									// is the piece completely transparent at that location?
 									if(piece.Graphics != null) {
-										uint color = piece.Graphics.GetColorAtPosition(transformedPosition);
-										if((color & 0xFF000000) != 0x00000000) {
+										if(piece.Graphics.GetAlphaAtPosition(transformedPosition) != 0x00) {
 											// no it is not
 											return piece;
 										}
@@ -743,7 +743,11 @@ namespace ZunTzu.Modelization {
 							// scenario file
 							errors.AddRange(verifyBuiltInScenario(archive, filename, gameBoxName, boardDoubleSidedness));
 						} else if(filename != "game-box.xml") {
-							if(!referencedFiles.ContainsKey(filename))
+							// precompiled tile sets (see ZunTzuLib.CompileTileSet) are named after their image
+							bool isTileSetOfReferencedImage =
+								filename.EndsWith(".ztt", StringComparison.OrdinalIgnoreCase) &&
+								referencedFiles.ContainsKey(filename.Substring(0, filename.Length - 4));
+							if(!referencedFiles.ContainsKey(filename) && !isTileSetOfReferencedImage)
 								errors.Add(WarningCode + filename + Resources.GameBoxError30);
 
 							if(filename.EndsWith(".jpg", StringComparison.OrdinalIgnoreCase)) {
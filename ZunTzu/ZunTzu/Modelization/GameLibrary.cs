@@ -108,6 +108,9 @@ namespace ZunTzu.Modelization {
 
 		/// <summary>Constructor.</summary>
 		internal GameLibrary() {
+			// compressed tiles are cached next to the library
+			ZunTzuLib.SetTileCacheDirectory(tileCacheDirectoryName);
+
 			if(File.Exists(libraryFileName)) {
 				XmlDocument xml = new XmlDocument();
 				using(Stream stream = File.OpenRead(libraryFileName)) {
@@ -165,6 +168,16 @@ namespace ZunTzu.Modelization {
 			}
 		}
 
+		private static string tileCacheDirectoryName {
+			get {
+				return Path.Combine(
+					(ApplicationDeployment.IsNetworkDeployed ?
+						ApplicationDeployment.CurrentDeployment.DataDirectory :
+						System.Windows.Forms.Application.StartupPath),
+					"TileCache");
+			}
+		}
+
 		private void updateLibraryFile() {
 			string temporaryFileName = Path.GetTempFileName();
 			using(Stream stream = File.Open(temporaryFileName, FileMode.Create, FileAccess.Write)) {
@@ -37,15 +37,15 @@ namespace ZunTzu.Visualization {
 							if(middleBoundingBox.Contains(position)) {
 								return item;
 							} else if(leftExtremityBoundingBox.Contains(position)) {
-								uint color = buttonImageElements[0].GetColorAtPosition(
+								byte alpha = buttonImageElements[0].GetAlphaAtPosition(
 									new PointF((position.X - leftExtremityBoundingBox.X - 9.0f) * 4.0f,
 									(position.Y - leftExtremityBoundingBox.Y - 14.0f) * 4.0f));
-								return ((color & 0xFF000000) != 0x00000000 ? item : null);
+								return (alpha != 0x00 ? item : null);
 							} else if(rightExtremityBoundingBox.Contains(position)) {
-								uint color = buttonImageElements[1].GetColorAtPosition(
+								byte alpha = buttonImageElements[1].GetAlphaAtPosition(
 									new PointF((position.X - rightExtremityBoundingBox.X - 9.0f) * 4.0f,
 									(position.Y - rightExtremityBoundingBox.Y - 14.0f) * 4.0f));
-								return ((color & 0xFF000000) != 0x00000000 ? item : null);
+								return (alpha != 0x00 ? item : null);
 							}
 						}
 						buttonLocation.Y += 32.0f;
@@ -53,10 +53,10 @@ namespace ZunTzu.Visualization {
 				} else {
 					RectangleF iconBoundingBox = new RectangleF(area.Right - 18.0f, area.Y + 7.0f, 13.0f, 11.0f);
 					if(iconBoundingBox.Contains(position)) {
-						uint color = buttonImageElements[4].GetColorAtPosition(
+						byte alpha = buttonImageElements[4].GetAlphaAtPosition(
 							new PointF((position.X - iconBoundingBox.X - 6.5f) * 4.0f,
 							(position.Y - iconBoundingBox.Y - 5.5f) * 4.0f));
-						return ((color & 0xFF000000) != 0x00000000 ? showMenuSwitch : null);
+						return (alpha != 0x00 ? showMenuSwitch : null);
 					}
 				}
 			}
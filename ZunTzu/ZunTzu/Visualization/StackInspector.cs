@@ -272,8 +272,7 @@ namespace ZunTzu.Visualization {
 							size.Height).Contains(transformedPosition))
 						{
 							// is the piece completely transparent at that location?
-							uint color = piece.Graphics.GetColorAtPosition(transformedPosition);
-							if((color & 0xFF000000) != 0x00000000) {
+							if(piece.Graphics.GetAlphaAtPosition(transformedPosition) != 0x00) {
 								// no it is not
 								return piece;
 							}
@@ -231,6 +231,7 @@ namespace ZunTzu.Visualization {
 
 			// invalidate cached background image
 			cachedBackgroundBoard = null;
+			loadingPreviewTileSet = null;
 
 			// load cursor and other icons
 			IFile iconsImageFile = FileSystem.FileSystem.GetResource("ZunTzu.ResourceFiles.Icons.png");
@@ -433,6 +434,7 @@ namespace ZunTzu.Visualization {
 						loadingGraphics = false;
 						loadingGraphicsProgress.Dispose();
 						loadingGraphicsProgress = null;
+						loadingPreviewTileSet = null;
 						break;
 					}
 				} while(timer.NowInMicroseconds - start < 100000L);
@@ -447,8 +449,9 @@ namespace ZunTzu.Visualization {
 			if(graphics.BeginFrame(currentTimeInMicroseconds)) {
 				if(loadingGraphics) {
 					// render blank screen "Loading graphics..."
-					// black background
-					graphics.MonochromaticImage.Render(gameDisplayArea, 0xFF000000);
+					// black background, or the visible board as far as it is loaded
+					if(!renderLoadingPreview())
+						graphics.MonochromaticImage.Render(gameDisplayArea, 0xFF000000);
 
 					// text
 					graphics.DrawText(
@@ -1094,64 +1097,118 @@ namespace ZunTzu.Visualization {
 					stackInspectorArea.Y + 0.5f * stackInspectorArea.Height));
 		}
 
+		/// <summary>Renders the tiles of the visible board loaded so far, coarser mipmap levels standing in for the missing tiles.</summary>
+		/// <returns>False if there is nothing to render yet.</returns>
+		private bool renderLoadingPreview() {
+			if(loadingPreviewTileSet == null || loadingPreviewTileSet.Size.IsEmpty)
+				return false;
+
+			// same area as displayed once loaded
+			RectangleF visibleArea = model.CurrentGameBox.CurrentGame.VisibleBoard.VisibleArea;
+			if(visibleArea.IsEmpty)
+				visibleArea = new RectangleF(0.0f, 0.0f, loadingPreviewTileSet.Size.Width, 0.0f);
+			visibleArea.Height = visibleArea.Width * gameDisplayArea.Height / gameDisplayArea.Width;
+
+			// the tiles needed for this frame are loaded first
+			loadingPreviewTileSet.PrioritizeArea(visibleArea, gameDisplayArea.Width);
+			loadingPreviewTileSet.ExtractImage(visibleArea, gameDisplayArea).RenderIgnoreMask(gameDisplayArea);
+			return true;
+		}
+
 		private void onDialogClosed(object sender, EventArgs e) {
 			currentDialog.Closed -= new EventHandler(onDialogClosed);
 			currentDialog = null;
 		}
 
 		private IEnumerable<float> loadGraphicsIncrements() {
+			// if ZUNTZU_LOADER_TRACE names a file, the image loaders are traced to it (Chrome trace event format)
+			string traceFileName = Environment.GetEnvironmentVariable("ZUNTZU_LOADER_TRACE");
+			if(!string.IsNullOrEmpty(traceFileName)) {
+				ZunTzuLib.ResetLoaderStats();
+				ZunTzuLib.SetLoaderTracing(2);
+			}
+
+			// the game box archive is mapped once for all its images
+			IntPtr sharedArchive = ZunTzuLib.OpenArchive(model.CurrentGameBox.Reference.FileName);
+			try {
+				foreach(float progress in loadBoxGraphicsIncrements())
+					yield return progress;
+			} finally {
+				ZunTzuLib.CloseArchive(sharedArchive);
+				if(!string.IsNullOrEmpty(traceFileName)) {
+					ZunTzuLib.SetLoaderTracing(0);
+					ZunTzuLib.DumpLoaderTrace(traceFileName);
+				}
+			}
+		}
+
+		private IEnumerable<float> loadBoxGraphicsIncrements() {
 			IGameBox gameBox = model.CurrentGameBox;
 			IArchive archive = new Archive(gameBox.Reference.FileName);
 			IGame game = gameBox.CurrentGame;
 
-			int currentProgress = 0;
 			yield return 0.0f;
 
-			// determine total graphics data size
-			int totalGraphicsDataSize = 0;
-			foreach(IBoard board in game.Boards) {
+			// the visible board is loaded first, so that it can be previewed while loading
+			IBoard visibleBoard = game.VisibleBoard;
+			bool visibleBoardIsHidden = (visibleBoard.Owner != Guid.Empty && visibleBoard.Owner != model.ThisPlayer.Guid);
+			List<IBoard> boards = new List<IBoard>(game.Boards);
+			if(boards.Remove(visibleBoard))
+				boards.Insert(0, visibleBoard);
+
+			// create the tile sets of all the boards, in loading order
+			List<ITileSet> tileSets = new List<ITileSet>();
+			foreach(IBoard board in boards) {
 				if(board is IMap) {
-					// load the image for this map
+					// the image for this map
 					IMap map = (IMap) board;
 					if(map.Properties != null) {
 						IFile imageFile = archive.GetFile(map.Properties.ImageFileName);
-						totalGraphicsDataSize += imageFile.SizeInBytes;
+						map.BackgroundGraphics = graphics.LoadTileSet(imageFile, (DetailLevelType) map.Properties.ImageResolution);
+						tileSets.Add(map.BackgroundGraphics);
+						if(board == visibleBoard && !visibleBoardIsHidden)
+							loadingPreviewTileSet = map.BackgroundGraphics;
 					}
 				} else {
-					// load the whole images for this counter sheet (both sides)
+					// the whole images for this counter sheet (both sides)
 					ICounterSheet counterSheet = (ICounterSheet) board;
 					IFile frontImageFile = archive.GetFile(counterSheet.Properties.FrontImageFileName);
-					totalGraphicsDataSize += frontImageFile.SizeInBytes;
 					if(counterSheet.Properties.FrontMaskFileName != null) {
 						IFile frontMaskFile = archive.GetFile(counterSheet.Properties.FrontMaskFileName);
-						totalGraphicsDataSize += frontMaskFile.SizeInBytes;
+						counterSheet.FrontGraphics = graphics.LoadTileSet(frontImageFile, frontMaskFile, (DetailLevelType)counterSheet.Properties.FrontImageResolution);
+					} else {
+						counterSheet.FrontGraphics = graphics.LoadTileSet(frontImageFile, (DetailLevelType)counterSheet.Properties.FrontImageResolution);
 					}
+					tileSets.Add(counterSheet.FrontGraphics);
+					if(board == visibleBoard && !visibleBoardIsHidden && counterSheet.Side == Side.Front)
+						loadingPreviewTileSet = counterSheet.FrontGraphics;
+
 					if(counterSheet.Properties.BackImageFileName != null) {
 						IFile backImageFile = archive.GetFile(counterSheet.Properties.BackImageFileName);
-						totalGraphicsDataSize += backImageFile.SizeInBytes;
 						if(counterSheet.Properties.BackMaskFileName != null) {
 							IFile backMaskFile = archive.GetFile(counterSheet.Properties.BackMaskFileName);
-							totalGraphicsDataSize += backMaskFile.SizeInBytes;
+							counterSheet.BackGraphics = graphics.LoadTileSet(backImageFile, backMaskFile, (DetailLevelType)counterSheet.Properties.BackImageResolution);
+						} else {
+							counterSheet.BackGraphics = graphics.LoadTileSet(backImageFile, (DetailLevelType)counterSheet.Properties.BackImageResolution);
 						}
+						tileSets.Add(counterSheet.BackGraphics);
+						if(board == visibleBoard && !visibleBoardIsHidden && counterSheet.Side == Side.Back)
+							loadingPreviewTileSet = counterSheet.BackGraphics;
+					} else {
+						counterSheet.BackGraphics = null;
 					}
 				}
 			}
 
-			// load map graphics
-			foreach(IBoard board in game.Boards) {
+			// load them all together (many small counter sheets keep all the cores busy)
+			foreach(float progress in graphics.LoadTileSetsIncrementally(tileSets))
+				yield return progress;
+
+			foreach(IBoard board in boards) {
 				RectangleF visibleArea = board.VisibleArea;
 
 				if(board is IMap) {
-					// load the image for this map
 					IMap map = (IMap) board;
-					if(map.Properties != null) {
-						IFile imageFile = archive.GetFile(map.Properties.ImageFileName);
-						int nextProgressIncrement = imageFile.SizeInBytes;
-						map.BackgroundGraphics = graphics.LoadTileSet(imageFile, (DetailLevelType) map.Properties.ImageResolution);
-						foreach(float progress in map.BackgroundGraphics.LoadIncrementally())
-							yield return (currentProgress + progress * nextProgressIncrement) / (float) totalGraphicsDataSize;
-						currentProgress += nextProgressIncrement;
-					}
 
 					// by default, display the whole area at startup
 					if(visibleArea.IsEmpty)
@@ -1159,37 +1216,7 @@ namespace ZunTzu.Visualization {
 							new RectangleF(0.0f, 0.0f, map.BackgroundGraphics.Size.Width, 0.0f) :
 							new RectangleF(0.0f, 0.0f, 1600.0f, 0.0f);
 				} else {
-					// load the whole images for this counter sheet (both sides)
 					ICounterSheet counterSheet = (ICounterSheet) board;
-					IFile frontImageFile = archive.GetFile(counterSheet.Properties.FrontImageFileName);
-					int nextProgressIncrement = frontImageFile.SizeInBytes;
-					if(counterSheet.Properties.FrontMaskFileName != null) {
-						IFile frontMaskFile = archive.GetFile(counterSheet.Properties.FrontMaskFileName);
-						nextProgressIncrement += frontMaskFile.SizeInBytes;
-						counterSheet.FrontGraphics = graphics.LoadTileSet(frontImageFile, frontMaskFile, (DetailLevelType)counterSheet.Properties.FrontImageResolution);
-					} else {
-						counterSheet.FrontGraphics = graphics.LoadTileSet(frontImageFile, (DetailLevelType)counterSheet.Properties.FrontImageResolution);
-					}
-					foreach(float progress in counterSheet.FrontGraphics.LoadIncrementally())
-						yield return (currentProgress + progress * nextProgressIncrement) / (float)totalGraphicsDataSize;
-					currentProgress += nextProgressIncrement;
-
-					if(counterSheet.Properties.BackImageFileName != null) {
-						IFile backImageFile = archive.GetFile(counterSheet.Properties.BackImageFileName);
-						nextProgressIncrement = backImageFile.SizeInBytes;
-						if(counterSheet.Properties.BackMaskFileName != null) {
-							IFile backMaskFile = archive.GetFile(counterSheet.Properties.BackMaskFileName);
-							nextProgressIncrement += backMaskFile.SizeInBytes;
-							counterSheet.BackGraphics = graphics.LoadTileSet(backImageFile, backMaskFile, (DetailLevelType)counterSheet.Properties.BackImageResolution);
-						} else {
-							counterSheet.BackGraphics = graphics.LoadTileSet(backImageFile, (DetailLevelType)counterSheet.Properties.BackImageResolution);
-						}
-						foreach(float progress in counterSheet.BackGraphics.LoadIncrementally())
-							yield return (currentProgress + progress * nextProgressIncrement) / (float)totalGraphicsDataSize;
-						currentProgress += nextProgressIncrement;
-					} else {
-						counterSheet.BackGraphics = null;
-					}
 
 					// by default, display the whole area at startup
 					if(visibleArea.IsEmpty)
@@ -1300,6 +1327,7 @@ namespace ZunTzu.Visualization {
 		private ViewElement[] viewElements;
 		private bool loadingGraphics = false;
 		private IEnumerator<float> loadingGraphicsProgress = null;
+		private ITileSet loadingPreviewTileSet = null;	// visible board while loading
 		private long previousFrameTimeInMicroseconds = 0;
 		private List<IStack> foldedStackList = new List<IStack>();
 		private List<IStack> unfoldedStackList = new List<IStack>();
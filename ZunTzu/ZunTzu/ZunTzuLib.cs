@@ -43,6 +43,33 @@ namespace ZunTzu {
 			[In] byte* blocks,
 			[In] int option);
 
+		// Raw DXT decompression services (width x height blocks, row after row, to A8R8G8B8 texels)
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void DecodeDxt1Blocks(
+			[In] byte* blocks,
+			[In] int width,
+			[In] int height,
+			[In] byte* texels,
+			[In] int stride);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void DecodeDxt5Blocks(
+			[In] byte* blocks,
+			[In] int width,
+			[In] int height,
+			[In] byte* texels,
+			[In] int stride);
+
+		// SIMD path of the DXT compression services (-1: widest supported, 0: SSE2, 1: AVX2, 2: AVX-512)
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern int SetDxtKernelPath(
+			[In] int path);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern int GetDxtKernelPath();
+
 		// Image loading and compression services
 
 		[DllImport("ZunTzuLib.dll")]
@@ -67,10 +94,117 @@ namespace ZunTzu {
 			[Out] out uint x,
 			[Out] out uint y);
 
+		[DllImport("ZunTzuLib.dll")]
+		public static extern int LoadNextTiles(
+			IntPtr imageLoader,
+			[In] IntPtr[] tiles,
+			uint tileCount,
+			[Out] uint[] mipmapLevels,
+			[Out] uint[] xs,
+			[Out] uint[] ys);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void PrioritizeTiles(
+			IntPtr imageLoader,
+			uint mipmapLevel,
+			uint left,
+			uint top,
+			uint right,
+			uint bottom);
+
 		[DllImport("ZunTzuLib.dll")]
 		public static extern void FreeImageLoader(
 			IntPtr imageLoader);
 
+		[DllImport("ZunTzuLib.dll")]
+		public static extern IntPtr OpenArchive(
+			[MarshalAs(UnmanagedType.LPWStr)] string archiveName);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void CloseArchive(
+			IntPtr archive);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void SetTileCacheDirectory(
+			[MarshalAs(UnmanagedType.LPWStr)] string directoryName);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern int CompileTileSet(
+			[MarshalAs(UnmanagedType.LPWStr)] string archiveName,
+			[MarshalAs(UnmanagedType.LPStr)] string imageEntryName,
+			[MarshalAs(UnmanagedType.LPStr)] string maskEntryName,
+			[MarshalAs(UnmanagedType.LPWStr)] string tileSetFileName);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern IntPtr CreateBatchImageLoader(
+			uint imageCount,
+			[In, MarshalAs(UnmanagedType.LPArray, ArraySubType = UnmanagedType.LPWStr)] string[] archiveNames,
+			[In, MarshalAs(UnmanagedType.LPArray, ArraySubType = UnmanagedType.LPStr)] string[] imageEntryNames,
+			[In, MarshalAs(UnmanagedType.LPArray, ArraySubType = UnmanagedType.LPStr)] string[] maskEntryNames,
+			uint skippedMipmapLevels,
+			int option);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern int GetBatchImageDimensions(
+			IntPtr batchLoader,
+			uint image,
+			[Out] out uint width,
+			[Out] out uint height);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern uint LoadNextBatchTiles(
+			IntPtr batchLoader,
+			[In] IntPtr[] destinations,
+			[In] int[] masked,
+			uint destinationCount,
+			[Out] IntPtr[] tiles,
+			uint tileCount,
+			[Out] uint[] images,
+			[Out] uint[] mipmapLevels,
+			[Out] uint[] xs,
+			[Out] uint[] ys);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void PrioritizeBatchTiles(
+			IntPtr batchLoader,
+			uint image,
+			uint mipmapLevel,
+			uint left,
+			uint top,
+			uint right,
+			uint bottom);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void FreeBatchImageLoader(
+			IntPtr batchLoader);
+
+		// Image loading probes
+
+		/// <summary>Counters of the image loading probes, same layout as loader_stats in ZunTzuLib.</summary>
+		/// <remarks>Probes: write slot wait, read slot wait, tile compression, scanline decoding, inflating.</remarks>
+		[StructLayout(LayoutKind.Sequential)]
+		public struct LoaderStats {
+			public fixed ulong Counts[5];
+			public fixed ulong Nanoseconds[5];
+			public ulong TraceEventCount;
+			public ulong DroppedTraceEventCount;
+		}
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void SetLoaderTracing(
+			int mode);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void GetLoaderStats(
+			out LoaderStats stats);
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern void ResetLoaderStats();
+
+		[DllImport("ZunTzuLib.dll")]
+		public static extern int DumpLoaderTrace(
+			[MarshalAs(UnmanagedType.LPWStr)] string fileName);
+
 		// Networking
 
 		[DllImport("ZunTzuLib.dll")]
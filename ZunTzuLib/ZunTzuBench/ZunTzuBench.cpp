@@ -0,0 +1,453 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// Headless benchmark of the image loading pipeline, built from the sources of ZunTzuLib.
+//
+//   ZunTzuBench [-threads n] [-kernel auto|sse2|avx2|avx512] [-options n] [-skip n] [-batch n] [-repeat n]
+//               [-trace trace.json] archive.zip image_entry [mask_entry]
+//
+// The pipeline is run stage after stage, each run adding a stage to the previous one:
+//   unzip     the image (and mask) entries are read
+//   decode    their scanlines are decoded
+//   mipmap    the mipmaps are built and cut into tiles, tiles are drained uncompressed
+//   compress  the whole loader (CreateImageLoader and LoadNextTiles), as used by ZunTzu
+// The time of a stage is the time of its run minus the time of the previous run (best of the repetitions).
+// The handoff figures are the waits of the consumer in LoadNextTiles during the last run.
+// The compression of a single tile is timed apart, and the PSNR of its colors is measured once decoded
+// (-options: 0 favors speed, 1 quality, 5 quality with a cluster fit, as CompileTileSet, 8 BC7 tiles for a masked image).
+// Results are written to the standard output as JSON.
+// With -trace, the probes of the loaders (see loader_trace.h) are added to the results, summed over all
+// the runs, and their events are written to a file that chrome://tracing or Perfetto can open.
+
+#include "stdafx.h"
+#include <chrono>
+#include <math.h>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <locale.h>
+#include <string>
+#endif
+#include "ZunTzuLib.h"
+#include "image_loader_error.h"
+#include "unzipper.h"
+#include "image_reader.h"
+#include "tile_layer.h"
+#include "synchronized_tile_buffer.h"
+#include "ztt_file.h"
+#include "loader_trace.h"
+
+static const size_t UNZIPPING_READ_SIZE = 64 * 1024;
+static const int COMPRESSED_TILE_SAMPLE_COUNT = 64;	// compressions of a single tile, to time the kernels
+
+struct settings {
+	const wchar_t * archive_name;
+	const char * image_entry_name;
+	const char * mask_entry_name;	// 0 if none
+	int thread_count;	// 0 for all cores
+	int kernel_path;	// -1: auto
+	int options;
+	unsigned int skipped_mipmap_levels;
+	unsigned int batch_size;	// 0 for 2 tiles per thread, as ZunTzu does
+	int repetitions;
+	const wchar_t * trace_file_name;	// 0 if not traced
+};
+
+struct stage_results {
+	double unzip_seconds;
+	unsigned long long unzipped_bytes;
+	double decode_seconds;
+	unsigned long long decoded_bytes;
+	double mipmap_seconds;
+	double compress_seconds;
+	double tile_compression_seconds;	// of a single tile on a single thread
+	double tile_psnr;	// of the colors of that tile, in dB
+	double first_tiles_seconds;
+	double max_wait_seconds;
+	double mean_wait_seconds;
+	unsigned int batch_count;
+};
+
+static double get_time() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool is_png(const char * entry_name) {
+	size_t entry_name_length = strlen(entry_name);
+	return entry_name_length >= 4 && (0 == _strnicmp(".png", entry_name + (entry_name_length - 4), 4));
+}
+
+static bool has_mask(const settings & s) {
+	return s.mask_entry_name != 0 && strlen(s.mask_entry_name) > 0;
+}
+
+static bool has_bc7_tiles(const settings & s) {
+	return has_mask(s) && (s.options & 8) != 0;	// as CreateImageLoader
+}
+
+// reads a whole entry, returns the number of bytes read
+static error_code unzip_entry(const wchar_t * archive_name, const char * entry_name, unsigned long long & size) {
+	simple_unzipper unzipper(archive_name, entry_name);
+	std::vector<char> buffer(UNZIPPING_READ_SIZE);
+	jmp_buf error_handler;
+	int error = setjmp(error_handler);
+	if(error != 0)
+		return error;
+	unzipper.set_error_handler(error_handler);
+
+	size = 0;
+	while(true) {
+		size_t bytes_read = 0;
+		if(unzipper.read_in_place(UNZIPPING_READ_SIZE, bytes_read) == 0)
+			bytes_read = unzipper.read(buffer.data(), UNZIPPING_READ_SIZE);
+		if(bytes_read == 0)
+			return 0;
+		size += bytes_read;
+	}
+}
+
+// decodes all the scanlines of an image, returns the number of bytes decoded
+static error_code decode_image(const wchar_t * archive_name, const char * entry_name, unsigned long long & size) {
+	image_reader * reader = (is_png(entry_name) ?
+		static_cast<image_reader*>(new png_reader(archive_name, entry_name)) :
+		static_cast<image_reader*>(new jpeg_reader(archive_name, entry_name)));
+	jmp_buf error_handler;
+	int error = setjmp(error_handler);
+	if(error != 0) {
+		delete reader;
+		return error;
+	}
+	reader->set_error_handler(error_handler);
+
+	unsigned int width, height;
+	reader->get_image_dimensions(width, height);
+	for(unsigned int y = 0; y < height; ++y)
+		reader->read_line();
+	delete reader;
+	size = (unsigned long long) width * height * 3;
+	return 0;
+}
+
+// builds all the tiles without compressing them, the last one is copied to sample_tile
+static error_code build_tiles(const settings & s, unsigned int & tile_count, std::vector<char> & sample_tile) {
+	tile_layer * tyler = (has_mask(s) ?
+		static_cast<tile_layer*>(new masked_tile_layer(s.archive_name, s.image_entry_name, s.mask_entry_name, s.skipped_mipmap_levels)) :
+		static_cast<tile_layer*>(new simple_tile_layer(s.archive_name, s.image_entry_name, s.skipped_mipmap_levels)));
+	unsigned int width, height;
+	error_code error = tyler->get_image_dimensions(width, height);
+	if(error != 0) {
+		delete tyler;
+		return error;
+	}
+	ztt_index index;
+	index.init(width, height, s.skipped_mipmap_levels, has_mask(s), s.options, 0);
+	tile_count = index.header.tile_count;
+
+	const size_t tile_size = 256 * 256 * (has_mask(s) ? 4 : 3);
+	synchronized_tile_buffer tile_buffer(1 + 2 * max(1, GetProcessorCoreCount()), tile_size);
+	std::thread image_loading_thread([&] { tyler->get_all_tiles(&tile_buffer); });
+	for(unsigned int i = 0; error == 0 && i < tile_count; ++i) {
+		unsigned int slot_index = 0;
+		error = tile_buffer.allocate_read_slot(slot_index);
+		if(error == 0) {
+			if(i + 1 == tile_count)
+				sample_tile.assign(tile_buffer.get_slot(slot_index)->texels, tile_buffer.get_slot(slot_index)->texels + tile_size);
+			tile_buffer.free_read_slot(slot_index);
+		}
+	}
+	if(error != 0)
+		tile_buffer.stop_producer();
+	image_loading_thread.join();
+	delete tyler;
+	return error;
+}
+
+// runs the whole loader, as ZunTzu does
+static error_code load_tiles(const settings & s, unsigned int & tile_count, stage_results & results) {
+	const double start = get_time();
+	void * loader = CreateImageLoader(s.archive_name, s.image_entry_name, s.mask_entry_name, s.skipped_mipmap_levels, s.options);
+	unsigned int width, height;
+	error_code error = GetImageDimensions(loader, &width, &height);
+	if(error != 0) {
+		FreeImageLoader(loader);
+		return error;
+	}
+	ztt_index index;
+	index.init(width, height, s.skipped_mipmap_levels, has_mask(s), s.options, 0);
+	tile_count = index.header.tile_count;
+
+	const unsigned int batch_size = (s.batch_size > 0 ? s.batch_size : 2 * max(1, GetProcessorCoreCount()));
+	std::vector<char> tiles((size_t) batch_size * index.header.tile_size);
+	std::vector<char*> tile_data(batch_size);
+	for(unsigned int i = 0; i < batch_size; ++i)
+		tile_data[i] = &tiles[(size_t) i * index.header.tile_size];
+	std::vector<unsigned int> mipmap_levels(batch_size), xs(batch_size), ys(batch_size);
+
+	results.max_wait_seconds = 0.0;
+	results.batch_count = 0;
+	double total_wait_seconds = 0.0;
+	for(unsigned int i = 0; error == 0 && i < tile_count; i += batch_size) {
+		const double batch_start = get_time();
+		error = LoadNextTiles(loader, tile_data.data(), min(batch_size, tile_count - i), mipmap_levels.data(), xs.data(), ys.data());
+		const double wait_seconds = get_time() - batch_start;
+		if(i == 0)
+			results.first_tiles_seconds = get_time() - start;
+		results.max_wait_seconds = max(results.max_wait_seconds, wait_seconds);
+		total_wait_seconds += wait_seconds;
+		++results.batch_count;
+	}
+	results.mean_wait_seconds = (results.batch_count > 0 ? total_wait_seconds / results.batch_count : 0.0);
+	FreeImageLoader(loader);
+	return error;
+}
+
+// peak signal-to-noise ratio of the colors of a compressed tile, 100 dB if lossless
+static double get_psnr(const settings & s, const std::vector<char> & tile, const std::vector<char> & blocks) {
+	const int texel_size = (has_mask(s) ? 4 : 3);
+	std::vector<char> decoded(256 * 256 * 4);
+	if(has_bc7_tiles(s))
+		DecompressBc7(blocks.data(), decoded.data(), 256 * 4);
+	else if(has_mask(s))
+		DecodeDxt5Blocks(blocks.data(), 64, 64, decoded.data(), 256 * 4);
+	else
+		DecodeDxt1Blocks(blocks.data(), 64, 64, decoded.data(), 256 * 4);
+	double squared_error = 0.0;
+	for(int i = 0; i < 256 * 256; ++i) {
+		for(int c = 0; c < 3; ++c) {
+			const int difference = (unsigned char) tile[texel_size * i + c] - (unsigned char) decoded[4 * i + c];
+			squared_error += (double) difference * difference;
+		}
+	}
+	const double mean_squared_error = squared_error / (256.0 * 256.0 * 3.0);
+	return (mean_squared_error > 0.0 ? min(100.0, 10.0 * log10(255.0 * 255.0 / mean_squared_error)) : 100.0);
+}
+
+static double time_tile_compression(const settings & s, const std::vector<char> & sample_tile, double & psnr) {
+	int options = s.options;
+	if(IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+		options |= 2;	// as CreateImageLoader
+	std::vector<char> blocks(256 * 256);
+	const double start = get_time();
+	for(int i = 0; i < COMPRESSED_TILE_SAMPLE_COUNT; ++i) {
+		if(has_bc7_tiles(s))
+			CompressBc7(sample_tile.data(), 0, 0, 256, 256, 256 * 4, blocks.data(), options);
+		else if(has_mask(s))
+			CompressDxt5(sample_tile.data(), 0, 0, 256, 256, 256 * 4, blocks.data(), options);
+		else
+			CompressDxt1(sample_tile.data(), 0, 0, 256, 256, 256 * 3, blocks.data(), options);
+	}
+	const double seconds = (get_time() - start) / COMPRESSED_TILE_SAMPLE_COUNT;
+	psnr = get_psnr(s, sample_tile, blocks);
+	return seconds;
+}
+
+static void keep_best(double & best, double seconds, int repetition) {
+	if(repetition == 0 || seconds < best)
+		best = seconds;
+}
+
+static error_code run_stages(const settings & s, unsigned int & tile_count, stage_results & results) {
+	double unzip_seconds = 0.0, decode_seconds = 0.0, mipmap_seconds = 0.0, compress_seconds = 0.0;
+	std::vector<char> sample_tile;
+	error_code error = 0;
+	for(int repetition = 0; error == 0 && repetition < s.repetitions; ++repetition) {
+		unsigned long long size = 0;
+		double start = get_time();
+		results.unzipped_bytes = 0;
+		error = unzip_entry(s.archive_name, s.image_entry_name, size);
+		results.unzipped_bytes += size;
+		if(error == 0 && has_mask(s)) {
+			error = unzip_entry(s.archive_name, s.mask_entry_name, size);
+			results.unzipped_bytes += size;
+		}
+		keep_best(unzip_seconds, get_time() - start, repetition);
+
+		start = get_time();
+		results.decoded_bytes = 0;
+		if(error == 0) {
+			error = decode_image(s.archive_name, s.image_entry_name, size);
+			results.decoded_bytes += size;
+		}
+		if(error == 0 && has_mask(s)) {
+			error = decode_image(s.archive_name, s.mask_entry_name, size);
+			results.decoded_bytes += size;
+		}
+		keep_best(decode_seconds, get_time() - start, repetition);
+
+		start = get_time();
+		if(error == 0)
+			error = build_tiles(s, tile_count, sample_tile);
+		keep_best(mipmap_seconds, get_time() - start, repetition);
+
+		start = get_time();
+		if(error == 0)
+			error = load_tiles(s, tile_count, results);
+		keep_best(compress_seconds, get_time() - start, repetition);
+	}
+	if(error != 0)
+		return error;
+
+	results.unzip_seconds = unzip_seconds;
+	results.decode_seconds = max(0.0, decode_seconds - unzip_seconds);
+	results.mipmap_seconds = max(0.0, mipmap_seconds - decode_seconds);
+	results.compress_seconds = max(0.0, compress_seconds - mipmap_seconds);
+	results.tile_compression_seconds = time_tile_compression(s, sample_tile, results.tile_psnr);
+	return 0;
+}
+
+static void print_string(const char * name, const char * value, const char * separator) {
+	printf("  \"%s\": \"", name);
+	for(const char * c = value; *c; ++c) {
+		if(*c == '"' || *c == '\\')
+			printf("\\%c", *c);
+		else if((unsigned char) *c >= 0x20)
+			putchar(*c);
+	}
+	printf("\"%s\n", separator);
+}
+
+static double per_second(double count, double seconds) {
+	return (seconds > 0.0 ? count / seconds : 0.0);
+}
+
+static void print_probes() {
+	static const char * const PROBE_KEYS[LOADER_PROBE_COUNT] = { "write_slot_wait", "read_slot_wait", "tile_compression", "scanline_decoding", "inflating" };
+	loader_stats stats;
+	GetLoaderStats(&stats);
+	printf("  \"probes\": {\n");
+	for(int i = 0; i < LOADER_PROBE_COUNT; ++i) {
+		printf("    \"%s\": { \"count\": %llu, \"seconds\": %.6f, \"mean_microseconds\": %.3f },\n",
+			PROBE_KEYS[i], stats.counts[i], stats.nanoseconds[i] * 1e-9, per_second(stats.nanoseconds[i] * 1e-3, (double) stats.counts[i]));
+	}
+	printf("    \"trace_events\": %llu,\n", stats.trace_event_count);
+	printf("    \"dropped_trace_events\": %llu\n", stats.dropped_trace_event_count);
+	printf("  },\n");
+}
+
+static void print_results(const settings & s, const char * archive_name, unsigned int tile_count, const stage_results & r) {
+	const double total_seconds = r.unzip_seconds + r.decode_seconds + r.mipmap_seconds + r.compress_seconds;
+	const int thread_count = GetProcessorCoreCount();
+	printf("{\n");
+	print_string("archive", archive_name, ",");
+	print_string("image", s.image_entry_name, ",");
+	print_string("mask", (has_mask(s) ? s.mask_entry_name : ""), ",");
+	printf("  \"threads\": %d,\n", thread_count);
+	printf("  \"kernel_path\": %d,\n", GetDxtKernelPath());
+	printf("  \"options\": %d,\n", s.options);
+	printf("  \"skipped_mipmap_levels\": %u,\n", s.skipped_mipmap_levels);
+	printf("  \"repetitions\": %d,\n", s.repetitions);
+	printf("  \"stages\": {\n");
+	printf("    \"unzip\": { \"seconds\": %.6f, \"bytes\": %llu, \"mb_per_second\": %.2f },\n",
+		r.unzip_seconds, r.unzipped_bytes, per_second(r.unzipped_bytes / 1048576.0, r.unzip_seconds));
+	printf("    \"decode\": { \"seconds\": %.6f, \"bytes\": %llu, \"mb_per_second\": %.2f },\n",
+		r.decode_seconds, r.decoded_bytes, per_second(r.decoded_bytes / 1048576.0, r.decode_seconds));
+	printf("    \"mipmap\": { \"seconds\": %.6f, \"tiles\": %u, \"tiles_per_second\": %.2f },\n",
+		r.mipmap_seconds, tile_count, per_second(tile_count, r.mipmap_seconds));
+	printf("    \"compress\": { \"seconds\": %.6f, \"tile_seconds\": %.9f, \"tiles_per_second_per_thread\": %.2f, \"tile_psnr_db\": %.2f },\n",
+		r.compress_seconds, r.tile_compression_seconds, per_second(1.0, r.tile_compression_seconds), r.tile_psnr);
+	printf("    \"handoff\": { \"batches\": %u, \"first_tiles_seconds\": %.6f, \"mean_wait_seconds\": %.6f, \"max_wait_seconds\": %.6f }\n",
+		r.batch_count, r.first_tiles_seconds, r.mean_wait_seconds, r.max_wait_seconds);
+	printf("  },\n");
+	if(s.trace_file_name != 0)
+		print_probes();
+	printf("  \"total\": { \"seconds\": %.6f, \"tiles\": %u, \"tiles_per_second\": %.2f, \"mb_per_second\": %.2f }\n",
+		total_seconds, tile_count, per_second(tile_count, total_seconds), per_second(r.decoded_bytes / 1048576.0, total_seconds));
+	printf("}\n");
+}
+
+static void print_usage() {
+	fprintf(stderr,
+		"usage: ZunTzuBench [-threads n] [-kernel auto|sse2|avx2|avx512] [-options n] [-skip n] [-batch n] [-repeat n]\n"
+		"                   [-trace trace.json] archive.zip image_entry [mask_entry]\n");
+}
+
+static char * to_multi_byte(const wchar_t * text) {
+#ifdef _WIN32
+	const int size = WideCharToMultiByte(CP_ACP, 0, text, -1, 0, 0, 0, 0);
+	char * multi_byte = new char[size];
+	WideCharToMultiByte(CP_ACP, 0, text, -1, multi_byte, size, 0, 0);
+#else
+	const size_t size = wcstombs(0, text, 0) + 1;
+	char * multi_byte = new char[size];
+	wcstombs(multi_byte, text, size);
+#endif
+	return multi_byte;
+}
+
+int wmain(int argc, wchar_t * argv[]) {
+	settings s = { 0, 0, 0, 0, -1, 0, 0, 0, 3, 0 };
+	int i = 1;
+	for(; i + 1 < argc && argv[i][0] == L'-'; i += 2) {
+		const wchar_t * value = argv[i + 1];
+		if(0 == wcscmp(argv[i], L"-threads")) {
+			s.thread_count = _wtoi(value);
+		} else if(0 == wcscmp(argv[i], L"-kernel")) {
+			s.kernel_path = (0 == wcscmp(value, L"sse2") ? 0 : 0 == wcscmp(value, L"avx2") ? 1 : 0 == wcscmp(value, L"avx512") ? 2 : -1);
+		} else if(0 == wcscmp(argv[i], L"-options")) {
+			s.options = _wtoi(value);
+		} else if(0 == wcscmp(argv[i], L"-skip")) {
+			s.skipped_mipmap_levels = (unsigned int) _wtoi(value);
+		} else if(0 == wcscmp(argv[i], L"-batch")) {
+			s.batch_size = (unsigned int) _wtoi(value);
+		} else if(0 == wcscmp(argv[i], L"-repeat")) {
+			s.repetitions = max(1, _wtoi(value));
+		} else if(0 == wcscmp(argv[i], L"-trace")) {
+			s.trace_file_name = value;
+		} else {
+			print_usage();
+			return 2;
+		}
+	}
+	if(argc - i < 2 || argc - i > 3) {
+		print_usage();
+		return 2;
+	}
+
+	char * archive_name = to_multi_byte(argv[i]);
+	char * image_entry_name = to_multi_byte(argv[i + 1]);
+	char * mask_entry_name = (argc - i == 3 ? to_multi_byte(argv[i + 2]) : 0);
+	s.archive_name = argv[i];
+	s.image_entry_name = image_entry_name;
+	s.mask_entry_name = mask_entry_name;
+
+	SetProcessorCoreCount(s.thread_count);
+	SetDxtKernelPath(s.kernel_path);
+	if(s.trace_file_name != 0)
+		SetLoaderTracing(LOADER_TRACING_EVENTS);
+
+	unsigned int tile_count = 0;
+	stage_results results = {};
+	const error_code error = run_stages(s, tile_count, results);
+	if(error == 0)
+		print_results(s, archive_name, tile_count, results);
+	else
+		printf("{ \"error\": %d }\n", error);
+	if(s.trace_file_name != 0 && DumpLoaderTrace(s.trace_file_name) < 0)
+		fprintf(stderr, "cannot write the trace file\n");
+
+	delete [] mask_entry_name;
+	delete [] image_entry_name;
+	delete [] archive_name;
+	return (error == 0 ? 0 : 1);
+}
+
+#ifndef _WIN32
+// the arguments are converted to wide strings, as passed to wmain on Windows
+int main(int argc, char * argv[]) {
+	setlocale(LC_ALL, "");
+	std::vector<std::wstring> arguments(argc);
+	std::vector<wchar_t *> wide_argv(argc + 1, 0);
+	for(int i = 0; i < argc; ++i) {
+		const size_t length = mbstowcs(0, argv[i], 0);
+		if(length == (size_t) -1) {
+			fprintf(stderr, "invalid argument: %s\n", argv[i]);
+			return 2;
+		}
+		arguments[i].resize(length + 1);
+		mbstowcs(&arguments[i][0], argv[i], length + 1);
+		wide_argv[i] = &arguments[i][0];
+	}
+	return wmain(argc, wide_argv.data());
+}
+#endif
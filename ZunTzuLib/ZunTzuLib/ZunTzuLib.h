@@ -3,22 +3,49 @@
 
 #pragma once
 
-#include "resource.h"		// main symbols
+#include "Resource.h"		// main symbols
+
+struct loader_stats;
 
 extern "C" {
 	// DXT compression routines
 	__declspec(dllexport) void __cdecl CompressDxt1(const char * rgb, int top, int left, int bottom, int right, int stride, char * blocks, int option);
 	__declspec(dllexport) void __cdecl CompressDxt1FromRgba(const char * rgba, int top, int left, int bottom, int right, int stride, char * blocks, int option);
 	__declspec(dllexport) void __cdecl CompressDxt5(const char * rgba, int top, int left, int bottom, int right, int stride, char * blocks, int option);
+	__declspec(dllexport) void __cdecl CompressBc7(const char * rgba, int top, int left, int bottom, int right, int stride, char * blocks, int option);	// mode 5 and mode 6 blocks, see bc7.cpp
+	__declspec(dllexport) int __cdecl DecompressBc7(const char * blocks, char * rgba, int stride);	// a whole tile, back to BGRA texels, returns the number of blocks it cannot decode
+	__declspec(dllexport) void __cdecl DecodeDxt1Blocks(const char * blocks, int width, int height, char * texels, int stride);	// width x height blocks, row after row, to 32-bit texels
+	__declspec(dllexport) void __cdecl DecodeDxt5Blocks(const char * blocks, int width, int height, char * texels, int stride);
+	__declspec(dllexport) int __cdecl SetDxtKernelPath(int path);	// -1: auto, 0: SSE2, 1: AVX2, 2: AVX-512, returns the path in use
+	__declspec(dllexport) int __cdecl GetDxtKernelPath();
 
 	// Image loading
 	__declspec(dllexport) void * __cdecl CreateImageLoader(const wchar_t * archive_name, const char * image_entry_name, const char * mask_entry_name, unsigned int skipped_mipmap_levels, int options);
 	__declspec(dllexport) int __cdecl GetImageDimensions(void * image_loader, unsigned int * width, unsigned int * height);
 	__declspec(dllexport) int __cdecl LoadNextTile(void * image_loader, char * tile, unsigned int * mipmap_level, unsigned int * x, unsigned int * y);
+	__declspec(dllexport) int __cdecl LoadNextTiles(void * image_loader, char ** tiles, unsigned int tile_count, unsigned int * mipmap_levels, unsigned int * xs, unsigned int * ys);	// tiles are compressed straight into the buffers of the caller
+	__declspec(dllexport) void __cdecl PrioritizeTiles(void * image_loader, unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);	// area in texels of the first mipmap level
 	__declspec(dllexport) void __cdecl FreeImageLoader(void * image_loader);
+	__declspec(dllexport) void * __cdecl OpenArchive(const wchar_t * archive_name);	// keeps the archive mapped for all the image loaders until closed, 0 if it cannot be mapped
+	__declspec(dllexport) void __cdecl CloseArchive(void * archive);
+	__declspec(dllexport) void __cdecl SetTileCacheDirectory(const wchar_t * directory_name);	// empty or null to disable the cache of compressed tiles
+	__declspec(dllexport) void __cdecl SetTileCacheMaxSize(unsigned long long max_size);	// in bytes, the least recently used tiles are evicted beyond it, 0 for the default size (2 GiB)
+	__declspec(dllexport) int __cdecl CompileTileSet(const wchar_t * archive_name, const char * image_entry_name, const char * mask_entry_name, const wchar_t * tile_set_file_name);	// writes a .ztt file
+	__declspec(dllexport) void * __cdecl CreateBatchImageLoader(unsigned int image_count, const wchar_t ** archive_names, const char ** image_entry_names, const char ** mask_entry_names, unsigned int skipped_mipmap_levels, int options);	// loads several images together (see batch_image_loader.h)
+	__declspec(dllexport) int __cdecl GetBatchImageDimensions(void * batch_loader, unsigned int image, unsigned int * width, unsigned int * height);	// known once a tile of the image has been yielded, returns the error of the image if it cannot be loaded
+	__declspec(dllexport) unsigned int __cdecl LoadNextBatchTiles(void * batch_loader, char ** destinations, const int * masked, unsigned int destination_count, char ** tiles, unsigned int tile_count, unsigned int * images, unsigned int * mipmap_levels, unsigned int * xs, unsigned int * ys);	// tiles of any image, compressed into the destinations supplied for opaque (DXT1) or masked (DXT5) images, 0 once all the images are loaded
+	__declspec(dllexport) void __cdecl PrioritizeBatchTiles(void * batch_loader, unsigned int image, unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+	__declspec(dllexport) void __cdecl FreeBatchImageLoader(void * batch_loader);
+
+	// Image loading probes (see loader_trace.h)
+	__declspec(dllexport) void __cdecl SetLoaderTracing(int mode);	// 0: off, 1: counters, 2: counters and trace events
+	__declspec(dllexport) void __cdecl GetLoaderStats(loader_stats * stats);
+	__declspec(dllexport) void __cdecl ResetLoaderStats();	// clears the counters and the trace events
+	__declspec(dllexport) int __cdecl DumpLoaderTrace(const wchar_t * file_name);	// writes the trace events in the Chrome trace event format once loading is over, returns their number or -1
 
 	// System info
-	__declspec(dllexport) int __cdecl GetProcessorCoreCount();
+	__declspec(dllexport) int __cdecl GetProcessorCoreCount();	// number of threads of the image loaders
+	__declspec(dllexport) void __cdecl SetProcessorCoreCount(int count);	// overrides the number of cores used by the image loaders, 0 for all cores
 
 	// Networking
 	__declspec(dllexport) void* __cdecl CreatePeer();
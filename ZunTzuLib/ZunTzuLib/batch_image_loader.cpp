@@ -0,0 +1,269 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include "ZunTzuLib.h"
+#include "batch_image_loader.h"
+#include "dxt_compressor.h"
+
+template<typename character>
+static character * copy_string(const character * text) {
+	size_t length = 0;
+	if(text != 0)
+		while(text[length] != 0)
+			++length;
+	character * copy = new character[length + 1];
+	for(size_t i = 0; i < length; ++i)
+		copy[i] = text[i];
+	copy[length] = 0;
+	return copy;
+}
+
+batch_image_loader::batch_image_loader(
+	unsigned int image_count,
+	const wchar_t * const * archive_names,
+	const char * const * image_entry_names,
+	const char * const * mask_entry_names,
+	unsigned int skipped_mipmap_levels,
+	int options)
+:
+	skipped_mipmap_levels(skipped_mipmap_levels),
+	options(options),
+	image_count(image_count),
+	jobs(new image_job[image_count]),
+	next_image(0),
+	loading_image_count(0),
+	stopping(false)
+{
+	for(unsigned int i = 0; i < image_count; ++i) {
+		image_job & job = jobs[i];
+		job.loader = this;
+		job.archive_name = copy_string(archive_names[i]);
+		job.image_entry_name = copy_string(image_entry_names[i]);
+		job.mask_entry_name = copy_string(mask_entry_names != 0 ? mask_entry_names[i] : 0);
+		job.compressor = 0;
+		job.width = 0;
+		job.height = 0;
+		job.remaining_tile_count = 0;
+		job.error = 0;
+		job.prioritizing = false;
+		job.tile_data = 0;
+		job.mipmap_levels = 0;
+		job.xs = 0;
+		job.ys = 0;
+	}
+
+	// an image decodes while another one is compressed, each batch is compressed by as many tasks as cores
+	const unsigned int core_count = max(1, GetProcessorCoreCount());
+	const unsigned int max_loading_image_count = max(2u, (core_count + 1) / 2);
+	batch_size = core_count;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	while(next_image < image_count && loading_image_count < max_loading_image_count) {
+		++loading_image_count;
+		submit_task(loading_task, &jobs[next_image++], &loading_tasks);
+	}
+}
+
+batch_image_loader::~batch_image_loader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	destination_supplied.notify_all();
+	loading_tasks.wait();
+
+	for(unsigned int i = 0; i < image_count; ++i) {
+		delete [] jobs[i].archive_name;
+		delete [] jobs[i].image_entry_name;
+		delete [] jobs[i].mask_entry_name;
+	}
+	delete [] jobs;
+}
+
+error_code batch_image_loader::get_image_dimensions(
+	unsigned int image,
+	unsigned int & width,
+	unsigned int & height)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	width = jobs[image].width;
+	height = jobs[image].height;
+	return jobs[image].error;
+}
+
+unsigned int batch_image_loader::get_next_tiles(
+	char * const * destinations,
+	const int * masked,
+	unsigned int destination_count,
+	char ** tile_data,
+	unsigned int tile_count,
+	unsigned int * images,
+	unsigned int * mipmap_levels,
+	unsigned int * xs,
+	unsigned int * ys)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// the images wait for destinations of their format
+	if(destination_count > 0) {
+		for(unsigned int i = 0; i < destination_count; ++i)
+			free_destinations[masked[i] != 0 ? 1 : 0].push_back(destinations[i]);
+		destination_supplied.notify_all();
+	}
+
+	blocking_wait(tile_loaded, lock, [this] { return !loaded_tiles.empty() || is_done(); });
+
+	const unsigned int count = min(tile_count, (unsigned int) loaded_tiles.size());
+	for(unsigned int i = 0; i < count; ++i) {
+		const loaded_tile & tile = loaded_tiles.front();
+		tile_data[i] = tile.data;
+		images[i] = tile.image;
+		mipmap_levels[i] = tile.mipmap_level;
+		xs[i] = tile.x;
+		ys[i] = tile.y;
+		loaded_tiles.pop_front();
+	}
+	return count;
+}
+
+void batch_image_loader::prioritize_tiles(
+	unsigned int image,
+	unsigned int mipmap_level,
+	unsigned int left,
+	unsigned int top,
+	unsigned int right,
+	unsigned int bottom)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	image_job & job = jobs[image];
+	job.prioritizing = true;
+	job.priority_area[0] = mipmap_level;
+	job.priority_area[1] = left;
+	job.priority_area[2] = top;
+	job.priority_area[3] = right;
+	job.priority_area[4] = bottom;
+}
+
+void batch_image_loader::loading_task(
+	void * context)
+{
+	image_job & job = *static_cast<image_job*>(context);
+	batch_image_loader * loader = job.loader;
+	std::vector<char *> & free_destinations = loader->free_destinations[job.mask_entry_name[0] != 0 ? 1 : 0];
+
+	error_code error = 0;
+	unsigned int tile_count = 0;
+	if(job.compressor == 0) {
+		error = loader->start_image(job);
+	} else {
+		// the free destinations of the format of the image, up to a batch: an image never holds destinations while waiting for more
+		bool prioritizing;
+		unsigned int priority_area[5];
+		{
+			std::unique_lock<std::mutex> lock(loader->mutex);
+			blocking_wait(loader->destination_supplied, lock, [loader, &free_destinations] { return loader->stopping || !free_destinations.empty(); });
+			if(!loader->stopping) {
+				tile_count = min(min(loader->batch_size, (unsigned int) free_destinations.size()), job.remaining_tile_count);
+				for(unsigned int i = 0; i < tile_count; ++i) {
+					job.tile_data[i] = free_destinations.back();
+					free_destinations.pop_back();
+				}
+			}
+			prioritizing = job.prioritizing;
+			job.prioritizing = false;
+			for(int i = 0; i < 5; ++i)
+				priority_area[i] = job.priority_area[i];
+		}
+		if(tile_count > 0) {
+			if(prioritizing)
+				job.compressor->prioritize_tiles(priority_area[0], priority_area[1], priority_area[2], priority_area[3], priority_area[4]);
+			error = job.compressor->get_next_tiles(job.tile_data, tile_count, job.mipmap_levels, job.xs, job.ys);
+		}
+	}
+
+	bool finished;
+	bool destinations_freed = false;
+	{
+		std::lock_guard<std::mutex> lock(loader->mutex);
+		if(error != 0) {
+			job.error = error;
+			for(unsigned int i = 0; i < tile_count; ++i)
+				free_destinations.push_back(job.tile_data[i]);
+			destinations_freed = (tile_count > 0);
+			tile_count = 0;
+		} else {
+			for(unsigned int i = 0; i < tile_count; ++i) {
+				loaded_tile tile = { job.tile_data[i], (unsigned int) (&job - loader->jobs), job.mipmap_levels[i], job.xs[i], job.ys[i] };
+				loader->loaded_tiles.push_back(tile);
+			}
+			job.remaining_tile_count -= tile_count;
+		}
+		finished = (error != 0 || job.remaining_tile_count == 0 || loader->stopping);
+	}
+	if(tile_count > 0)
+		loader->tile_loaded.notify_all();
+	if(destinations_freed)
+		loader->destination_supplied.notify_all();
+
+	if(finished)
+		loader->finish_image(job);
+	else
+		submit_task(loading_task, &job, &loader->loading_tasks);
+}
+
+error_code batch_image_loader::start_image(
+	image_job & job)
+{
+	job.compressor = static_cast<dxt_compressor*>(CreateImageLoader(job.archive_name, job.image_entry_name, job.mask_entry_name, skipped_mipmap_levels, options));
+
+	// the compressor starts decoding once the dimensions are known
+	unsigned int width, height;
+	error_code error = job.compressor->get_image_dimensions(width, height);
+	if(error != 0)
+		return error;
+
+	// the image is loaded once the tiles of its index are yielded: the index must count exactly the tiles of the loaders
+	ztt_index index;
+	index.init(width, height, skipped_mipmap_levels, job.mask_entry_name[0] != 0, options, 0);
+	job.tile_data = new char*[batch_size];
+	job.mipmap_levels = new unsigned int[batch_size];
+	job.xs = new unsigned int[batch_size];
+	job.ys = new unsigned int[batch_size];
+
+	std::lock_guard<std::mutex> lock(mutex);
+	job.width = width;
+	job.height = height;
+	job.remaining_tile_count = index.header.tile_count;
+	return 0;
+}
+
+void batch_image_loader::finish_image(
+	image_job & job)
+{
+	delete job.compressor;
+	job.compressor = 0;
+	delete [] job.tile_data;
+	delete [] job.mipmap_levels;
+	delete [] job.xs;
+	delete [] job.ys;
+	job.tile_data = 0;
+	job.mipmap_levels = 0;
+	job.xs = 0;
+	job.ys = 0;
+
+	bool done;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		--loading_image_count;
+		if(!stopping && next_image < image_count) {
+			++loading_image_count;
+			submit_task(loading_task, &jobs[next_image++], &loading_tasks);
+		}
+		done = is_done();
+	}
+	if(done)
+		tile_loaded.notify_all();
+}
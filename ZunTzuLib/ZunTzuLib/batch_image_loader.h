@@ -0,0 +1,84 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include <deque>
+#include <vector>
+#include "thread_pool.h"
+
+typedef int error_code;	// no error if 0, otherwise abort
+
+class dxt_compressor;
+
+// Loads the images of a game box together, so that the many small counter sheets keep all the cores busy.
+// A few images load at once, each one by a task of the thread pool compressing a batch of tiles and then
+// submitting itself again. The next image starts as soon as one is done. Tiles are yielded to the caller
+// as they are compressed, tagged with the index of their image. They are compressed straight into memory
+// supplied by the caller (e.g. locked textures), of the format of the image: DXT1 if opaque, DXT5 if masked.
+class batch_image_loader {
+public:
+	batch_image_loader(unsigned int image_count, const wchar_t * const * archive_names, const char * const * image_entry_names, const char * const * mask_entry_names, unsigned int skipped_mipmap_levels, int options);
+	~batch_image_loader();	// stops loading
+
+	// known once a tile of the image has been yielded (0 before), the error of the image if it cannot be loaded
+	error_code get_image_dimensions(unsigned int image, unsigned int & width, unsigned int & height);
+	// tiles of any image, waits for at least one, 0 once all the images are loaded or have failed
+	// destinations[i] is supplied for the tiles of masked images if masked[i] is not 0, of opaque images otherwise:
+	// at least one per format must be held by the loader, until it yields them back or is deleted
+	// tile i belongs to images[i], it is located by mipmap_levels[i], xs[i] and ys[i], and tile_data[i] is one of the destinations
+	unsigned int get_next_tiles(char * const * destinations, const int * masked, unsigned int destination_count, char ** tile_data, unsigned int tile_count, unsigned int * images, unsigned int * mipmap_levels, unsigned int * xs, unsigned int * ys);
+	// see dxt_compressor::prioritize_tiles, applied before the next batch of tiles of the image
+	void prioritize_tiles(unsigned int image, unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+
+private:
+	struct image_job {
+		batch_image_loader * loader;
+		wchar_t * archive_name;
+		char * image_entry_name;
+		char * mask_entry_name;
+		dxt_compressor * compressor;	// while loading
+		unsigned int width;
+		unsigned int height;
+		unsigned int remaining_tile_count;
+		error_code error;
+		bool prioritizing;	// a priority area is waiting for the next batch
+		unsigned int priority_area[5];	// mipmap level, left, top, right, bottom
+
+		// current batch
+		char ** tile_data;
+		unsigned int * mipmap_levels;
+		unsigned int * xs;
+		unsigned int * ys;
+	};
+
+	struct loaded_tile {
+		char * data;
+		unsigned int image;
+		unsigned int mipmap_level;
+		unsigned int x;
+		unsigned int y;
+	};
+
+	static void loading_task(void * context);	// starts the image or compresses a batch of its tiles
+	error_code start_image(image_job & job);
+	void finish_image(image_job & job);
+	bool is_done() const { return loading_image_count == 0 && next_image == image_count; }
+
+	unsigned int skipped_mipmap_levels;
+	int options;
+	unsigned int image_count;
+	image_job * jobs;
+	unsigned int batch_size;	// tiles compressed at once per image
+	task_group loading_tasks;
+
+	std::mutex mutex;	// guards the fields below and the errors, dimensions and priority areas of the jobs
+	std::condition_variable tile_loaded;	// or all the images are done
+	std::condition_variable destination_supplied;	// or loading stops
+	unsigned int next_image;	// to start
+	unsigned int loading_image_count;
+	std::deque<loaded_tile> loaded_tiles;
+	std::vector<char *> free_destinations[2];	// supplied by the caller, for the tiles of opaque and of masked images
+	bool stopping;
+};
@@ -0,0 +1,462 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include <float.h>
+#include <emmintrin.h>	// SIMD intrinsics
+#include "ZunTzuLib.h"
+#include "dxt_kernels.h"
+
+// BC7 blocks are written in two modes only, in the same 16 bytes per block as DXT5:
+//   mode 6  one set of RGBA endpoints of 7 bits per channel plus a low bit (p-bit) per endpoint, 16 indices of 4 bits
+//   mode 5  RGB endpoints of 7 bits and alpha endpoints of 8 bits, with their own indices of 2 bits (no rotation)
+// Mode 6 is used for opaque blocks. Where alpha varies (anti-aliased edges of counters), the mode of lower
+// error is kept: mode 6 follows color and alpha along a single axis, mode 5 fits them apart.
+
+static const int WEIGHTS_2[4] = { 0, 21, 43, 64 };
+static const int WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// SIMD macros, as in dxt_simd.cpp
+
+#ifdef _MSC_VER
+#define M128I_U32(x, i) ((x).m128i_u32[i])
+#else
+typedef unsigned int u32x4 __attribute__((vector_size(16), may_alias));
+#define M128I_U32(x, i) (reinterpret_cast<u32x4 &>(x)[i])
+#endif
+
+#define SELECT(mask, x, y) _mm_or_ps(_mm_and_ps((mask), (x)), _mm_andnot_ps((mask), (y)))
+
+// bits of a block, from the least significant bit of its first byte
+class bit_writer {
+public:
+	bit_writer(unsigned char * block) : block(block), position(0) {
+		for(int i = 0; i < 16; ++i)
+			block[i] = 0;
+	}
+	void write(unsigned int value, int bit_count) {	// value < (1 << bit_count), bit_count <= 8
+		const unsigned int bits = value << (position & 7);
+		block[position >> 3] |= (unsigned char) bits;
+		if((position & 7) + bit_count > 8)
+			block[(position >> 3) + 1] |= (unsigned char) (bits >> 8);
+		position += bit_count;
+	}
+private:
+	unsigned char * block;
+	int position;
+};
+
+class bit_reader {
+public:
+	bit_reader(const unsigned char * block) : block(block), position(0) {}
+	unsigned int read(int bit_count) {
+		unsigned int value = 0;
+		for(int i = 0; i < bit_count; ++i, ++position)
+			value |= (unsigned int) ((block[position >> 3] >> (position & 7)) & 1) << i;
+		return value;
+	}
+private:
+	const unsigned char * block;
+	int position;
+};
+
+static inline int interpolate(int start, int end, int weight)
+{
+	return ((64 - weight) * start + weight * end + 32) >> 6;
+}
+
+// Endpoints of 4 blocks (one per lane) for channels [first_channel, last_channel), with indices from 0 to max_index:
+// the texels span their principal axis (power iteration on the covariance matrix), refined once by least squares.
+static void fit_endpoints(
+	const __m128 (* texels)[4],
+	int first_channel,
+	int last_channel,
+	float max_index,
+	__m128 * start,
+	__m128 * end)
+{
+	__m128 mean[4];
+	for(int c = first_channel; c < last_channel; ++c) {
+		mean[c] = texels[0][c];
+		for(int i = 1; i < 16; ++i)
+			mean[c] = _mm_add_ps(mean[c], texels[i][c]);
+		mean[c] = _mm_mul_ps(mean[c], _mm_set1_ps(1.0f / 16.0f));
+	}
+
+	__m128 covariance[4][4];
+	for(int c = first_channel; c < last_channel; ++c)
+		for(int k = c; k < last_channel; ++k)
+			covariance[c][k] = _mm_setzero_ps();
+	for(int i = 0; i < 16; ++i) {
+		__m128 d[4];
+		for(int c = first_channel; c < last_channel; ++c)
+			d[c] = _mm_sub_ps(texels[i][c], mean[c]);
+		for(int c = first_channel; c < last_channel; ++c)
+			for(int k = c; k < last_channel; ++k)
+				covariance[c][k] = _mm_add_ps(covariance[c][k], _mm_mul_ps(d[c], d[k]));
+	}
+	for(int c = first_channel; c < last_channel; ++c)
+		for(int k = first_channel; k < c; ++k)
+			covariance[c][k] = covariance[k][c];
+
+	// principal axis, from the channel of largest variance
+	__m128 axis[4];
+	__m128 largest_variance = covariance[first_channel][first_channel];
+	for(int k = first_channel; k < last_channel; ++k)
+		axis[k] = covariance[first_channel][k];
+	for(int c = first_channel + 1; c < last_channel; ++c) {
+		const __m128 larger = _mm_cmpgt_ps(covariance[c][c], largest_variance);
+		largest_variance = _mm_max_ps(covariance[c][c], largest_variance);
+		for(int k = first_channel; k < last_channel; ++k)
+			axis[k] = SELECT(larger, covariance[c][k], axis[k]);
+	}
+	for(int iteration = 0; iteration < 4; ++iteration) {
+		__m128 next[4];
+		__m128 norm = _mm_setzero_ps();
+		for(int c = first_channel; c < last_channel; ++c) {
+			next[c] = _mm_setzero_ps();
+			for(int k = first_channel; k < last_channel; ++k)
+				next[c] = _mm_add_ps(next[c], _mm_mul_ps(covariance[c][k], axis[k]));
+			norm = _mm_max_ps(norm, _mm_max_ps(next[c], _mm_sub_ps(_mm_setzero_ps(), next[c])));
+		}
+		const __m128 valid = _mm_cmpgt_ps(norm, _mm_setzero_ps());	// not a single color
+		const __m128 inv_norm = _mm_div_ps(_mm_set1_ps(1.0f), SELECT(valid, norm, _mm_set1_ps(1.0f)));
+		for(int c = first_channel; c < last_channel; ++c)
+			axis[c] = SELECT(valid, _mm_mul_ps(next[c], inv_norm), axis[c]);
+	}
+
+	// projections on the axis, and their indices between the extreme ones
+	__m128 projections[16];
+	__m128 min_projection = _mm_set1_ps(FLT_MAX);
+	__m128 max_projection = _mm_set1_ps(-FLT_MAX);
+	for(int i = 0; i < 16; ++i) {
+		projections[i] = _mm_setzero_ps();
+		for(int c = first_channel; c < last_channel; ++c)
+			projections[i] = _mm_add_ps(projections[i], _mm_mul_ps(_mm_sub_ps(texels[i][c], mean[c]), axis[c]));
+		min_projection = _mm_min_ps(min_projection, projections[i]);
+		max_projection = _mm_max_ps(max_projection, projections[i]);
+	}
+	const __m128 range = _mm_sub_ps(max_projection, min_projection);
+	const __m128 spread = _mm_cmpgt_ps(range, _mm_setzero_ps());
+	const __m128 index_scale = _mm_and_ps(spread, _mm_div_ps(_mm_set1_ps(max_index), SELECT(spread, range, _mm_set1_ps(1.0f))));
+
+	// least squares refinement, as for DXT1 with end weights of index / max_index:
+	// alpha[i] * start + beta[i] * end = pixel[i], beta[i] == 1 - alpha[i]
+	__m128 S_beta = _mm_setzero_ps();
+	__m128 S_beta_2 = _mm_setzero_ps();
+	__m128 S_pixel[4];
+	__m128 S_beta_pixel[4];
+	for(int c = first_channel; c < last_channel; ++c) {
+		S_pixel[c] = _mm_setzero_ps();
+		S_beta_pixel[c] = _mm_setzero_ps();
+	}
+	for(int i = 0; i < 16; ++i) {
+		const __m128 index = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(projections[i], min_projection), index_scale)));
+		const __m128 beta = _mm_div_ps(index, _mm_set1_ps(max_index));
+		S_beta = _mm_add_ps(S_beta, beta);
+		S_beta_2 = _mm_add_ps(S_beta_2, _mm_mul_ps(beta, beta));
+		for(int c = first_channel; c < last_channel; ++c) {
+			S_pixel[c] = _mm_add_ps(S_pixel[c], texels[i][c]);
+			S_beta_pixel[c] = _mm_add_ps(S_beta_pixel[c], _mm_mul_ps(beta, texels[i][c]));
+		}
+	}
+	const __m128 S_alpha_beta = _mm_sub_ps(S_beta, S_beta_2);
+	const __m128 S_alpha_2 = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(16.0f), S_beta), S_alpha_beta);
+	const __m128 determinant = _mm_sub_ps(_mm_mul_ps(S_alpha_2, S_beta_2), _mm_mul_ps(S_alpha_beta, S_alpha_beta));
+	const __m128 solvable = _mm_cmpgt_ps(determinant, _mm_set1_ps(1e-3f));
+	const __m128 factor = _mm_div_ps(_mm_set1_ps(1.0f), SELECT(solvable, determinant, _mm_set1_ps(1.0f)));
+
+	for(int c = first_channel; c < last_channel; ++c) {
+		const __m128 S_alpha_pixel = _mm_sub_ps(S_pixel[c], S_beta_pixel[c]);
+		const __m128 fitted_start = _mm_mul_ps(factor, _mm_sub_ps(_mm_mul_ps(S_alpha_pixel, S_beta_2), _mm_mul_ps(S_beta_pixel[c], S_alpha_beta)));
+		const __m128 fitted_end = _mm_mul_ps(factor, _mm_sub_ps(_mm_mul_ps(S_beta_pixel[c], S_alpha_2), _mm_mul_ps(S_alpha_pixel, S_alpha_beta)));
+		// otherwise the extremes of the projections
+		start[c] = SELECT(solvable, fitted_start, _mm_add_ps(mean[c], _mm_mul_ps(min_projection, axis[c])));
+		end[c] = SELECT(solvable, fitted_end, _mm_add_ps(mean[c], _mm_mul_ps(max_projection, axis[c])));
+		start[c] = _mm_max_ps(_mm_setzero_ps(), _mm_min_ps(_mm_set1_ps(255.0f), start[c]));
+		end[c] = _mm_max_ps(_mm_setzero_ps(), _mm_min_ps(_mm_set1_ps(255.0f), end[c]));
+	}
+}
+
+// mode 6 endpoint: 7 bits per channel and whichever p-bit is closer, as 8-bit channels
+static void quantize_endpoint_6(
+	const __m128 * endpoint,
+	__m128i * quantized)
+{
+	__m128 errors[2];
+	__m128i values[2][4];
+	for(int p = 0; p < 2; ++p) {
+		errors[p] = _mm_setzero_ps();
+		for(int c = 0; c < 4; ++c) {
+			const __m128i q = _mm_cvtps_epi32(_mm_max_ps(_mm_setzero_ps(), _mm_min_ps(_mm_set1_ps(127.0f),
+				_mm_mul_ps(_mm_sub_ps(endpoint[c], _mm_set1_ps((float) p)), _mm_set1_ps(0.5f)))));
+			values[p][c] = _mm_or_si128(_mm_slli_epi32(q, 1), _mm_set1_epi32(p));
+			const __m128 d = _mm_sub_ps(_mm_cvtepi32_ps(values[p][c]), endpoint[c]);
+			errors[p] = _mm_add_ps(errors[p], _mm_mul_ps(d, d));
+		}
+	}
+	const __m128 odd = _mm_cmplt_ps(errors[1], errors[0]);
+	for(int c = 0; c < 4; ++c)
+		quantized[c] = _mm_castps_si128(SELECT(odd, _mm_castsi128_ps(values[1][c]), _mm_castsi128_ps(values[0][c])));
+}
+
+// mode 5 endpoint: 7 bits per color channel (the high bit is repeated when decoded), 8 bits of alpha
+static void quantize_endpoint_5(
+	const __m128 * endpoint,
+	__m128i * quantized)
+{
+	for(int c = 0; c < 3; ++c) {
+		const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(endpoint[c], _mm_set1_ps(127.0f / 255.0f)));
+		quantized[c] = _mm_or_si128(_mm_slli_epi32(q, 1), _mm_srli_epi32(q, 6));
+	}
+	quantized[3] = _mm_cvtps_epi32(endpoint[3]);
+}
+
+// Indices of the closest interpolated values around the projection of each texel, for channels [first_channel, last_channel)
+// of 4 blocks. The weights of the indices are round(64 * index / max_index), so that the values are interpolated exactly.
+// Returns the squared errors.
+static __m128 select_indices(
+	const __m128 (* texels)[4],
+	int first_channel,
+	int last_channel,
+	const __m128i * start,
+	const __m128i * end,
+	float max_index,
+	__m128i * indices)
+{
+	__m128 a[4], b[4], segment[4];
+	__m128 segment_norm_2 = _mm_setzero_ps();
+	for(int c = first_channel; c < last_channel; ++c) {
+		a[c] = _mm_cvtepi32_ps(start[c]);
+		b[c] = _mm_cvtepi32_ps(end[c]);
+		segment[c] = _mm_sub_ps(b[c], a[c]);
+		segment_norm_2 = _mm_add_ps(segment_norm_2, _mm_mul_ps(segment[c], segment[c]));
+	}
+	const __m128 spread = _mm_cmpgt_ps(segment_norm_2, _mm_setzero_ps());
+	const __m128 scale = _mm_and_ps(spread, _mm_div_ps(_mm_set1_ps(max_index), SELECT(spread, segment_norm_2, _mm_set1_ps(1.0f))));
+
+	__m128 error = _mm_setzero_ps();
+	for(int i = 0; i < 16; ++i) {
+		__m128 dot_product = _mm_setzero_ps();
+		for(int c = first_channel; c < last_channel; ++c)
+			dot_product = _mm_add_ps(dot_product, _mm_mul_ps(_mm_sub_ps(texels[i][c], a[c]), segment[c]));
+		const __m128 guess = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(scale, dot_product)));
+
+		__m128 best_distance = _mm_set1_ps(FLT_MAX);
+		__m128 best_index = _mm_setzero_ps();
+		for(int offset = -1; offset <= 1; ++offset) {
+			const __m128 index = _mm_max_ps(_mm_setzero_ps(), _mm_min_ps(_mm_set1_ps(max_index), _mm_add_ps(guess, _mm_set1_ps((float) offset))));
+			const __m128 weight = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(index, _mm_set1_ps(64.0f / max_index))));
+			const __m128 complement = _mm_sub_ps(_mm_set1_ps(64.0f), weight);
+			__m128 distance = _mm_setzero_ps();
+			for(int c = first_channel; c < last_channel; ++c) {
+				const __m128i sum = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(_mm_mul_ps(complement, a[c]), _mm_mul_ps(weight, b[c])), _mm_set1_ps(32.0f)));
+				const __m128 d = _mm_sub_ps(texels[i][c], _mm_cvtepi32_ps(_mm_srai_epi32(sum, 6)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+			}
+			const __m128 closer = _mm_cmplt_ps(distance, best_distance);
+			best_distance = _mm_min_ps(distance, best_distance);
+			best_index = SELECT(closer, index, best_index);
+		}
+		indices[i] = _mm_cvtps_epi32(best_index);
+		error = _mm_add_ps(error, best_distance);
+	}
+	return error;
+}
+
+// the most significant bit of the first index is implicitly 0: the endpoints are swapped otherwise
+static void write_indices(
+	bit_writer & bits,
+	__m128i * indices,
+	int lane,
+	int bit_count)
+{
+	const unsigned int max_index = (1 << bit_count) - 1;
+	const unsigned int first = M128I_U32(indices[0], lane);
+	const unsigned int flip = (first > (max_index >> 1) ? max_index : 0);
+	bits.write(first ^ flip, bit_count - 1);
+	for(int i = 1; i < 16; ++i)
+		bits.write(M128I_U32(indices[i], lane) ^ flip, bit_count);
+}
+
+static void write_endpoints(
+	bit_writer & bits,
+	const int (* endpoints)[4],
+	int channel,
+	int bit_count,
+	bool swapped)
+{
+	bits.write(endpoints[swapped ? 1 : 0][channel] >> (8 - bit_count), bit_count);
+	bits.write(endpoints[swapped ? 0 : 1][channel] >> (8 - bit_count), bit_count);
+}
+
+// 4 blocks at once, one block per lane
+static void encodeFourBc7Blocks_simd(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride)
+{
+	__m128 texels[16][4];
+	for(int i = 0; i < 16; ++i)
+		for(int c = 0; c < 4; ++c)
+			texels[i][c] = _mm_setr_ps(rgba[4 * i + c], rgba[64 + 4 * i + c], rgba[128 + 4 * i + c], rgba[192 + 4 * i + c]);
+
+	__m128 start[4], end[4];
+	__m128i start_6[4], end_6[4];
+	__m128i indices[16];
+	fit_endpoints(texels, 0, 4, 15.0f, start, end);
+	quantize_endpoint_6(start, start_6);
+	quantize_endpoint_6(end, end_6);
+	const __m128 error = select_indices(texels, 0, 4, start_6, end_6, 15.0f, indices);
+
+	// mode 5 is only tried where alpha varies
+	__m128 min_alpha = texels[0][3];
+	__m128 max_alpha = texels[0][3];
+	for(int i = 1; i < 16; ++i) {
+		min_alpha = _mm_min_ps(min_alpha, texels[i][3]);
+		max_alpha = _mm_max_ps(max_alpha, texels[i][3]);
+	}
+	int mode_5 = _mm_movemask_ps(_mm_cmplt_ps(min_alpha, max_alpha));
+	__m128i start_5[4], end_5[4];
+	__m128i color_indices[16], alpha_indices[16];
+	if(mode_5 != 0) {
+		fit_endpoints(texels, 0, 3, 3.0f, start, end);
+		fit_endpoints(texels, 3, 4, 3.0f, start, end);
+		quantize_endpoint_5(start, start_5);
+		quantize_endpoint_5(end, end_5);
+		const __m128 error_5 = _mm_add_ps(
+			select_indices(texels, 0, 3, start_5, end_5, 3.0f, color_indices),
+			select_indices(texels, 3, 4, start_5, end_5, 3.0f, alpha_indices));
+		mode_5 &= _mm_movemask_ps(_mm_cmplt_ps(error_5, error));
+	}
+
+	for(int lane = 0; lane < 4; ++lane) {
+		bit_writer bits(blocks + block_stride * lane);
+		if(mode_5 & (1 << lane)) {
+			int endpoints[2][4];
+			for(int c = 0; c < 4; ++c) {
+				endpoints[0][c] = (int) M128I_U32(start_5[c], lane);
+				endpoints[1][c] = (int) M128I_U32(end_5[c], lane);
+			}
+			bits.write(1 << 5, 6);	// mode 5
+			bits.write(0, 2);	// no rotation
+			for(int c = 0; c < 3; ++c)
+				write_endpoints(bits, endpoints, c, 7, M128I_U32(color_indices[0], lane) > 1);
+			write_endpoints(bits, endpoints, 3, 8, M128I_U32(alpha_indices[0], lane) > 1);
+			write_indices(bits, color_indices, lane, 2);
+			write_indices(bits, alpha_indices, lane, 2);
+		} else {
+			int endpoints[2][4];
+			for(int c = 0; c < 4; ++c) {
+				endpoints[0][c] = (int) M128I_U32(start_6[c], lane);
+				endpoints[1][c] = (int) M128I_U32(end_6[c], lane);
+			}
+			const bool swapped = (M128I_U32(indices[0], lane) > 7);
+			bits.write(1 << 6, 7);	// mode 6
+			for(int c = 0; c < 4; ++c)
+				write_endpoints(bits, endpoints, c, 7, swapped);
+			bits.write(endpoints[swapped ? 1 : 0][0] & 1, 1);
+			bits.write(endpoints[swapped ? 0 : 1][0] & 1, 1);
+			write_indices(bits, indices, lane, 4);
+		}
+	}
+}
+
+void __fastcall encodeBc7Blocks_simd(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	for(size_t i = 0; i < block_count; i += 4)
+		encodeFourBc7Blocks_simd(rgba + 64 * i, blocks + block_stride * i, block_stride);
+}
+
+// 16 RGBA texels of a block, false (and transparent black) if it is in a mode other than 5 and 6
+static bool decode_bc7_block(
+	const unsigned char * block,
+	unsigned char * rgba)
+{
+	bit_reader bits(block);
+	int endpoints[2][4];
+	if((block[0] & 0x7f) == (1 << 6)) {
+		bits.read(7);
+		for(int c = 0; c < 4; ++c) {
+			endpoints[0][c] = bits.read(7) << 1;
+			endpoints[1][c] = bits.read(7) << 1;
+		}
+		const unsigned int p_bits[2] = { bits.read(1), bits.read(1) };
+		for(int c = 0; c < 4; ++c) {
+			endpoints[0][c] |= p_bits[0];
+			endpoints[1][c] |= p_bits[1];
+		}
+		for(int i = 0; i < 16; ++i) {
+			const int index = bits.read(i == 0 ? 3 : 4);
+			for(int c = 0; c < 4; ++c)
+				rgba[4 * i + c] = (unsigned char) interpolate(endpoints[0][c], endpoints[1][c], WEIGHTS_4[index]);
+		}
+		return true;
+	} else if((block[0] & 0x3f) == (1 << 5)) {
+		bits.read(6);
+		const int rotation = bits.read(2);
+		for(int c = 0; c < 4; ++c) {
+			for(int e = 0; e < 2; ++e) {
+				if(c < 3) {
+					const int value = bits.read(7);
+					endpoints[e][c] = (value << 1) | (value >> 6);
+				} else {
+					endpoints[e][c] = bits.read(8);
+				}
+			}
+		}
+		for(int i = 0; i < 16; ++i) {
+			const int index = bits.read(i == 0 ? 1 : 2);
+			for(int c = 0; c < 3; ++c)
+				rgba[4 * i + c] = (unsigned char) interpolate(endpoints[0][c], endpoints[1][c], WEIGHTS_2[index]);
+		}
+		for(int i = 0; i < 16; ++i) {
+			const int index = bits.read(i == 0 ? 1 : 2);
+			rgba[4 * i + 3] = (unsigned char) interpolate(endpoints[0][3], endpoints[1][3], WEIGHTS_2[index]);
+		}
+		if(rotation != 0) {
+			for(int i = 0; i < 16; ++i) {
+				const unsigned char swapped = rgba[4 * i + rotation - 1];
+				rgba[4 * i + rotation - 1] = rgba[4 * i + 3];
+				rgba[4 * i + 3] = swapped;
+			}
+		}
+		return true;
+	} else {
+		for(int i = 0; i < 64; ++i)
+			rgba[i] = 0;
+		return false;
+	}
+}
+
+extern "C" int __cdecl DecompressBc7(
+	const char * blocks,
+	char * rgba,
+	int stride)
+{
+	int undecoded_block_count = 0;
+	for(int blockY = 0; blockY < 64; ++blockY) {
+		for(int blockX = 0; blockX < 64; ++blockX) {
+			unsigned char texels[64];
+			if(!decode_bc7_block(reinterpret_cast<const unsigned char *>(blocks + 16 * (64 * blockY + blockX)), texels))
+				++undecoded_block_count;
+			for(int row = 0; row < 4; ++row) {
+				char * line = rgba + stride * (4 * blockY + row) + 4 * 4 * blockX;
+				for(int col = 0; col < 4; ++col) {
+					// back to the texel order of the source of CompressBc7
+					const unsigned char * texel = texels + 4 * (4 * row + col);
+					line[4 * col + 0] = (char) texel[2];
+					line[4 * col + 1] = (char) texel[1];
+					line[4 * col + 2] = (char) texel[0];
+					line[4 * col + 3] = (char) texel[3];
+				}
+			}
+		}
+	}
+	return undecoded_block_count;
+}
@@ -0,0 +1,94 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// AVX2 execution path: this file is compiled with /arch:AVX2 and without the precompiled header,
+// its functions must only be called when the processor supports AVX2 (see dxt_dispatch.cpp)
+
+#include <stddef.h>
+#include <immintrin.h>	// SIMD intrinsics
+#include "downsample_kernels.h"
+
+// Same computation as the SSE2 kernels, twice as wide.
+
+// 6 destination texels (18 bytes) per iteration, 3 per 128-bit lane
+void __fastcall downsample_rgb_avx2(
+	const unsigned char * source_odd,
+	const unsigned char * source_even,
+	unsigned char * dest,
+	size_t dest_width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i two = _mm256_set1_epi16(2);
+
+	// bytes 0-2, 6-8 and 12-14 (the first texel of each pair) moved to bytes 0-8 of each lane
+	const __m256i first_texels = _mm256_setr_epi8(
+		0, 1, 2, 6, 7, 8, 12, 13, 14, -1, -1, -1, -1, -1, -1, -1,
+		0, 1, 2, 6, 7, 8, 12, 13, 14, -1, -1, -1, -1, -1, -1, -1);
+
+	// 37 bytes of each source scanline are read per iteration
+	size_t x = 0;
+	for(; x + 7 <= dest_width; x += 6) {
+		// byte k of the sum is the sum of bytes k and k + 3 (the next texel) of both scanlines
+		const __m256i odd = _mm256_loadu2_m128i(reinterpret_cast<const __m128i*>(source_odd + 18), reinterpret_cast<const __m128i*>(source_odd));
+		const __m256i odd_next = _mm256_loadu2_m128i(reinterpret_cast<const __m128i*>(source_odd + 21), reinterpret_cast<const __m128i*>(source_odd + 3));
+		const __m256i even = _mm256_loadu2_m128i(reinterpret_cast<const __m128i*>(source_even + 18), reinterpret_cast<const __m128i*>(source_even));
+		const __m256i even_next = _mm256_loadu2_m128i(reinterpret_cast<const __m128i*>(source_even + 21), reinterpret_cast<const __m128i*>(source_even + 3));
+		__m256i sum_low = _mm256_add_epi16(
+			_mm256_add_epi16(_mm256_unpacklo_epi8(odd, zero), _mm256_unpacklo_epi8(odd_next, zero)),
+			_mm256_add_epi16(_mm256_unpacklo_epi8(even, zero), _mm256_unpacklo_epi8(even_next, zero)));
+		__m256i sum_high = _mm256_add_epi16(
+			_mm256_add_epi16(_mm256_unpackhi_epi8(odd, zero), _mm256_unpackhi_epi8(odd_next, zero)),
+			_mm256_add_epi16(_mm256_unpackhi_epi8(even, zero), _mm256_unpackhi_epi8(even_next, zero)));
+		sum_low = _mm256_srli_epi16(_mm256_add_epi16(sum_low, two), 2);
+		sum_high = _mm256_srli_epi16(_mm256_add_epi16(sum_high, two), 2);
+		const __m256i texels = _mm256_shuffle_epi8(_mm256_packus_epi16(sum_low, sum_high), first_texels);
+
+		// 9 bytes of each lane
+		const __m128i low = _mm256_castsi256_si128(texels);
+		const __m128i high = _mm256_extracti128_si256(texels, 1);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_or_si128(low, _mm_slli_si128(high, 9)));
+		*reinterpret_cast<unsigned short*>(dest + 16) = (unsigned short) _mm_extract_epi16(_mm_srli_si128(high, 7), 0);
+
+		dest += 18;
+		source_odd += 36;
+		source_even += 36;
+	}
+	downsample_rgb_scalar(source_odd, source_even, dest, dest_width - x);
+}
+
+// 8 destination texels (32 bytes) per iteration
+void __fastcall downsample_rgba_avx2(
+	const unsigned char * source_odd,
+	const unsigned char * source_even,
+	unsigned char * dest,
+	size_t dest_width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i two = _mm256_set1_epi16(2);
+
+	size_t x = 0;
+	for(; x + 8 <= dest_width; x += 8) {
+		__m256i averages[2];
+		for(int i = 0; i < 2; ++i) {
+			// vertical sums of 8 texels, texels 0, 1, 4, 5 and texels 2, 3, 6, 7
+			const __m256i odd = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_odd + 32 * i));
+			const __m256i even = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_even + 32 * i));
+			const __m256i sum0145 = _mm256_add_epi16(_mm256_unpacklo_epi8(odd, zero), _mm256_unpacklo_epi8(even, zero));
+			const __m256i sum2367 = _mm256_add_epi16(_mm256_unpackhi_epi8(odd, zero), _mm256_unpackhi_epi8(even, zero));
+
+			// horizontal sums of pairs of texels
+			const __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(sum0145, sum2367), _mm256_unpackhi_epi64(sum0145, sum2367));
+			averages[i] = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+		}
+
+		// packing interleaves the lanes: texels 0, 1, 4, 5, 2, 3, 6, 7
+		const __m256i texels = _mm256_permute4x64_epi64(_mm256_packus_epi16(averages[0], averages[1]), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), texels);
+
+		dest += 32;
+		source_odd += 64;
+		source_even += 64;
+	}
+	downsample_rgba_scalar(source_odd, source_even, dest, dest_width - x);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#ifndef _WIN32
+#include "platform.h"	// these kernels are compiled without stdafx.h
+#endif
+
+// Box filter kernels building a scanline of the next mipmap level from two scanlines.
+// Each destination texel is the rounded average of 2x2 source texels: (a + b + c + d + 2) >> 2.
+// Source scanlines start at their first texel and must be readable up to texel 2 * dest_width - 1
+// (the right guard band of an odd width scanline).
+// The execution path is the one of the DXT kernels (see dxt_kernels.h).
+typedef void (__fastcall * downsample_kernel)(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width);
+
+struct downsample_kernels {
+	downsample_kernel downsample_rgb;	// 3 bytes per texel
+	downsample_kernel downsample_rgba;	// 4 bytes per texel
+};
+
+// Kernels for the current path (see SetDxtKernelPath)
+const downsample_kernels & get_downsample_kernels();
+
+// SSE2 (downsample_simd.cpp)
+void __fastcall downsample_rgb_simd(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width);
+void __fastcall downsample_rgba_simd(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width);
+
+// AVX2 (downsample_avx2.cpp)
+void __fastcall downsample_rgb_avx2(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width);
+void __fastcall downsample_rgba_avx2(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width);
+
+// reference implementations, also used for the last texels of a scanline
+
+static inline void downsample_rgb_scalar(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width) {
+	for(size_t x = 0; x < dest_width; ++x) {
+		*(dest+0) = ((unsigned int) *(source_odd+0) + (unsigned int) *(source_odd+3) + (unsigned int) *(source_even+0) + (unsigned int) *(source_even+3) + (unsigned int) 2) >> 2;
+		*(dest+1) = ((unsigned int) *(source_odd+1) + (unsigned int) *(source_odd+4) + (unsigned int) *(source_even+1) + (unsigned int) *(source_even+4) + (unsigned int) 2) >> 2;
+		*(dest+2) = ((unsigned int) *(source_odd+2) + (unsigned int) *(source_odd+5) + (unsigned int) *(source_even+2) + (unsigned int) *(source_even+5) + (unsigned int) 2) >> 2;
+		dest += 3;
+		source_odd += 6;
+		source_even += 6;
+	}
+}
+
+static inline void downsample_rgba_scalar(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width) {
+	for(size_t x = 0; x < dest_width; ++x) {
+		*(dest+0) = ((unsigned int) *(source_odd+0) + (unsigned int) *(source_odd+4) + (unsigned int) *(source_even+0) + (unsigned int) *(source_even+4) + (unsigned int) 2) >> 2;
+		*(dest+1) = ((unsigned int) *(source_odd+1) + (unsigned int) *(source_odd+5) + (unsigned int) *(source_even+1) + (unsigned int) *(source_even+5) + (unsigned int) 2) >> 2;
+		*(dest+2) = ((unsigned int) *(source_odd+2) + (unsigned int) *(source_odd+6) + (unsigned int) *(source_even+2) + (unsigned int) *(source_even+6) + (unsigned int) 2) >> 2;
+		*(dest+3) = ((unsigned int) *(source_odd+3) + (unsigned int) *(source_odd+7) + (unsigned int) *(source_even+3) + (unsigned int) *(source_even+7) + (unsigned int) 2) >> 2;
+		dest += 4;
+		source_odd += 8;
+		source_even += 8;
+	}
+}
@@ -0,0 +1,88 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include <emmintrin.h>	// SIMD intrinsics
+#include "downsample_kernels.h"
+
+// Sums are computed on 16 bits, so that the rounding is exactly the one of the scalar kernels.
+
+// 3 destination texels (9 bytes) per iteration
+void __fastcall downsample_rgb_simd(
+	const unsigned char * source_odd,
+	const unsigned char * source_even,
+	unsigned char * dest,
+	size_t dest_width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two = _mm_set1_epi16(2);
+
+	// 19 bytes of each source scanline are read per iteration
+	size_t x = 0;
+	for(; x + 4 <= dest_width; x += 3) {
+		// byte k of the sum is the sum of bytes k and k + 3 (the next texel) of both scanlines
+		const __m128i odd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_odd));
+		const __m128i odd_next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_odd + 3));
+		const __m128i even = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_even));
+		const __m128i even_next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_even + 3));
+		__m128i sum_low = _mm_add_epi16(
+			_mm_add_epi16(_mm_unpacklo_epi8(odd, zero), _mm_unpacklo_epi8(odd_next, zero)),
+			_mm_add_epi16(_mm_unpacklo_epi8(even, zero), _mm_unpacklo_epi8(even_next, zero)));
+		__m128i sum_high = _mm_add_epi16(
+			_mm_add_epi16(_mm_unpackhi_epi8(odd, zero), _mm_unpackhi_epi8(odd_next, zero)),
+			_mm_add_epi16(_mm_unpackhi_epi8(even, zero), _mm_unpackhi_epi8(even_next, zero)));
+		sum_low = _mm_srli_epi16(_mm_add_epi16(sum_low, two), 2);
+		sum_high = _mm_srli_epi16(_mm_add_epi16(sum_high, two), 2);
+		const __m128i average = _mm_packus_epi16(sum_low, sum_high);
+
+		// keep bytes 0-2, 6-8 and 12-14 (the first texel of each pair)
+		const unsigned long long low = (unsigned long long) _mm_cvtsi128_si64(average);
+		const unsigned long long high = (unsigned long long) _mm_cvtsi128_si64(_mm_unpackhi_epi64(average, average));
+		const unsigned long long texels =
+			(low & 0xffffff) |
+			((low >> 48) << 24) |
+			((high & 0xff) << 40) |
+			(((high >> 32) & 0xffff) << 48);
+		*reinterpret_cast<unsigned long long*>(dest) = texels;
+		dest[8] = (unsigned char) (high >> 48);
+
+		dest += 9;
+		source_odd += 18;
+		source_even += 18;
+	}
+	downsample_rgb_scalar(source_odd, source_even, dest, dest_width - x);
+}
+
+// 4 destination texels (16 bytes) per iteration
+void __fastcall downsample_rgba_simd(
+	const unsigned char * source_odd,
+	const unsigned char * source_even,
+	unsigned char * dest,
+	size_t dest_width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two = _mm_set1_epi16(2);
+
+	size_t x = 0;
+	for(; x + 4 <= dest_width; x += 4) {
+		__m128i averages[2];
+		for(int i = 0; i < 2; ++i) {
+			// vertical sums of 4 texels
+			const __m128i odd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_odd + 16 * i));
+			const __m128i even = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_even + 16 * i));
+			const __m128i sum01 = _mm_add_epi16(_mm_unpacklo_epi8(odd, zero), _mm_unpacklo_epi8(even, zero));
+			const __m128i sum23 = _mm_add_epi16(_mm_unpackhi_epi8(odd, zero), _mm_unpackhi_epi8(even, zero));
+
+			// horizontal sums of pairs of texels
+			const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(sum01, sum23), _mm_unpackhi_epi64(sum01, sum23));
+			averages[i] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_packus_epi16(averages[0], averages[1]));
+
+		dest += 16;
+		source_odd += 32;
+		source_even += 32;
+	}
+	downsample_rgba_scalar(source_odd, source_even, dest, dest_width - x);
+}
@@ -3,84 +3,278 @@
 ----------------------------------------------------------------------------- */
 
 #include "stdafx.h"
+#include <emmintrin.h>	// SIMD intrinsics
 #include "ZunTzuLib.h"
+#include "dxt_kernels.h"
 
 // options: FAVOR_SPEED = 0, FAVOR_QUALITY = 1
 // options: USE_FLOAT = 0, USE_SIMD = 2
+// options: CLUSTER_FIT = 4, implies FAVOR_QUALITY (slow, for offline compilation only: the float path falls back to FAVOR_QUALITY)
+// options: BC7 = 8, masked images only (CompressBc7 always uses the SIMD path, the other options are ignored)
 
 // float execution path
 void __fastcall encodeDxt1Block_fast_float(const unsigned char * rgba, unsigned char * block);
 void __fastcall encodeDxt1Block_quality_float(const unsigned char * rgba, unsigned char * block);
 void __fastcall encodeDxt5Block_float(const unsigned char * rgba,	unsigned char * block);
-// simd execution path
+// simd execution path (kernels in dxt_kernels.h)
 unsigned int __fastcall set_mxcsr();
 void __fastcall restore_mxcsr(unsigned int mxcsr);
-void __fastcall encodeDxt1Block_fast_simd(const unsigned char * rgba, unsigned char * block);
-void __fastcall encodeDxt1Block_quality_simd(const unsigned char * rgba, unsigned char * block);
-void __fastcall encodeDxt5Block_simd(const unsigned char * rgba,	unsigned char * block);
+
+// Uniform blocks (black padding around the image, borders, transparent mask areas) are encoded once
+// per texel value and copied: the encoders give the same block for the same uniform texels.
+struct uniform_block {
+	bool valid;
+	unsigned int texel;
+	unsigned char block[16];
+};
+
+static inline bool is_uniform_block(
+	const unsigned int * texels)
+{
+	const __m128i first = _mm_set1_epi32((int) texels[0]);
+	const __m128i * t = reinterpret_cast<const __m128i*>(texels);
+	const __m128i equal = _mm_and_si128(
+		_mm_and_si128(_mm_cmpeq_epi32(_mm_loadu_si128(t + 0), first), _mm_cmpeq_epi32(_mm_loadu_si128(t + 1), first)),
+		_mm_and_si128(_mm_cmpeq_epi32(_mm_loadu_si128(t + 2), first), _mm_cmpeq_epi32(_mm_loadu_si128(t + 3), first)));
+	return 0xffff == _mm_movemask_epi8(equal);
+}
+
+// whether the 256x256 texels of the tile are all the same, texel_size is 3 (RGB) or 4 (RGBA)
+static bool is_uniform_tile(
+	const char * source,
+	int stride,
+	int texel_size)
+{
+	// 48 bytes hold a whole number of texels of either size
+	char pattern[48];
+	for(int i = 0; i < 48; ++i)
+		pattern[i] = source[i % texel_size];
+	const __m128i patterns[3] = {
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 0)),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 16)),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 32))
+	};
+
+	for(int y = 0; y < 256; ++y) {
+		const __m128i * line = reinterpret_cast<const __m128i*>(source + y * stride);
+		__m128i equal = _mm_cmpeq_epi8(patterns[0], patterns[0]);
+		for(int i = 0; i < 16 * texel_size; ++i)
+			equal = _mm_and_si128(equal, _mm_cmpeq_epi8(_mm_loadu_si128(line + i), patterns[i % 3]));
+		if(0xffff != _mm_movemask_epi8(equal))
+			return false;
+	}
+	return true;
+}
+
+typedef void (* block_encoder)(const dxt_kernels & kernels, int option, const unsigned char * rgba, unsigned char * blocks, size_t block_count);
+
+// DXT1 blocks, 8 bytes apart
+static void encode_dxt1_blocks(
+	const dxt_kernels & kernels,
+	int option,
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_count)
+{
+	switch(option) {
+		case 0:
+			for(size_t i = 0; i < block_count; ++i)
+				encodeDxt1Block_fast_float(rgba + 64 * i, blocks + 8 * i);
+			break;
+
+		case 1:
+		case 5:
+			for(size_t i = 0; i < block_count; ++i)
+				encodeDxt1Block_quality_float(rgba + 64 * i, blocks + 8 * i);
+			break;
+
+		case 2:
+			kernels.encode_dxt1_fast(rgba, blocks, 8, block_count);
+			break;
+
+		case 3:
+			kernels.encode_dxt1_quality(rgba, blocks, 8, block_count);
+			break;
+
+		case 7:
+			kernels.encode_dxt1_cluster(rgba, blocks, 8, block_count);
+			break;
+	}
+}
+
+// DXT5 blocks, 16 bytes apart
+static void encode_dxt5_blocks(
+	const dxt_kernels & kernels,
+	int option,
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_count)
+{
+	switch(option) {
+		case 0:
+			for(size_t i = 0; i < block_count; ++i) {
+				encodeDxt5Block_float(rgba + 64 * i, blocks + 16 * i);
+				encodeDxt1Block_fast_float(rgba + 64 * i, blocks + 16 * i + 8);
+			}
+			break;
+
+		case 1:
+		case 5:
+			for(size_t i = 0; i < block_count; ++i) {
+				encodeDxt5Block_float(rgba + 64 * i, blocks + 16 * i);
+				encodeDxt1Block_quality_float(rgba + 64 * i, blocks + 16 * i + 8);
+			}
+			break;
+
+		case 2:
+			kernels.encode_dxt5_alpha(rgba, blocks, 16, block_count);
+			kernels.encode_dxt1_fast(rgba, blocks + 8, 16, block_count);
+			break;
+
+		case 3:
+			kernels.encode_dxt5_alpha(rgba, blocks, 16, block_count);
+			kernels.encode_dxt1_quality(rgba, blocks + 8, 16, block_count);
+			break;
+
+		case 7:
+			kernels.encode_dxt5_alpha(rgba, blocks, 16, block_count);
+			kernels.encode_dxt1_cluster(rgba, blocks + 8, 16, block_count);
+			break;
+	}
+}
+
+// BC7 blocks, 16 bytes apart (a single SIMD encoder, whatever the option)
+static void encode_bc7_blocks(
+	const dxt_kernels & kernels,
+	int /*option*/,
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_count)
+{
+	kernels.encode_bc7(rgba, blocks, 16, block_count);
+}
+
+// Encodes a row of 64 blocks. A uniform block is only encoded if its texel differs from the previous uniform block.
+static void encode_block_row(
+	const dxt_kernels & kernels,
+	int option,
+	block_encoder encode,
+	size_t block_size,
+	const unsigned int * texels,
+	char * blocks,
+	uniform_block & last_uniform)
+{
+	int sources[64];	// for each block, the encoded block to copy, -1 for last_uniform
+	int encoded_blocks[64];	// the blocks to encode
+	int encoded_count = 0;
+	bool has_uniform = last_uniform.valid;
+	unsigned int uniform_texel = last_uniform.texel;
+	int uniform_source = -1;
+	for(int blockX = 0; blockX < 64; ++blockX) {
+		const unsigned int * block = texels + 16 * blockX;
+		if(is_uniform_block(block)) {
+			if(has_uniform && block[0] == uniform_texel) {
+				sources[blockX] = uniform_source;
+				continue;
+			}
+			has_uniform = true;
+			uniform_texel = block[0];
+			uniform_source = encoded_count;
+		}
+		encoded_blocks[encoded_count] = blockX;
+		sources[blockX] = encoded_count++;
+	}
+
+	if(encoded_count == 64) {
+		encode(kernels, option, (const unsigned char *) texels, (unsigned char *) blocks, 64);
+	} else {
+		unsigned int packed[64 * 16];
+		unsigned char encoded[64 * 16];
+		if(encoded_count > 0) {
+			// the kernels encode whole batches: padded with copies of the last block
+			const int padded_count = (option & 2) ?
+				(int) ((encoded_count + DXT_KERNEL_BATCH_SIZE - 1) / DXT_KERNEL_BATCH_SIZE * DXT_KERNEL_BATCH_SIZE) :
+				encoded_count;
+			for(int i = 0; i < padded_count; ++i)
+				CopyMemory(packed + 16 * i, texels + 16 * encoded_blocks[min(i, encoded_count - 1)], 64);
+			encode(kernels, option, (const unsigned char *) packed, encoded, padded_count);
+		}
+		for(int blockX = 0; blockX < 64; ++blockX) {
+			const unsigned char * block = (sources[blockX] < 0 ? last_uniform.block : encoded + block_size * sources[blockX]);
+			CopyMemory(blocks + block_size * blockX, block, block_size);
+		}
+	}
+
+	if(uniform_source >= 0) {
+		last_uniform.valid = true;
+		last_uniform.texel = uniform_texel;
+		CopyMemory(last_uniform.block, blocks + block_size * encoded_blocks[uniform_source], block_size);
+	}
+}
 
 extern "C" void __cdecl CompressDxt1(
 	const char * rgb,
 	int top, int left, int bottom, int right,
 	int stride, char * blocks, int option)
 {
+	if(option & 4)
+		option |= 1;	// cluster fit implies FAVOR_QUALITY
 	unsigned int mxcsr;
 	if(option & 2)
 		mxcsr = set_mxcsr();
+	const dxt_kernels & kernels = get_dxt_kernels();
 
 	const char * const source = rgb + top * stride + left * 3;
 	const int width = right - left;
 	const int height = bottom - top;
 
-	const char * lines[4];
-	for(int i = 0; i < 4; ++i)
-		lines[i] = source + stride * i;
+	// a tile of a single color needs no gathering, nor the rows below the image
+	unsigned int uniform_texel = 0x00000000;
+	const bool uniform_tile = top >= 0 && left >= 0 && height >= 256 && width >= 256 && is_uniform_tile(source, stride, 3);
+	if(uniform_tile) {
+		((char*) &uniform_texel)[0] = source[2];
+		((char*) &uniform_texel)[1] = source[1];
+		((char*) &uniform_texel)[2] = source[0];
+		((char*) &uniform_texel)[3] = (char) 0xff;
+	}
 
-	unsigned int ptr[16];
+	unsigned int ptr[64 * 16];	// a whole row of blocks, encoded in batches by the SIMD kernels
+	uniform_block last_uniform = {};
 
 	for(int blockY = 0; blockY < 64; ++blockY) {
-		for(int blockX = 0; blockX < 64; ++blockX) {
+		if(uniform_tile || blockY * 4 >= height) {
+			for(int i = 0; i < 64 * 16; ++i)
+				ptr[i] = uniform_texel;
+		} else {
+			const char * lines[4];
+			for(int i = 0; i < 4; ++i)
+				lines[i] = source + stride * (blockY * 4 + i);
+
 			unsigned int * p = ptr;
-			for(int row = 0; row < 4; ++row) {
-				for(int col = 0; col < 4; ++col) {
-					if((blockY == 0 && row == 0 && top < 0) ||
-						((blockY * 4) + row >= height) ||
-						(blockX == 0 && col == 0 && left < 0) ||
-						((blockX * 4) + col >= width))
-					{
-						*p = (unsigned int) 0x00000000;
-					} else {
-						((char*) p)[0] = *(lines[row] + col * 3 + 2);
-						((char*) p)[1] = *(lines[row] + col * 3 + 1);
-						((char*) p)[2] = *(lines[row] + col * 3 + 0);
-						((char*) p)[3] = (char) 0xff;
+			for(int blockX = 0; blockX < 64; ++blockX) {
+				for(int row = 0; row < 4; ++row) {
+					for(int col = 0; col < 4; ++col) {
+						if((blockY == 0 && row == 0 && top < 0) ||
+							((blockY * 4) + row >= height) ||
+							(blockX == 0 && col == 0 && left < 0) ||
+							((blockX * 4) + col >= width))
+						{
+							*p = (unsigned int) 0x00000000;
+						} else {
+							((char*) p)[0] = *(lines[row] + col * 3 + 2);
+							((char*) p)[1] = *(lines[row] + col * 3 + 1);
+							((char*) p)[2] = *(lines[row] + col * 3 + 0);
+							((char*) p)[3] = (char) 0xff;
+						}
+						++p;
 					}
-					++p;
 				}
+				for(int i = 0; i < 4; ++i)
+					lines[i] += 4 * 3;
 			}
-			switch(option) {
-				case 0:
-					encodeDxt1Block_fast_float((const unsigned char *) ptr, (unsigned char *) blocks);
-					break;
-
-				case 1:
-					encodeDxt1Block_quality_float((const unsigned char *) ptr, (unsigned char *) blocks);
-					break;
-
-				case 2:
-					encodeDxt1Block_fast_simd((const unsigned char *) ptr, (unsigned char *) blocks);
-					break;
-
-				case 3:
-					encodeDxt1Block_quality_simd((const unsigned char *) ptr, (unsigned char *) blocks);
-					break;
-			}
-			blocks += 8;
-			for(int i = 0; i < 4; ++i)
-				lines[i] += 4 * 3;
 		}
-		for(int i = 0; i < 4; ++i)
-			lines[i] += stride * 4 - 256 * 3;
+		encode_block_row(kernels, option, encode_dxt1_blocks, 8, ptr, blocks, last_uniform);
+		blocks += 64 * 8;
 	}
 
 	if(option & 2)
@@ -92,137 +286,144 @@ extern "C" void __cdecl CompressDxt1FromRgba(
 	int top, int left, int bottom, int right,
 	int stride, char * blocks, int option)
 {
+	if(option & 4)
+		option |= 1;	// cluster fit implies FAVOR_QUALITY
 	unsigned int mxcsr;
 	if(option & 2)
 		mxcsr = set_mxcsr();
+	const dxt_kernels & kernels = get_dxt_kernels();
 
 	const char * const source = rgba + top * stride + left * 4;
 	const int width = right - left;
 	const int height = bottom - top;
 
-	const char * lines[4];
-	for(int i = 0; i < 4; ++i)
-		lines[i] = source + stride * i;
-
-	unsigned int ptr[16];
+	// the rows below the image need no gathering
+	unsigned int ptr[64 * 16];	// a whole row of blocks, encoded in batches by the SIMD kernels
+	uniform_block last_uniform = {};
 
 	for(int blockY = 0; blockY < 64; ++blockY) {
-		for(int blockX = 0; blockX < 64; ++blockX) {
+		if(blockY * 4 >= height) {
+			for(int i = 0; i < 64 * 16; ++i)
+				ptr[i] = 0x00000000;
+		} else {
+			const char * lines[4];
+			for(int i = 0; i < 4; ++i)
+				lines[i] = source + stride * (blockY * 4 + i);
+
 			unsigned int * p = ptr;
-			for(int row = 0; row < 4; ++row) {
-				for(int col = 0; col < 4; ++col) {
-					if((blockY == 0 && row == 0 && top < 0) ||
-						((blockY * 4) + row >= height) ||
-						(blockX == 0 && col == 0 && left < 0) ||
-						((blockX * 4) + col >= width))
-					{
-						*p = (unsigned int) 0x00000000;
-					} else {
-						((char*) p)[0] = *(lines[row] + col * 3 + 2);
-						((char*) p)[1] = *(lines[row] + col * 3 + 1);
-						((char*) p)[2] = *(lines[row] + col * 3 + 0);
-						((char*) p)[3] = *(lines[row] + col * 3 + 3);
+			for(int blockX = 0; blockX < 64; ++blockX) {
+				for(int row = 0; row < 4; ++row) {
+					for(int col = 0; col < 4; ++col) {
+						if((blockY == 0 && row == 0 && top < 0) ||
+							((blockY * 4) + row >= height) ||
+							(blockX == 0 && col == 0 && left < 0) ||
+							((blockX * 4) + col >= width))
+						{
+							*p = (unsigned int) 0x00000000;
+						} else {
+							((char*) p)[0] = *(lines[row] + col * 3 + 2);
+							((char*) p)[1] = *(lines[row] + col * 3 + 1);
+							((char*) p)[2] = *(lines[row] + col * 3 + 0);
+							((char*) p)[3] = *(lines[row] + col * 3 + 3);
+						}
+						++p;
 					}
-					++p;
 				}
+				for(int i = 0; i < 4; ++i)
+					lines[i] += 4 * 4;
 			}
-			switch(option) {
-				case 0:
-					encodeDxt1Block_fast_float((const unsigned char *) ptr, (unsigned char *) blocks);
-					break;
-
-				case 1:
-					encodeDxt1Block_quality_float((const unsigned char *) ptr, (unsigned char *) blocks);
-					break;
-
-				case 2:
-					encodeDxt1Block_fast_simd((const unsigned char *) ptr, (unsigned char *) blocks);
-					break;
-
-				case 3:
-					encodeDxt1Block_quality_simd((const unsigned char *) ptr, (unsigned char *) blocks);
-					break;
-			}
-			blocks += 8;
-			for(int i = 0; i < 4; ++i)
-				lines[i] += 4 * 4;
 		}
-		for(int i = 0; i < 4; ++i)
-			lines[i] += stride * 4 - 256 * 4;
+		encode_block_row(kernels, option, encode_dxt1_blocks, 8, ptr, blocks, last_uniform);
+		blocks += 64 * 8;
 	}
 
 	if(option & 2)
 		restore_mxcsr(mxcsr);
 }
 
-extern "C" void __cdecl CompressDxt5(
+// Tiles of 16-byte blocks from BGRA texels (DXT5 or BC7)
+static void compress_rgba_tile(
 	const char * rgba,
 	int top, int left, int bottom, int right,
-	int stride, char * blocks, int option)
+	int stride, char * blocks, int option,
+	block_encoder encode)
 {
+	if(option & 4)
+		option |= 1;	// cluster fit implies FAVOR_QUALITY
 	unsigned int mxcsr;
 	if(option & 2)
 		mxcsr = set_mxcsr();
+	const dxt_kernels & kernels = get_dxt_kernels();
 
 	const char * const source = rgba + top * stride + left * 4;
 	const int width = right - left;
 	const int height = bottom - top;
 
-	const char * lines[4];
-	for(int i = 0; i < 4; ++i)
-		lines[i] = source + stride * i;
+	// a tile of a single color needs no gathering, nor the rows below the image
+	unsigned int uniform_texel = 0x00000000;
+	const bool uniform_tile = top >= 0 && left >= 0 && height >= 256 && width >= 256 && is_uniform_tile(source, stride, 4);
+	if(uniform_tile) {
+		((char*) &uniform_texel)[0] = source[2];
+		((char*) &uniform_texel)[1] = source[1];
+		((char*) &uniform_texel)[2] = source[0];
+		((char*) &uniform_texel)[3] = source[3];
+	}
 
-	unsigned int ptr[16];
+	unsigned int ptr[64 * 16];	// a whole row of blocks, encoded in batches by the SIMD kernels
+	uniform_block last_uniform = {};
 
 	for(int blockY = 0; blockY < 64; ++blockY) {
-		for(int blockX = 0; blockX < 64; ++blockX) {
+		if(uniform_tile || blockY * 4 >= height) {
+			for(int i = 0; i < 64 * 16; ++i)
+				ptr[i] = uniform_texel;
+		} else {
+			const char * lines[4];
+			for(int i = 0; i < 4; ++i)
+				lines[i] = source + stride * (blockY * 4 + i);
+
 			unsigned int * p = ptr;
-			for(int row = 0; row < 4; ++row) {
-				for(int col = 0; col < 4; ++col) {
-					if((blockY == 0 && row == 0 && top < 0) ||
-						((blockY * 4) + row >= height) ||
-						(blockX == 0 && col == 0 && left < 0) ||
-						((blockX * 4) + col >= width))
-					{
-						*p = (unsigned int) 0x00000000;
-					} else {
-						((char*) p)[0] = *(lines[row] + col * 4 + 2);
-						((char*) p)[1] = *(lines[row] + col * 4 + 1);
-						((char*) p)[2] = *(lines[row] + col * 4 + 0);
-						((char*) p)[3] = *(lines[row] + col * 4 + 3);
+			for(int blockX = 0; blockX < 64; ++blockX) {
+				for(int row = 0; row < 4; ++row) {
+					for(int col = 0; col < 4; ++col) {
+						if((blockY == 0 && row == 0 && top < 0) ||
+							((blockY * 4) + row >= height) ||
+							(blockX == 0 && col == 0 && left < 0) ||
+							((blockX * 4) + col >= width))
+						{
+							*p = (unsigned int) 0x00000000;
+						} else {
+							((char*) p)[0] = *(lines[row] + col * 4 + 2);
+							((char*) p)[1] = *(lines[row] + col * 4 + 1);
+							((char*) p)[2] = *(lines[row] + col * 4 + 0);
+							((char*) p)[3] = *(lines[row] + col * 4 + 3);
+						}
+						++p;
 					}
-					++p;
 				}
+				for(int i = 0; i < 4; ++i)
+					lines[i] += 4 * 4;
 			}
-			switch(option) {
-				case 0:
-					encodeDxt5Block_float((const unsigned char *) ptr, (unsigned char *) blocks);
-					encodeDxt1Block_fast_float((const unsigned char *) ptr, (unsigned char *) (blocks + 8));
-					break;
-
-				case 1:
-					encodeDxt5Block_float((const unsigned char *) ptr, (unsigned char *) blocks);
-					encodeDxt1Block_quality_float((const unsigned char *) ptr, (unsigned char *) (blocks + 8));
-					break;
-
-				case 2:
-					encodeDxt5Block_simd((const unsigned char *) ptr, (unsigned char *) blocks);
-					encodeDxt1Block_fast_simd((const unsigned char *) ptr, (unsigned char *) (blocks + 8));
-					break;
-
-				case 3:
-					encodeDxt5Block_simd((const unsigned char *) ptr, (unsigned char *) blocks);
-					encodeDxt1Block_quality_simd((const unsigned char *) ptr, (unsigned char *) (blocks + 8));
-					break;
-			}
-			blocks += 16;
-			for(int i = 0; i < 4; ++i)
-				lines[i] += 4 * 4;
 		}
-		for(int i = 0; i < 4; ++i)
-			lines[i] += stride * 4 - 256 * 4;
+		encode_block_row(kernels, option, encode, 16, ptr, blocks, last_uniform);
+		blocks += 64 * 16;
 	}
 
 	if(option & 2)
 		restore_mxcsr(mxcsr);
 }
+
+extern "C" void __cdecl CompressDxt5(
+	const char * rgba,
+	int top, int left, int bottom, int right,
+	int stride, char * blocks, int option)
+{
+	compress_rgba_tile(rgba, top, left, bottom, right, stride, blocks, option, encode_dxt5_blocks);
+}
+
+extern "C" void __cdecl CompressBc7(
+	const char * rgba,
+	int top, int left, int bottom, int right,
+	int stride, char * blocks, int option)
+{
+	compress_rgba_tile(rgba, top, left, bottom, right, stride, blocks, option | 2, encode_bc7_blocks);
+}
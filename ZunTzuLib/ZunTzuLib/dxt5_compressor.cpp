@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "ZunTzuLib.h"
 #include "dxt_compressor.h"
+#include "loader_trace.h"
 #include "synchronized_tile_buffer.h"
 #include "tile_layer.h"
 
@@ -17,25 +18,22 @@ dxt5_compressor::dxt5_compressor(
 :
 	options(options),
 	tyler(new masked_tile_layer(archive_name, image_entry_name, mask_entry_name, skipped_mipmap_levels)),
-	compression_thread_count(0),
-	threads(0),
+	image_width(0),
+	image_height(0),
 	tile_buffer(0),
-	texture_buffer(0)
+	compressed_by_tasks(false),
+	jobs(0),
+	job_capacity(0)
 {
 }
 
 dxt5_compressor::~dxt5_compressor()
 {
-	if(threads != 0) {
+	if(tile_buffer != 0) {
 		tile_buffer->stop_producer();
-		if(texture_buffer != 0)
-			texture_buffer->stop_producer();
-		WaitForMultipleObjects(1 + compression_thread_count, threads, true, 10000);
-		for(int i = 0; i < 1 + compression_thread_count; ++i)
-			CloseHandle(threads[i]);
-		delete [] threads;
+		loading_tasks.wait();
 	}
-	delete texture_buffer;
+	delete [] jobs;
 	delete tile_buffer;
 	delete tyler;
 }
@@ -44,51 +42,64 @@ error_code dxt5_compressor::get_image_dimensions(
 	unsigned int & width,
 	unsigned int & height)
 {
-	return tyler->get_image_dimensions(width, height);
+	// the image is loaded as soon as its dimensions are known, e.g. while the previous image is compressed
+	if(tile_buffer == 0) {
+		error_code error = tyler->get_image_dimensions(image_width, image_height);
+		if(0 != error) {
+			width = 0;
+			height = 0;
+			return error;
+		}
+		start_loading();
+	}
+	width = image_width;
+	height = image_height;
+	return 0;
 }
 
-DWORD WINAPI dxt5_compressor::image_loading_loop(
-  __in LPVOID lpParameter)
+void dxt5_compressor::image_loading_task(
+	void * context)
 {
-	dxt5_compressor * compressor = static_cast<dxt5_compressor*>(lpParameter);
+	dxt5_compressor * compressor = static_cast<dxt5_compressor*>(context);
 	compressor->tyler->get_all_tiles(compressor->tile_buffer);
-	return 0;
 }
 
-DWORD WINAPI dxt5_compressor::compression_loop(
-  __in LPVOID lpParameter)
+void dxt5_compressor::compression_task(
+	void * context)
 {
-	dxt5_compressor * compressor = static_cast<dxt5_compressor*>(lpParameter);
-	while(true) {
-		// get write buffer
-		unsigned int write_slot_index = 0;
-		if(!compressor->texture_buffer->allocate_write_slot(write_slot_index)) {
-			// consumer loop has issued a "stop producer loop" command
-			return 0;
-		}
-		tile_slot * write_slot = compressor->texture_buffer->get_slot(write_slot_index);
+	compression_job * job = static_cast<compression_job*>(context);
+	synchronized_tile_buffer * tile_buffer = job->compressor->tile_buffer;
+	tile_slot * slot = tile_buffer->get_slot(job->slot_index);
 
-		// get read buffer
-		unsigned int read_slot_index = 0;
-		error_code read_error = compressor->tile_buffer->allocate_read_slot(read_slot_index);
-		if(0 == read_error) {
-			tile_slot * read_slot = compressor->tile_buffer->get_slot(read_slot_index);
+	const unsigned long long compression_start = begin_probe();
+	const int options = job->compressor->options;
+	(options & 8 ? CompressBc7 : CompressDxt5)(slot->texels, 0, 0, 256, 256, 256 * 4, job->destination, options);
+	end_probe(PROBE_TILE_COMPRESSION, compression_start);
 
-			// compress data
-			write_slot->mipmap_level = read_slot->mipmap_level;
-			write_slot->x = read_slot->x;
-			write_slot->y = read_slot->y;
+	tile_buffer->free_read_slot(job->slot_index);
+}
 
-			CompressDxt5(read_slot->texels, 0, 0, 256, 256, 256 * 4, write_slot->texels, compressor->options);
+void dxt5_compressor::start_loading()
+{
+	// if more than one core then the tiles are compressed by tasks, the tile buffer holds as many tiles again
+	const int core_count = GetProcessorCoreCount();
+	compressed_by_tasks = (core_count > 1);
 
-			// yield result
-			compressor->tile_buffer->free_read_slot(read_slot_index);
-			compressor->texture_buffer->free_write_slot(write_slot_index);
-		} else {
-			compressor->texture_buffer->stop_consumer(read_error);
-			return 0;
-		}
-	}
+	tile_buffer = new synchronized_tile_buffer((compressed_by_tasks ? 1 + 2 * core_count : 3), 256 * 256 * 4);
+
+	// the image is decoded by a task, the mipmaps are built by more tasks (see mipmap_pipeline)
+	submit_task(image_loading_task, this, &loading_tasks);
+}
+
+void dxt5_compressor::prioritize_tiles(
+	unsigned int mipmap_level,
+	unsigned int left,
+	unsigned int top,
+	unsigned int right,
+	unsigned int bottom)
+{
+	// the mipmap pipeline yields these tiles first, as soon as they are built
+	tyler->prioritize_tiles(mipmap_level, left, top, right, bottom);
 }
 
 error_code dxt5_compressor::get_next_tile(
@@ -97,67 +108,51 @@ error_code dxt5_compressor::get_next_tile(
 	unsigned int & x,
 	unsigned int & y)
 {
-	if(threads == 0) {
-		// if more than one core then launch one compression thread per core
-		compression_thread_count = GetProcessorCoreCount();
-
-		threads = new HANDLE[1 + compression_thread_count];
-
-		tile_buffer = new synchronized_tile_buffer((compression_thread_count > 0 ? 1 + 2 * compression_thread_count : 3), 256 * 256 * 4);
-
-		// create image loading thread
-		threads[0] = CreateThread(
-			0, //  __in_opt   LPSECURITY_ATTRIBUTES lpThreadAttributes
-			0, //  __in       SIZE_T dwStackSize
-			image_loading_loop, //  __in       LPTHREAD_START_ROUTINE lpStartAddress
-			this, //  __in_opt   LPVOID lpParameter
-			0, //  __in       DWORD dwCreationFlags
-			0 //  __out_opt  LPDWORD lpThreadId
-		);
-
-		if(compression_thread_count > 0) {
-			texture_buffer = new synchronized_tile_buffer(1 + 2 * compression_thread_count, 64 * 64 * 16);
-
-			// create texture compression threads
-			for(int i = 0; i < compression_thread_count; ++i) {
-				threads[1 + i] = CreateThread(
-					0, //  __in_opt   LPSECURITY_ATTRIBUTES lpThreadAttributes
-					0, //  __in       SIZE_T dwStackSize
-					compression_loop, //  __in       LPTHREAD_START_ROUTINE lpStartAddress
-					this, //  __in_opt   LPVOID lpParameter
-					0, //  __in       DWORD dwCreationFlags
-					0 //  __out_opt  LPDWORD lpThreadId
-				);
-			}
-		}
+	return get_next_tiles(&tile_data, 1, &mipmap_level, &x, &y);
+}
+
+error_code dxt5_compressor::get_next_tiles(
+	char ** tile_data,
+	unsigned int tile_count,
+	unsigned int * mipmap_levels,
+	unsigned int * xs,
+	unsigned int * ys)
+{
+	if(tile_buffer == 0)
+		start_loading();
+
+	if(compressed_by_tasks && job_capacity < tile_count) {
+		delete [] jobs;
+		jobs = new compression_job[tile_count];
+		job_capacity = tile_count;
 	}
 
-	if(compression_thread_count == 0) {
+	// tiles are taken in turn by this thread, and compressed here or by tasks
+	error_code error = 0;
+	for(unsigned int i = 0; i < tile_count; ++i) {
 		unsigned int slot_index = 0;
-		error_code error = tile_buffer->allocate_read_slot(slot_index);
-		if(0 == error) {
-			tile_slot * slot = tile_buffer->get_slot(slot_index);
-			mipmap_level = slot->mipmap_level;
-			x = slot->x;
-			y = slot->y;
-			CompressDxt5(slot->texels, 0, 0, 256, 256, 256 * 4, tile_data, options);
+		error = tile_buffer->allocate_read_slot(slot_index);
+		if(0 != error)
+			break;
+		tile_slot * slot = tile_buffer->get_slot(slot_index);
+		mipmap_levels[i] = slot->mipmap_level;
+		xs[i] = slot->x;
+		ys[i] = slot->y;
+
+		if(compressed_by_tasks) {
+			jobs[i].compressor = this;
+			jobs[i].slot_index = slot_index;
+			jobs[i].destination = tile_data[i];
+			submit_task(compression_task, &jobs[i], &compression_tasks);
+		} else {
+			const unsigned long long compression_start = begin_probe();
+			(options & 8 ? CompressBc7 : CompressDxt5)(slot->texels, 0, 0, 256, 256, 256 * 4, tile_data[i], options);
+			end_probe(PROBE_TILE_COMPRESSION, compression_start);
 			tile_buffer->free_read_slot(slot_index);
 		}
-		return error;
-
-	} else {
-		unsigned int slot_index = 0;
-		error_code error = texture_buffer->allocate_read_slot(slot_index);
-		if(0 == error) {
-			tile_slot * slot = texture_buffer->get_slot(slot_index);
-			mipmap_level = slot->mipmap_level;
-			x = slot->x;
-			y = slot->y;
-
-			CopyMemory(tile_data, slot->texels, 64 * 64 * 16);
-
-			texture_buffer->free_read_slot(slot_index);
-		}
-		return error;
 	}
+
+	// none of the tasks may write into tile_data after returning
+	compression_tasks.wait();
+	return error;
 }
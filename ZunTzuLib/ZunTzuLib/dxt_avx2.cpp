@@ -0,0 +1,782 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// AVX2 execution path: this file is compiled with /arch:AVX2, /fp:precise and without the precompiled header,
+// its functions must only be called when the processor supports AVX2 (see dxt_dispatch.cpp)
+
+#include <stddef.h>
+#include <immintrin.h>	// SIMD intrinsics
+#include "dxt_kernels.h"
+
+// SIMD macros
+
+#define INVERSE_SIGN(x) _mm256_sub_ps(_mm256_setzero_ps(), (x))
+#define SELECT(mask, x, y) _mm256_blendv_ps((y), (x), (mask))
+#define SELECT_EPI32(mask, x, y) _mm256_blendv_epi8((y), (x), (mask))
+
+// Same algorithm as encodeDxt1Block_fast_simd, with one block per lane (8 blocks at once).
+// The floating point operations are performed in the same order as in the
+// single block version, so that both produce bit-identical blocks.
+//
+// rgba: 8 consecutive blocks of 16 texels (8 x 64 bytes)
+// blocks: 8 output blocks of 8 bytes, block_stride bytes apart
+
+static inline void encodeEightDxt1Blocks_fast_avx2(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride)
+{
+	const __m256i mask_8_bits = _mm256_set1_epi32(0x000000ff);
+	const __m256 ZERO = _mm256_setzero_ps();
+	const __m256 PERCEPTUAL_COEFF[3] = {
+		_mm256_set1_ps(0.114f),
+		_mm256_set1_ps(0.587f),
+		_mm256_set1_ps(0.299f)
+	};
+	const __m256 INV_PERCEPTUAL_COEFF[3] = {
+		_mm256_set1_ps(31.0f / 255.0f / 0.114f),
+		_mm256_set1_ps(63.0f / 255.0f / 0.587f),
+		_mm256_set1_ps(31.0f / 255.0f / 0.299f)
+	};
+	const __m256 CLAMP_31 = _mm256_set1_ps(31.0f);
+	const __m256 CLAMP_63 = _mm256_set1_ps(63.0f);
+
+	// read colors, transpose (one block per lane) and multiply by a perceptual coefficient
+
+	__m256 q_pixels[4][4][3];	// [row][column][channel]
+
+	for(int row = 0; row < 4; ++row) {
+		__m256i block_rows[4];	// blocks 0-3 in the lower half, blocks 4-7 in the upper half
+		for(int b = 0; b < 4; ++b)
+			block_rows[b] = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(rgba + 64*b + 16*row))),
+				_mm_loadu_si128((const __m128i *)(rgba + 64*(b + 4) + 16*row)), 1);
+
+		__m256i t0 = _mm256_unpacklo_epi32(block_rows[0], block_rows[1]);
+		__m256i t1 = _mm256_unpacklo_epi32(block_rows[2], block_rows[3]);
+		__m256i t2 = _mm256_unpackhi_epi32(block_rows[0], block_rows[1]);
+		__m256i t3 = _mm256_unpackhi_epi32(block_rows[2], block_rows[3]);
+
+		__m256i texels[4] = {
+			_mm256_unpacklo_epi64(t0, t1),
+			_mm256_unpackhi_epi64(t0, t1),
+			_mm256_unpacklo_epi64(t2, t3),
+			_mm256_unpackhi_epi64(t2, t3)
+		};
+
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(texels[col], mask_8_bits)), PERCEPTUAL_COEFF[0]);
+			q_pixels[row][col][1] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels[col], 8), mask_8_bits)), PERCEPTUAL_COEFF[1]);
+			q_pixels[row][col][2] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels[col], 16), mask_8_bits)), PERCEPTUAL_COEFF[2]);
+		}
+	}
+
+	// calculate bounding box
+
+	__m256 min[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	__m256 max[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			for(int c = 0; c < 3; ++c) {
+				min[c] = _mm256_min_ps(min[c], q_pixels[row][col][c]);
+				max[c] = _mm256_max_ps(max[c], q_pixels[row][col][c]);
+			}
+		}
+	}
+
+	// single color?
+	__m256i single_color_mask = _mm256_castps_si256(
+		_mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(min[0], max[0], _CMP_EQ_OQ), _mm256_cmp_ps(min[1], max[1], _CMP_EQ_OQ)),
+			_mm256_cmp_ps(min[2], max[2], _CMP_EQ_OQ)));
+
+	// calculate centroid (same summation order as the single block version)
+
+	__m256 centroid[3];
+	for(int c = 0; c < 3; ++c) {
+		__m256 column_sums[4];
+		for(int col = 0; col < 4; ++col) {
+			column_sums[col] = q_pixels[0][col][c];
+			for(int row = 1; row < 4; ++row)
+				column_sums[col] = _mm256_add_ps(column_sums[col], q_pixels[row][col][c]);
+		}
+		centroid[c] = _mm256_mul_ps(
+			_mm256_add_ps(
+				_mm256_add_ps(column_sums[0], column_sums[2]),
+				_mm256_add_ps(column_sums[1], column_sums[3])),
+			_mm256_set1_ps(1.0f / 16.0f));
+	}
+
+	// move referential to centroid
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm256_sub_ps(q_pixels[row][col][0], centroid[0]);
+			q_pixels[row][col][1] = _mm256_sub_ps(q_pixels[row][col][1], centroid[1]);
+			q_pixels[row][col][2] = _mm256_sub_ps(q_pixels[row][col][2], centroid[2]);
+		}
+	}
+
+	// principal component analysis approximation: find best diagonal of the bounding box
+
+	// calculate directions for all four diagonals
+
+	__m256 any_diagonal[3] = {
+		_mm256_sub_ps(max[0], min[0]),
+		_mm256_sub_ps(max[1], min[1]),
+		_mm256_sub_ps(max[2], min[2])
+	};
+	__m256 inv_diag_norm =
+		_mm256_rsqrt_ps(
+			_mm256_add_ps(
+				_mm256_add_ps(
+					_mm256_mul_ps(any_diagonal[0], any_diagonal[0]),
+					_mm256_mul_ps(any_diagonal[1], any_diagonal[1])
+				),
+				_mm256_mul_ps(any_diagonal[2], any_diagonal[2])
+			)
+		);
+	any_diagonal[0] = _mm256_mul_ps(any_diagonal[0], inv_diag_norm);
+	any_diagonal[1] = _mm256_mul_ps(any_diagonal[1], inv_diag_norm);
+	any_diagonal[2] = _mm256_mul_ps(any_diagonal[2], inv_diag_norm);
+
+	__m256 diags[4][3] = {
+		{ any_diagonal[0], any_diagonal[1], any_diagonal[2] },
+		{ any_diagonal[0], any_diagonal[1], INVERSE_SIGN(any_diagonal[2]) },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), any_diagonal[2] },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), INVERSE_SIGN(any_diagonal[2]) }
+	};
+
+	// for each diagonal calculate the projection of each colour
+	// (the four diagonals only differ by the signs of their last two components,
+	// so the products are shared between them)
+
+	__m256 min_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+	__m256 max_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			__m256 product0 = _mm256_mul_ps(q_pixels[row][col][0], diags[0][0]);
+			__m256 product1 = _mm256_mul_ps(q_pixels[row][col][1], diags[0][1]);
+			__m256 product1_inv = _mm256_mul_ps(q_pixels[row][col][1], diags[2][1]);
+			__m256 product2 = _mm256_mul_ps(q_pixels[row][col][2], diags[0][2]);
+			__m256 product2_inv = _mm256_mul_ps(q_pixels[row][col][2], diags[1][2]);
+
+			__m256 dot_products[4] = {
+				_mm256_add_ps(product0, _mm256_add_ps(product1, product2)),
+				_mm256_add_ps(product0, _mm256_add_ps(product1, product2_inv)),
+				_mm256_add_ps(product0, _mm256_add_ps(product1_inv, product2)),
+				_mm256_add_ps(product0, _mm256_add_ps(product1_inv, product2_inv))
+			};
+			for(int diag_choice = 0; diag_choice < 4; ++diag_choice) {
+				min_dot_product[diag_choice] = _mm256_min_ps(min_dot_product[diag_choice], dot_products[diag_choice]);
+				max_dot_product[diag_choice] = _mm256_max_ps(max_dot_product[diag_choice], dot_products[diag_choice]);
+			}
+		}
+	}
+
+	// keep the most discriminating diagonal (i.e. biggest difference between least and greatest dot products)
+	// the first diagonal is the default choice, as in the single block version
+
+	__m256 largest_dot_product_difference = _mm256_sub_ps(max_dot_product[0], min_dot_product[0]);
+	__m256 best_min_dot_product = min_dot_product[0];
+	__m256 best_max_dot_product = max_dot_product[0];
+	__m256 best_diag[3] = { diags[0][0], diags[0][1], diags[0][2] };
+
+	for(int diag_choice = 1; diag_choice < 4; ++diag_choice) {
+		__m256 dot_product_difference = _mm256_sub_ps(max_dot_product[diag_choice], min_dot_product[diag_choice]);
+		__m256 is_better = _mm256_cmp_ps(largest_dot_product_difference, dot_product_difference, _CMP_LT_OQ);
+
+		largest_dot_product_difference = SELECT(is_better, dot_product_difference, largest_dot_product_difference);
+		best_min_dot_product = SELECT(is_better, min_dot_product[diag_choice], best_min_dot_product);
+		best_max_dot_product = SELECT(is_better, max_dot_product[diag_choice], best_max_dot_product);
+		best_diag[1] = SELECT(is_better, diags[diag_choice][1], best_diag[1]);
+		best_diag[2] = SELECT(is_better, diags[diag_choice][2], best_diag[2]);
+	}
+
+	// choose extreme positions as start and end colors, round and clamp values
+
+	__m256i start_color_rounded[3], end_color_rounded[3];
+	start_color_rounded[0] = _mm256_cvtps_epi32(_mm256_max_ps(ZERO, _mm256_min_ps(CLAMP_31, _mm256_mul_ps(INV_PERCEPTUAL_COEFF[0], _mm256_add_ps(centroid[0], _mm256_mul_ps(best_max_dot_product, best_diag[0]))))));
+	start_color_rounded[1] = _mm256_cvtps_epi32(_mm256_max_ps(ZERO, _mm256_min_ps(CLAMP_63, _mm256_mul_ps(INV_PERCEPTUAL_COEFF[1], _mm256_add_ps(centroid[1], _mm256_mul_ps(best_max_dot_product, best_diag[1]))))));
+	start_color_rounded[2] = _mm256_cvtps_epi32(_mm256_max_ps(ZERO, _mm256_min_ps(CLAMP_31, _mm256_mul_ps(INV_PERCEPTUAL_COEFF[2], _mm256_add_ps(centroid[2], _mm256_mul_ps(best_max_dot_product, best_diag[2]))))));
+
+	end_color_rounded[0] = _mm256_cvtps_epi32(_mm256_max_ps(ZERO, _mm256_min_ps(CLAMP_31, _mm256_mul_ps(INV_PERCEPTUAL_COEFF[0], _mm256_add_ps(centroid[0], _mm256_mul_ps(best_min_dot_product, best_diag[0]))))));
+	end_color_rounded[1] = _mm256_cvtps_epi32(_mm256_max_ps(ZERO, _mm256_min_ps(CLAMP_63, _mm256_mul_ps(INV_PERCEPTUAL_COEFF[1], _mm256_add_ps(centroid[1], _mm256_mul_ps(best_min_dot_product, best_diag[1]))))));
+	end_color_rounded[2] = _mm256_cvtps_epi32(_mm256_max_ps(ZERO, _mm256_min_ps(CLAMP_31, _mm256_mul_ps(INV_PERCEPTUAL_COEFF[2], _mm256_add_ps(centroid[2], _mm256_mul_ps(best_min_dot_product, best_diag[2]))))));
+
+	// convert to R5G6B5 format
+
+	__m256i start = _mm256_or_si256(_mm256_or_si256(
+		start_color_rounded[2],
+		_mm256_slli_epi32(start_color_rounded[1], 5)),
+		_mm256_slli_epi32(start_color_rounded[0], 11));
+	__m256i end = _mm256_or_si256(_mm256_or_si256(
+		end_color_rounded[2],
+		_mm256_slli_epi32(end_color_rounded[1], 5)),
+		_mm256_slli_epi32(end_color_rounded[0], 11));
+
+	// map each color to the indice of the closest position, and convert to DXT1 codes (last texel in the upper bits)
+	// (code = (-index & 3) ^ (index == 0 || index == 3), see DXT1_CODES_4 in dxt_simd.cpp)
+
+	__m256i indices = _mm256_setzero_si256();
+	__m256 coeff = _mm256_mul_ps(_mm256_set1_ps(3.0f), _mm256_rcp_ps(largest_dot_product_difference));
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i three = _mm256_set1_epi32(3);
+	for(int row = 3; row >= 0; --row) {
+		for(int col = 3; col >= 0; --col) {
+			__m256 dot_product =
+				_mm256_add_ps(
+					_mm256_mul_ps(q_pixels[row][col][0], best_diag[0]),
+					_mm256_add_ps(
+						_mm256_mul_ps(q_pixels[row][col][1], best_diag[1]),
+						_mm256_mul_ps(q_pixels[row][col][2], best_diag[2])
+					)
+				);
+			__m256i index = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sub_ps(dot_product, best_min_dot_product), coeff));
+			__m256i code = _mm256_xor_si256(
+				_mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), index), three),
+				_mm256_xor_si256(_mm256_and_si256(_mm256_srli_epi32(_mm256_add_epi32(index, one), 1), one), one));
+			indices = _mm256_or_si256(_mm256_slli_epi32(indices, 2), code);
+		}
+	}
+
+	// reverse start and end to stay in four colors mode,
+	// or clear the indices in the degenerate case where the colors end up being the same when rounded down
+
+	__m256i start_equals_end = _mm256_cmpeq_epi32(start, end);
+	__m256i start_lower_than_end = _mm256_cmpgt_epi32(end, start);
+	__m256i color0 = SELECT_EPI32(start_lower_than_end, end, start);
+	__m256i color1 = SELECT_EPI32(start_lower_than_end, start, end);
+	indices = _mm256_xor_si256(indices, _mm256_and_si256(start_lower_than_end, _mm256_set1_epi32(0x55555555)));
+	indices = _mm256_andnot_si256(start_equals_end, indices);
+
+	// single color blocks
+
+	__m256i first_texels = _mm256_i32gather_epi32((const int *)rgba, _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112), 4);
+	__m256i single_color = _mm256_or_si256(_mm256_or_si256(
+		_mm256_srli_epi32(_mm256_and_si256(_mm256_srli_epi32(first_texels, 16), mask_8_bits), 3),
+		_mm256_slli_epi32(_mm256_srli_epi32(_mm256_and_si256(_mm256_srli_epi32(first_texels, 8), mask_8_bits), 2), 5)),
+		_mm256_slli_epi32(_mm256_srli_epi32(_mm256_and_si256(first_texels, mask_8_bits), 3), 11));
+
+	color0 = SELECT_EPI32(single_color_mask, single_color, color0);
+	color1 = SELECT_EPI32(single_color_mask, single_color, color1);
+	indices = _mm256_andnot_si256(single_color_mask, indices);
+
+	// write block bits
+
+	__m256i endpoints = _mm256_or_si256(color0, _mm256_slli_epi32(color1, 16));
+	__m256i blocks0145 = _mm256_unpacklo_epi32(endpoints, indices);
+	__m256i blocks2367 = _mm256_unpackhi_epi32(endpoints, indices);
+	__m128i blocks01 = _mm256_castsi256_si128(blocks0145);
+	__m128i blocks45 = _mm256_extracti128_si256(blocks0145, 1);
+	__m128i blocks23 = _mm256_castsi256_si128(blocks2367);
+	__m128i blocks67 = _mm256_extracti128_si256(blocks2367, 1);
+	_mm_storel_epi64((__m128i *)(blocks + 0 * block_stride), blocks01);
+	_mm_storel_epi64((__m128i *)(blocks + 1 * block_stride), _mm_srli_si128(blocks01, 8));
+	_mm_storel_epi64((__m128i *)(blocks + 2 * block_stride), blocks23);
+	_mm_storel_epi64((__m128i *)(blocks + 3 * block_stride), _mm_srli_si128(blocks23, 8));
+	_mm_storel_epi64((__m128i *)(blocks + 4 * block_stride), blocks45);
+	_mm_storel_epi64((__m128i *)(blocks + 5 * block_stride), _mm_srli_si128(blocks45, 8));
+	_mm_storel_epi64((__m128i *)(blocks + 6 * block_stride), blocks67);
+	_mm_storel_epi64((__m128i *)(blocks + 7 * block_stride), _mm_srli_si128(blocks67, 8));
+}
+
+void __fastcall encodeDxt1Blocks_fast_avx2(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	for(size_t i = 0; i < block_count; i += 8)
+		encodeEightDxt1Blocks_fast_avx2(rgba + 64 * i, blocks + block_stride * i, block_stride);
+}
+
+// Sum of the 16 texels of each block from their column sums,
+// in the order of HORIZONTAL_ADD in the single block version
+
+static inline __m256 add_columns(const __m256 column_sums[4])
+{
+	return _mm256_add_ps(
+		_mm256_add_ps(column_sums[0], column_sums[2]),
+		_mm256_add_ps(column_sums[1], column_sums[3]));
+}
+
+// Same algorithm as encodeDxt1Block_quality_simd, with one block per lane (8 blocks at once).
+// The floating point operations are performed in the same order as in the
+// single block version, so that both produce bit-identical blocks.
+//
+// rgba: 8 consecutive blocks of 16 texels (8 x 64 bytes)
+// blocks: 8 output blocks of 8 bytes, block_stride bytes apart
+
+static inline void encodeEightDxt1Blocks_quality_avx2(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride)
+{
+	const __m256i mask_8_bits = _mm256_set1_epi32(0x000000ff);
+	const __m256 ZERO = _mm256_setzero_ps();
+	const __m256 THREE = _mm256_set1_ps(3.0f);
+	const __m256 ONE_THIRD = _mm256_set1_ps(1.0f / 3.0f);
+
+	// read colors and transpose (one block per lane, no perceptual coefficient)
+
+	__m256 q_pixels[4][4][3];	// [row][column][channel]
+
+	for(int row = 0; row < 4; ++row) {
+		__m256i block_rows[4];	// blocks 0-3 in the lower half, blocks 4-7 in the upper half
+		for(int b = 0; b < 4; ++b)
+			block_rows[b] = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(rgba + 64*b + 16*row))),
+				_mm_loadu_si128((const __m128i *)(rgba + 64*(b + 4) + 16*row)), 1);
+
+		__m256i t0 = _mm256_unpacklo_epi32(block_rows[0], block_rows[1]);
+		__m256i t1 = _mm256_unpacklo_epi32(block_rows[2], block_rows[3]);
+		__m256i t2 = _mm256_unpackhi_epi32(block_rows[0], block_rows[1]);
+		__m256i t3 = _mm256_unpackhi_epi32(block_rows[2], block_rows[3]);
+
+		__m256i texels[4] = {
+			_mm256_unpacklo_epi64(t0, t1),
+			_mm256_unpackhi_epi64(t0, t1),
+			_mm256_unpacklo_epi64(t2, t3),
+			_mm256_unpackhi_epi64(t2, t3)
+		};
+
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm256_cvtepi32_ps(_mm256_and_si256(texels[col], mask_8_bits));
+			q_pixels[row][col][1] = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels[col], 8), mask_8_bits));
+			q_pixels[row][col][2] = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels[col], 16), mask_8_bits));
+		}
+	}
+
+	// calculate bounding box
+
+	__m256 min[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	__m256 max[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			for(int c = 0; c < 3; ++c) {
+				min[c] = _mm256_min_ps(min[c], q_pixels[row][col][c]);
+				max[c] = _mm256_max_ps(max[c], q_pixels[row][col][c]);
+			}
+		}
+	}
+
+	// single color?
+	__m256i single_color_mask = _mm256_castps_si256(
+		_mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(min[0], max[0], _CMP_EQ_OQ), _mm256_cmp_ps(min[1], max[1], _CMP_EQ_OQ)),
+			_mm256_cmp_ps(min[2], max[2], _CMP_EQ_OQ)));
+
+	// calculate centroid
+
+	__m256 centroid[3];
+	for(int c = 0; c < 3; ++c) {
+		__m256 column_sums[4];
+		for(int col = 0; col < 4; ++col) {
+			column_sums[col] = q_pixels[0][col][c];
+			for(int row = 1; row < 4; ++row)
+				column_sums[col] = _mm256_add_ps(column_sums[col], q_pixels[row][col][c]);
+		}
+		centroid[c] = _mm256_mul_ps(add_columns(column_sums), _mm256_set1_ps(1.0f / 16.0f));
+	}
+
+	// move referential to centroid
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm256_sub_ps(q_pixels[row][col][0], centroid[0]);
+			q_pixels[row][col][1] = _mm256_sub_ps(q_pixels[row][col][1], centroid[1]);
+			q_pixels[row][col][2] = _mm256_sub_ps(q_pixels[row][col][2], centroid[2]);
+		}
+	}
+
+	// principal component analysis approximation: find best diagonal of the bounding box
+
+	// calculate directions for all four diagonals
+
+	__m256 any_diagonal[3] = {
+		_mm256_sub_ps(max[0], min[0]),
+		_mm256_sub_ps(max[1], min[1]),
+		_mm256_sub_ps(max[2], min[2])
+	};
+	__m256 inv_diag_norm =
+		_mm256_rsqrt_ps(
+			_mm256_add_ps(
+				_mm256_add_ps(
+					_mm256_mul_ps(any_diagonal[0], any_diagonal[0]),
+					_mm256_mul_ps(any_diagonal[1], any_diagonal[1])
+				),
+				_mm256_mul_ps(any_diagonal[2], any_diagonal[2])
+			)
+		);
+	any_diagonal[0] = _mm256_mul_ps(any_diagonal[0], inv_diag_norm);
+	any_diagonal[1] = _mm256_mul_ps(any_diagonal[1], inv_diag_norm);
+	any_diagonal[2] = _mm256_mul_ps(any_diagonal[2], inv_diag_norm);
+
+	__m256 diags[4][3] = {
+		{ any_diagonal[0], any_diagonal[1], any_diagonal[2] },
+		{ any_diagonal[0], any_diagonal[1], INVERSE_SIGN(any_diagonal[2]) },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), any_diagonal[2] },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), INVERSE_SIGN(any_diagonal[2]) }
+	};
+
+	// for each diagonal calculate the projection of each colour
+	// (the four diagonals only differ by the signs of their last two components,
+	// so the products are shared between them)
+
+	__m256 min_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+	__m256 max_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			__m256 product0 = _mm256_mul_ps(q_pixels[row][col][0], diags[0][0]);
+			__m256 product1 = _mm256_mul_ps(q_pixels[row][col][1], diags[0][1]);
+			__m256 product1_inv = _mm256_mul_ps(q_pixels[row][col][1], diags[2][1]);
+			__m256 product2 = _mm256_mul_ps(q_pixels[row][col][2], diags[0][2]);
+			__m256 product2_inv = _mm256_mul_ps(q_pixels[row][col][2], diags[1][2]);
+
+			__m256 dot_products[4] = {
+				_mm256_add_ps(product0, _mm256_add_ps(product1, product2)),
+				_mm256_add_ps(product0, _mm256_add_ps(product1, product2_inv)),
+				_mm256_add_ps(product0, _mm256_add_ps(product1_inv, product2)),
+				_mm256_add_ps(product0, _mm256_add_ps(product1_inv, product2_inv))
+			};
+			for(int diag_choice = 0; diag_choice < 4; ++diag_choice) {
+				min_dot_product[diag_choice] = _mm256_min_ps(min_dot_product[diag_choice], dot_products[diag_choice]);
+				max_dot_product[diag_choice] = _mm256_max_ps(max_dot_product[diag_choice], dot_products[diag_choice]);
+			}
+		}
+	}
+
+	// keep the most discriminating diagonal (i.e. biggest difference between least and greatest dot products)
+	// the first diagonal is the default choice, as in the single block version
+
+	__m256 largest_dot_product_difference = _mm256_sub_ps(max_dot_product[0], min_dot_product[0]);
+	__m256 best_min_dot_product = min_dot_product[0];
+	__m256 best_diag[3] = { diags[0][0], diags[0][1], diags[0][2] };
+
+	for(int diag_choice = 1; diag_choice < 4; ++diag_choice) {
+		__m256 dot_product_difference = _mm256_sub_ps(max_dot_product[diag_choice], min_dot_product[diag_choice]);
+		__m256 is_better = _mm256_cmp_ps(largest_dot_product_difference, dot_product_difference, _CMP_LT_OQ);
+
+		largest_dot_product_difference = SELECT(is_better, dot_product_difference, largest_dot_product_difference);
+		best_min_dot_product = SELECT(is_better, min_dot_product[diag_choice], best_min_dot_product);
+		best_diag[1] = SELECT(is_better, diags[diag_choice][1], best_diag[1]);
+		best_diag[2] = SELECT(is_better, diags[diag_choice][2], best_diag[2]);
+	}
+
+	// map each color to the indice of the closest position
+
+	__m256i indices[4][4];
+	__m256 coeff = _mm256_mul_ps(THREE, _mm256_rcp_ps(largest_dot_product_difference));
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			__m256 dot_product =
+				_mm256_add_ps(
+					_mm256_mul_ps(q_pixels[row][col][0], best_diag[0]),
+					_mm256_add_ps(
+						_mm256_mul_ps(q_pixels[row][col][1], best_diag[1]),
+						_mm256_mul_ps(q_pixels[row][col][2], best_diag[2])
+					)
+				);
+			indices[row][col] = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sub_ps(dot_product, best_min_dot_product), coeff));
+		}
+	}
+
+	__m256 clamp_min[3] = {
+		INVERSE_SIGN(centroid[0]),
+		INVERSE_SIGN(centroid[1]),
+		INVERSE_SIGN(centroid[2])
+	};
+	__m256 clamp_max[3] = {
+		_mm256_sub_ps(_mm256_set1_ps(255.0f), centroid[0]),
+		_mm256_sub_ps(_mm256_set1_ps(255.0f), centroid[1]),
+		_mm256_sub_ps(_mm256_set1_ps(255.0f), centroid[2])
+	};
+
+	__m256 start_color[3], end_color[3];
+
+	// refine using Least Squares (see encodeDxt1Block_quality_simd)
+	for(int iteration = 0; iteration < 3; ++iteration) {
+		__m256 column_S_alpha[4], column_S_alpha_2[4], column_S_alpha_pixel[3][4];
+		for(int col = 0; col < 4; ++col) {
+			__m256 alpha = _mm256_mul_ps(_mm256_cvtepi32_ps(indices[0][col]), ONE_THIRD);
+			column_S_alpha[col] = alpha;
+			column_S_alpha_2[col] = _mm256_mul_ps(alpha, alpha);
+			for(int c = 0; c < 3; ++c)
+				column_S_alpha_pixel[c][col] = _mm256_mul_ps(alpha, q_pixels[0][col][c]);
+			for(int row = 1; row < 4; ++row) {
+				alpha = _mm256_mul_ps(_mm256_cvtepi32_ps(indices[row][col]), ONE_THIRD);
+
+				column_S_alpha[col] = _mm256_add_ps(column_S_alpha[col], alpha);
+				column_S_alpha_2[col] = _mm256_add_ps(column_S_alpha_2[col], _mm256_mul_ps(alpha, alpha));
+				for(int c = 0; c < 3; ++c)
+					column_S_alpha_pixel[c][col] = _mm256_add_ps(column_S_alpha_pixel[c][col], _mm256_mul_ps(alpha, q_pixels[row][col][c]));
+			}
+		}
+		__m256 S_alpha = add_columns(column_S_alpha);
+		__m256 S_alpha_2 = add_columns(column_S_alpha_2);
+		__m256 S_alpha_pixel[3] = {
+			add_columns(column_S_alpha_pixel[0]),
+			add_columns(column_S_alpha_pixel[1]),
+			add_columns(column_S_alpha_pixel[2])
+		};
+
+		// calculations are simplified by the fact that beta[i] == (1 - alpha[i])
+		__m256 S_alpha_beta = _mm256_sub_ps(S_alpha, S_alpha_2);
+		__m256 S_beta_2 = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(16.0f), S_alpha), S_alpha_beta);
+
+		__m256 factor = _mm256_rcp_ps(_mm256_sub_ps(_mm256_mul_ps(S_alpha_2, S_beta_2), _mm256_mul_ps(S_alpha_beta, S_alpha_beta)));
+		__m256 start_factor = _mm256_mul_ps(_mm256_add_ps(S_beta_2, S_alpha_beta), factor);
+		__m256 end_factor = _mm256_sub_ps(ZERO, _mm256_mul_ps(_mm256_add_ps(S_alpha_2, S_alpha_beta), factor));
+
+		// compute start and end color, and clamp to [0, 255]
+
+		for(int c = 0; c < 3; ++c) {
+			start_color[c] = _mm256_max_ps(clamp_min[c], _mm256_min_ps(clamp_max[c], _mm256_mul_ps(start_factor, S_alpha_pixel[c])));
+			end_color[c] = _mm256_max_ps(clamp_min[c], _mm256_min_ps(clamp_max[c], _mm256_mul_ps(end_factor, S_alpha_pixel[c])));
+		}
+
+		// recalculate indexes
+		// map each color to the indice of the closest position
+
+		__m256 segment[3] = {
+			_mm256_sub_ps(start_color[0], end_color[0]),
+			_mm256_sub_ps(start_color[1], end_color[1]),
+			_mm256_sub_ps(start_color[2], end_color[2])
+		};
+		__m256 segment_norm_2 =
+			_mm256_add_ps(
+				_mm256_add_ps(
+					_mm256_mul_ps(segment[0], segment[0]),
+					_mm256_mul_ps(segment[1], segment[1])
+				),
+				_mm256_mul_ps(segment[2], segment[2])
+			);
+		// coefficient used to pre-multiply dot product result == 3/(norm^2)
+		__m256 coeff = _mm256_mul_ps(THREE, _mm256_rcp_ps(segment_norm_2));
+		segment[0] = _mm256_mul_ps(segment[0], coeff);
+		segment[1] = _mm256_mul_ps(segment[1], coeff);
+		segment[2] = _mm256_mul_ps(segment[2], coeff);
+
+		for(int row = 0; row < 4; ++row) {
+			for(int col = 0; col < 4; ++col) {
+				// calculate dot product (pre-multiplied by 3/norm)
+				__m256 dot_product =
+					_mm256_add_ps(
+						_mm256_mul_ps(_mm256_sub_ps(q_pixels[row][col][0], end_color[0]), segment[0]),
+						_mm256_add_ps(
+							_mm256_mul_ps(_mm256_sub_ps(q_pixels[row][col][1], end_color[1]), segment[1]),
+							_mm256_mul_ps(_mm256_sub_ps(q_pixels[row][col][2], end_color[2]), segment[2])
+						)
+					);
+				// round and clamp values
+				indices[row][col] = _mm256_cvtps_epi32(_mm256_max_ps(ZERO, _mm256_min_ps(THREE, dot_product)));
+			}
+		}
+	}
+
+	// reset referential away from centroid and round (no need to clamp, it's already done)
+
+	__m256i start_color_rounded[3], end_color_rounded[3];
+
+	start_color_rounded[0] = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_set1_ps(31.0f / 255.0f), _mm256_add_ps(centroid[0], start_color[0])));
+	start_color_rounded[1] = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_set1_ps(63.0f / 255.0f), _mm256_add_ps(centroid[1], start_color[1])));
+	start_color_rounded[2] = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_set1_ps(31.0f / 255.0f), _mm256_add_ps(centroid[2], start_color[2])));
+
+	end_color_rounded[0] = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_set1_ps(31.0f / 255.0f), _mm256_add_ps(centroid[0], end_color[0])));
+	end_color_rounded[1] = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_set1_ps(63.0f / 255.0f), _mm256_add_ps(centroid[1], end_color[1])));
+	end_color_rounded[2] = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_set1_ps(31.0f / 255.0f), _mm256_add_ps(centroid[2], end_color[2])));
+
+	// convert to R5G6B5 format (truncated to 16 bits as in the single block version)
+
+	const __m256i mask_16_bits = _mm256_set1_epi32(0x0000ffff);
+	__m256i start = _mm256_and_si256(mask_16_bits, _mm256_or_si256(_mm256_or_si256(
+		start_color_rounded[2],
+		_mm256_slli_epi32(start_color_rounded[1], 5)),
+		_mm256_slli_epi32(start_color_rounded[0], 11)));
+	__m256i end = _mm256_and_si256(mask_16_bits, _mm256_or_si256(_mm256_or_si256(
+		end_color_rounded[2],
+		_mm256_slli_epi32(end_color_rounded[1], 5)),
+		_mm256_slli_epi32(end_color_rounded[0], 11)));
+
+	// convert the indices to DXT1 codes (last texel in the upper bits)
+	// (code = (-index & 3) ^ (index == 0 || index == 3), see DXT1_CODES_4 in dxt_simd.cpp)
+
+	__m256i codes = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i three = _mm256_set1_epi32(3);
+	for(int row = 3; row >= 0; --row) {
+		for(int col = 3; col >= 0; --col) {
+			__m256i index = indices[row][col];
+			__m256i code = _mm256_xor_si256(
+				_mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), index), three),
+				_mm256_xor_si256(_mm256_and_si256(_mm256_srli_epi32(_mm256_add_epi32(index, one), 1), one), one));
+			codes = _mm256_or_si256(_mm256_slli_epi32(codes, 2), code);
+		}
+	}
+
+	// reverse start and end to stay in four colors mode,
+	// or clear the codes in the degenerate case where the colors end up being the same when rounded down
+
+	__m256i start_equals_end = _mm256_cmpeq_epi32(start, end);
+	__m256i start_lower_than_end = _mm256_cmpgt_epi32(end, start);
+	__m256i color0 = SELECT_EPI32(start_lower_than_end, end, start);
+	__m256i color1 = SELECT_EPI32(start_lower_than_end, start, end);
+	codes = _mm256_xor_si256(codes, _mm256_and_si256(start_lower_than_end, _mm256_set1_epi32(0x55555555)));
+	codes = _mm256_andnot_si256(start_equals_end, codes);
+
+	// single color blocks
+
+	__m256i first_texels = _mm256_i32gather_epi32((const int *)rgba, _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112), 4);
+	__m256i single_color = _mm256_or_si256(_mm256_or_si256(
+		_mm256_srli_epi32(_mm256_and_si256(_mm256_srli_epi32(first_texels, 16), mask_8_bits), 3),
+		_mm256_slli_epi32(_mm256_srli_epi32(_mm256_and_si256(_mm256_srli_epi32(first_texels, 8), mask_8_bits), 2), 5)),
+		_mm256_slli_epi32(_mm256_srli_epi32(_mm256_and_si256(first_texels, mask_8_bits), 3), 11));
+
+	color0 = SELECT_EPI32(single_color_mask, single_color, color0);
+	color1 = SELECT_EPI32(single_color_mask, single_color, color1);
+	codes = _mm256_andnot_si256(single_color_mask, codes);
+
+	// write block bits
+
+	__m256i endpoints = _mm256_or_si256(color0, _mm256_slli_epi32(color1, 16));
+	__m256i blocks0145 = _mm256_unpacklo_epi32(endpoints, codes);
+	__m256i blocks2367 = _mm256_unpackhi_epi32(endpoints, codes);
+	__m128i blocks01 = _mm256_castsi256_si128(blocks0145);
+	__m128i blocks45 = _mm256_extracti128_si256(blocks0145, 1);
+	__m128i blocks23 = _mm256_castsi256_si128(blocks2367);
+	__m128i blocks67 = _mm256_extracti128_si256(blocks2367, 1);
+	_mm_storel_epi64((__m128i *)(blocks + 0 * block_stride), blocks01);
+	_mm_storel_epi64((__m128i *)(blocks + 1 * block_stride), _mm_srli_si128(blocks01, 8));
+	_mm_storel_epi64((__m128i *)(blocks + 2 * block_stride), blocks23);
+	_mm_storel_epi64((__m128i *)(blocks + 3 * block_stride), _mm_srli_si128(blocks23, 8));
+	_mm_storel_epi64((__m128i *)(blocks + 4 * block_stride), blocks45);
+	_mm_storel_epi64((__m128i *)(blocks + 5 * block_stride), _mm_srli_si128(blocks45, 8));
+	_mm_storel_epi64((__m128i *)(blocks + 6 * block_stride), blocks67);
+	_mm_storel_epi64((__m128i *)(blocks + 7 * block_stride), _mm_srli_si128(blocks67, 8));
+}
+
+void __fastcall encodeDxt1Blocks_quality_avx2(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	for(size_t i = 0; i < block_count; i += 8)
+		encodeEightDxt1Blocks_quality_avx2(rgba + 64 * i, blocks + block_stride * i, block_stride);
+}
+
+// DXT5 alpha blocks, on 16-bit integer lanes (the 16 alphas of a block in one register)
+// Same computations as encodeDxt5AlphaBlocks_simd, see dxt_simd.cpp for the details.
+
+static inline __m256i quantize_alpha_avx2(
+	__m256i alpha, __m256i base, __m256i step_count, __m256i distance)
+{
+	const __m256i distance_2 = _mm256_add_epi16(distance, distance);
+	const __m256i distance_4 = _mm256_add_epi16(distance_2, distance_2);
+	const __m256i one = _mm256_set1_epi16(1);
+
+	__m256i t = _mm256_add_epi16(
+		_mm256_mullo_epi16(_mm256_sub_epi16(alpha, base), step_count),
+		_mm256_srli_epi16(distance, 1));
+
+	__m256i ge = _mm256_cmpgt_epi16(t, _mm256_sub_epi16(distance_4, one));
+	__m256i index = _mm256_and_si256(ge, _mm256_set1_epi16(4));
+	t = _mm256_sub_epi16(t, _mm256_and_si256(ge, distance_4));
+	ge = _mm256_cmpgt_epi16(t, _mm256_sub_epi16(distance_2, one));
+	index = _mm256_or_si256(index, _mm256_and_si256(ge, _mm256_set1_epi16(2)));
+	t = _mm256_sub_epi16(t, _mm256_and_si256(ge, distance_2));
+	ge = _mm256_cmpgt_epi16(t, _mm256_sub_epi16(distance, one));
+	return _mm256_or_si256(index, _mm256_and_si256(ge, one));
+}
+
+static inline __m256i get_codes_8_avx2(__m256i index)
+{
+	const __m256i code = _mm256_and_si256(_mm256_sub_epi16(_mm256_setzero_si256(), index), _mm256_set1_epi16(7));
+	return _mm256_xor_si256(code, _mm256_and_si256(_mm256_cmpgt_epi16(_mm256_set1_epi16(2), code), _mm256_set1_epi16(1)));
+}
+
+static inline __m256i get_codes_6_avx2(__m256i index, __m256i alpha)
+{
+	__m256i code = _mm256_add_epi16(index, _mm256_set1_epi16(1));
+	code = SELECT_EPI32(_mm256_cmpeq_epi16(index, _mm256_setzero_si256()), _mm256_setzero_si256(), code);
+	code = SELECT_EPI32(_mm256_cmpeq_epi16(index, _mm256_set1_epi16(5)), _mm256_set1_epi16(1), code);
+	code = SELECT_EPI32(_mm256_cmpeq_epi16(alpha, _mm256_setzero_si256()), _mm256_set1_epi16(6), code);
+	return SELECT_EPI32(_mm256_cmpeq_epi16(alpha, _mm256_set1_epi16(255)), _mm256_set1_epi16(7), code);
+}
+
+// smallest of the 16 lanes
+static inline unsigned int horizontal_min_epu16(__m256i x)
+{
+	return (unsigned int) _mm_cvtsi128_si32(_mm_minpos_epu16(
+		_mm_min_epu16(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1)))) & 0xffff;
+}
+
+void __fastcall encodeDxt5AlphaBlocks_avx2(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha_255 = _mm256_set1_epi16(255);
+	const __m256i pair_factors = _mm256_set1_epi32(0x00080001);	// (1, 8) on 16-bit lanes
+	const __m128i quad_factors = _mm_set_epi16(64, 1, 64, 1, 64, 1, 64, 1);
+	const __m128i octet_factors = _mm_set_epi16(4096, 1, 4096, 1, 4096, 1, 4096, 1);
+
+	for(size_t i = 0; i < block_count; ++i, rgba += 64, blocks += block_stride) {
+		// the 16 alphas of the block, in texel order
+		const __m256i * texels = reinterpret_cast<const __m256i*>(rgba);
+		const __m256i alpha = _mm256_permute4x64_epi64(
+			_mm256_packs_epi32(_mm256_srli_epi32(_mm256_loadu_si256(texels + 0), 24), _mm256_srli_epi32(_mm256_loadu_si256(texels + 1), 24)),
+			_MM_SHUFFLE(3, 1, 2, 0));
+
+		// single alpha?
+		const unsigned int first_alpha = rgba[3];
+		if(-1 == _mm256_movemask_epi8(_mm256_cmpeq_epi16(alpha, _mm256_set1_epi16((short) first_alpha)))) {
+			*reinterpret_cast<unsigned int*>(blocks) = first_alpha | (first_alpha << 8);
+			*reinterpret_cast<unsigned int*>(blocks + 4) = 0x00000000;
+			continue;
+		}
+
+		unsigned int alpha_0 = 255 - horizontal_min_epu16(_mm256_sub_epi16(alpha_255, alpha));	// max
+		unsigned int alpha_1 = horizontal_min_epu16(alpha);	// min
+
+		__m256i codes;
+		if(alpha_1 == 0 && alpha_0 == 255) {
+			// 6 interpolants between the min non-0 and the max non-255 alphas
+			const __m256i min_non_0 = _mm256_or_si256(alpha, _mm256_and_si256(_mm256_cmpeq_epi16(alpha, zero), alpha_255));
+			const __m256i max_non_255 = _mm256_andnot_si256(_mm256_cmpeq_epi16(alpha, alpha_255), alpha);
+			alpha_0 = horizontal_min_epu16(min_non_0);
+			alpha_1 = 255 - horizontal_min_epu16(_mm256_sub_epi16(alpha_255, max_non_255));
+			if(alpha_0 == 255) {
+				// 0 and 255 only
+				alpha_0 = 0;
+				alpha_1 = 255;
+			}
+
+			const __m256i base = _mm256_set1_epi16((short) alpha_0);
+			const __m256i distance = _mm256_set1_epi16((short) (alpha_1 > alpha_0 ? alpha_1 - alpha_0 : 1));
+			codes = get_codes_6_avx2(quantize_alpha_avx2(alpha, base, _mm256_set1_epi16(5), distance), alpha);
+		} else {
+			// 8 interpolants between the min and max alphas
+			const __m256i base = _mm256_set1_epi16((short) alpha_1);
+			const __m256i distance = _mm256_set1_epi16((short) (alpha_0 - alpha_1));
+			codes = get_codes_8_avx2(quantize_alpha_avx2(alpha, base, _mm256_set1_epi16(7), distance));
+		}
+
+		// 16 codes of 3 bits: pairs of 6 bits, quads of 12 bits, then two octets of 24 bits
+		const __m256i pairs = _mm256_madd_epi16(codes, pair_factors);
+		__m128i bits = _mm_packs_epi32(_mm256_castsi256_si128(pairs), _mm256_extracti128_si256(pairs, 1));
+		bits = _mm_madd_epi16(bits, quad_factors);
+		bits = _mm_madd_epi16(_mm_packs_epi32(bits, bits), octet_factors);
+		const unsigned int bits_0 = _mm_cvtsi128_si32(bits);
+		const unsigned int bits_1 = _mm_cvtsi128_si32(_mm_srli_si128(bits, 4));
+
+		*reinterpret_cast<unsigned int*>(blocks) = alpha_0 | (alpha_1 << 8) | (bits_0 << 16);
+		*reinterpret_cast<unsigned int*>(blocks + 4) = (bits_0 >> 16) | (bits_1 << 8);
+	}
+}
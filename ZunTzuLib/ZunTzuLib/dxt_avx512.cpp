@@ -0,0 +1,681 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// AVX-512 execution path: this file is compiled with /arch:AVX2, /fp:precise and without the precompiled header,
+// its functions must only be called when the processor supports AVX-512F (see dxt_dispatch.cpp)
+
+#include <stddef.h>
+#include <immintrin.h>	// SIMD intrinsics
+#include "dxt_kernels.h"
+
+// SIMD macros
+
+#define INVERSE_SIGN(x) _mm512_sub_ps(_mm512_setzero_ps(), (x))
+#define SELECT(mask, x, y) _mm512_mask_blend_ps((mask), (y), (x))
+#define SELECT_EPI32(mask, x, y) _mm512_mask_blend_epi32((mask), (y), (x))
+
+// _mm512_rsqrt14_ps and _mm512_rcp14_ps are more accurate than their SSE counterparts:
+// approximate 16 lanes with two 8 lane instructions to stay bit-identical with the other paths
+
+static inline __m512 rsqrt_ps(__m512 x)
+{
+	__m256 lo = _mm256_rsqrt_ps(_mm512_castps512_ps256(x));
+	__m256 hi = _mm256_rsqrt_ps(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)));
+	return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+}
+
+static inline __m512 rcp_ps(__m512 x)
+{
+	__m256 lo = _mm256_rcp_ps(_mm512_castps512_ps256(x));
+	__m256 hi = _mm256_rcp_ps(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)));
+	return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+}
+
+// Same algorithm as encodeDxt1Block_fast_simd, with one block per lane (16 blocks at once).
+// The floating point operations are performed in the same order as in the
+// single block version, so that both produce bit-identical blocks.
+//
+// rgba: 16 consecutive blocks of 16 texels (16 x 64 bytes)
+// blocks: 16 output blocks of 8 bytes, block_stride bytes apart
+
+static inline void encodeSixteenDxt1Blocks_fast_avx512(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride)
+{
+	const __m512i mask_8_bits = _mm512_set1_epi32(0x000000ff);
+	const __m512 ZERO = _mm512_setzero_ps();
+	const __m512 PERCEPTUAL_COEFF[3] = {
+		_mm512_set1_ps(0.114f),
+		_mm512_set1_ps(0.587f),
+		_mm512_set1_ps(0.299f)
+	};
+	const __m512 INV_PERCEPTUAL_COEFF[3] = {
+		_mm512_set1_ps(31.0f / 255.0f / 0.114f),
+		_mm512_set1_ps(63.0f / 255.0f / 0.587f),
+		_mm512_set1_ps(31.0f / 255.0f / 0.299f)
+	};
+	const __m512 CLAMP_31 = _mm512_set1_ps(31.0f);
+	const __m512 CLAMP_63 = _mm512_set1_ps(63.0f);
+
+	// read colors, transpose (one block per lane) and multiply by a perceptual coefficient
+
+	__m512 q_pixels[4][4][3];	// [row][column][channel]
+
+	for(int row = 0; row < 4; ++row) {
+		__m512i block_rows[4];	// blocks b, b+4, b+8, b+12 in the four 128-bit quarters
+		for(int b = 0; b < 4; ++b) {
+			block_rows[b] = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i *)(rgba + 64*b + 16*row)));
+			block_rows[b] = _mm512_inserti32x4(block_rows[b], _mm_loadu_si128((const __m128i *)(rgba + 64*(b + 4) + 16*row)), 1);
+			block_rows[b] = _mm512_inserti32x4(block_rows[b], _mm_loadu_si128((const __m128i *)(rgba + 64*(b + 8) + 16*row)), 2);
+			block_rows[b] = _mm512_inserti32x4(block_rows[b], _mm_loadu_si128((const __m128i *)(rgba + 64*(b + 12) + 16*row)), 3);
+		}
+
+		__m512i t0 = _mm512_unpacklo_epi32(block_rows[0], block_rows[1]);
+		__m512i t1 = _mm512_unpacklo_epi32(block_rows[2], block_rows[3]);
+		__m512i t2 = _mm512_unpackhi_epi32(block_rows[0], block_rows[1]);
+		__m512i t3 = _mm512_unpackhi_epi32(block_rows[2], block_rows[3]);
+
+		__m512i texels[4] = {
+			_mm512_unpacklo_epi64(t0, t1),
+			_mm512_unpackhi_epi64(t0, t1),
+			_mm512_unpacklo_epi64(t2, t3),
+			_mm512_unpackhi_epi64(t2, t3)
+		};
+
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_and_si512(texels[col], mask_8_bits)), PERCEPTUAL_COEFF[0]);
+			q_pixels[row][col][1] = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(texels[col], 8), mask_8_bits)), PERCEPTUAL_COEFF[1]);
+			q_pixels[row][col][2] = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(texels[col], 16), mask_8_bits)), PERCEPTUAL_COEFF[2]);
+		}
+	}
+
+	// calculate bounding box
+
+	__m512 min[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	__m512 max[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			for(int c = 0; c < 3; ++c) {
+				min[c] = _mm512_min_ps(min[c], q_pixels[row][col][c]);
+				max[c] = _mm512_max_ps(max[c], q_pixels[row][col][c]);
+			}
+		}
+	}
+
+	// single color?
+	__mmask16 single_color_mask =
+		_mm512_cmp_ps_mask(min[0], max[0], _CMP_EQ_OQ) &
+		_mm512_cmp_ps_mask(min[1], max[1], _CMP_EQ_OQ) &
+		_mm512_cmp_ps_mask(min[2], max[2], _CMP_EQ_OQ);
+
+	// calculate centroid (same summation order as the single block version)
+
+	__m512 centroid[3];
+	for(int c = 0; c < 3; ++c) {
+		__m512 column_sums[4];
+		for(int col = 0; col < 4; ++col) {
+			column_sums[col] = q_pixels[0][col][c];
+			for(int row = 1; row < 4; ++row)
+				column_sums[col] = _mm512_add_ps(column_sums[col], q_pixels[row][col][c]);
+		}
+		centroid[c] = _mm512_mul_ps(
+			_mm512_add_ps(
+				_mm512_add_ps(column_sums[0], column_sums[2]),
+				_mm512_add_ps(column_sums[1], column_sums[3])),
+			_mm512_set1_ps(1.0f / 16.0f));
+	}
+
+	// move referential to centroid
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm512_sub_ps(q_pixels[row][col][0], centroid[0]);
+			q_pixels[row][col][1] = _mm512_sub_ps(q_pixels[row][col][1], centroid[1]);
+			q_pixels[row][col][2] = _mm512_sub_ps(q_pixels[row][col][2], centroid[2]);
+		}
+	}
+
+	// principal component analysis approximation: find best diagonal of the bounding box
+
+	// calculate directions for all four diagonals
+
+	__m512 any_diagonal[3] = {
+		_mm512_sub_ps(max[0], min[0]),
+		_mm512_sub_ps(max[1], min[1]),
+		_mm512_sub_ps(max[2], min[2])
+	};
+	__m512 inv_diag_norm =
+		rsqrt_ps(
+			_mm512_add_ps(
+				_mm512_add_ps(
+					_mm512_mul_ps(any_diagonal[0], any_diagonal[0]),
+					_mm512_mul_ps(any_diagonal[1], any_diagonal[1])
+				),
+				_mm512_mul_ps(any_diagonal[2], any_diagonal[2])
+			)
+		);
+	any_diagonal[0] = _mm512_mul_ps(any_diagonal[0], inv_diag_norm);
+	any_diagonal[1] = _mm512_mul_ps(any_diagonal[1], inv_diag_norm);
+	any_diagonal[2] = _mm512_mul_ps(any_diagonal[2], inv_diag_norm);
+
+	__m512 diags[4][3] = {
+		{ any_diagonal[0], any_diagonal[1], any_diagonal[2] },
+		{ any_diagonal[0], any_diagonal[1], INVERSE_SIGN(any_diagonal[2]) },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), any_diagonal[2] },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), INVERSE_SIGN(any_diagonal[2]) }
+	};
+
+	// for each diagonal calculate the projection of each colour
+	// (the four diagonals only differ by the signs of their last two components,
+	// so the products are shared between them)
+
+	__m512 min_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+	__m512 max_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			__m512 product0 = _mm512_mul_ps(q_pixels[row][col][0], diags[0][0]);
+			__m512 product1 = _mm512_mul_ps(q_pixels[row][col][1], diags[0][1]);
+			__m512 product1_inv = _mm512_mul_ps(q_pixels[row][col][1], diags[2][1]);
+			__m512 product2 = _mm512_mul_ps(q_pixels[row][col][2], diags[0][2]);
+			__m512 product2_inv = _mm512_mul_ps(q_pixels[row][col][2], diags[1][2]);
+
+			__m512 dot_products[4] = {
+				_mm512_add_ps(product0, _mm512_add_ps(product1, product2)),
+				_mm512_add_ps(product0, _mm512_add_ps(product1, product2_inv)),
+				_mm512_add_ps(product0, _mm512_add_ps(product1_inv, product2)),
+				_mm512_add_ps(product0, _mm512_add_ps(product1_inv, product2_inv))
+			};
+			for(int diag_choice = 0; diag_choice < 4; ++diag_choice) {
+				min_dot_product[diag_choice] = _mm512_min_ps(min_dot_product[diag_choice], dot_products[diag_choice]);
+				max_dot_product[diag_choice] = _mm512_max_ps(max_dot_product[diag_choice], dot_products[diag_choice]);
+			}
+		}
+	}
+
+	// keep the most discriminating diagonal (i.e. biggest difference between least and greatest dot products)
+	// the first diagonal is the default choice, as in the single block version
+
+	__m512 largest_dot_product_difference = _mm512_sub_ps(max_dot_product[0], min_dot_product[0]);
+	__m512 best_min_dot_product = min_dot_product[0];
+	__m512 best_max_dot_product = max_dot_product[0];
+	__m512 best_diag[3] = { diags[0][0], diags[0][1], diags[0][2] };
+
+	for(int diag_choice = 1; diag_choice < 4; ++diag_choice) {
+		__m512 dot_product_difference = _mm512_sub_ps(max_dot_product[diag_choice], min_dot_product[diag_choice]);
+		__mmask16 is_better = _mm512_cmp_ps_mask(largest_dot_product_difference, dot_product_difference, _CMP_LT_OQ);
+
+		largest_dot_product_difference = SELECT(is_better, dot_product_difference, largest_dot_product_difference);
+		best_min_dot_product = SELECT(is_better, min_dot_product[diag_choice], best_min_dot_product);
+		best_max_dot_product = SELECT(is_better, max_dot_product[diag_choice], best_max_dot_product);
+		best_diag[1] = SELECT(is_better, diags[diag_choice][1], best_diag[1]);
+		best_diag[2] = SELECT(is_better, diags[diag_choice][2], best_diag[2]);
+	}
+
+	// choose extreme positions as start and end colors, round and clamp values
+
+	__m512i start_color_rounded[3], end_color_rounded[3];
+	start_color_rounded[0] = _mm512_cvtps_epi32(_mm512_max_ps(ZERO, _mm512_min_ps(CLAMP_31, _mm512_mul_ps(INV_PERCEPTUAL_COEFF[0], _mm512_add_ps(centroid[0], _mm512_mul_ps(best_max_dot_product, best_diag[0]))))));
+	start_color_rounded[1] = _mm512_cvtps_epi32(_mm512_max_ps(ZERO, _mm512_min_ps(CLAMP_63, _mm512_mul_ps(INV_PERCEPTUAL_COEFF[1], _mm512_add_ps(centroid[1], _mm512_mul_ps(best_max_dot_product, best_diag[1]))))));
+	start_color_rounded[2] = _mm512_cvtps_epi32(_mm512_max_ps(ZERO, _mm512_min_ps(CLAMP_31, _mm512_mul_ps(INV_PERCEPTUAL_COEFF[2], _mm512_add_ps(centroid[2], _mm512_mul_ps(best_max_dot_product, best_diag[2]))))));
+
+	end_color_rounded[0] = _mm512_cvtps_epi32(_mm512_max_ps(ZERO, _mm512_min_ps(CLAMP_31, _mm512_mul_ps(INV_PERCEPTUAL_COEFF[0], _mm512_add_ps(centroid[0], _mm512_mul_ps(best_min_dot_product, best_diag[0]))))));
+	end_color_rounded[1] = _mm512_cvtps_epi32(_mm512_max_ps(ZERO, _mm512_min_ps(CLAMP_63, _mm512_mul_ps(INV_PERCEPTUAL_COEFF[1], _mm512_add_ps(centroid[1], _mm512_mul_ps(best_min_dot_product, best_diag[1]))))));
+	end_color_rounded[2] = _mm512_cvtps_epi32(_mm512_max_ps(ZERO, _mm512_min_ps(CLAMP_31, _mm512_mul_ps(INV_PERCEPTUAL_COEFF[2], _mm512_add_ps(centroid[2], _mm512_mul_ps(best_min_dot_product, best_diag[2]))))));
+
+	// convert to R5G6B5 format
+
+	__m512i start = _mm512_or_si512(_mm512_or_si512(
+		start_color_rounded[2],
+		_mm512_slli_epi32(start_color_rounded[1], 5)),
+		_mm512_slli_epi32(start_color_rounded[0], 11));
+	__m512i end = _mm512_or_si512(_mm512_or_si512(
+		end_color_rounded[2],
+		_mm512_slli_epi32(end_color_rounded[1], 5)),
+		_mm512_slli_epi32(end_color_rounded[0], 11));
+
+	// map each color to the indice of the closest position, and convert to DXT1 codes (last texel in the upper bits)
+	// (code = (-index & 3) ^ (index == 0 || index == 3), see DXT1_CODES_4 in dxt_simd.cpp)
+
+	__m512i indices = _mm512_setzero_si512();
+	__m512 coeff = _mm512_mul_ps(_mm512_set1_ps(3.0f), rcp_ps(largest_dot_product_difference));
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i three = _mm512_set1_epi32(3);
+	for(int row = 3; row >= 0; --row) {
+		for(int col = 3; col >= 0; --col) {
+			__m512 dot_product =
+				_mm512_add_ps(
+					_mm512_mul_ps(q_pixels[row][col][0], best_diag[0]),
+					_mm512_add_ps(
+						_mm512_mul_ps(q_pixels[row][col][1], best_diag[1]),
+						_mm512_mul_ps(q_pixels[row][col][2], best_diag[2])
+					)
+				);
+			__m512i index = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_sub_ps(dot_product, best_min_dot_product), coeff));
+			__m512i code = _mm512_xor_si512(
+				_mm512_and_si512(_mm512_sub_epi32(_mm512_setzero_si512(), index), three),
+				_mm512_xor_si512(_mm512_and_si512(_mm512_srli_epi32(_mm512_add_epi32(index, one), 1), one), one));
+			indices = _mm512_or_si512(_mm512_slli_epi32(indices, 2), code);
+		}
+	}
+
+	// reverse start and end to stay in four colors mode,
+	// or clear the indices in the degenerate case where the colors end up being the same when rounded down
+
+	__mmask16 start_equals_end = _mm512_cmpeq_epi32_mask(start, end);
+	__mmask16 start_lower_than_end = _mm512_cmplt_epi32_mask(start, end);
+	__m512i color0 = SELECT_EPI32(start_lower_than_end, end, start);
+	__m512i color1 = SELECT_EPI32(start_lower_than_end, start, end);
+	indices = _mm512_mask_xor_epi32(indices, start_lower_than_end, indices, _mm512_set1_epi32(0x55555555));
+	indices = _mm512_maskz_mov_epi32((__mmask16) ~start_equals_end, indices);
+
+	// single color blocks
+
+	__m512i first_texels = _mm512_i32gather_epi32(
+		_mm512_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240),
+		(const int *)rgba, 4);
+	__m512i single_color = _mm512_or_si512(_mm512_or_si512(
+		_mm512_srli_epi32(_mm512_and_si512(_mm512_srli_epi32(first_texels, 16), mask_8_bits), 3),
+		_mm512_slli_epi32(_mm512_srli_epi32(_mm512_and_si512(_mm512_srli_epi32(first_texels, 8), mask_8_bits), 2), 5)),
+		_mm512_slli_epi32(_mm512_srli_epi32(_mm512_and_si512(first_texels, mask_8_bits), 3), 11));
+
+	color0 = SELECT_EPI32(single_color_mask, single_color, color0);
+	color1 = SELECT_EPI32(single_color_mask, single_color, color1);
+	indices = _mm512_maskz_mov_epi32((__mmask16) ~single_color_mask, indices);
+
+	// write block bits
+
+	unsigned int endpoint_values[16];
+	unsigned int index_values[16];
+	_mm512_storeu_si512(endpoint_values, _mm512_or_si512(color0, _mm512_slli_epi32(color1, 16)));
+	_mm512_storeu_si512(index_values, indices);
+	for(int b = 0; b < 16; ++b) {
+		*((unsigned int*)(blocks + b * block_stride)) = endpoint_values[b];
+		*((unsigned int*)(blocks + b * block_stride + 4)) = index_values[b];
+	}
+}
+
+void __fastcall encodeDxt1Blocks_fast_avx512(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	for(size_t i = 0; i < block_count; i += 16)
+		encodeSixteenDxt1Blocks_fast_avx512(rgba + 64 * i, blocks + block_stride * i, block_stride);
+}
+
+// Sum of the 16 texels of each block from their column sums,
+// in the order of HORIZONTAL_ADD in the single block version
+
+static inline __m512 add_columns(const __m512 column_sums[4])
+{
+	return _mm512_add_ps(
+		_mm512_add_ps(column_sums[0], column_sums[2]),
+		_mm512_add_ps(column_sums[1], column_sums[3]));
+}
+
+// Same algorithm as encodeDxt1Block_quality_simd, with one block per lane (16 blocks at once).
+// The floating point operations are performed in the same order as in the
+// single block version, so that both produce bit-identical blocks.
+//
+// rgba: 16 consecutive blocks of 16 texels (16 x 64 bytes)
+// blocks: 16 output blocks of 8 bytes, block_stride bytes apart
+
+static inline void encodeSixteenDxt1Blocks_quality_avx512(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride)
+{
+	const __m512i mask_8_bits = _mm512_set1_epi32(0x000000ff);
+	const __m512 ZERO = _mm512_setzero_ps();
+	const __m512 THREE = _mm512_set1_ps(3.0f);
+	const __m512 ONE_THIRD = _mm512_set1_ps(1.0f / 3.0f);
+
+	// read colors and transpose (one block per lane, no perceptual coefficient)
+
+	__m512 q_pixels[4][4][3];	// [row][column][channel]
+
+	for(int row = 0; row < 4; ++row) {
+		__m512i block_rows[4];	// blocks b, b+4, b+8, b+12 in the four 128-bit quarters
+		for(int b = 0; b < 4; ++b) {
+			block_rows[b] = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i *)(rgba + 64*b + 16*row)));
+			block_rows[b] = _mm512_inserti32x4(block_rows[b], _mm_loadu_si128((const __m128i *)(rgba + 64*(b + 4) + 16*row)), 1);
+			block_rows[b] = _mm512_inserti32x4(block_rows[b], _mm_loadu_si128((const __m128i *)(rgba + 64*(b + 8) + 16*row)), 2);
+			block_rows[b] = _mm512_inserti32x4(block_rows[b], _mm_loadu_si128((const __m128i *)(rgba + 64*(b + 12) + 16*row)), 3);
+		}
+
+		__m512i t0 = _mm512_unpacklo_epi32(block_rows[0], block_rows[1]);
+		__m512i t1 = _mm512_unpacklo_epi32(block_rows[2], block_rows[3]);
+		__m512i t2 = _mm512_unpackhi_epi32(block_rows[0], block_rows[1]);
+		__m512i t3 = _mm512_unpackhi_epi32(block_rows[2], block_rows[3]);
+
+		__m512i texels[4] = {
+			_mm512_unpacklo_epi64(t0, t1),
+			_mm512_unpackhi_epi64(t0, t1),
+			_mm512_unpacklo_epi64(t2, t3),
+			_mm512_unpackhi_epi64(t2, t3)
+		};
+
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm512_cvtepi32_ps(_mm512_and_si512(texels[col], mask_8_bits));
+			q_pixels[row][col][1] = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(texels[col], 8), mask_8_bits));
+			q_pixels[row][col][2] = _mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(texels[col], 16), mask_8_bits));
+		}
+	}
+
+	// calculate bounding box
+
+	__m512 min[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	__m512 max[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			for(int c = 0; c < 3; ++c) {
+				min[c] = _mm512_min_ps(min[c], q_pixels[row][col][c]);
+				max[c] = _mm512_max_ps(max[c], q_pixels[row][col][c]);
+			}
+		}
+	}
+
+	// single color?
+	__mmask16 single_color_mask =
+		_mm512_cmp_ps_mask(min[0], max[0], _CMP_EQ_OQ) &
+		_mm512_cmp_ps_mask(min[1], max[1], _CMP_EQ_OQ) &
+		_mm512_cmp_ps_mask(min[2], max[2], _CMP_EQ_OQ);
+
+	// calculate centroid
+
+	__m512 centroid[3];
+	for(int c = 0; c < 3; ++c) {
+		__m512 column_sums[4];
+		for(int col = 0; col < 4; ++col) {
+			column_sums[col] = q_pixels[0][col][c];
+			for(int row = 1; row < 4; ++row)
+				column_sums[col] = _mm512_add_ps(column_sums[col], q_pixels[row][col][c]);
+		}
+		centroid[c] = _mm512_mul_ps(add_columns(column_sums), _mm512_set1_ps(1.0f / 16.0f));
+	}
+
+	// move referential to centroid
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm512_sub_ps(q_pixels[row][col][0], centroid[0]);
+			q_pixels[row][col][1] = _mm512_sub_ps(q_pixels[row][col][1], centroid[1]);
+			q_pixels[row][col][2] = _mm512_sub_ps(q_pixels[row][col][2], centroid[2]);
+		}
+	}
+
+	// principal component analysis approximation: find best diagonal of the bounding box
+
+	// calculate directions for all four diagonals
+
+	__m512 any_diagonal[3] = {
+		_mm512_sub_ps(max[0], min[0]),
+		_mm512_sub_ps(max[1], min[1]),
+		_mm512_sub_ps(max[2], min[2])
+	};
+	__m512 inv_diag_norm =
+		rsqrt_ps(
+			_mm512_add_ps(
+				_mm512_add_ps(
+					_mm512_mul_ps(any_diagonal[0], any_diagonal[0]),
+					_mm512_mul_ps(any_diagonal[1], any_diagonal[1])
+				),
+				_mm512_mul_ps(any_diagonal[2], any_diagonal[2])
+			)
+		);
+	any_diagonal[0] = _mm512_mul_ps(any_diagonal[0], inv_diag_norm);
+	any_diagonal[1] = _mm512_mul_ps(any_diagonal[1], inv_diag_norm);
+	any_diagonal[2] = _mm512_mul_ps(any_diagonal[2], inv_diag_norm);
+
+	__m512 diags[4][3] = {
+		{ any_diagonal[0], any_diagonal[1], any_diagonal[2] },
+		{ any_diagonal[0], any_diagonal[1], INVERSE_SIGN(any_diagonal[2]) },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), any_diagonal[2] },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), INVERSE_SIGN(any_diagonal[2]) }
+	};
+
+	// for each diagonal calculate the projection of each colour
+	// (the four diagonals only differ by the signs of their last two components,
+	// so the products are shared between them)
+
+	__m512 min_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+	__m512 max_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			__m512 product0 = _mm512_mul_ps(q_pixels[row][col][0], diags[0][0]);
+			__m512 product1 = _mm512_mul_ps(q_pixels[row][col][1], diags[0][1]);
+			__m512 product1_inv = _mm512_mul_ps(q_pixels[row][col][1], diags[2][1]);
+			__m512 product2 = _mm512_mul_ps(q_pixels[row][col][2], diags[0][2]);
+			__m512 product2_inv = _mm512_mul_ps(q_pixels[row][col][2], diags[1][2]);
+
+			__m512 dot_products[4] = {
+				_mm512_add_ps(product0, _mm512_add_ps(product1, product2)),
+				_mm512_add_ps(product0, _mm512_add_ps(product1, product2_inv)),
+				_mm512_add_ps(product0, _mm512_add_ps(product1_inv, product2)),
+				_mm512_add_ps(product0, _mm512_add_ps(product1_inv, product2_inv))
+			};
+			for(int diag_choice = 0; diag_choice < 4; ++diag_choice) {
+				min_dot_product[diag_choice] = _mm512_min_ps(min_dot_product[diag_choice], dot_products[diag_choice]);
+				max_dot_product[diag_choice] = _mm512_max_ps(max_dot_product[diag_choice], dot_products[diag_choice]);
+			}
+		}
+	}
+
+	// keep the most discriminating diagonal (i.e. biggest difference between least and greatest dot products)
+	// the first diagonal is the default choice, as in the single block version
+
+	__m512 largest_dot_product_difference = _mm512_sub_ps(max_dot_product[0], min_dot_product[0]);
+	__m512 best_min_dot_product = min_dot_product[0];
+	__m512 best_diag[3] = { diags[0][0], diags[0][1], diags[0][2] };
+
+	for(int diag_choice = 1; diag_choice < 4; ++diag_choice) {
+		__m512 dot_product_difference = _mm512_sub_ps(max_dot_product[diag_choice], min_dot_product[diag_choice]);
+		__mmask16 is_better = _mm512_cmp_ps_mask(largest_dot_product_difference, dot_product_difference, _CMP_LT_OQ);
+
+		largest_dot_product_difference = SELECT(is_better, dot_product_difference, largest_dot_product_difference);
+		best_min_dot_product = SELECT(is_better, min_dot_product[diag_choice], best_min_dot_product);
+		best_diag[1] = SELECT(is_better, diags[diag_choice][1], best_diag[1]);
+		best_diag[2] = SELECT(is_better, diags[diag_choice][2], best_diag[2]);
+	}
+
+	// map each color to the indice of the closest position
+
+	__m512i indices[4][4];
+	__m512 coeff = _mm512_mul_ps(THREE, rcp_ps(largest_dot_product_difference));
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			__m512 dot_product =
+				_mm512_add_ps(
+					_mm512_mul_ps(q_pixels[row][col][0], best_diag[0]),
+					_mm512_add_ps(
+						_mm512_mul_ps(q_pixels[row][col][1], best_diag[1]),
+						_mm512_mul_ps(q_pixels[row][col][2], best_diag[2])
+					)
+				);
+			indices[row][col] = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_sub_ps(dot_product, best_min_dot_product), coeff));
+		}
+	}
+
+	__m512 clamp_min[3] = {
+		INVERSE_SIGN(centroid[0]),
+		INVERSE_SIGN(centroid[1]),
+		INVERSE_SIGN(centroid[2])
+	};
+	__m512 clamp_max[3] = {
+		_mm512_sub_ps(_mm512_set1_ps(255.0f), centroid[0]),
+		_mm512_sub_ps(_mm512_set1_ps(255.0f), centroid[1]),
+		_mm512_sub_ps(_mm512_set1_ps(255.0f), centroid[2])
+	};
+
+	__m512 start_color[3], end_color[3];
+
+	// refine using Least Squares (see encodeDxt1Block_quality_simd)
+	for(int iteration = 0; iteration < 3; ++iteration) {
+		__m512 column_S_alpha[4], column_S_alpha_2[4], column_S_alpha_pixel[3][4];
+		for(int col = 0; col < 4; ++col) {
+			__m512 alpha = _mm512_mul_ps(_mm512_cvtepi32_ps(indices[0][col]), ONE_THIRD);
+			column_S_alpha[col] = alpha;
+			column_S_alpha_2[col] = _mm512_mul_ps(alpha, alpha);
+			for(int c = 0; c < 3; ++c)
+				column_S_alpha_pixel[c][col] = _mm512_mul_ps(alpha, q_pixels[0][col][c]);
+			for(int row = 1; row < 4; ++row) {
+				alpha = _mm512_mul_ps(_mm512_cvtepi32_ps(indices[row][col]), ONE_THIRD);
+
+				column_S_alpha[col] = _mm512_add_ps(column_S_alpha[col], alpha);
+				column_S_alpha_2[col] = _mm512_add_ps(column_S_alpha_2[col], _mm512_mul_ps(alpha, alpha));
+				for(int c = 0; c < 3; ++c)
+					column_S_alpha_pixel[c][col] = _mm512_add_ps(column_S_alpha_pixel[c][col], _mm512_mul_ps(alpha, q_pixels[row][col][c]));
+			}
+		}
+		__m512 S_alpha = add_columns(column_S_alpha);
+		__m512 S_alpha_2 = add_columns(column_S_alpha_2);
+		__m512 S_alpha_pixel[3] = {
+			add_columns(column_S_alpha_pixel[0]),
+			add_columns(column_S_alpha_pixel[1]),
+			add_columns(column_S_alpha_pixel[2])
+		};
+
+		// calculations are simplified by the fact that beta[i] == (1 - alpha[i])
+		__m512 S_alpha_beta = _mm512_sub_ps(S_alpha, S_alpha_2);
+		__m512 S_beta_2 = _mm512_sub_ps(_mm512_sub_ps(_mm512_set1_ps(16.0f), S_alpha), S_alpha_beta);
+
+		__m512 factor = rcp_ps(_mm512_sub_ps(_mm512_mul_ps(S_alpha_2, S_beta_2), _mm512_mul_ps(S_alpha_beta, S_alpha_beta)));
+		__m512 start_factor = _mm512_mul_ps(_mm512_add_ps(S_beta_2, S_alpha_beta), factor);
+		__m512 end_factor = _mm512_sub_ps(ZERO, _mm512_mul_ps(_mm512_add_ps(S_alpha_2, S_alpha_beta), factor));
+
+		// compute start and end color, and clamp to [0, 255]
+
+		for(int c = 0; c < 3; ++c) {
+			start_color[c] = _mm512_max_ps(clamp_min[c], _mm512_min_ps(clamp_max[c], _mm512_mul_ps(start_factor, S_alpha_pixel[c])));
+			end_color[c] = _mm512_max_ps(clamp_min[c], _mm512_min_ps(clamp_max[c], _mm512_mul_ps(end_factor, S_alpha_pixel[c])));
+		}
+
+		// recalculate indexes
+		// map each color to the indice of the closest position
+
+		__m512 segment[3] = {
+			_mm512_sub_ps(start_color[0], end_color[0]),
+			_mm512_sub_ps(start_color[1], end_color[1]),
+			_mm512_sub_ps(start_color[2], end_color[2])
+		};
+		__m512 segment_norm_2 =
+			_mm512_add_ps(
+				_mm512_add_ps(
+					_mm512_mul_ps(segment[0], segment[0]),
+					_mm512_mul_ps(segment[1], segment[1])
+				),
+				_mm512_mul_ps(segment[2], segment[2])
+			);
+		// coefficient used to pre-multiply dot product result == 3/(norm^2)
+		__m512 coeff = _mm512_mul_ps(THREE, rcp_ps(segment_norm_2));
+		segment[0] = _mm512_mul_ps(segment[0], coeff);
+		segment[1] = _mm512_mul_ps(segment[1], coeff);
+		segment[2] = _mm512_mul_ps(segment[2], coeff);
+
+		for(int row = 0; row < 4; ++row) {
+			for(int col = 0; col < 4; ++col) {
+				// calculate dot product (pre-multiplied by 3/norm)
+				__m512 dot_product =
+					_mm512_add_ps(
+						_mm512_mul_ps(_mm512_sub_ps(q_pixels[row][col][0], end_color[0]), segment[0]),
+						_mm512_add_ps(
+							_mm512_mul_ps(_mm512_sub_ps(q_pixels[row][col][1], end_color[1]), segment[1]),
+							_mm512_mul_ps(_mm512_sub_ps(q_pixels[row][col][2], end_color[2]), segment[2])
+						)
+					);
+				// round and clamp values
+				indices[row][col] = _mm512_cvtps_epi32(_mm512_max_ps(ZERO, _mm512_min_ps(THREE, dot_product)));
+			}
+		}
+	}
+
+	// reset referential away from centroid and round (no need to clamp, it's already done)
+
+	__m512i start_color_rounded[3], end_color_rounded[3];
+
+	start_color_rounded[0] = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_set1_ps(31.0f / 255.0f), _mm512_add_ps(centroid[0], start_color[0])));
+	start_color_rounded[1] = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_set1_ps(63.0f / 255.0f), _mm512_add_ps(centroid[1], start_color[1])));
+	start_color_rounded[2] = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_set1_ps(31.0f / 255.0f), _mm512_add_ps(centroid[2], start_color[2])));
+
+	end_color_rounded[0] = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_set1_ps(31.0f / 255.0f), _mm512_add_ps(centroid[0], end_color[0])));
+	end_color_rounded[1] = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_set1_ps(63.0f / 255.0f), _mm512_add_ps(centroid[1], end_color[1])));
+	end_color_rounded[2] = _mm512_cvtps_epi32(_mm512_mul_ps(_mm512_set1_ps(31.0f / 255.0f), _mm512_add_ps(centroid[2], end_color[2])));
+
+	// convert to R5G6B5 format (truncated to 16 bits as in the single block version)
+
+	const __m512i mask_16_bits = _mm512_set1_epi32(0x0000ffff);
+	__m512i start = _mm512_and_si512(mask_16_bits, _mm512_or_si512(_mm512_or_si512(
+		start_color_rounded[2],
+		_mm512_slli_epi32(start_color_rounded[1], 5)),
+		_mm512_slli_epi32(start_color_rounded[0], 11)));
+	__m512i end = _mm512_and_si512(mask_16_bits, _mm512_or_si512(_mm512_or_si512(
+		end_color_rounded[2],
+		_mm512_slli_epi32(end_color_rounded[1], 5)),
+		_mm512_slli_epi32(end_color_rounded[0], 11)));
+
+	// convert the indices to DXT1 codes (last texel in the upper bits)
+	// (code = (-index & 3) ^ (index == 0 || index == 3), see DXT1_CODES_4 in dxt_simd.cpp)
+
+	__m512i codes = _mm512_setzero_si512();
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i three = _mm512_set1_epi32(3);
+	for(int row = 3; row >= 0; --row) {
+		for(int col = 3; col >= 0; --col) {
+			__m512i index = indices[row][col];
+			__m512i code = _mm512_xor_si512(
+				_mm512_and_si512(_mm512_sub_epi32(_mm512_setzero_si512(), index), three),
+				_mm512_xor_si512(_mm512_and_si512(_mm512_srli_epi32(_mm512_add_epi32(index, one), 1), one), one));
+			codes = _mm512_or_si512(_mm512_slli_epi32(codes, 2), code);
+		}
+	}
+
+	// reverse start and end to stay in four colors mode,
+	// or clear the codes in the degenerate case where the colors end up being the same when rounded down
+
+	__mmask16 start_equals_end = _mm512_cmpeq_epi32_mask(start, end);
+	__mmask16 start_lower_than_end = _mm512_cmplt_epi32_mask(start, end);
+	__m512i color0 = SELECT_EPI32(start_lower_than_end, end, start);
+	__m512i color1 = SELECT_EPI32(start_lower_than_end, start, end);
+	codes = _mm512_mask_xor_epi32(codes, start_lower_than_end, codes, _mm512_set1_epi32(0x55555555));
+	codes = _mm512_maskz_mov_epi32((__mmask16) ~start_equals_end, codes);
+
+	// single color blocks
+
+	__m512i first_texels = _mm512_i32gather_epi32(
+		_mm512_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240),
+		(const int *)rgba, 4);
+	__m512i single_color = _mm512_or_si512(_mm512_or_si512(
+		_mm512_srli_epi32(_mm512_and_si512(_mm512_srli_epi32(first_texels, 16), mask_8_bits), 3),
+		_mm512_slli_epi32(_mm512_srli_epi32(_mm512_and_si512(_mm512_srli_epi32(first_texels, 8), mask_8_bits), 2), 5)),
+		_mm512_slli_epi32(_mm512_srli_epi32(_mm512_and_si512(first_texels, mask_8_bits), 3), 11));
+
+	color0 = SELECT_EPI32(single_color_mask, single_color, color0);
+	color1 = SELECT_EPI32(single_color_mask, single_color, color1);
+	codes = _mm512_maskz_mov_epi32((__mmask16) ~single_color_mask, codes);
+
+	// write block bits
+
+	unsigned int endpoint_values[16];
+	unsigned int code_values[16];
+	_mm512_storeu_si512(endpoint_values, _mm512_or_si512(color0, _mm512_slli_epi32(color1, 16)));
+	_mm512_storeu_si512(code_values, codes);
+	for(int b = 0; b < 16; ++b) {
+		*((unsigned int*)(blocks + b * block_stride)) = endpoint_values[b];
+		*((unsigned int*)(blocks + b * block_stride + 4)) = code_values[b];
+	}
+}
+
+void __fastcall encodeDxt1Blocks_quality_avx512(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	for(size_t i = 0; i < block_count; i += 16)
+		encodeSixteenDxt1Blocks_quality_avx512(rgba + 64 * i, blocks + block_stride * i, block_stride);
+}
@@ -4,17 +4,31 @@
 	  Copyright (c) 2006-2022 ZunTzu Software and contributors
 ----------------------------------------------------------------------------- */
 
+#include "ztt_file.h"
+#include "thread_pool.h"
+
 typedef int error_code;	// no error if 0, otherwise abort
 
 class dxt_compressor {
 public:
-	virtual ~dxt_compressor() = 0 {}
+	virtual ~dxt_compressor() = 0;
 	virtual error_code get_image_dimensions(unsigned int & width, unsigned int & height) = 0;
 	virtual error_code get_next_tile(char * tile_data, unsigned int & mipmap_level, unsigned int & x, unsigned int & y) = 0;
+	// yields tile_count tiles at once, tile i is written to tile_data[i] and is located by mipmap_levels[i], xs[i] and ys[i]
+	virtual error_code get_next_tiles(char ** tile_data, unsigned int tile_count, unsigned int * mipmap_levels, unsigned int * xs, unsigned int * ys) {
+		error_code error = 0;
+		for(unsigned int i = 0; error == 0 && i < tile_count; ++i)
+			error = get_next_tile(tile_data[i], mipmap_levels[i], xs[i], ys[i]);
+		return error;
+	}
+	// hint: the tiles covering this area (in texels of the first mipmap level) at this mipmap level and coarser are wanted first
+	virtual void prioritize_tiles(unsigned int /*mipmap_level*/, unsigned int /*left*/, unsigned int /*top*/, unsigned int /*right*/, unsigned int /*bottom*/) {}
 protected:
 	dxt_compressor() {}
 };
 
+inline dxt_compressor::~dxt_compressor() {}
+
 class tile_layer;
 class synchronized_tile_buffer;
 
@@ -24,16 +38,30 @@ public:
 	virtual ~dxt1_compressor();
 	virtual error_code get_image_dimensions(unsigned int & width, unsigned int & height);
 	virtual error_code get_next_tile(char * tile_data, unsigned int & mipmap_level, unsigned int & x, unsigned int & y);
+	virtual error_code get_next_tiles(char ** tile_data, unsigned int tile_count, unsigned int * mipmap_levels, unsigned int * xs, unsigned int * ys);
+	virtual void prioritize_tiles(unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
 private:
-	static DWORD WINAPI image_loading_loop(__in LPVOID lpParameter);
-	static DWORD WINAPI compression_loop(__in LPVOID lpParameter);
+	struct compression_job {
+		dxt1_compressor * compressor;
+		unsigned int slot_index;	// of the tile in tile_buffer
+		char * destination;
+	};
+
+	void start_loading();
+	static void image_loading_task(void * context);
+	static void compression_task(void * context);
 
 	int options;
 	tile_layer * tyler;
-	int compression_thread_count;
-	HANDLE * threads;
-	synchronized_tile_buffer * tile_buffer;
-	synchronized_tile_buffer * texture_buffer;
+	unsigned int image_width;	// known once loading has started
+	unsigned int image_height;
+	synchronized_tile_buffer * tile_buffer;	// 0 until loading starts
+	task_group loading_tasks;
+	// with several cores, each tile of a batch is compressed by a task straight into the memory of the caller
+	bool compressed_by_tasks;
+	task_group compression_tasks;
+	compression_job * jobs;	// one per tile of the largest batch
+	unsigned int job_capacity;
 };
 
 class dxt5_compressor : public dxt_compressor {
@@ -42,14 +70,83 @@ public:
 	virtual ~dxt5_compressor();
 	virtual error_code get_image_dimensions(unsigned int & width, unsigned int & height);
 	virtual error_code get_next_tile(char * tile_data, unsigned int & mipmap_level, unsigned int & x, unsigned int & y);
+	virtual error_code get_next_tiles(char ** tile_data, unsigned int tile_count, unsigned int * mipmap_levels, unsigned int * xs, unsigned int * ys);
+	virtual void prioritize_tiles(unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
 private:
-	static DWORD WINAPI image_loading_loop(__in LPVOID lpParameter);
-	static DWORD WINAPI compression_loop(__in LPVOID lpParameter);
+	struct compression_job {
+		dxt5_compressor * compressor;
+		unsigned int slot_index;	// of the tile in tile_buffer
+		char * destination;
+	};
+
+	void start_loading();
+	static void image_loading_task(void * context);
+	static void compression_task(void * context);
 
 	int options;
 	tile_layer * tyler;
-	int compression_thread_count;
-	HANDLE * threads;
-	synchronized_tile_buffer * tile_buffer;
-	synchronized_tile_buffer * texture_buffer;
+	unsigned int image_width;	// known once loading has started
+	unsigned int image_height;
+	synchronized_tile_buffer * tile_buffer;	// 0 until loading starts
+	task_group loading_tasks;
+	// with several cores, each tile of a batch is compressed by a task straight into the memory of the caller
+	bool compressed_by_tasks;
+	task_group compression_tasks;
+	compression_job * jobs;	// one per tile of the largest batch
+	unsigned int job_capacity;
+};
+
+class tile_cache_key;
+class unzipper;
+
+// yields the tiles of a tile set (see ztt_file.h), mapped from a file or read from an archive entry
+// a mapped tile set yields the coarsest mipmap levels first and honors prioritize_tiles, an archive entry is read in sequence
+class ztt_tile_reader : public dxt_compressor {
+public:
+	ztt_tile_reader(ztt_mapped_file * file);
+	ztt_tile_reader(const wchar_t * archive_name, const char * entry_name, bool has_mask);
+	virtual ~ztt_tile_reader();
+	virtual error_code get_image_dimensions(unsigned int & width, unsigned int & height);
+	virtual error_code get_next_tile(char * tile_data, unsigned int & mipmap_level, unsigned int & x, unsigned int & y);
+	virtual void prioritize_tiles(unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+private:
+	error_code read_index();
+	void find_next_mapped_tile();
+
+	ztt_mapped_file * file;	// 0 if read from an archive entry
+	::unzipper * unzipper;	// 0 if mapped from a file
+	unsigned int expected_format;
+	ztt_index index;
+	bool index_read;
+	unsigned int next_mipmap_level;
+	unsigned int next_x;
+	unsigned int next_y;
+	unsigned int remaining_tile_count;
+
+	// mapped tile set only
+	bool * yielded;	// per tile
+	bool prioritizing;	// true while yielding the tiles of the priority area
+	unsigned int priority_mipmap_level;
+	unsigned int priority_left;
+	unsigned int priority_top;
+	unsigned int priority_right;
+	unsigned int priority_bottom;
+};
+
+// records the tiles yielded by another compressor, the cached tile set is published once complete (see tile_cache.h)
+class tile_cache_recorder : public dxt_compressor {
+public:
+	tile_cache_recorder(tile_cache_key * key, dxt_compressor * compressor);
+	virtual ~tile_cache_recorder();
+	virtual error_code get_image_dimensions(unsigned int & width, unsigned int & height);
+	virtual error_code get_next_tile(char * tile_data, unsigned int & mipmap_level, unsigned int & x, unsigned int & y);
+	virtual error_code get_next_tiles(char ** tile_data, unsigned int tile_count, unsigned int * mipmap_levels, unsigned int * xs, unsigned int * ys);
+	virtual void prioritize_tiles(unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+private:
+	void record_tile(unsigned int mipmap_level, unsigned int x, unsigned int y, const char * tile_data);
+
+	tile_cache_key * key;
+	dxt_compressor * compressor;
+	ztt_writer * writer;
+	bool recording;
 };
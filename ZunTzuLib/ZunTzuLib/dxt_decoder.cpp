@@ -0,0 +1,132 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include <emmintrin.h>	// SIMD intrinsics
+#include "ZunTzuLib.h"
+
+// DXT blocks are decoded as the hardware does (565 colors expanded by bit replication, DXT1 blocks with
+// color0 <= color1 in the 3-color mode with transparent black), to texels in the B8G8R8A8 order of the
+// tiles, read as A8R8G8B8 values by ZunTzu for hit-testing and picking.
+
+// 4 texels of the palette of a color block
+static inline __m128i decode_palette(
+	const unsigned char * block,
+	bool three_colors_allowed)
+{
+	const unsigned int color0 = block[0] | (block[1] << 8);
+	const unsigned int color1 = block[2] | (block[3] << 8);
+	const int b0 = color0 & 0x1f, g0 = (color0 >> 5) & 0x3f, r0 = color0 >> 11;
+	const int b1 = color1 & 0x1f, g1 = (color1 >> 5) & 0x3f, r1 = color1 >> 11;
+	// 16-bit channels: b0 g0 r0 a0 b1 g1 r1 a1
+	const __m128i endpoints = _mm_setr_epi16(
+		(short) ((b0 << 3) | (b0 >> 2)), (short) ((g0 << 2) | (g0 >> 4)), (short) ((r0 << 3) | (r0 >> 2)), 0xff,
+		(short) ((b1 << 3) | (b1 >> 2)), (short) ((g1 << 2) | (g1 >> 4)), (short) ((r1 << 3) | (r1 >> 2)), 0xff);
+	const __m128i start = _mm_unpacklo_epi64(endpoints, endpoints);
+	const __m128i end = _mm_unpackhi_epi64(endpoints, endpoints);
+	const __m128i sum = _mm_add_epi16(start, end);
+	__m128i interpolated;
+	if(three_colors_allowed && color0 <= color1) {
+		// (start + end) / 2 and transparent black
+		interpolated = _mm_and_si128(_mm_srli_epi16(sum, 1), _mm_setr_epi32(-1, -1, 0, 0));
+	} else {
+		// (2 * start + end) / 3 and (start + 2 * end) / 3, x / 3 == (x * 0xaaab) >> 17
+		interpolated = _mm_srli_epi16(_mm_mulhi_epu16(_mm_add_epi16(sum, endpoints), _mm_set1_epi16((short) 0xaaab)), 1);
+	}
+	return _mm_packus_epi16(endpoints, interpolated);
+}
+
+// a row of 4 texels, from the 4 indices of 2 bits in indices
+static inline __m128i select_colors(
+	const __m128i * colors,
+	unsigned int indices)
+{
+	const __m128i masks = _mm_setr_epi32(0x03, 0x0c, 0x30, 0xc0);
+	const __m128i bits = _mm_and_si128(_mm_set1_epi32(indices), masks);
+	__m128i row = colors[0];
+	for(int i = 1; i < 4; ++i) {
+		// index i in the bits of each texel: i, i << 2, i << 4, i << 6
+		const __m128i selected = _mm_cmpeq_epi32(bits, _mm_and_si128(_mm_set1_epi32(i * 0x55), masks));
+		row = _mm_or_si128(_mm_and_si128(selected, colors[i]), _mm_andnot_si128(selected, row));
+	}
+	return row;
+}
+
+static inline void decode_color_block(
+	const unsigned char * block,
+	bool three_colors_allowed,
+	__m128i * rows)
+{
+	const __m128i palette = decode_palette(block, three_colors_allowed);
+	const __m128i colors[4] = {
+		_mm_shuffle_epi32(palette, 0x00), _mm_shuffle_epi32(palette, 0x55),
+		_mm_shuffle_epi32(palette, 0xaa), _mm_shuffle_epi32(palette, 0xff)
+	};
+	for(int row = 0; row < 4; ++row)
+		rows[row] = select_colors(colors, block[4 + row]);
+}
+
+// the alphas of a DXT5 block replace those of its colors
+static inline void decode_alpha_block(
+	const unsigned char * block,
+	__m128i * rows)
+{
+	unsigned int alphas[8];
+	alphas[0] = block[0];
+	alphas[1] = block[1];
+	if(alphas[0] > alphas[1]) {
+		for(int i = 0; i < 6; ++i)
+			alphas[i + 2] = ((6 - i) * alphas[0] + (1 + i) * alphas[1]) / 7;
+	} else {
+		for(int i = 0; i < 4; ++i)
+			alphas[i + 2] = ((4 - i) * alphas[0] + (1 + i) * alphas[1]) / 5;
+		alphas[6] = 0x00;
+		alphas[7] = 0xff;
+	}
+
+	// 16 indices of 3 bits, 2 rows per 24 bits
+	for(int half = 0; half < 2; ++half) {
+		unsigned int indices = block[2 + 3 * half] | (block[3 + 3 * half] << 8) | (block[4 + 3 * half] << 16);
+		for(int row = 2 * half; row < 2 * half + 2; ++row) {
+			unsigned int row_alphas[4];
+			for(int col = 0; col < 4; ++col, indices >>= 3)
+				row_alphas[col] = alphas[indices & 7] << 24;
+			const __m128i alpha_row = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row_alphas));
+			rows[row] = _mm_or_si128(_mm_and_si128(rows[row], _mm_set1_epi32(0x00ffffff)), alpha_row);
+		}
+	}
+}
+
+extern "C" void __cdecl DecodeDxt1Blocks(
+	const char * blocks,
+	int width, int height,
+	char * texels, int stride)
+{
+	const unsigned char * block = reinterpret_cast<const unsigned char *>(blocks);
+	for(int blockY = 0; blockY < height; ++blockY) {
+		for(int blockX = 0; blockX < width; ++blockX, block += 8) {
+			__m128i rows[4];
+			decode_color_block(block, true, rows);
+			for(int row = 0; row < 4; ++row)
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(texels + stride * (4 * blockY + row) + 16 * blockX), rows[row]);
+		}
+	}
+}
+
+extern "C" void __cdecl DecodeDxt5Blocks(
+	const char * blocks,
+	int width, int height,
+	char * texels, int stride)
+{
+	const unsigned char * block = reinterpret_cast<const unsigned char *>(blocks);
+	for(int blockY = 0; blockY < height; ++blockY) {
+		for(int blockX = 0; blockX < width; ++blockX, block += 16) {
+			__m128i rows[4];
+			decode_color_block(block + 8, false, rows);
+			decode_alpha_block(block, rows);
+			for(int row = 0; row < 4; ++row)
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(texels + stride * (4 * blockY + row) + 16 * blockX), rows[row]);
+		}
+	}
+}
@@ -0,0 +1,122 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <stdlib.h>
+#endif
+#include <atomic>
+#include "ZunTzuLib.h"
+#include "dxt_kernels.h"
+#include "downsample_kernels.h"
+
+// The cluster fit and BC7 kernels are only used offline (CompileTileSet) or for masked images,
+// they are shared with the SSE2 path. The DXT5 alpha kernel holds a whole block in one AVX2 register
+// (16-bit lanes), AVX-512 would need AVX-512BW for no wider blocks: the AVX-512 path uses the AVX2 one.
+static const dxt_kernels KERNELS[] = {
+	{ DXT_KERNEL_PATH_SSE2, encodeDxt1Blocks_fast_simd, encodeDxt1Blocks_quality_simd, encodeDxt1Blocks_cluster_simd, encodeDxt5AlphaBlocks_simd, encodeBc7Blocks_simd },
+	{ DXT_KERNEL_PATH_AVX2, encodeDxt1Blocks_fast_avx2, encodeDxt1Blocks_quality_avx2, encodeDxt1Blocks_cluster_simd, encodeDxt5AlphaBlocks_avx2, encodeBc7Blocks_simd },
+	{ DXT_KERNEL_PATH_AVX512, encodeDxt1Blocks_fast_avx512, encodeDxt1Blocks_quality_avx512, encodeDxt1Blocks_cluster_simd, encodeDxt5AlphaBlocks_avx2, encodeBc7Blocks_simd }
+};
+
+static const downsample_kernels DOWNSAMPLE_KERNELS[] = {
+	{ downsample_rgb_simd, downsample_rgba_simd },
+	{ downsample_rgb_avx2, downsample_rgba_avx2 },
+	{ downsample_rgb_avx2, downsample_rgba_avx2 }
+};
+
+#ifdef _WIN32
+static DXT_KERNEL_PATH get_widest_supported_path()
+{
+	int info[4];
+
+	__cpuid(info, 0);
+	if(info[0] < 7)
+		return DXT_KERNEL_PATH_SSE2;
+
+	// the OS must save the AVX registers on context switches
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if(!osxsave || !avx)
+		return DXT_KERNEL_PATH_SSE2;
+	const unsigned long long xcr0 = _xgetbv(0);
+	if((xcr0 & 0x06) != 0x06)	// XMM and YMM state
+		return DXT_KERNEL_PATH_SSE2;
+
+	__cpuidex(info, 7, 0);
+	const bool avx2 = (info[1] & (1 << 5)) != 0;
+	const bool avx512f = (info[1] & (1 << 16)) != 0;
+	if(avx512f && (xcr0 & 0xe6) == 0xe6)	// XMM, YMM, opmask and ZMM state
+		return DXT_KERNEL_PATH_AVX512;
+	if(avx2)
+		return DXT_KERNEL_PATH_AVX2;
+	return DXT_KERNEL_PATH_SSE2;
+}
+#else
+static DXT_KERNEL_PATH get_widest_supported_path()
+{
+	// GCC and Clang also check that the OS saves the wide registers
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f"))
+		return DXT_KERNEL_PATH_AVX512;
+	if(__builtin_cpu_supports("avx2"))
+		return DXT_KERNEL_PATH_AVX2;
+	return DXT_KERNEL_PATH_SSE2;
+}
+#endif
+
+static const DXT_KERNEL_PATH widest_supported_path = get_widest_supported_path();
+
+static DXT_KERNEL_PATH get_initial_path()
+{
+	// the ZUNTZU_DXT_KERNELS environment variable (sse2, avx2 or avx512) restricts the choice,
+	// so that the execution paths can be benchmarked and tested against each other
+	char value[16];
+#ifdef _WIN32
+	DWORD length = GetEnvironmentVariableA("ZUNTZU_DXT_KERNELS", value, sizeof(value));
+#else
+	const char * variable = getenv("ZUNTZU_DXT_KERNELS");
+	size_t length = (variable != 0 ? strlen(variable) : 0);
+	if(length > 0 && length < sizeof(value))
+		strcpy(value, variable);
+#endif
+	if(length > 0 && length < sizeof(value)) {
+		DXT_KERNEL_PATH requested_path =
+			(_stricmp(value, "sse2") == 0 ? DXT_KERNEL_PATH_SSE2 :
+			 _stricmp(value, "avx2") == 0 ? DXT_KERNEL_PATH_AVX2 :
+			 DXT_KERNEL_PATH_AVX512);
+		if(requested_path < widest_supported_path)
+			return requested_path;
+	}
+	return widest_supported_path;
+}
+
+static std::atomic<const dxt_kernels *> current_kernels(&KERNELS[get_initial_path()]);
+
+const dxt_kernels & get_dxt_kernels()
+{
+	return *current_kernels.load(std::memory_order_acquire);
+}
+
+const downsample_kernels & get_downsample_kernels()
+{
+	return DOWNSAMPLE_KERNELS[get_dxt_kernels().path];
+}
+
+extern "C" int __cdecl SetDxtKernelPath(int path)
+{
+	if(path == DXT_KERNEL_PATH_AUTO)
+		path = widest_supported_path;
+	if(path >= DXT_KERNEL_PATH_SSE2 && path <= widest_supported_path)
+		current_kernels.store(&KERNELS[path], std::memory_order_release);
+	return current_kernels.load(std::memory_order_acquire)->path;
+}
+
+extern "C" int __cdecl GetDxtKernelPath()
+{
+	return current_kernels.load(std::memory_order_acquire)->path;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#ifndef _WIN32
+#include "platform.h"	// these kernels are compiled without stdafx.h
+#endif
+
+// SIMD execution paths, from the most portable to the widest
+enum DXT_KERNEL_PATH {
+	DXT_KERNEL_PATH_AUTO = -1,	// widest path supported by the processor and the OS
+	DXT_KERNEL_PATH_SSE2 = 0,
+	DXT_KERNEL_PATH_AVX2 = 1,
+	DXT_KERNEL_PATH_AVX512 = 2
+};
+
+// Encodes block_count consecutive blocks of 16 texels (64 bytes each)
+// into blocks written block_stride bytes apart.
+// block_count must be a multiple of DXT_KERNEL_BATCH_SIZE.
+typedef void (__fastcall * dxt_blocks_kernel)(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+
+const size_t DXT_KERNEL_BATCH_SIZE = 16;	// widest batch (AVX-512)
+
+struct dxt_kernels {
+	DXT_KERNEL_PATH path;
+	dxt_blocks_kernel encode_dxt1_fast;	// color blocks, fast option
+	dxt_blocks_kernel encode_dxt1_quality;	// color blocks, quality option
+	dxt_blocks_kernel encode_dxt1_cluster;	// color blocks, cluster fit option
+	dxt_blocks_kernel encode_dxt5_alpha;	// alpha blocks
+	dxt_blocks_kernel encode_bc7;	// BC7 blocks (modes 5 and 6)
+};
+
+// Kernels for the current path (chosen from CPUID on first use, see SetDxtKernelPath)
+const dxt_kernels & get_dxt_kernels();
+
+// SSE2 (dxt_simd.cpp)
+void __fastcall encodeDxt1Blocks_fast_simd(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+void __fastcall encodeDxt1Blocks_quality_simd(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+void __fastcall encodeDxt1Blocks_cluster_simd(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+void __fastcall encodeDxt5AlphaBlocks_simd(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+
+// SSE2 (bc7.cpp)
+void __fastcall encodeBc7Blocks_simd(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+
+// AVX2 (dxt_avx2.cpp)
+void __fastcall encodeDxt1Blocks_fast_avx2(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+void __fastcall encodeDxt1Blocks_quality_avx2(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+void __fastcall encodeDxt5AlphaBlocks_avx2(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+
+// AVX-512 (dxt_avx512.cpp)
+void __fastcall encodeDxt1Blocks_fast_avx512(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
+void __fastcall encodeDxt1Blocks_quality_avx512(const unsigned char * rgba, unsigned char * blocks, size_t block_stride, size_t block_count);
@@ -3,8 +3,12 @@
 ----------------------------------------------------------------------------- */
 
 #include "stdafx.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
 #include <emmintrin.h>	// SIMD intrinsics
 #include "ZunTzuLib.h"
+#include "dxt_kernels.h"
 
 unsigned int __fastcall set_mxcsr()
 {
@@ -20,6 +24,14 @@ void __fastcall restore_mxcsr(unsigned int mxcsr)
 
 // SIMD macros
 
+// 32-bit lane of an integer vector (an lvalue)
+#ifdef _MSC_VER
+#define M128I_U32(x, i) ((x).m128i_u32[i])
+#else
+typedef unsigned int u32x4 __attribute__((vector_size(16), may_alias));
+#define M128I_U32(x, i) (reinterpret_cast<u32x4 &>(x)[i])
+#endif
+
 #define HORIZONTAL_MIN(x) \
 	((x) = _mm_min_ps((x), _mm_shuffle_ps((x), (x), _MM_SHUFFLE(1,0,3,2))), \
 	(x) = _mm_min_ps((x), _mm_shuffle_ps((x), (x), _MM_SHUFFLE(2,3,0,1))))
@@ -29,7 +41,19 @@ void __fastcall restore_mxcsr(unsigned int mxcsr)
 #define HORIZONTAL_ADD(x) \
 	((x) = _mm_add_ps((x), _mm_shuffle_ps((x), (x), _MM_SHUFFLE(1,0,3,2))), \
 	(x) = _mm_add_ps((x), _mm_shuffle_ps((x), (x), _MM_SHUFFLE(2,3,0,1))))
+#define HORIZONTAL_MIN_EPU8(x) \
+	((x) = _mm_min_epu8((x), _mm_srli_si128((x), 8)), \
+	(x) = _mm_min_epu8((x), _mm_srli_si128((x), 4)), \
+	(x) = _mm_min_epu8((x), _mm_srli_si128((x), 2)), \
+	(x) = _mm_min_epu8((x), _mm_srli_si128((x), 1)))
+#define HORIZONTAL_MAX_EPU8(x) \
+	((x) = _mm_max_epu8((x), _mm_srli_si128((x), 8)), \
+	(x) = _mm_max_epu8((x), _mm_srli_si128((x), 4)), \
+	(x) = _mm_max_epu8((x), _mm_srli_si128((x), 2)), \
+	(x) = _mm_max_epu8((x), _mm_srli_si128((x), 1)))
 #define INVERSE_SIGN(x) _mm_sub_ps(_mm_set1_ps(0.0f), (x))
+#define SELECT(mask, x, y) _mm_or_ps(_mm_and_ps((mask), (x)), _mm_andnot_ps((mask), (y)))
+#define SELECT_EPI32(mask, x, y) _mm_or_si128(_mm_and_si128((mask), (x)), _mm_andnot_si128((mask), (y)))
 
 // DXT1 code book
 
@@ -72,22 +96,22 @@ void __fastcall encodeDxt1Block_fast_simd(
 	for(int i = 0; i < 4; ++i) {
 		__m128i r, g, b;
 
-		r.m128i_u32[0] = rgba[16*i + (0 + 0)];
-		r.m128i_u32[1] = rgba[16*i + (4 + 0)];
-		r.m128i_u32[2] = rgba[16*i + (8 + 0)];
-		r.m128i_u32[3] = rgba[16*i + (12 + 0)];
+		M128I_U32(r, 0) = rgba[16*i + (0 + 0)];
+		M128I_U32(r, 1) = rgba[16*i + (4 + 0)];
+		M128I_U32(r, 2) = rgba[16*i + (8 + 0)];
+		M128I_U32(r, 3) = rgba[16*i + (12 + 0)];
 		q_pixels[i][0] = _mm_mul_ps(_mm_cvtepi32_ps(r), PERCEPTUAL_COEFF[0]);
 
-		g.m128i_u32[0] = rgba[16*i + (0 + 1)];
-		g.m128i_u32[1] = rgba[16*i + (4 + 1)];
-		g.m128i_u32[2] = rgba[16*i + (8 + 1)];
-		g.m128i_u32[3] = rgba[16*i + (12 + 1)];
+		M128I_U32(g, 0) = rgba[16*i + (0 + 1)];
+		M128I_U32(g, 1) = rgba[16*i + (4 + 1)];
+		M128I_U32(g, 2) = rgba[16*i + (8 + 1)];
+		M128I_U32(g, 3) = rgba[16*i + (12 + 1)];
 		q_pixels[i][1] = _mm_mul_ps(_mm_cvtepi32_ps(g), PERCEPTUAL_COEFF[1]);
 
-		b.m128i_u32[0] = rgba[16*i + (0 + 2)];
-		b.m128i_u32[1] = rgba[16*i + (4 + 2)];
-		b.m128i_u32[2] = rgba[16*i + (8 + 2)];
-		b.m128i_u32[3] = rgba[16*i + (12 + 2)];
+		M128I_U32(b, 0) = rgba[16*i + (0 + 2)];
+		M128I_U32(b, 1) = rgba[16*i + (4 + 2)];
+		M128I_U32(b, 2) = rgba[16*i + (8 + 2)];
+		M128I_U32(b, 3) = rgba[16*i + (12 + 2)];
 		q_pixels[i][2] = _mm_mul_ps(_mm_cvtepi32_ps(b), PERCEPTUAL_COEFF[2]);
 	}
 
@@ -255,13 +279,13 @@ void __fastcall encodeDxt1Block_fast_simd(
 		// convert to R5G6B5 format
 
 		unsigned short start = (unsigned short)(
-			start_color_rounded[2].m128i_u32[0] |
-			(start_color_rounded[1].m128i_u32[0] << 5) |
-			(start_color_rounded[0].m128i_u32[0] << 11));
+			M128I_U32(start_color_rounded[2], 0) |
+			(M128I_U32(start_color_rounded[1], 0) << 5) |
+			(M128I_U32(start_color_rounded[0], 0) << 11));
 		unsigned short end = (unsigned short)(
-			end_color_rounded[2].m128i_u32[0] |
-			(end_color_rounded[1].m128i_u32[0] << 5) |
-			(end_color_rounded[0].m128i_u32[0] << 11));
+			M128I_U32(end_color_rounded[2], 0) |
+			(M128I_U32(end_color_rounded[1], 0) << 5) |
+			(M128I_U32(end_color_rounded[0], 0) << 11));
 
 		// map each color to the indice of the closest position
 
@@ -281,10 +305,10 @@ void __fastcall encodeDxt1Block_fast_simd(
 		for( int i = 0; i < 4; ++i )
 		{
 			block[4 + i] =
-				DXT1_CODES_4[0*4 + indices[i].m128i_u32[0]] |
-				DXT1_CODES_4[1*4 + indices[i].m128i_u32[1]] |
-				DXT1_CODES_4[2*4 + indices[i].m128i_u32[2]] |
-				DXT1_CODES_4[3*4 + indices[i].m128i_u32[3]];
+				DXT1_CODES_4[0*4 + M128I_U32(indices[i], 0)] |
+				DXT1_CODES_4[1*4 + M128I_U32(indices[i], 1)] |
+				DXT1_CODES_4[2*4 + M128I_U32(indices[i], 2)] |
+				DXT1_CODES_4[3*4 + M128I_U32(indices[i], 3)];
 		}
 
 		if(start <= end) {	// good branch prediction (start is often > end because of the diagonals of the bounding box are oriented from low red to high red)
@@ -301,6 +325,264 @@ void __fastcall encodeDxt1Block_fast_simd(
 	}
 }
 
+// Same algorithm as encodeDxt1Block_fast_simd, transposed so that each SIMD lane
+// holds a different block: no horizontal reductions and no scalar gathers.
+// The floating point operations are performed in the same order as in the
+// single block version, so that both produce bit-identical blocks.
+//
+// rgba: 4 consecutive blocks of 16 texels (4 x 64 bytes)
+// blocks: 4 output blocks of 8 bytes, block_stride bytes apart
+
+static inline void encodeFourDxt1Blocks_fast_simd(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride)
+{
+	const __m128i mask_8_bits = _mm_set1_epi32(0x000000ff);
+
+	// read colors, transpose (one block per lane) and multiply by a perceptual coefficient
+
+	__m128 q_pixels[4][4][3];	// [row][column][channel]
+
+	for(int row = 0; row < 4; ++row) {
+		__m128i block_rows[4];
+		for(int b = 0; b < 4; ++b)
+			block_rows[b] = _mm_loadu_si128((const __m128i *)(rgba + 64*b + 16*row));
+
+		__m128i t0 = _mm_unpacklo_epi32(block_rows[0], block_rows[1]);
+		__m128i t1 = _mm_unpacklo_epi32(block_rows[2], block_rows[3]);
+		__m128i t2 = _mm_unpackhi_epi32(block_rows[0], block_rows[1]);
+		__m128i t3 = _mm_unpackhi_epi32(block_rows[2], block_rows[3]);
+
+		__m128i texels[4] = {
+			_mm_unpacklo_epi64(t0, t1),
+			_mm_unpackhi_epi64(t0, t1),
+			_mm_unpacklo_epi64(t2, t3),
+			_mm_unpackhi_epi64(t2, t3)
+		};
+
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(texels[col], mask_8_bits)), PERCEPTUAL_COEFF[0]);
+			q_pixels[row][col][1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels[col], 8), mask_8_bits)), PERCEPTUAL_COEFF[1]);
+			q_pixels[row][col][2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels[col], 16), mask_8_bits)), PERCEPTUAL_COEFF[2]);
+		}
+	}
+
+	// calculate bounding box
+
+	__m128 min[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	__m128 max[3] = { q_pixels[0][0][0], q_pixels[0][0][1], q_pixels[0][0][2] };
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			for(int c = 0; c < 3; ++c) {
+				min[c] = _mm_min_ps(min[c], q_pixels[row][col][c]);
+				max[c] = _mm_max_ps(max[c], q_pixels[row][col][c]);
+			}
+		}
+	}
+
+	// single color?
+	__m128i single_color_mask = _mm_castps_si128(
+		_mm_and_ps(
+			_mm_and_ps(_mm_cmpeq_ps(min[0], max[0]), _mm_cmpeq_ps(min[1], max[1])),
+			_mm_cmpeq_ps(min[2], max[2])));
+
+	// calculate centroid (same summation order as the single block version)
+
+	__m128 centroid[3];
+	for(int c = 0; c < 3; ++c) {
+		__m128 column_sums[4];
+		for(int col = 0; col < 4; ++col) {
+			column_sums[col] = q_pixels[0][col][c];
+			for(int row = 1; row < 4; ++row)
+				column_sums[col] = _mm_add_ps(column_sums[col], q_pixels[row][col][c]);
+		}
+		centroid[c] = _mm_mul_ps(
+			_mm_add_ps(
+				_mm_add_ps(column_sums[0], column_sums[2]),
+				_mm_add_ps(column_sums[1], column_sums[3])),
+			_mm_set1_ps(1.0f / 16.0f));
+	}
+
+	// move referential to centroid
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			q_pixels[row][col][0] = _mm_sub_ps(q_pixels[row][col][0], centroid[0]);
+			q_pixels[row][col][1] = _mm_sub_ps(q_pixels[row][col][1], centroid[1]);
+			q_pixels[row][col][2] = _mm_sub_ps(q_pixels[row][col][2], centroid[2]);
+		}
+	}
+
+	// principal component analysis approximation: find best diagonal of the bounding box
+
+	// calculate directions for all four diagonals
+
+	__m128 any_diagonal[3] = {
+		_mm_sub_ps(max[0], min[0]),
+		_mm_sub_ps(max[1], min[1]),
+		_mm_sub_ps(max[2], min[2])
+	};
+	__m128 inv_diag_norm =
+		_mm_rsqrt_ps(
+			_mm_add_ps(
+				_mm_add_ps(
+					_mm_mul_ps(any_diagonal[0], any_diagonal[0]),
+					_mm_mul_ps(any_diagonal[1], any_diagonal[1])
+				),
+				_mm_mul_ps(any_diagonal[2], any_diagonal[2])
+			)
+		);
+	any_diagonal[0] = _mm_mul_ps(any_diagonal[0], inv_diag_norm);
+	any_diagonal[1] = _mm_mul_ps(any_diagonal[1], inv_diag_norm);
+	any_diagonal[2] = _mm_mul_ps(any_diagonal[2], inv_diag_norm);
+
+	__m128 diags[4][3] = {
+		{ any_diagonal[0], any_diagonal[1], any_diagonal[2] },
+		{ any_diagonal[0], any_diagonal[1], INVERSE_SIGN(any_diagonal[2]) },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), any_diagonal[2] },
+		{ any_diagonal[0], INVERSE_SIGN(any_diagonal[1]), INVERSE_SIGN(any_diagonal[2]) }
+	};
+
+	// for each diagonal calculate the projection of each colour
+	// (the four diagonals only differ by the signs of their last two components,
+	// so the products are shared between them)
+
+	__m128 min_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+	__m128 max_dot_product[4] = { ZERO, ZERO, ZERO, ZERO };
+
+	for(int row = 0; row < 4; ++row) {
+		for(int col = 0; col < 4; ++col) {
+			__m128 product0 = _mm_mul_ps(q_pixels[row][col][0], diags[0][0]);
+			__m128 product1 = _mm_mul_ps(q_pixels[row][col][1], diags[0][1]);
+			__m128 product1_inv = _mm_mul_ps(q_pixels[row][col][1], diags[2][1]);
+			__m128 product2 = _mm_mul_ps(q_pixels[row][col][2], diags[0][2]);
+			__m128 product2_inv = _mm_mul_ps(q_pixels[row][col][2], diags[1][2]);
+
+			__m128 dot_products[4] = {
+				_mm_add_ps(product0, _mm_add_ps(product1, product2)),
+				_mm_add_ps(product0, _mm_add_ps(product1, product2_inv)),
+				_mm_add_ps(product0, _mm_add_ps(product1_inv, product2)),
+				_mm_add_ps(product0, _mm_add_ps(product1_inv, product2_inv))
+			};
+			for(int diag_choice = 0; diag_choice < 4; ++diag_choice) {
+				min_dot_product[diag_choice] = _mm_min_ps(min_dot_product[diag_choice], dot_products[diag_choice]);
+				max_dot_product[diag_choice] = _mm_max_ps(max_dot_product[diag_choice], dot_products[diag_choice]);
+			}
+		}
+	}
+
+	// keep the most discriminating diagonal (i.e. biggest difference between least and greatest dot products)
+	// the first diagonal is the default choice, as in the single block version
+
+	__m128 largest_dot_product_difference = _mm_sub_ps(max_dot_product[0], min_dot_product[0]);
+	__m128 best_min_dot_product = min_dot_product[0];
+	__m128 best_max_dot_product = max_dot_product[0];
+	__m128 best_diag[3] = { diags[0][0], diags[0][1], diags[0][2] };
+
+	for(int diag_choice = 1; diag_choice < 4; ++diag_choice) {
+		__m128 dot_product_difference = _mm_sub_ps(max_dot_product[diag_choice], min_dot_product[diag_choice]);
+		__m128 is_better = _mm_cmplt_ps(largest_dot_product_difference, dot_product_difference);
+
+		largest_dot_product_difference = SELECT(is_better, dot_product_difference, largest_dot_product_difference);
+		best_min_dot_product = SELECT(is_better, min_dot_product[diag_choice], best_min_dot_product);
+		best_max_dot_product = SELECT(is_better, max_dot_product[diag_choice], best_max_dot_product);
+		best_diag[1] = SELECT(is_better, diags[diag_choice][1], best_diag[1]);
+		best_diag[2] = SELECT(is_better, diags[diag_choice][2], best_diag[2]);
+	}
+
+	// choose extreme positions as start and end colors, round and clamp values
+
+	__m128i start_color_rounded[3], end_color_rounded[3];
+	start_color_rounded[0] = _mm_cvtps_epi32(_mm_max_ps(ZERO, _mm_min_ps(CLAMP_31, _mm_mul_ps(INV_PERCEPTUAL_COEFF[0], _mm_add_ps(centroid[0], _mm_mul_ps(best_max_dot_product, best_diag[0]))))));
+	start_color_rounded[1] = _mm_cvtps_epi32(_mm_max_ps(ZERO, _mm_min_ps(CLAMP_63, _mm_mul_ps(INV_PERCEPTUAL_COEFF[1], _mm_add_ps(centroid[1], _mm_mul_ps(best_max_dot_product, best_diag[1]))))));
+	start_color_rounded[2] = _mm_cvtps_epi32(_mm_max_ps(ZERO, _mm_min_ps(CLAMP_31, _mm_mul_ps(INV_PERCEPTUAL_COEFF[2], _mm_add_ps(centroid[2], _mm_mul_ps(best_max_dot_product, best_diag[2]))))));
+
+	end_color_rounded[0] = _mm_cvtps_epi32(_mm_max_ps(ZERO, _mm_min_ps(CLAMP_31, _mm_mul_ps(INV_PERCEPTUAL_COEFF[0], _mm_add_ps(centroid[0], _mm_mul_ps(best_min_dot_product, best_diag[0]))))));
+	end_color_rounded[1] = _mm_cvtps_epi32(_mm_max_ps(ZERO, _mm_min_ps(CLAMP_63, _mm_mul_ps(INV_PERCEPTUAL_COEFF[1], _mm_add_ps(centroid[1], _mm_mul_ps(best_min_dot_product, best_diag[1]))))));
+	end_color_rounded[2] = _mm_cvtps_epi32(_mm_max_ps(ZERO, _mm_min_ps(CLAMP_31, _mm_mul_ps(INV_PERCEPTUAL_COEFF[2], _mm_add_ps(centroid[2], _mm_mul_ps(best_min_dot_product, best_diag[2]))))));
+
+	// convert to R5G6B5 format
+
+	__m128i start = _mm_or_si128(_mm_or_si128(
+		start_color_rounded[2],
+		_mm_slli_epi32(start_color_rounded[1], 5)),
+		_mm_slli_epi32(start_color_rounded[0], 11));
+	__m128i end = _mm_or_si128(_mm_or_si128(
+		end_color_rounded[2],
+		_mm_slli_epi32(end_color_rounded[1], 5)),
+		_mm_slli_epi32(end_color_rounded[0], 11));
+
+	// map each color to the indice of the closest position, and convert to DXT1 codes (last texel in the upper bits)
+	// (DXT1_CODES_4 maps indices 0, 1, 2, 3 to codes 1, 3, 2, 0, i.e. code = (-index & 3) ^ (index == 0 || index == 3))
+
+	__m128i indices = _mm_setzero_si128();
+	__m128 coeff = _mm_mul_ps(_mm_set1_ps(3.0f), _mm_rcp_ps(largest_dot_product_difference));
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i three = _mm_set1_epi32(3);
+	for(int row = 3; row >= 0; --row) {
+		for(int col = 3; col >= 0; --col) {
+			__m128 dot_product =
+				_mm_add_ps(
+					_mm_mul_ps(q_pixels[row][col][0], best_diag[0]),
+					_mm_add_ps(
+						_mm_mul_ps(q_pixels[row][col][1], best_diag[1]),
+						_mm_mul_ps(q_pixels[row][col][2], best_diag[2])
+					)
+				);
+			__m128i index = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(dot_product, best_min_dot_product), coeff));
+			__m128i code = _mm_xor_si128(
+				_mm_and_si128(_mm_sub_epi32(_mm_setzero_si128(), index), three),
+				_mm_xor_si128(_mm_and_si128(_mm_srli_epi32(_mm_add_epi32(index, one), 1), one), one));
+			indices = _mm_or_si128(_mm_slli_epi32(indices, 2), code);
+		}
+	}
+
+	// reverse start and end to stay in four colors mode,
+	// or clear the indices in the degenerate case where the colors end up being the same when rounded down
+
+	__m128i start_equals_end = _mm_cmpeq_epi32(start, end);
+	__m128i start_lower_than_end = _mm_cmplt_epi32(start, end);
+	__m128i color0 = SELECT_EPI32(start_lower_than_end, end, start);
+	__m128i color1 = SELECT_EPI32(start_lower_than_end, start, end);
+	indices = _mm_xor_si128(indices, _mm_and_si128(start_lower_than_end, _mm_set1_epi32(0x55555555)));
+	indices = _mm_andnot_si128(start_equals_end, indices);
+
+	// single color blocks
+
+	__m128i first_texels = _mm_unpacklo_epi64(
+		_mm_unpacklo_epi32(_mm_cvtsi32_si128(*(const int *)(rgba + 64*0)), _mm_cvtsi32_si128(*(const int *)(rgba + 64*1))),
+		_mm_unpacklo_epi32(_mm_cvtsi32_si128(*(const int *)(rgba + 64*2)), _mm_cvtsi32_si128(*(const int *)(rgba + 64*3))));
+	__m128i single_color = _mm_or_si128(_mm_or_si128(
+		_mm_srli_epi32(_mm_and_si128(_mm_srli_epi32(first_texels, 16), mask_8_bits), 3),
+		_mm_slli_epi32(_mm_srli_epi32(_mm_and_si128(_mm_srli_epi32(first_texels, 8), mask_8_bits), 2), 5)),
+		_mm_slli_epi32(_mm_srli_epi32(_mm_and_si128(first_texels, mask_8_bits), 3), 11));
+
+	color0 = SELECT_EPI32(single_color_mask, single_color, color0);
+	color1 = SELECT_EPI32(single_color_mask, single_color, color1);
+	indices = _mm_andnot_si128(single_color_mask, indices);
+
+	// write block bits
+
+	__m128i endpoints = _mm_or_si128(color0, _mm_slli_epi32(color1, 16));
+	__m128i blocks01 = _mm_unpacklo_epi32(endpoints, indices);
+	__m128i blocks23 = _mm_unpackhi_epi32(endpoints, indices);
+	_mm_storel_epi64((__m128i *)(blocks + 0 * block_stride), blocks01);
+	_mm_storel_epi64((__m128i *)(blocks + 1 * block_stride), _mm_srli_si128(blocks01, 8));
+	_mm_storel_epi64((__m128i *)(blocks + 2 * block_stride), blocks23);
+	_mm_storel_epi64((__m128i *)(blocks + 3 * block_stride), _mm_srli_si128(blocks23, 8));
+}
+
+void __fastcall encodeDxt1Blocks_fast_simd(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	for(size_t i = 0; i < block_count; i += 4)
+		encodeFourDxt1Blocks_fast_simd(rgba + 64 * i, blocks + block_stride * i, block_stride);
+}
+
 void __fastcall encodeDxt1Block_quality_simd(
 	const unsigned char * rgba,
 	unsigned char * block)
@@ -313,22 +595,22 @@ void __fastcall encodeDxt1Block_quality_simd(
 	for(int i = 0; i < 4; ++i) {
 		__m128i r, g, b;
 
-		r.m128i_u32[0] = rgba[16*i + (0 + 0)];
-		r.m128i_u32[1] = rgba[16*i + (4 + 0)];
-		r.m128i_u32[2] = rgba[16*i + (8 + 0)];
-		r.m128i_u32[3] = rgba[16*i + (12 + 0)];
+		M128I_U32(r, 0) = rgba[16*i + (0 + 0)];
+		M128I_U32(r, 1) = rgba[16*i + (4 + 0)];
+		M128I_U32(r, 2) = rgba[16*i + (8 + 0)];
+		M128I_U32(r, 3) = rgba[16*i + (12 + 0)];
 		q_pixels[i][0] = _mm_cvtepi32_ps(r);
 
-		g.m128i_u32[0] = rgba[16*i + (0 + 1)];
-		g.m128i_u32[1] = rgba[16*i + (4 + 1)];
-		g.m128i_u32[2] = rgba[16*i + (8 + 1)];
-		g.m128i_u32[3] = rgba[16*i + (12 + 1)];
+		M128I_U32(g, 0) = rgba[16*i + (0 + 1)];
+		M128I_U32(g, 1) = rgba[16*i + (4 + 1)];
+		M128I_U32(g, 2) = rgba[16*i + (8 + 1)];
+		M128I_U32(g, 3) = rgba[16*i + (12 + 1)];
 		q_pixels[i][1] = _mm_cvtepi32_ps(g);
 
-		b.m128i_u32[0] = rgba[16*i + (0 + 2)];
-		b.m128i_u32[1] = rgba[16*i + (4 + 2)];
-		b.m128i_u32[2] = rgba[16*i + (8 + 2)];
-		b.m128i_u32[3] = rgba[16*i + (12 + 2)];
+		M128I_U32(b, 0) = rgba[16*i + (0 + 2)];
+		M128I_U32(b, 1) = rgba[16*i + (4 + 2)];
+		M128I_U32(b, 2) = rgba[16*i + (8 + 2)];
+		M128I_U32(b, 3) = rgba[16*i + (12 + 2)];
 		q_pixels[i][2] = _mm_cvtepi32_ps(b);
 	}
 
@@ -594,13 +876,13 @@ void __fastcall encodeDxt1Block_quality_simd(
 		// convert to R5G6B5 format
 
 		unsigned short start = (unsigned short)(
-			start_color_rounded[2].m128i_u32[0] |
-			(start_color_rounded[1].m128i_u32[0] << 5) |
-			(start_color_rounded[0].m128i_u32[0] << 11));
+			M128I_U32(start_color_rounded[2], 0) |
+			(M128I_U32(start_color_rounded[1], 0) << 5) |
+			(M128I_U32(start_color_rounded[0], 0) << 11));
 		unsigned short end = (unsigned short)(
-			end_color_rounded[2].m128i_u32[0] |
-			(end_color_rounded[1].m128i_u32[0] << 5) |
-			(end_color_rounded[0].m128i_u32[0] << 11));
+			M128I_U32(end_color_rounded[2], 0) |
+			(M128I_U32(end_color_rounded[1], 0) << 5) |
+			(M128I_U32(end_color_rounded[0], 0) << 11));
 
 		// write block bits
 
@@ -612,10 +894,10 @@ void __fastcall encodeDxt1Block_quality_simd(
 		for( int i = 0; i < 4; ++i )
 		{
 			block[4 + i] =
-				DXT1_CODES_4[0*4 + indices[i].m128i_u32[0]] |
-				DXT1_CODES_4[1*4 + indices[i].m128i_u32[1]] |
-				DXT1_CODES_4[2*4 + indices[i].m128i_u32[2]] |
-				DXT1_CODES_4[3*4 + indices[i].m128i_u32[3]];
+				DXT1_CODES_4[0*4 + M128I_U32(indices[i], 0)] |
+				DXT1_CODES_4[1*4 + M128I_U32(indices[i], 1)] |
+				DXT1_CODES_4[2*4 + M128I_U32(indices[i], 2)] |
+				DXT1_CODES_4[3*4 + M128I_U32(indices[i], 3)];
 		}
 
 		if(start <= end) {	// note that start is often >= end because of the diagonals of the bounding box are oriented from low red to high red
@@ -632,150 +914,354 @@ void __fastcall encodeDxt1Block_quality_simd(
 	}
 }
 
-static const unsigned int DXT5_CODES_8[8] = {
-	0x00000001, 0x00000007, 0x00000006, 0x00000005,
-	0x00000004, 0x00000003, 0x00000002, 0x00000000
-};
-
-static const unsigned int DXT5_CODES_6[8] = {
-	0x00000000, 0x00000002, 0x00000003,
-	0x00000004, 0x00000005, 0x00000001,
-	0x00000006, 0x00000007
-};
+// DXT5 alpha blocks, on 16-bit integer lanes
 
-void __fastcall encodeDxt5Block_simd(
-	const unsigned char * rgba,
-	unsigned char * block)
+// 3-bit index of each texel: (alpha - base) * step_count / distance, rounded (ties up), without division
+static inline __m128i quantize_alpha(
+	__m128i alpha, __m128i base, __m128i step_count, __m128i distance)
 {
-	// read alpha, calculate bounds
-
-	__m128 alpha[4];
+	const __m128i distance_2 = _mm_add_epi16(distance, distance);
+	const __m128i distance_4 = _mm_add_epi16(distance_2, distance_2);
+	const __m128i one = _mm_set1_epi16(1);
+
+	__m128i t = _mm_add_epi16(
+		_mm_mullo_epi16(_mm_sub_epi16(alpha, base), step_count),
+		_mm_srli_epi16(distance, 1));
+
+	__m128i ge = _mm_cmpgt_epi16(t, _mm_sub_epi16(distance_4, one));
+	__m128i index = _mm_and_si128(ge, _mm_set1_epi16(4));
+	t = _mm_sub_epi16(t, _mm_and_si128(ge, distance_4));
+	ge = _mm_cmpgt_epi16(t, _mm_sub_epi16(distance_2, one));
+	index = _mm_or_si128(index, _mm_and_si128(ge, _mm_set1_epi16(2)));
+	t = _mm_sub_epi16(t, _mm_and_si128(ge, distance_2));
+	ge = _mm_cmpgt_epi16(t, _mm_sub_epi16(distance, one));
+	return _mm_or_si128(index, _mm_and_si128(ge, one));
+}
 
-	const __m128 const_0 = _mm_set1_ps(0.0f);
-	const __m128 const_255 = _mm_set1_ps(255.0f);
+// 8 interpolated alphas, from min (index 0) to max (index 7):
+// code 0 is alpha_0 (max), code 1 is alpha_1 (min), codes 2 to 7 go from max to min
+static inline __m128i get_codes_8(__m128i index)
+{
+	const __m128i code = _mm_and_si128(_mm_sub_epi16(_mm_setzero_si128(), index), _mm_set1_epi16(7));
+	return _mm_xor_si128(code, _mm_and_si128(_mm_cmpgt_epi16(_mm_set1_epi16(2), code), _mm_set1_epi16(1)));
+}
 
-	__m128 min = const_255;
-	__m128 max = const_0;
-	__m128 min_non_0 = const_255;
-	__m128 max_non_255 = const_0;
+// 6 interpolated alphas, from min (index 0) to max (index 5), plus 0 and 255:
+// code 0 is alpha_0 (min), code 1 is alpha_1 (max), codes 2 to 5 go from min to max, 6 is 0 and 7 is 255
+static inline __m128i get_codes_6(__m128i index, __m128i alpha)
+{
+	__m128i code = _mm_add_epi16(index, _mm_set1_epi16(1));
+	code = SELECT_EPI32(_mm_cmpeq_epi16(index, _mm_setzero_si128()), _mm_setzero_si128(), code);
+	code = SELECT_EPI32(_mm_cmpeq_epi16(index, _mm_set1_epi16(5)), _mm_set1_epi16(1), code);
+	code = SELECT_EPI32(_mm_cmpeq_epi16(alpha, _mm_setzero_si128()), _mm_set1_epi16(6), code);
+	return SELECT_EPI32(_mm_cmpeq_epi16(alpha, _mm_set1_epi16(255)), _mm_set1_epi16(7), code);
+}
 
-	for(int i = 0; i < 4; ++i) {
-		__m128i a;
-		a.m128i_u32[0] = rgba[16*i + (0 + 3)];
-		a.m128i_u32[1] = rgba[16*i + (4 + 3)];
-		a.m128i_u32[2] = rgba[16*i + (8 + 3)];
-		a.m128i_u32[3] = rgba[16*i + (12 + 3)];
+// Alpha halves of DXT5 blocks: alpha_0 and alpha_1, then 16 codes of 3 bits.
+// Endpoints are the min and max alphas. When both 0 and 255 are present, the 6-interpolant mode
+// spans the other alphas and keeps 0 and 255 exact, otherwise the 8-interpolant mode spans them all.
+// Blocks of a single alpha (e.g. fully opaque or fully transparent) are written straight away.
+void __fastcall encodeDxt5AlphaBlocks_simd(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i all_ones = _mm_cmpeq_epi8(zero, zero);
+	const __m128i pair_factors = _mm_set_epi16(8, 1, 8, 1, 8, 1, 8, 1);
+	const __m128i quad_factors = _mm_set_epi16(64, 1, 64, 1, 64, 1, 64, 1);
+	const __m128i octet_factors = _mm_set_epi16(4096, 1, 4096, 1, 4096, 1, 4096, 1);
+
+	for(size_t i = 0; i < block_count; ++i, rgba += 64, blocks += block_stride) {
+		// the 16 alphas of the block, as bytes
+		const __m128i * texels = reinterpret_cast<const __m128i*>(rgba);
+		const __m128i alpha_8 = _mm_packus_epi16(
+			_mm_packs_epi32(_mm_srli_epi32(_mm_loadu_si128(texels + 0), 24), _mm_srli_epi32(_mm_loadu_si128(texels + 1), 24)),
+			_mm_packs_epi32(_mm_srli_epi32(_mm_loadu_si128(texels + 2), 24), _mm_srli_epi32(_mm_loadu_si128(texels + 3), 24)));
+
+		// single alpha?
+		const unsigned int first_alpha = rgba[3];
+		if(0xffff == _mm_movemask_epi8(_mm_cmpeq_epi8(alpha_8, _mm_set1_epi8((char) first_alpha)))) {
+			*reinterpret_cast<unsigned int*>(blocks) = first_alpha | (first_alpha << 8);
+			*reinterpret_cast<unsigned int*>(blocks + 4) = 0x00000000;
+			continue;
+		}
 
-		alpha[i] = _mm_cvtepi32_ps(a);
+		__m128i min_alpha = alpha_8;
+		__m128i max_alpha = alpha_8;
+		HORIZONTAL_MIN_EPU8(min_alpha);
+		HORIZONTAL_MAX_EPU8(max_alpha);
+		unsigned int alpha_0 = _mm_cvtsi128_si32(max_alpha) & 0xff;
+		unsigned int alpha_1 = _mm_cvtsi128_si32(min_alpha) & 0xff;
+
+		const __m128i alpha_lo = _mm_unpacklo_epi8(alpha_8, zero);
+		const __m128i alpha_hi = _mm_unpackhi_epi8(alpha_8, zero);
+		__m128i codes_lo, codes_hi;
+		if(alpha_1 == 0 && alpha_0 == 255) {
+			// 6 interpolants between the min non-0 and the max non-255 alphas
+			__m128i min_non_0 = _mm_or_si128(alpha_8, _mm_cmpeq_epi8(alpha_8, zero));
+			__m128i max_non_255 = _mm_andnot_si128(_mm_cmpeq_epi8(alpha_8, all_ones), alpha_8);
+			HORIZONTAL_MIN_EPU8(min_non_0);
+			HORIZONTAL_MAX_EPU8(max_non_255);
+			alpha_0 = _mm_cvtsi128_si32(min_non_0) & 0xff;
+			alpha_1 = _mm_cvtsi128_si32(max_non_255) & 0xff;
+			if(alpha_0 == 255) {
+				// 0 and 255 only
+				alpha_0 = 0;
+				alpha_1 = 255;
+			}
 
-		min = _mm_min_ps(min, alpha[i]);
-		max = _mm_max_ps(max, alpha[i]);
+			const __m128i base = _mm_set1_epi16((short) alpha_0);
+			const __m128i distance = _mm_set1_epi16((short) max(1u, alpha_1 - alpha_0));
+			const __m128i step_count = _mm_set1_epi16(5);
+			codes_lo = get_codes_6(quantize_alpha(alpha_lo, base, step_count, distance), alpha_lo);
+			codes_hi = get_codes_6(quantize_alpha(alpha_hi, base, step_count, distance), alpha_hi);
+		} else {
+			// 8 interpolants between the min and max alphas
+			const __m128i base = _mm_set1_epi16((short) alpha_1);
+			const __m128i distance = _mm_set1_epi16((short) (alpha_0 - alpha_1));
+			const __m128i step_count = _mm_set1_epi16(7);
+			codes_lo = get_codes_8(quantize_alpha(alpha_lo, base, step_count, distance));
+			codes_hi = get_codes_8(quantize_alpha(alpha_hi, base, step_count, distance));
+		}
 
-		__m128 a_is_0 = _mm_cmpeq_ps(alpha[i], const_0);
-		min_non_0 = _mm_or_ps(
-			_mm_and_ps(a_is_0, min_non_0),
-			_mm_andnot_ps(a_is_0, _mm_min_ps(min_non_0, alpha[i]))
-		);
+		// 16 codes of 3 bits: pairs of 6 bits, quads of 12 bits, then two octets of 24 bits
+		__m128i bits = _mm_packs_epi32(_mm_madd_epi16(codes_lo, pair_factors), _mm_madd_epi16(codes_hi, pair_factors));
+		bits = _mm_madd_epi16(bits, quad_factors);
+		bits = _mm_madd_epi16(_mm_packs_epi32(bits, bits), octet_factors);
+		const unsigned int bits_0 = _mm_cvtsi128_si32(bits);
+		const unsigned int bits_1 = _mm_cvtsi128_si32(_mm_srli_si128(bits, 4));
 
-		max_non_255 = _mm_max_ps(max_non_255,
-			_mm_and_ps(alpha[i], _mm_cmpneq_ps(alpha[i], const_255)));
+		*reinterpret_cast<unsigned int*>(blocks) = alpha_0 | (alpha_1 << 8) | (bits_0 << 16);
+		*reinterpret_cast<unsigned int*>(blocks + 4) = (bits_0 >> 16) | (bits_1 << 8);
 	}
+}
 
-	// HORIZONTAL_MIN: (x, y, z, w) -> (min(x,y,z,x), min(x,y,z,x), min(x,y,z,x))
-	min = HORIZONTAL_MIN(min);
-	min_non_0 = HORIZONTAL_MIN(min_non_0);
-
-	// HORIZONTAL_MAX: (x, y, z, w) -> (max(x,y,z,x), max(x,y,z,x), max(x,y,z,x))
-	max = HORIZONTAL_MAX(max);
-	max_non_255 = HORIZONTAL_MAX(max_non_255);
-
-	// single alpha?
-	if(1 == _mm_comieq_ss(min, max)) {
+void __fastcall encodeDxt1Blocks_quality_simd(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	for(size_t i = 0; i < block_count; ++i)
+		encodeDxt1Block_quality_simd(rgba + 64 * i, blocks + block_stride * i);
+}
 
-		// single alpha
-		// write block bits
-		unsigned char single_alpha = rgba[3];
+// DXT1 cluster fit
 
-		block[1] = block[0] = single_alpha;
-		block[3] = block[2] = (unsigned char) 0x00;
-		*((unsigned int*)(block + 4)) = 0x00000000;
-
-	} else {
-		
-		unsigned int codes[16];
+// texels of a block ordered along their principal axis (power iteration on the covariance matrix)
+static void order_along_principal_axis(
+	const unsigned char * rgba,
+	float (* points)[3])
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for(int i = 0; i < 16; ++i)
+		for(int c = 0; c < 3; ++c)
+			mean[c] += rgba[4 * i + c];
+	for(int c = 0; c < 3; ++c)
+		mean[c] *= 1.0f / 16.0f;
+
+	float covariance[3][3] = { { 0.0f } };
+	for(int i = 0; i < 16; ++i) {
+		float d[3];
+		for(int c = 0; c < 3; ++c)
+			d[c] = rgba[4 * i + c] - mean[c];
+		for(int c = 0; c < 3; ++c)
+			for(int k = 0; k < 3; ++k)
+				covariance[c][k] += d[c] * d[k];
+	}
 
-		// min == 0 && max == 255 ?
-		if(1 == _mm_comieq_ss(min, const_0) &&
-			1 == _mm_comieq_ss(max, const_255))
-		{
-			__m128 min_non_0_is_255 = _mm_cmpeq_ps(min_non_0, const_255);
-			min_non_0 = _mm_andnot_ps(min_non_0_is_255, min_non_0);
-			max_non_255 = _mm_or_ps(
-				_mm_and_ps(min_non_0_is_255, const_255),
-				_mm_andnot_ps(min_non_0_is_255, max_non_255));
-
-			block[0] = _mm_cvtss_si32(min_non_0);
-			block[1] = _mm_cvtss_si32(max_non_255);
-
-			// coeff = min_non_0 == max_non_255 ? 0.0f : 5.0f / (max_non_255 - min_non_0)
-			__m128 coeff = _mm_and_ps(
-				_mm_cmpneq_ps(max_non_255, min_non_0),
-				_mm_div_ps(_mm_set1_ps(5.0f), _mm_sub_ps(max_non_255, min_non_0)));
-			for(int i = 0; i < 4; ++i) {
-				__m128 a = alpha[i];
-				__m128 a_is_0 = _mm_cmpeq_ps(a, const_0);
-				__m128 a_is_255 = _mm_cmpeq_ps(a, const_255);
-				__m128i indices = _mm_cvtps_epi32(
-					_mm_or_ps(
-						_mm_and_ps(a_is_0, _mm_set1_ps(6.0f)),
-						_mm_andnot_ps(a_is_0,
-							_mm_or_ps(
-								_mm_and_ps(a_is_255, _mm_set1_ps(7.0f)),
-								_mm_andnot_ps(a_is_255,
-									_mm_mul_ps(_mm_sub_ps(a, min_non_0), coeff)
-								)
-							)
-						)
-					)
-				);
+	// start from the channel of largest variance
+	int largest = 0;
+	for(int c = 1; c < 3; ++c)
+		if(covariance[c][c] > covariance[largest][largest])
+			largest = c;
+	float axis[3] = { covariance[largest][0], covariance[largest][1], covariance[largest][2] };
+	for(int iteration = 0; iteration < 8; ++iteration) {
+		float next[3];
+		for(int c = 0; c < 3; ++c)
+			next[c] = covariance[c][0] * axis[0] + covariance[c][1] * axis[1] + covariance[c][2] * axis[2];
+		const float norm = max(max(fabsf(next[0]), fabsf(next[1])), fabsf(next[2]));
+		if(norm == 0.0f)
+			break;	// single color
+		for(int c = 0; c < 3; ++c)
+			axis[c] = next[c] / norm;
+	}
 
-				codes[i*4 + 0] = DXT5_CODES_6[indices.m128i_u32[0]];
-				codes[i*4 + 1] = DXT5_CODES_6[indices.m128i_u32[1]];
-				codes[i*4 + 2] = DXT5_CODES_6[indices.m128i_u32[2]];
-				codes[i*4 + 3] = DXT5_CODES_6[indices.m128i_u32[3]];
-			}
+	// insertion sort of the projections
+	float dot_products[16];
+	int order[16];
+	for(int i = 0; i < 16; ++i) {
+		const float dot_product = rgba[4 * i + 0] * axis[0] + rgba[4 * i + 1] * axis[1] + rgba[4 * i + 2] * axis[2];
+		int j = i;
+		for(; j > 0 && dot_products[j - 1] > dot_product; --j) {
+			dot_products[j] = dot_products[j - 1];
+			order[j] = order[j - 1];
+		}
+		dot_products[j] = dot_product;
+		order[j] = i;
+	}
+	for(int i = 0; i < 16; ++i)
+		for(int c = 0; c < 3; ++c)
+			points[i][c] = rgba[4 * order[i] + c];
+}
 
-		} else {
+// endpoint channel rounded to 5 bits (blue, red) or 6 bits (green), and expanded back to 8 bits
+static inline __m128i quantize_endpoint(__m128 channel, int c)
+{
+	const float scale = (c == 1 ? 63.0f / 255.0f : 31.0f / 255.0f);
+	return _mm_cvtps_epi32(_mm_mul_ps(_mm_max_ps(ZERO, _mm_min_ps(_mm_set1_ps(255.0f), channel)), _mm_set1_ps(scale)));
+}
 
-			block[0] = _mm_cvtss_si32(max);
-			block[1] = _mm_cvtss_si32(min);
+static inline __m128i expand_endpoint(__m128i quantized, int c)
+{
+	return (c == 1 ?
+		_mm_or_si128(_mm_slli_epi32(quantized, 2), _mm_srli_epi32(quantized, 4)) :
+		_mm_or_si128(_mm_slli_epi32(quantized, 3), _mm_srli_epi32(quantized, 2)));
+}
 
-			__m128 coeff = _mm_div_ps(_mm_set1_ps(7.0f), _mm_sub_ps(max, min));
-			for(int i = 0; i < 4; ++i) {
-				__m128 a = alpha[i];
-				__m128i indices = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(a, min), coeff));
+// Colour halves of 4 blocks at once, one block per lane, for offline compression:
+// the texels of each block are ordered along its principal axis and every split of that order into 4 consecutive
+// clusters (start, 2/3 start + 1/3 end, 1/3 start + 2/3 end, end) is tried. The endpoints of a split are its least
+// squares solution, rounded to R5G6B5 before measuring the error. The splits are the same for all the lanes.
+static void encodeFourDxt1Blocks_cluster_simd(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride)
+{
+	// prefix sums of the ordered texels: sums[n] is the sum of the first n texels
+	__m128 sums[17][3];
+	{
+		float points[4][16][3];
+		for(int lane = 0; lane < 4; ++lane)
+			order_along_principal_axis(rgba + 64 * lane, points[lane]);
+		for(int c = 0; c < 3; ++c)
+			sums[0][c] = ZERO;
+		for(int i = 0; i < 16; ++i)
+			for(int c = 0; c < 3; ++c)
+				sums[i + 1][c] = _mm_add_ps(sums[i][c], _mm_setr_ps(points[0][i][c], points[1][i][c], points[2][i][c], points[3][i][c]));
+	}
 
-				codes[i*4 + 0] = DXT5_CODES_8[indices.m128i_u32[0]];
-				codes[i*4 + 1] = DXT5_CODES_8[indices.m128i_u32[1]];
-				codes[i*4 + 2] = DXT5_CODES_8[indices.m128i_u32[2]];
-				codes[i*4 + 3] = DXT5_CODES_8[indices.m128i_u32[3]];
+	__m128 best_error = _mm_set1_ps(FLT_MAX);
+	__m128i best_start[3] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+	__m128i best_end[3] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+	for(int count_0 = 0; count_0 <= 16; ++count_0) {
+		for(int count_1 = 0; count_0 + count_1 <= 16; ++count_1) {
+			for(int count_2 = 0; count_0 + count_1 + count_2 <= 16; ++count_2) {
+				const int count_3 = 16 - count_0 - count_1 - count_2;
+				if(count_0 == 16 || count_1 == 16 || count_2 == 16 || count_3 == 16)
+					continue;	// a single cluster has no least squares solution
+
+				// same equations as the quality option, S{alpha[i]^2}, S{beta[i]^2} and S{alpha[i]*beta[i]} only depend on the split
+				const float S_alpha_2 = count_0 + (4 * count_1 + count_2) * (1.0f / 9.0f);
+				const float S_beta_2 = count_3 + (count_1 + 4 * count_2) * (1.0f / 9.0f);
+				const float S_alpha_beta = (count_1 + count_2) * (2.0f / 9.0f);
+				const float factor = 1.0f / (S_alpha_2 * S_beta_2 - S_alpha_beta * S_alpha_beta);
+
+				const __m128 * cluster_sums_0 = sums[count_0];
+				const __m128 * cluster_sums_1 = sums[count_0 + count_1];
+				const __m128 * cluster_sums_2 = sums[count_0 + count_1 + count_2];
+				__m128 error = ZERO;
+				__m128i start[3], end[3];
+				for(int c = 0; c < 3; ++c) {
+					const __m128 cluster_1 = _mm_sub_ps(cluster_sums_1[c], cluster_sums_0[c]);
+					const __m128 cluster_2 = _mm_sub_ps(cluster_sums_2[c], cluster_sums_1[c]);
+					const __m128 cluster_3 = _mm_sub_ps(sums[16][c], cluster_sums_2[c]);
+					const __m128 S_alpha_pixel = _mm_add_ps(cluster_sums_0[c],
+						_mm_mul_ps(_mm_set1_ps(1.0f / 3.0f), _mm_add_ps(_mm_add_ps(cluster_1, cluster_1), cluster_2)));
+					const __m128 S_beta_pixel = _mm_add_ps(cluster_3,
+						_mm_mul_ps(_mm_set1_ps(1.0f / 3.0f), _mm_add_ps(_mm_add_ps(cluster_2, cluster_2), cluster_1)));
+
+					const __m128 start_color = _mm_mul_ps(_mm_set1_ps(factor),
+						_mm_sub_ps(_mm_mul_ps(S_alpha_pixel, _mm_set1_ps(S_beta_2)), _mm_mul_ps(S_beta_pixel, _mm_set1_ps(S_alpha_beta))));
+					const __m128 end_color = _mm_mul_ps(_mm_set1_ps(factor),
+						_mm_sub_ps(_mm_mul_ps(S_beta_pixel, _mm_set1_ps(S_alpha_2)), _mm_mul_ps(S_alpha_pixel, _mm_set1_ps(S_alpha_beta))));
+
+					start[c] = quantize_endpoint(start_color, c);
+					end[c] = quantize_endpoint(end_color, c);
+					const __m128 s = _mm_cvtepi32_ps(expand_endpoint(start[c], c));
+					const __m128 e = _mm_cvtepi32_ps(expand_endpoint(end[c], c));
+
+					// squared error, less S{pixel[i]^2} which is the same for all the splits
+					error = _mm_add_ps(error, _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, s), _mm_set1_ps(S_alpha_2)), _mm_mul_ps(_mm_mul_ps(e, e), _mm_set1_ps(S_beta_2))),
+						_mm_mul_ps(_mm_set1_ps(2.0f), _mm_sub_ps(
+							_mm_mul_ps(_mm_mul_ps(s, e), _mm_set1_ps(S_alpha_beta)),
+							_mm_add_ps(_mm_mul_ps(s, S_alpha_pixel), _mm_mul_ps(e, S_beta_pixel))))));
+				}
+
+				const __m128i better = _mm_castps_si128(_mm_cmplt_ps(error, best_error));
+				best_error = _mm_min_ps(error, best_error);
+				for(int c = 0; c < 3; ++c) {
+					best_start[c] = SELECT_EPI32(better, start[c], best_start[c]);
+					best_end[c] = SELECT_EPI32(better, end[c], best_end[c]);
+				}
 			}
 		}
+	}
 
-		for(int i = 0; i < 2; ++i) {
-			block[i*3 + 2] = (unsigned char) (
-				codes[i*8 + 0] |
-				(codes[i*8 + 1] << 3) |
-				((0x00000003 & codes[i*8 + 2]) << 6));
-			block[i*3 + 3] = (unsigned char) (
-				((0x00000004 & codes[i*8 + 2]) >> 2) |
-				(codes[i*8 + 3] << 1) |
-				(codes[i*8 + 4] << 4) |
-				((0x00000001 & codes[i*8 + 5]) << 7));
-			block[i*3 + 4] = (unsigned char) (
-				((0x00000006 & codes[i*8 + 5]) >> 1) |
-				(codes[i*8 + 6] << 2) |
-				(codes[i*8 + 7] << 5));
+	// write block bits, each texel taking the closest color of the palette
+	for(int lane = 0; lane < 4; ++lane) {
+		const unsigned char * texels = rgba + 64 * lane;
+		unsigned char * block = blocks + block_stride * lane;
+
+		unsigned short start = (unsigned short) (
+			M128I_U32(best_start[2], lane) | (M128I_U32(best_start[1], lane) << 5) | (M128I_U32(best_start[0], lane) << 11));
+		unsigned short end = (unsigned short) (
+			M128I_U32(best_end[2], lane) | (M128I_U32(best_end[1], lane) << 5) | (M128I_U32(best_end[0], lane) << 11));
+		if(start < end) {
+			// reverse start and end to stay in four colors mode
+			const unsigned short swapped = start;
+			start = end;
+			end = swapped;
 		}
+		*((unsigned short*)block) = start;
+		*((unsigned short*)(block + 2)) = end;
+		if(start == end) {
+			*((unsigned int*)(block + 4)) = 0x00000000;
+			continue;
+		}
+
+		// palette in code order: start, end, 2/3 start + 1/3 end, 1/3 start + 2/3 end
+		int palette[4][3];
+		const int shifts[3] = { 11, 5, 0 };
+		const int bit_counts[3] = { 5, 6, 5 };
+		for(int c = 0; c < 3; ++c) {
+			const int s = (start >> shifts[c]) & ((1 << bit_counts[c]) - 1);
+			const int e = (end >> shifts[c]) & ((1 << bit_counts[c]) - 1);
+			palette[0][c] = (s << (8 - bit_counts[c])) | (s >> (2 * bit_counts[c] - 8));
+			palette[1][c] = (e << (8 - bit_counts[c])) | (e >> (2 * bit_counts[c] - 8));
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		unsigned int indices = 0;
+		for(int i = 0; i < 16; ++i) {
+			int best_code = 0;
+			int best_distance = INT_MAX;
+			for(int code = 0; code < 4; ++code) {
+				int distance = 0;
+				for(int c = 0; c < 3; ++c) {
+					const int d = texels[4 * i + c] - palette[code][c];
+					distance += d * d;
+				}
+				if(distance < best_distance) {
+					best_distance = distance;
+					best_code = code;
+				}
+			}
+			indices |= (unsigned int) best_code << (2 * i);
+		}
+		*((unsigned int*)(block + 4)) = indices;
 	}
 }
+
+void __fastcall encodeDxt1Blocks_cluster_simd(
+	const unsigned char * rgba,
+	unsigned char * blocks,
+	size_t block_stride,
+	size_t block_count)
+{
+	for(size_t i = 0; i < block_count; i += 4)
+		encodeFourDxt1Blocks_cluster_simd(rgba + 64 * i, blocks + block_stride * i, block_stride);
+}
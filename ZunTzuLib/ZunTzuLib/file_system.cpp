@@ -0,0 +1,462 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#endif
+#include "file_system.h"
+#include "image_loader_error.h"
+
+#ifdef _WIN32
+
+mapped_file::mapped_file() :
+	file(INVALID_HANDLE_VALUE),
+	mapping(0),
+	data(0),
+	size(0)
+{
+}
+
+mapped_file::~mapped_file()
+{
+	if(data != 0)
+		UnmapViewOfFile(data);
+	if(mapping != 0)
+		CloseHandle(mapping);
+	if(file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+}
+
+error_code mapped_file::map(
+	const wchar_t * file_name)
+{
+	file = CreateFileW(file_name,
+		GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return UNZIPPER_CANNOT_OPEN_ARCHIVE_FILE;
+
+	LARGE_INTEGER file_size;
+	if(!GetFileSizeEx(file, &file_size))
+		return UNZIPPER_CANNOT_READ_FILE_SIZE;
+
+	mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mapping == NULL)
+		return UNZIPPER_CANNOT_CREATE_FILE_MAPPING;
+
+	data = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(data == NULL)
+		return UNZIPPER_CANNOT_MAP_FILE;
+	size = (unsigned long long) file_size.QuadPart;
+	return 0;
+}
+
+positioned_file::positioned_file() :
+	file(INVALID_HANDLE_VALUE)
+{
+}
+
+positioned_file::~positioned_file()
+{
+	close();
+}
+
+bool positioned_file::create(
+	const wchar_t * file_name,
+	unsigned long long size)
+{
+	file = CreateFileW(file_name,
+		GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	file_size.QuadPart = (LONGLONG) size;
+	if(!SetFilePointerEx(file, file_size, NULL, FILE_BEGIN) || !SetEndOfFile(file)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool positioned_file::write(
+	unsigned long long offset,
+	const void * data,
+	size_t size)
+{
+	OVERLAPPED overlapped;
+	ZeroMemory(&overlapped, sizeof(overlapped));
+	overlapped.Offset = (DWORD) offset;
+	overlapped.OffsetHigh = (DWORD) (offset >> 32);
+	DWORD bytes_written = 0;
+	return WriteFile(file, data, (DWORD) size, &bytes_written, &overlapped) && bytes_written == size;
+}
+
+bool positioned_file::is_open() const
+{
+	return file != INVALID_HANDLE_VALUE;
+}
+
+void positioned_file::close()
+{
+	if(file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+}
+
+scratch_mapping::scratch_mapping() :
+	mapping(0),
+	data(0),
+	size(0)
+{
+}
+
+scratch_mapping::~scratch_mapping()
+{
+	if(data != 0)
+		UnmapViewOfFile(data);
+	if(mapping != 0)
+		CloseHandle(mapping);
+}
+
+bool scratch_mapping::map(
+	unsigned long long size)
+{
+	mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD) (size >> 32), (DWORD) size, NULL);
+	if(mapping == NULL)
+		return false;
+	data = (char *) MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T) size);
+	if(data == NULL)
+		return false;
+	this->size = size;
+	return true;
+}
+
+bool delete_file(
+	const wchar_t * file_name)
+{
+	return 0 != DeleteFileW(file_name);
+}
+
+bool touch_file(
+	const wchar_t * file_name)
+{
+	// FILE_WRITE_ATTRIBUTES does not conflict with the mappings of the file
+	HANDLE file = CreateFileW(file_name, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING, 0, 0);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	const bool touched = (0 != SetFileTime(file, 0, 0, &now));
+	CloseHandle(file);
+	return touched;
+}
+
+bool list_files(
+	const wchar_t * directory_name,
+	const wchar_t * extension,
+	std::vector<file_info> & files)
+{
+	wchar_t pattern[MAX_PATH];
+	if(0 > _snwprintf_s(pattern, MAX_PATH, _TRUNCATE, L"%ls\\*%ls", directory_name, extension))
+		return false;
+	WIN32_FIND_DATAW data;
+	HANDLE search = FindFirstFileW(pattern, &data);
+	if(search == INVALID_HANDLE_VALUE)
+		return GetLastError() == ERROR_FILE_NOT_FOUND;
+	do {
+		file_info file;
+		if((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 &&
+			0 < _snwprintf_s(file.file_name, MAX_PATH, _TRUNCATE, L"%ls\\%ls", directory_name, data.cFileName))
+		{
+			file.size = ((unsigned long long) data.nFileSizeHigh << 32) | data.nFileSizeLow;
+			file.last_write_time = ((unsigned long long) data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+			files.push_back(file);
+		}
+	} while(FindNextFileW(search, &data));
+	FindClose(search);
+	return true;
+}
+
+bool replace_file(
+	const wchar_t * source_file_name,
+	const wchar_t * destination_file_name)
+{
+	return 0 != MoveFileExW(source_file_name, destination_file_name, MOVEFILE_REPLACE_EXISTING);
+}
+
+bool create_directory(
+	const wchar_t * directory_name)
+{
+	CreateDirectoryW(directory_name, 0);
+	DWORD attributes = GetFileAttributesW(directory_name);
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+bool create_temporary_file(
+	const wchar_t * directory_name,
+	const wchar_t * prefix,
+	wchar_t (&file_name)[MAX_PATH])
+{
+	return 0 != GetTempFileNameW(directory_name, prefix, 0, file_name);
+}
+
+FILE * create_text_file(
+	const wchar_t * file_name)
+{
+	FILE * file = 0;
+	if(0 != _wfopen_s(&file, file_name, L"w"))
+		return 0;
+	return file;
+}
+
+#else
+
+// wide characters are UTF-32 on POSIX systems
+static std::string to_utf8(const wchar_t * text) {
+	std::string utf8;
+	for(; *text != 0; ++text) {
+		const unsigned int c = (unsigned int) *text;
+		if(c < 0x80) {
+			utf8 += (char) c;
+		} else if(c < 0x800) {
+			utf8 += (char) (0xC0 | (c >> 6));
+			utf8 += (char) (0x80 | (c & 0x3F));
+		} else if(c < 0x10000) {
+			utf8 += (char) (0xE0 | (c >> 12));
+			utf8 += (char) (0x80 | ((c >> 6) & 0x3F));
+			utf8 += (char) (0x80 | (c & 0x3F));
+		} else {
+			utf8 += (char) (0xF0 | (c >> 18));
+			utf8 += (char) (0x80 | ((c >> 12) & 0x3F));
+			utf8 += (char) (0x80 | ((c >> 6) & 0x3F));
+			utf8 += (char) (0x80 | (c & 0x3F));
+		}
+	}
+	return utf8;
+}
+
+// false if the text does not fit
+static bool from_utf8(const char * utf8, wchar_t * text, size_t text_size) {
+	size_t length = 0;
+	for(const unsigned char * p = reinterpret_cast<const unsigned char*>(utf8); *p != 0; ) {
+		unsigned int c = *p++;
+		int continuation_count = (c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0);
+		if(continuation_count > 0)
+			c &= (0x3F >> continuation_count);
+		for(; continuation_count > 0 && (*p & 0xC0) == 0x80; --continuation_count)
+			c = (c << 6) | (*p++ & 0x3F);
+		if(length + 1 >= text_size)
+			return false;
+		text[length++] = (wchar_t) c;
+	}
+	text[length] = 0;
+	return true;
+}
+
+mapped_file::mapped_file() :
+	data(0),
+	size(0)
+{
+}
+
+mapped_file::~mapped_file()
+{
+	if(data != 0)
+		munmap(const_cast<char*>(data), (size_t) size);
+}
+
+error_code mapped_file::map(
+	const wchar_t * file_name)
+{
+	const int file = open(to_utf8(file_name).c_str(), O_RDONLY);
+	if(file == -1)
+		return UNZIPPER_CANNOT_OPEN_ARCHIVE_FILE;
+
+	struct stat status;
+	if(fstat(file, &status) != 0) {
+		::close(file);
+		return UNZIPPER_CANNOT_READ_FILE_SIZE;
+	}
+	if(status.st_size == 0) {
+		::close(file);
+		return UNZIPPER_CANNOT_CREATE_FILE_MAPPING;	// as on Windows
+	}
+
+	// the mapping outlives the file descriptor
+	void * view = mmap(0, (size_t) status.st_size, PROT_READ, MAP_SHARED, file, 0);
+	::close(file);
+	if(view == MAP_FAILED)
+		return UNZIPPER_CANNOT_MAP_FILE;
+	data = static_cast<const char*>(view);
+	size = (unsigned long long) status.st_size;
+	return 0;
+}
+
+positioned_file::positioned_file() :
+	file(-1)
+{
+}
+
+positioned_file::~positioned_file()
+{
+	close();
+}
+
+bool positioned_file::create(
+	const wchar_t * file_name,
+	unsigned long long size)
+{
+	file = open(to_utf8(file_name).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(file == -1)
+		return false;
+	if(ftruncate(file, (off_t) size) != 0) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool positioned_file::write(
+	unsigned long long offset,
+	const void * data,
+	size_t size)
+{
+	const char * bytes = static_cast<const char*>(data);
+	while(size > 0) {
+		const ssize_t bytes_written = pwrite(file, bytes, size, (off_t) offset);
+		if(bytes_written <= 0)
+			return false;
+		bytes += bytes_written;
+		offset += bytes_written;
+		size -= bytes_written;
+	}
+	return true;
+}
+
+bool positioned_file::is_open() const
+{
+	return file != -1;
+}
+
+void positioned_file::close()
+{
+	if(file != -1) {
+		::close(file);
+		file = -1;
+	}
+}
+
+scratch_mapping::scratch_mapping() :
+	data(0),
+	size(0)
+{
+}
+
+scratch_mapping::~scratch_mapping()
+{
+	if(data != 0)
+		munmap(data, (size_t) size);
+}
+
+bool scratch_mapping::map(
+	unsigned long long size)
+{
+	if(size == 0 || size != (size_t) size)
+		return false;
+	void * view = mmap(0, (size_t) size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(view == MAP_FAILED)
+		return false;
+	data = static_cast<char*>(view);
+	this->size = size;
+	return true;
+}
+
+bool delete_file(
+	const wchar_t * file_name)
+{
+	return 0 == unlink(to_utf8(file_name).c_str());
+}
+
+bool touch_file(
+	const wchar_t * file_name)
+{
+	return 0 == utimensat(AT_FDCWD, to_utf8(file_name).c_str(), 0, 0);
+}
+
+bool list_files(
+	const wchar_t * directory_name,
+	const wchar_t * extension,
+	std::vector<file_info> & files)
+{
+	const std::string directory_utf8 = to_utf8(directory_name);
+	const std::string extension_utf8 = to_utf8(extension);
+	DIR * directory = opendir(directory_utf8.c_str());
+	if(directory == 0)
+		return false;
+	while(const dirent * entry = readdir(directory)) {
+		const size_t length = strlen(entry->d_name);
+		if(length < extension_utf8.size() || 0 != strcmp(entry->d_name + length - extension_utf8.size(), extension_utf8.c_str()))
+			continue;
+		const std::string name = directory_utf8 + '/' + entry->d_name;
+		struct stat status;
+		file_info file;
+		if(stat(name.c_str(), &status) == 0 && S_ISREG(status.st_mode) && from_utf8(name.c_str(), file.file_name, MAX_PATH)) {
+			file.size = (unsigned long long) status.st_size;
+			file.last_write_time = (unsigned long long) status.st_mtim.tv_sec * 1000000000ULL + (unsigned long long) status.st_mtim.tv_nsec;
+			files.push_back(file);
+		}
+	}
+	closedir(directory);
+	return true;
+}
+
+bool replace_file(
+	const wchar_t * source_file_name,
+	const wchar_t * destination_file_name)
+{
+	return 0 == rename(to_utf8(source_file_name).c_str(), to_utf8(destination_file_name).c_str());
+}
+
+bool create_directory(
+	const wchar_t * directory_name)
+{
+	const std::string name = to_utf8(directory_name);
+	mkdir(name.c_str(), 0755);
+	struct stat status;
+	return stat(name.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+bool create_temporary_file(
+	const wchar_t * directory_name,
+	const wchar_t * prefix,
+	wchar_t (&file_name)[MAX_PATH])
+{
+	std::string name = to_utf8(directory_name) + '/' + to_utf8(prefix) + "XXXXXX";
+	const int file = mkstemp(&name[0]);
+	if(file == -1)
+		return false;
+	::close(file);
+	if(!from_utf8(name.c_str(), file_name, MAX_PATH)) {
+		unlink(name.c_str());
+		return false;
+	}
+	return true;
+}
+
+FILE * create_text_file(
+	const wchar_t * file_name)
+{
+	return fopen(to_utf8(file_name).c_str(), "w");
+}
+
+#endif
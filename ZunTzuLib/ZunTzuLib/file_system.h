@@ -0,0 +1,82 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// Files used by the image loaders, on Windows and on POSIX systems (for the headless builds, see CMakeLists.txt).
+// File names are wide strings, as everywhere in ZunTzuLib. On POSIX systems they are converted to UTF-8.
+
+#include <vector>
+
+typedef int error_code;	// no error if 0, otherwise abort
+
+#ifdef _WIN32
+const wchar_t PATH_SEPARATOR = L'\\';
+#else
+const wchar_t PATH_SEPARATOR = L'/';
+#endif
+
+// read-only mapping of a whole file
+class mapped_file {
+public:
+	mapped_file();
+	~mapped_file();
+	error_code map(const wchar_t * file_name);	// UNZIPPER_CANNOT_OPEN_ARCHIVE_FILE... UNZIPPER_CANNOT_MAP_FILE if error
+	const char * get_data() const { return data; }
+	unsigned long long get_size() const { return size; }
+private:
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+	const char * data;	// 0 if not mapped
+	unsigned long long size;
+};
+
+// file of a fixed size, written at any offset
+class positioned_file {
+public:
+	positioned_file();
+	~positioned_file();
+	bool create(const wchar_t * file_name, unsigned long long size);	// replaces any existing file
+	bool write(unsigned long long offset, const void * data, size_t size);
+	bool is_open() const;
+	void close();
+private:
+#ifdef _WIN32
+	HANDLE file;
+#else
+	int file;
+#endif
+};
+
+// read-write memory backed by the paging file rather than the heap, e.g. for a whole decoded image
+class scratch_mapping {
+public:
+	scratch_mapping();
+	~scratch_mapping();
+	bool map(unsigned long long size);	// zero-filled, false if it cannot be mapped
+	char * get_data() const { return data; }
+private:
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+	char * data;	// 0 if not mapped
+	unsigned long long size;
+};
+
+// file of a directory, see list_files
+struct file_info {
+	wchar_t file_name[MAX_PATH];	// directory included
+	unsigned long long size;
+	unsigned long long last_write_time;	// only comparable with the times of other files
+};
+
+bool delete_file(const wchar_t * file_name);
+bool touch_file(const wchar_t * file_name);	// sets the last write time to now
+bool list_files(const wchar_t * directory_name, const wchar_t * extension, std::vector<file_info> & files);	// files whose name ends with the extension (e.g. L".ztt"), false if the directory cannot be read
+bool replace_file(const wchar_t * source_file_name, const wchar_t * destination_file_name);
+bool create_directory(const wchar_t * directory_name);	// true if the directory exists afterwards
+bool create_temporary_file(const wchar_t * directory_name, const wchar_t * prefix, wchar_t (&file_name)[MAX_PATH]);	// an empty file with a unique name
+FILE * create_text_file(const wchar_t * file_name);	// opened for writing, 0 if error
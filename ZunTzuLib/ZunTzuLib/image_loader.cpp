@@ -4,7 +4,11 @@
 
 #include "stdafx.h"
 #include "ZunTzuLib.h"
+#include "batch_image_loader.h"
 #include "dxt_compressor.h"
+#include "tile_cache.h"
+#include "image_loader_error.h"
+#include "unzipper.h"
 
 extern "C" void * __cdecl CreateImageLoader(
 	const wchar_t * archive_name,
@@ -19,9 +23,49 @@ extern "C" void * __cdecl CreateImageLoader(
 	if(IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
 		options |= 2;
 
-	return (mask_entry_name == 0 || strlen(mask_entry_name) == 0 ?
+	// cluster fit implies FAVOR_QUALITY, the cached tiles of both spellings are the same
+	if(options & 4)
+		options |= 1;
+
+	// BC7 tiles (see dxt.cpp) replace the DXT5 tiles of masked images only
+	const bool masked = (mask_entry_name != 0 && strlen(mask_entry_name) > 0);
+	if(!masked)
+		options &= ~8;
+
+	// a tile set precompiled by the box author ("image.jpg.ztt") replaces the image and its mask,
+	// unless BC7 tiles are wanted or mipmap levels are skipped (it holds all the levels)
+	char tile_set_entry_name[MAX_PATH];
+	unsigned int tile_set_crc32;
+	if((options & 8) == 0 && skipped_mipmap_levels == 0 &&
+		0 == strcpy_s(tile_set_entry_name, image_entry_name) && 0 == strcat_s(tile_set_entry_name, ".ztt") &&
+		simple_unzipper::find_entry(archive_name, tile_set_entry_name, tile_set_crc32))
+	{
+		// its index is read at once: a tile set of the wrong format (DXT1 for a masked image or DXT5 for an opaque one) is ignored
+		ztt_tile_reader * reader = new ztt_tile_reader(archive_name, tile_set_entry_name, masked);
+		unsigned int width, height;
+		if(reader->get_image_dimensions(width, height) == 0)
+			return static_cast<dxt_compressor*>(reader);
+		delete reader;
+	}
+
+	// tiles compressed by a previous run are read back from the cache, otherwise they are recorded
+	tile_cache_key * key = new tile_cache_key(archive_name, image_entry_name, mask_entry_name, skipped_mipmap_levels, options);
+	if(key->is_valid()) {
+		ztt_mapped_file * file = key->open_cached_tiles();
+		if(file != 0) {
+			delete key;
+			return static_cast<dxt_compressor*>(new ztt_tile_reader(file));
+		}
+	}
+
+	dxt_compressor * compressor = (!masked ?
 		static_cast<dxt_compressor*>(new dxt1_compressor(archive_name, image_entry_name, skipped_mipmap_levels, options)) :
 		static_cast<dxt_compressor*>(new dxt5_compressor(archive_name, image_entry_name, mask_entry_name, skipped_mipmap_levels, options)));
+	if(!key->is_valid()) {
+		delete key;
+		return compressor;
+	}
+	return static_cast<dxt_compressor*>(new tile_cache_recorder(key, compressor));
 }
 
 extern "C" int __cdecl GetImageDimensions(
@@ -46,6 +90,30 @@ extern "C" int __cdecl LoadNextTile(
 	return compressor->get_next_tile(tile, *mipmap_level, *x, *y);
 }
 
+extern "C" int __cdecl LoadNextTiles(
+	void * image_loader,
+	char ** tiles,
+	unsigned int tile_count,
+	unsigned int * mipmap_levels,
+	unsigned int * xs,
+	unsigned int * ys)
+{
+	dxt_compressor * compressor = static_cast<dxt_compressor*>(image_loader);
+	return compressor->get_next_tiles(tiles, tile_count, mipmap_levels, xs, ys);
+}
+
+extern "C" void __cdecl PrioritizeTiles(
+	void * image_loader,
+	unsigned int mipmap_level,
+	unsigned int left,
+	unsigned int top,
+	unsigned int right,
+	unsigned int bottom)
+{
+	dxt_compressor * compressor = static_cast<dxt_compressor*>(image_loader);
+	compressor->prioritize_tiles(mipmap_level, left, top, right, bottom);
+}
+
 extern "C" void __cdecl FreeImageLoader(
 	void * image_loader)
 {
@@ -53,3 +121,111 @@ extern "C" void __cdecl FreeImageLoader(
 	dxt_compressor * compressor = static_cast<dxt_compressor*>(image_loader);
 	delete compressor;
 }
+
+extern "C" void * __cdecl CreateBatchImageLoader(
+	unsigned int image_count,
+	const wchar_t ** archive_names,
+	const char ** image_entry_names,
+	const char ** mask_entry_names,
+	unsigned int skipped_mipmap_levels,
+	int options)
+{
+	return new batch_image_loader(image_count, archive_names, image_entry_names, mask_entry_names, skipped_mipmap_levels, options);
+}
+
+extern "C" int __cdecl GetBatchImageDimensions(
+	void * batch_loader,
+	unsigned int image,
+	unsigned int * width,
+	unsigned int * height)
+{
+	return static_cast<batch_image_loader*>(batch_loader)->get_image_dimensions(image, *width, *height);
+}
+
+extern "C" unsigned int __cdecl LoadNextBatchTiles(
+	void * batch_loader,
+	char ** destinations,
+	const int * masked,
+	unsigned int destination_count,
+	char ** tiles,
+	unsigned int tile_count,
+	unsigned int * images,
+	unsigned int * mipmap_levels,
+	unsigned int * xs,
+	unsigned int * ys)
+{
+	return static_cast<batch_image_loader*>(batch_loader)->get_next_tiles(destinations, masked, destination_count, tiles, tile_count, images, mipmap_levels, xs, ys);
+}
+
+extern "C" void __cdecl PrioritizeBatchTiles(
+	void * batch_loader,
+	unsigned int image,
+	unsigned int mipmap_level,
+	unsigned int left,
+	unsigned int top,
+	unsigned int right,
+	unsigned int bottom)
+{
+	static_cast<batch_image_loader*>(batch_loader)->prioritize_tiles(image, mipmap_level, left, top, right, bottom);
+}
+
+extern "C" void __cdecl FreeBatchImageLoader(
+	void * batch_loader)
+{
+	delete static_cast<batch_image_loader*>(batch_loader);
+}
+
+extern "C" void * __cdecl OpenArchive(
+	const wchar_t * archive_name)
+{
+	error_code error;
+	return zip_archive::open(archive_name, error);
+}
+
+extern "C" void __cdecl CloseArchive(
+	void * archive)
+{
+	if(archive != 0)
+		static_cast<zip_archive*>(archive)->release();
+}
+
+extern "C" int __cdecl CompileTileSet(
+	const wchar_t * archive_name,
+	const char * image_entry_name,
+	const char * mask_entry_name,
+	const wchar_t * tile_set_file_name)
+{
+	// offline compilation favors quality, whatever the time it takes
+	int options = 1 | 4;
+	if(IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+		options |= 2;
+
+	const bool has_mask = (mask_entry_name != 0 && strlen(mask_entry_name) > 0);
+	dxt_compressor * compressor = (!has_mask ?
+		static_cast<dxt_compressor*>(new dxt1_compressor(archive_name, image_entry_name, 0, options)) :
+		static_cast<dxt_compressor*>(new dxt5_compressor(archive_name, image_entry_name, mask_entry_name, 0, options)));
+
+	unsigned int width, height;
+	error_code error = compressor->get_image_dimensions(width, height);
+	if(error == 0) {
+		ztt_index index;
+		index.init(width, height, 0, has_mask, options, 0);
+		ztt_writer writer;
+		if(!writer.create(tile_set_file_name, index, 0)) {
+			error = ZTT_CANNOT_WRITE_FILE;
+		} else {
+			char * tile_data = new char[index.header.tile_size];
+			for(unsigned int i = 0; error == 0 && i < index.header.tile_count; ++i) {
+				unsigned int mipmap_level, x, y;
+				error = compressor->get_next_tile(tile_data, mipmap_level, x, y);
+				if(error == 0 && !writer.write_tile(mipmap_level, x, y, tile_data))
+					error = ZTT_CANNOT_WRITE_FILE;
+			}
+			delete [] tile_data;
+			if(!writer.close() && error == 0)
+				error = ZTT_CANNOT_WRITE_FILE;
+		}
+	}
+	delete compressor;
+	return error;
+}
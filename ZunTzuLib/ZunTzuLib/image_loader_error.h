@@ -21,6 +21,10 @@ enum IMAGE_LOADER_ERROR {
 	IMAGE_NOT_A_PNG_FILE,
 	IMAGE_READ_ERROR,
 	IMAGE_CANNOT_CREATE_PNG_READER,
+	ZTT_NOT_A_TILE_SET,
+	ZTT_READ_PAST_LAST_TILE,
+	ZTT_CANNOT_WRITE_FILE,
+	IMAGE_CANNOT_MAP_SCRATCH_IMAGE,
 
 	JPEG_ERRORS,	// JPEG errors start here
 	JPEG_JERR_ARITH_NOTIMPL, // Sorry, there are legal restrictions on arithmetic coding
@@ -9,7 +9,7 @@
 
 class image_reader {
 public:
-	virtual ~image_reader() = 0 {}
+	virtual ~image_reader() = 0;
 	virtual void set_error_handler(const jmp_buf & error_handler) = 0;
 	virtual void get_image_dimensions(unsigned int & width, unsigned int & height) = 0;
 	virtual char * read_line() = 0;
@@ -17,7 +17,11 @@ protected:
 	image_reader() {}
 };
 
+inline image_reader::~image_reader() {}
+
 class unzipper;
+class jpeg_band_decoder;
+class scratch_mapping;
 
 struct my_error_mgr {
 	struct jpeg_error_mgr pub;	// "public" fields
@@ -33,11 +37,16 @@ public:
 	virtual char * read_line();
 private:
 	void init_jpeg();
+	void start_decompress();
 
 	my_error_mgr jerr;
 	struct jpeg_decompress_struct cinfo;
 	JSAMPARRAY pBuffer;
-	unzipper * unzipper;
+	::unzipper * unzipper;
+	JOCTET * data;	// copy of the start of the entry, or of the whole entry if decoded by bands, 0 if read in place
+	size_t data_size;
+	jpeg_band_decoder * band_decoder;	// 0 if decoded by this thread only
+	bool header_read;
 };
 
 class png_reader : public image_reader {
@@ -49,12 +58,15 @@ public:
 	virtual char * read_line();
 private:
 	void init_png();
+	void read_interlaced_image();
 
 	jmp_buf error_handler;
 	png_structp png_ptr;
 	png_infop info_ptr;
 	png_bytep row_pointer;
-	unzipper * unzipper;
+	::unzipper * unzipper;
 	unsigned int current_scanline;
 	unsigned int height;
+	int pass_count;	// more than 1 if interlaced
+	scratch_mapping * image;	// all the passes of an interlaced image, decoded by the first read_line
 };
@@ -11,6 +11,8 @@
 
 #undef RIGHT_SHIFT_IS_UNSIGNED
 
+#ifdef _WIN32  /* the system libjpeg of other platforms keeps the defaults */
+
 /* Define "boolean" as unsigned char, not int, per Windows custom */
 #ifndef __RPCNDR_H__            /* don't conflict if rpcndr.h already read */
 typedef unsigned char boolean;
@@ -23,3 +25,5 @@ typedef short INT16;
 typedef signed int INT32;
 #endif
 #define XMD_H                   /* prevent jmorecfg.h from redefining it */
+
+#endif
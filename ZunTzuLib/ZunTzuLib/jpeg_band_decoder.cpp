@@ -0,0 +1,344 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include "jerror.h"
+#include "image_reader.h"
+#include "jpeg_band_decoder.h"
+#include "image_loader_error.h"
+
+static const size_t BAND_BUFFER_SIZE = 8 * 1024 * 1024;	// decoded scanlines of a band, approximately
+
+// markers not defined by jpeglib.h
+static const JOCTET JPEG_SOI = 0xD8;
+static const JOCTET JPEG_SOS = 0xDA;
+static const JOCTET JPEG_DRI = 0xDD;
+
+METHODDEF(void) band_error_exit(j_common_ptr cinfo) {
+	my_error_mgr * myerr = reinterpret_cast<my_error_mgr*>(cinfo->err);
+	longjmp(myerr->setjmp_buffer, JPEG_ERRORS + myerr->pub.msg_code);
+}
+
+static unsigned int gcd(unsigned int a, unsigned int b) {
+	while(b != 0) {
+		unsigned int r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+bool jpeg_band_decoder::parse_header(
+	const JOCTET * data,
+	size_t data_size,
+	header_info & header)
+{
+	ZeroMemory(&header, sizeof(header));
+	if(data_size < 2 || data[0] != 0xFF || data[1] != JPEG_SOI)
+		return false;
+
+	bool sof_found = false;
+	for(size_t i = 2; i + 4 <= data_size; ) {
+		if(data[i] != 0xFF)
+			return false;
+		const JOCTET marker = data[i + 1];
+		if(marker == 0xFF) {	// fill byte
+			++i;
+			continue;
+		}
+		const size_t length = (data[i + 2] << 8) | data[i + 3];
+		if(length < 2 || i + 2 + length > data_size)
+			return false;
+
+		if(marker == JPEG_SOS) {
+			header.sos_end = i + 2 + length;
+			return sof_found;
+		} else if(marker == JPEG_DRI && length == 4) {
+			header.restart_interval = (data[i + 4] << 8) | data[i + 5];
+		} else if(marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {	// SOFn, not DHT, JPG or DAC
+			header.sof_offset = i;
+			sof_found = true;
+		}
+		i += 2 + length;
+	}
+	return false;
+}
+
+jpeg_band_decoder::jpeg_band_decoder() :
+	data(0),
+	interval_offsets(0),
+	interval_count(0),
+	width(0),
+	height(0),
+	mcu_height(0),
+	mcus_per_row(0),
+	mcu_row_count(0),
+	band_mcu_row_count(0),
+	margin_mcu_row_count(0),
+	band_count(0),
+	thread_count(0),
+	slot_count(0),
+	slots(0),
+	free_slot_count(0),
+	decoding_task_count(0),
+	next_band_to_decode(0),
+	stop(false),
+	current_band(0),
+	current_scanline(0)
+{
+	ZeroMemory(&header, sizeof(header));
+}
+
+jpeg_band_decoder * jpeg_band_decoder::create(
+	const JOCTET * data,
+	size_t data_size,
+	const header_info & header,
+	const jpeg_decompress_struct & cinfo,
+	int thread_count)
+{
+	// a single sequential scan with restart markers is required
+	if(thread_count < 2 || header.restart_interval == 0 || cinfo.progressive_mode ||
+		cinfo.comps_in_scan != cinfo.num_components || cinfo.image_width == 0 || cinfo.image_height == 0)
+		return 0;
+
+	// MCU geometry (a non-interleaved scan has single block MCUs)
+	unsigned int mcu_width = DCTSIZE;
+	unsigned int mcu_height = DCTSIZE;
+	if(cinfo.comps_in_scan > 1) {
+		mcu_width *= cinfo.max_h_samp_factor;
+		mcu_height *= cinfo.max_v_samp_factor;
+	}
+	const unsigned int mcus_per_row = (cinfo.image_width + mcu_width - 1) / mcu_width;
+	const unsigned int mcu_row_count = (cinfo.image_height + mcu_height - 1) / mcu_height;
+
+	// bands start every so many rows of MCUs, where a restart interval starts too
+	const unsigned int restart_interval = header.restart_interval;
+	const unsigned int aligned_mcu_row_count = restart_interval / gcd(restart_interval, mcus_per_row);
+	bool vertical_upsampling = false;
+	for(int i = 0; i < cinfo.num_components; ++i)
+		if(cinfo.comp_info[i].v_samp_factor < cinfo.max_v_samp_factor)
+			vertical_upsampling = true;
+	const unsigned int margin_mcu_row_count = (vertical_upsampling ? aligned_mcu_row_count : 0);
+	unsigned int band_mcu_row_count = max(1U, (unsigned int) (BAND_BUFFER_SIZE / ((size_t) cinfo.image_width * 3 * mcu_height)));
+	band_mcu_row_count = max(band_mcu_row_count, (margin_mcu_row_count > 0 ? 4U : 1U) * aligned_mcu_row_count);	// margins are comparatively small
+	band_mcu_row_count = (band_mcu_row_count + aligned_mcu_row_count - 1) / aligned_mcu_row_count * aligned_mcu_row_count;
+	const unsigned int band_count = (mcu_row_count + band_mcu_row_count - 1) / band_mcu_row_count;
+	if(band_count < 2)
+		return 0;
+
+	// find the restart intervals
+	const unsigned int interval_count = (unsigned int) (((unsigned long long) mcus_per_row * mcu_row_count + restart_interval - 1) / restart_interval);
+	size_t * interval_offsets = new size_t[interval_count + 1];
+	unsigned int found_interval_count = 1;
+	interval_offsets[0] = header.sos_end;
+	const JOCTET * data_end = data + data_size;
+	for(const JOCTET * p = data + header.sos_end; ; ) {
+		p = (p < data_end - 1 ? static_cast<const JOCTET*>(memchr(p, 0xFF, data_end - 1 - p)) : 0);
+		if(p == 0) {
+			delete [] interval_offsets;	// truncated image
+			return 0;
+		}
+		const JOCTET marker = p[1];
+		if(marker == 0x00 || marker == 0xFF) {	// stuffed byte or fill byte
+			++p;
+		} else if(marker >= JPEG_RST0 && marker <= JPEG_RST0 + 7 && found_interval_count < interval_count) {
+			interval_offsets[found_interval_count++] = (p + 2) - data;
+			p += 2;
+		} else if(marker == JPEG_EOI && found_interval_count == interval_count) {
+			interval_offsets[interval_count] = (p + 2) - data;
+			break;
+		} else {
+			delete [] interval_offsets;	// unexpected marker
+			return 0;
+		}
+	}
+
+	jpeg_band_decoder * decoder = new jpeg_band_decoder();
+	decoder->data = data;
+	decoder->header = header;
+	decoder->interval_offsets = interval_offsets;
+	decoder->interval_count = interval_count;
+	decoder->width = cinfo.image_width;
+	decoder->height = cinfo.image_height;
+	decoder->mcu_height = mcu_height;
+	decoder->mcus_per_row = mcus_per_row;
+	decoder->mcu_row_count = mcu_row_count;
+	decoder->band_mcu_row_count = band_mcu_row_count;
+	decoder->margin_mcu_row_count = margin_mcu_row_count;
+	decoder->band_count = band_count;
+
+	// one slot per task, plus the one being read, plus one decoded in advance
+	decoder->thread_count = min(thread_count, (int) band_count);
+	decoder->slot_count = decoder->thread_count + 2;
+	decoder->slots = new band_slot[decoder->slot_count];
+	for(unsigned int i = 0; i < decoder->slot_count; ++i) {
+		decoder->slots[i].scanlines = new unsigned char[(size_t) band_mcu_row_count * mcu_height * decoder->width * 3];
+		decoder->slots[i].error = 0;
+		decoder->slots[i].decoded = false;
+	}
+	decoder->free_slot_count = decoder->slot_count;
+
+	decoder->decoding_task_count = decoder->thread_count;
+	for(int i = 0; i < decoder->thread_count; ++i)
+		submit_task(decoding_task, decoder, &decoder->tasks);
+	return decoder;
+}
+
+jpeg_band_decoder::~jpeg_band_decoder()
+{
+	// tasks finish the band they are decoding
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	tasks.wait();
+	if(slots != 0) {
+		for(unsigned int i = 0; i < slot_count; ++i)
+			delete [] slots[i].scanlines;
+		delete [] slots;
+	}
+	delete [] interval_offsets;
+}
+
+unsigned int jpeg_band_decoder::get_band_height(
+	unsigned int band) const
+{
+	const unsigned int first_mcu_row = band * band_mcu_row_count;
+	return min(height, (first_mcu_row + band_mcu_row_count) * mcu_height) - first_mcu_row * mcu_height;
+}
+
+void jpeg_band_decoder::decoding_task(
+	void * context)
+{
+	// decodes bands until their slots are all in use, read_line submits another task once a slot is freed
+	jpeg_band_decoder * decoder = static_cast<jpeg_band_decoder*>(context);
+	while(true) {
+		// the slot of the band is free once the band decoded slot_count bands earlier has been read
+		unsigned int band;
+		{
+			std::lock_guard<std::mutex> lock(decoder->mutex);
+			if(decoder->stop || decoder->next_band_to_decode == decoder->band_count || decoder->free_slot_count == 0) {
+				--decoder->decoding_task_count;
+				return;
+			}
+			--decoder->free_slot_count;
+			band = decoder->next_band_to_decode++;
+		}
+
+		band_slot & slot = decoder->slots[band % decoder->slot_count];
+		const error_code error = decoder->decode_band(band, slot.scanlines);
+		{
+			std::lock_guard<std::mutex> lock(decoder->mutex);
+			slot.error = error;
+			slot.decoded = true;
+		}
+		decoder->band_decoded.notify_all();
+	}
+}
+
+error_code jpeg_band_decoder::decode_band(
+	unsigned int band,
+	unsigned char * scanlines)
+{
+	// rows of MCUs to decode: the band and its margins
+	const unsigned int first_mcu_row = band * band_mcu_row_count;
+	const unsigned int end_mcu_row = min(mcu_row_count, first_mcu_row + band_mcu_row_count);
+	const unsigned int first_decoded_mcu_row = (first_mcu_row > margin_mcu_row_count ? first_mcu_row - margin_mcu_row_count : 0);
+	const unsigned int end_decoded_mcu_row = min(mcu_row_count, end_mcu_row + margin_mcu_row_count);
+	const unsigned int first_interval = (unsigned int) ((unsigned long long) first_decoded_mcu_row * mcus_per_row / header.restart_interval);
+	const unsigned int end_interval = (end_decoded_mcu_row == mcu_row_count ?
+		interval_count :
+		(unsigned int) ((unsigned long long) end_decoded_mcu_row * mcus_per_row / header.restart_interval));
+	const unsigned int decoded_height = min(height, end_decoded_mcu_row * mcu_height) - first_decoded_mcu_row * mcu_height;
+
+	// JPEG of the band: the header with the height of the band, the intervals with their markers renumbered, EOI
+	const size_t stream_size = header.sos_end + (interval_offsets[end_interval] - interval_offsets[first_interval]);
+	JOCTET * stream = new JOCTET[stream_size];
+	CopyMemory(stream, data, header.sos_end);
+	stream[header.sof_offset + 5] = (JOCTET) (decoded_height >> 8);
+	stream[header.sof_offset + 6] = (JOCTET) decoded_height;
+	JOCTET * p = stream + header.sos_end;
+	for(unsigned int i = first_interval; i < end_interval; ++i) {
+		if(i > first_interval) {
+			*p++ = 0xFF;
+			*p++ = (JOCTET) (JPEG_RST0 + (i - first_interval - 1) % 8);
+		}
+		const size_t interval_size = interval_offsets[i + 1] - 2 - interval_offsets[i];
+		CopyMemory(p, data + interval_offsets[i], interval_size);
+		p += interval_size;
+	}
+	*p++ = 0xFF;
+	*p++ = JPEG_EOI;
+
+	my_error_mgr jerr;
+	struct jpeg_decompress_struct cinfo;
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = band_error_exit;
+	jpeg_create_decompress(&cinfo);
+
+	int error = setjmp(jerr.setjmp_buffer);
+	if(error == 0) {
+		jpeg_mem_src(&cinfo, stream, (unsigned long) stream_size);
+		jpeg_read_header(&cinfo, TRUE);
+		cinfo.out_color_space = JCS_RGB;
+		jpeg_start_decompress(&cinfo);
+
+		// the top margin is decoded in place of the first scanline
+		const unsigned int margin_height = (first_mcu_row - first_decoded_mcu_row) * mcu_height;
+		JSAMPROW row = scanlines;
+		for(unsigned int y = 0; y < margin_height; ++y)
+			jpeg_read_scanlines(&cinfo, &row, 1);
+
+		const unsigned int band_height = get_band_height(band);
+		for(unsigned int y = 0; y < band_height; ) {
+			row = scanlines + (size_t) y * width * 3;
+			y += jpeg_read_scanlines(&cinfo, &row, 1);
+		}
+	}
+	jpeg_destroy_decompress(&cinfo);
+	delete [] stream;
+	return error;
+}
+
+error_code jpeg_band_decoder::read_line(
+	unsigned char * & scanline)
+{
+	// the slot of the band read is freed once its last scanline has been used
+	if(current_band < band_count && current_scanline == get_band_height(current_band)) {
+		bool new_task = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			++free_slot_count;
+			if(decoding_task_count < thread_count && next_band_to_decode < band_count) {
+				++decoding_task_count;
+				new_task = true;
+			}
+		}
+		if(new_task)
+			submit_task(decoding_task, this, &tasks);
+		++current_band;
+		current_scanline = 0;
+	}
+	if(current_band == band_count)
+		return IMAGE_READ_PAST_LAST_SCANLINE;
+
+	band_slot & slot = slots[current_band % slot_count];
+	if(current_scanline == 0) {
+		error_code error;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			blocking_wait(band_decoded, lock, [&slot] { return slot.decoded; });
+			slot.decoded = false;
+			error = slot.error;
+		}
+		if(error != 0) {
+			current_band = band_count;
+			return error;
+		}
+	}
+
+	scanline = slot.scanlines + (size_t) current_scanline * width * 3;
+	++current_scanline;
+	return 0;
+}
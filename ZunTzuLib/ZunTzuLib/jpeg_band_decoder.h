@@ -0,0 +1,83 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include <mutex>
+#include <condition_variable>
+#include "jpeglib.h"
+#include "thread_pool.h"
+
+typedef int error_code;	// no error if 0, otherwise abort
+
+// Decodes a sequential JPEG with restart markers by horizontal bands, on several workers of the thread pool.
+// Each band is decoded as a JPEG of its own: the header of the image with the height of the band,
+// followed by the restart intervals of the band. Restart intervals reset the entropy decoder,
+// so a band must start with an interval, and with a row of MCUs.
+// When the chroma is vertically subsampled, the upsampling of a scanline depends on its neighbours:
+// a margin is then decoded above and below each band and dropped, so that scanlines are identical
+// to those decoded by a single decoder.
+class jpeg_band_decoder {
+public:
+	struct header_info {
+		size_t sof_offset;	// offset of the SOF marker
+		size_t sos_end;	// offset of the entropy-coded data
+		unsigned int restart_interval;	// in MCUs, 0 if none
+	};
+
+	// false if the header is not complete
+	static bool parse_header(const JOCTET * data, size_t data_size, header_info & header);
+
+	// returns 0 if the image cannot be decoded by bands, cinfo must have read the header
+	static jpeg_band_decoder * create(const JOCTET * data, size_t data_size, const header_info & header, const jpeg_decompress_struct & cinfo, int thread_count);
+
+	~jpeg_band_decoder();
+
+	// scanlines are yielded in order, a scanline is valid until the next call
+	error_code read_line(unsigned char * & scanline);
+
+private:
+	jpeg_band_decoder();
+	static void decoding_task(void * context);
+	error_code decode_band(unsigned int band, unsigned char * scanlines);
+	unsigned int get_band_height(unsigned int band) const;
+
+	struct band_slot {
+		unsigned char * scanlines;
+		error_code error;
+		bool decoded;	// set once the band is decoded, reset once it starts being read
+	};
+
+	// image
+	const JOCTET * data;
+	header_info header;
+	size_t * interval_offsets;	// start of each restart interval, the last one as if there were an interval after the image
+	unsigned int interval_count;
+	unsigned int width;
+	unsigned int height;
+	unsigned int mcu_height;	// in scanlines
+	unsigned int mcus_per_row;
+	unsigned int mcu_row_count;
+
+	// bands
+	unsigned int band_mcu_row_count;
+	unsigned int margin_mcu_row_count;	// decoded above and below each band, then dropped
+	unsigned int band_count;
+
+	// decoding tasks
+	int thread_count;	// bands decoded at once, at most
+	task_group tasks;
+	unsigned int slot_count;
+	band_slot * slots;	// band i is decoded in slot i % slot_count
+	std::mutex mutex;	// guards the fields below and the state of the slots
+	unsigned int free_slot_count;
+	int decoding_task_count;	// submitted and not returned yet
+	std::condition_variable band_decoded;
+	unsigned int next_band_to_decode;
+	bool stop;
+
+	// reading
+	unsigned int current_band;
+	unsigned int current_scanline;	// in the current band
+};
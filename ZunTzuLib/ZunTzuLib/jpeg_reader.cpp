@@ -3,11 +3,16 @@
 ----------------------------------------------------------------------------- */
 
 #include "stdafx.h"
+#include "ZunTzuLib.h"
 #include "jerror.h"
 #include "image_reader.h"
+#include "jpeg_band_decoder.h"
+#include "loader_trace.h"
 #include "unzipper.h"
 #include "image_loader_error.h"
 
+static const size_t HEADER_READ_SIZE = 64 * 1024;	// enough for the header of most JPEG files
+
 // Here's the routine that will replace the standard error_exit method:
 
 METHODDEF(void) my_error_exit(j_common_ptr cinfo) {
@@ -22,15 +27,22 @@ jpeg_reader::jpeg_reader(
 	const wchar_t * archive_name,
 	const char * entry_name) :
 	pBuffer(0),
-	unzipper(new simple_unzipper(archive_name, entry_name))
+	unzipper(new simple_unzipper(archive_name, entry_name)),
+	data(0),
+	data_size(0),
+	band_decoder(0),
+	header_read(false)
 {
 	cinfo.err = jpeg_std_error(&jerr.pub);
+	cinfo.mem = 0;	// nothing to destroy if the loader is freed before init_jpeg
 	jerr.pub.error_exit = my_error_exit;
 }
 
 jpeg_reader::~jpeg_reader() {
+	delete band_decoder;
 	delete unzipper;
 	jpeg_destroy_decompress(&cinfo);
+	delete [] data;
 }
 
 void jpeg_reader::set_error_handler(const jmp_buf & error_handler) {
@@ -38,27 +50,82 @@ void jpeg_reader::set_error_handler(const jmp_buf & error_handler) {
 	unzipper->set_error_handler(error_handler);
 }
 
-GLOBAL(void) jpeg_unzipper_src(j_decompress_ptr cinfo, unzipper * unzipper);
+GLOBAL(void) jpeg_unzipper_src(j_decompress_ptr cinfo, unzipper * unzipper, const JOCTET * prefix, size_t prefix_size);
 
 void jpeg_reader::init_jpeg() {
 	jpeg_create_decompress(&cinfo);
-	jpeg_unzipper_src(&cinfo, unzipper);
+
+	// with restart markers and several cores, the image is decoded by bands from the whole entry in memory
+	// otherwise it is decoded as it is unzipped
+	// entries that can be read in place (see simple_unzipper) are not copied
+	size_t header_size = 0;
+	const JOCTET * header_data = reinterpret_cast<const JOCTET*>(unzipper->read_in_place(HEADER_READ_SIZE, header_size));
+	if(header_data == 0) {
+		data = new JOCTET[HEADER_READ_SIZE];
+		data_size = unzipper->read(reinterpret_cast<char*>(data), HEADER_READ_SIZE);
+		header_data = data;
+		header_size = data_size;
+	}
+	const int thread_count = GetProcessorCoreCount();
+	jpeg_band_decoder::header_info header;
+	const bool read_whole_entry = (thread_count > 1 && header_size == HEADER_READ_SIZE &&
+		jpeg_band_decoder::parse_header(header_data, header_size, header) && header.restart_interval > 0);
+	const JOCTET * entry_data = header_data;
+	size_t entry_size = header_size;
+	if(read_whole_entry) {
+		if(data == 0) {
+			size_t remaining_size = 0;
+			unzipper->read_in_place(~(size_t) 0, remaining_size);
+			entry_size += remaining_size;
+		} else {
+			for(size_t capacity = 2 * HEADER_READ_SIZE; ; capacity *= 2) {
+				JOCTET * larger_data = new JOCTET[capacity];
+				CopyMemory(larger_data, data, data_size);
+				delete [] data;
+				data = larger_data;
+				const size_t bytes_read = unzipper->read(reinterpret_cast<char*>(data + data_size), capacity - data_size);
+				data_size += bytes_read;
+				if(data_size < capacity)
+					break;
+			}
+			entry_data = data;
+			entry_size = data_size;
+		}
+		jpeg_mem_src(&cinfo, entry_data, (unsigned long) entry_size);
+	} else {
+		jpeg_unzipper_src(&cinfo, unzipper, header_data, header_size);
+	}
 	jpeg_read_header(&cinfo, TRUE);
+	header_read = true;
 
-	// throw exception in case of CMYK color space or progressive JPEG
+	// throw exception in case of CMYK color space
 	if(cinfo.num_components != 1 && cinfo.num_components != 3)
 		ERREXIT(&cinfo, IMAGE_UNSUPPORTED_COLOR_SPACE - JPEG_ERRORS);
-	if(cinfo.progressive_mode)
-		ERREXIT(&cinfo, IMAGE_UNSUPPORTED_PROGRESSIVE - JPEG_ERRORS);
 	cinfo.out_color_space = JCS_RGB;
 
+	if(read_whole_entry)
+		band_decoder = jpeg_band_decoder::create(entry_data, entry_size, header, cinfo, thread_count);
+	if(band_decoder != 0 || cinfo.progressive_mode) {
+		jpeg_calc_output_dimensions(&cinfo);
+		return;
+	}
+
+	start_decompress();
+}
+
+// a progressive JPEG has all its scans decoded into the coefficient buffer of libjpeg by jpeg_start_decompress:
+// that is left to the first read_line, on the loading task rather than on the caller of get_image_dimensions
+void jpeg_reader::start_decompress() {
+	const unsigned long long decoding_start = begin_probe();
 	jpeg_start_decompress(&cinfo);
+	if(cinfo.progressive_mode)
+		end_probe(PROBE_SCANLINE_DECODING, decoding_start);
 
 	pBuffer = (*cinfo.mem->alloc_sarray) ((j_common_ptr) &cinfo, JPOOL_IMAGE, cinfo.output_components * cinfo.output_width, 1);
 }
 
 void jpeg_reader::get_image_dimensions(unsigned int & width, unsigned int & height) {
-	if(!pBuffer)
+	if(!header_read)
 		init_jpeg();
 
 	width = cinfo.output_width;
@@ -66,11 +133,25 @@ void jpeg_reader::get_image_dimensions(unsigned int & width, unsigned int & heig
 }
 
 char * jpeg_reader::read_line() {
-	if(!pBuffer)
+	if(!header_read)
 		init_jpeg();
 
+	if(band_decoder != 0) {
+		const unsigned long long decoding_start = begin_probe();
+		unsigned char * scanline;
+		error_code error = band_decoder->read_line(scanline);
+		if(error != 0)
+			ERREXIT(&cinfo, error - JPEG_ERRORS);	// throw error
+		end_probe(PROBE_SCANLINE_DECODING, decoding_start);
+		return reinterpret_cast<char*>(scanline);
+	}
+
+	if(!pBuffer)
+		start_decompress();
 	if(cinfo.output_scanline < cinfo.output_height) {
+		const unsigned long long decoding_start = begin_probe();
 		JDIMENSION count = jpeg_read_scanlines(&cinfo, pBuffer, 1);
+		end_probe(PROBE_SCANLINE_DECODING, decoding_start);
 		return reinterpret_cast<char*>(pBuffer[0]);
 	} else {
 		ERREXIT(&cinfo, IMAGE_READ_PAST_LAST_SCANLINE - JPEG_ERRORS);	// throw IMAGE_READ_PAST_LAST_SCANLINE
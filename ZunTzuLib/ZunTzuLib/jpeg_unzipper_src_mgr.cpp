@@ -13,12 +13,15 @@
 struct my_source_mgr {
 	struct jpeg_source_mgr pub;	// public fields
 
-	unzipper * unzipper;		// source stream
+	::unzipper * unzipper;		// source stream
 	JOCTET * buffer;		// start of buffer
 	bool start_of_file;	// have we gotten any data yet?
+	const JOCTET * prefix;	// data already read from the stream
+	size_t prefix_size;
 };
 
 #define INPUT_BUF_SIZE 4096	/* choose an efficiently fread'able size */
+#define IN_PLACE_READ_SIZE (64 * 1024)	/* read in place: large enough to call fill_input_buffer seldom */
 
 // Initialize source --- called by jpeg_read_header before any data is actually read.
 
@@ -64,7 +67,23 @@ METHODDEF(void) init_source(j_decompress_ptr cinfo) {
 
 METHODDEF(boolean) fill_input_buffer(j_decompress_ptr cinfo) {
 	my_source_mgr * src = reinterpret_cast<my_source_mgr*>(cinfo->src);
-	size_t nbytes = src->unzipper->read(reinterpret_cast<char*>(src->buffer), INPUT_BUF_SIZE);
+
+	// data already read from the stream comes first
+	if(src->prefix_size > 0) {
+		src->pub.next_input_byte = src->prefix;
+		src->pub.bytes_in_buffer = src->prefix_size;
+		src->prefix_size = 0;
+		src->start_of_file = false;
+		return TRUE;
+	}
+
+	// entries that can be read in place are not copied
+	size_t nbytes = 0;
+	const JOCTET * input = reinterpret_cast<const JOCTET*>(src->unzipper->read_in_place(IN_PLACE_READ_SIZE, nbytes));
+	if(input == 0) {
+		nbytes = src->unzipper->read(reinterpret_cast<char*>(src->buffer), INPUT_BUF_SIZE);
+		input = src->buffer;
+	}
 
 	if(nbytes <= 0) {
 		if(src->start_of_file)	// Treat empty input file as fatal error
@@ -74,9 +93,10 @@ METHODDEF(boolean) fill_input_buffer(j_decompress_ptr cinfo) {
 		src->buffer[0] = (JOCTET) 0xFF;
 		src->buffer[1] = (JOCTET) JPEG_EOI;
 		nbytes = 2;
+		input = src->buffer;
 	}
 
-	src->pub.next_input_byte = src->buffer;
+	src->pub.next_input_byte = input;
 	src->pub.bytes_in_buffer = nbytes;
 	src->start_of_file = false;
 
@@ -133,8 +153,9 @@ METHODDEF(void) term_source(j_decompress_ptr cinfo) {
 // Prepare for input from a unzipper stream.
 // The caller must have already opened the stream, and is responsible
 // for closing it after finishing decompression.
+// The prefix holds the data already read from the stream, it must remain valid during decompression.
 
-GLOBAL(void) jpeg_unzipper_src(j_decompress_ptr cinfo, unzipper * unzipper) {
+GLOBAL(void) jpeg_unzipper_src(j_decompress_ptr cinfo, unzipper * unzipper, const JOCTET * prefix, size_t prefix_size) {
 	my_source_mgr * src;
 
 	if(cinfo->src == NULL) {	// first time for this JPEG object?
@@ -150,6 +171,8 @@ GLOBAL(void) jpeg_unzipper_src(j_decompress_ptr cinfo, unzipper * unzipper) {
 	src->pub.resync_to_restart = jpeg_resync_to_restart; // use default method
 	src->pub.term_source = term_source;
 	src->unzipper = unzipper;
+	src->prefix = prefix;
+	src->prefix_size = prefix_size;
 	src->pub.bytes_in_buffer = 0; // forces fill_input_buffer on first read
 	src->pub.next_input_byte = NULL; // until buffer loaded
 }
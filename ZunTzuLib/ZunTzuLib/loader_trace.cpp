@@ -0,0 +1,137 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include "ZunTzuLib.h"
+#include "file_system.h"
+#include "loader_trace.h"
+
+static const size_t TRACE_EVENT_CAPACITY = 1 << 20;	// 24 MB, about a minute of loading on a quad core
+
+static const char * const PROBE_NAMES[LOADER_PROBE_COUNT] = {
+	"write slot wait",
+	"read slot wait",
+	"tile compression",
+	"scanline decoding",
+	"inflating"
+};
+
+struct trace_event {
+	unsigned long long start;
+	unsigned long long end;
+	unsigned int probe;
+	unsigned int thread;
+};
+
+// one cache line per probe, so that threads hitting different probes do not contend
+struct alignas(64) probe_counters {
+	std::atomic<unsigned long long> count;
+	std::atomic<unsigned long long> nanoseconds;
+};
+
+std::atomic<int> loader_tracing(LOADER_TRACING_OFF);
+
+static probe_counters counters[LOADER_PROBE_COUNT];
+static std::mutex trace_events_mutex;	// allocation of the trace event buffer
+static trace_event * trace_events = 0;	// allocated once, never freed: probes may still be writing
+static std::atomic<size_t> trace_event_count(0);	// may exceed TRACE_EVENT_CAPACITY, the extra events are dropped
+static std::atomic<unsigned int> next_thread_id(1);
+static thread_local unsigned int thread_id = 0;
+
+unsigned long long get_probe_time() {
+	return (unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() | 1;
+}
+
+void record_probe(loader_probe probe, unsigned long long start, unsigned long long end) {
+	counters[probe].count.fetch_add(1, std::memory_order_relaxed);
+	counters[probe].nanoseconds.fetch_add(end - start, std::memory_order_relaxed);
+
+	if(loader_tracing.load(std::memory_order_acquire) == LOADER_TRACING_EVENTS) {
+		const size_t index = trace_event_count.fetch_add(1, std::memory_order_relaxed);
+		if(index < TRACE_EVENT_CAPACITY) {
+			if(thread_id == 0)
+				thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+			trace_event & e = trace_events[index];
+			e.start = start;
+			e.end = end;
+			e.probe = probe;
+			e.thread = thread_id;
+		}
+	}
+}
+
+extern "C" void __cdecl SetLoaderTracing(
+	int mode)
+{
+	if(mode == LOADER_TRACING_EVENTS) {
+		std::lock_guard<std::mutex> lock(trace_events_mutex);
+		if(trace_events == 0)
+			trace_events = new trace_event[TRACE_EVENT_CAPACITY];
+	} else if(mode != LOADER_TRACING_COUNTERS) {
+		mode = LOADER_TRACING_OFF;
+	}
+	loader_tracing.store(mode, std::memory_order_release);	// publishes trace_events
+}
+
+extern "C" void __cdecl GetLoaderStats(
+	loader_stats * stats)
+{
+	for(int i = 0; i < LOADER_PROBE_COUNT; ++i) {
+		stats->counts[i] = counters[i].count.load(std::memory_order_relaxed);
+		stats->nanoseconds[i] = counters[i].nanoseconds.load(std::memory_order_relaxed);
+	}
+	const size_t event_count = trace_event_count.load(std::memory_order_relaxed);
+	stats->trace_event_count = (event_count < TRACE_EVENT_CAPACITY ? event_count : TRACE_EVENT_CAPACITY);
+	stats->dropped_trace_event_count = event_count - stats->trace_event_count;
+}
+
+extern "C" void __cdecl ResetLoaderStats()
+{
+	for(int i = 0; i < LOADER_PROBE_COUNT; ++i) {
+		counters[i].count.store(0, std::memory_order_relaxed);
+		counters[i].nanoseconds.store(0, std::memory_order_relaxed);
+	}
+	trace_event_count.store(0, std::memory_order_relaxed);
+}
+
+extern "C" int __cdecl DumpLoaderTrace(
+	const wchar_t * file_name)
+{
+	std::lock_guard<std::mutex> lock(trace_events_mutex);
+	size_t event_count = trace_event_count.load(std::memory_order_acquire);
+	if(event_count > TRACE_EVENT_CAPACITY)
+		event_count = TRACE_EVENT_CAPACITY;
+	if(trace_events == 0)
+		event_count = 0;
+
+	FILE * file = create_text_file(file_name);
+	if(file == 0)
+		return -1;
+
+	// timestamps in microseconds from the first event
+	unsigned long long origin = 0;
+	for(size_t i = 0; i < event_count; ++i) {
+		if(origin == 0 || trace_events[i].start < origin)
+			origin = trace_events[i].start;
+	}
+
+	fprintf(file, "{\"traceEvents\":[");
+	for(size_t i = 0; i < event_count; ++i) {
+		const trace_event & e = trace_events[i];
+		fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"loader\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+			(i > 0 ? "," : ""),
+			PROBE_NAMES[e.probe < LOADER_PROBE_COUNT ? e.probe : 0],
+			(e.start - origin) / 1000.0,
+			(e.end - e.start) / 1000.0,
+			e.thread);
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	const bool written = (0 == ferror(file));
+	fclose(file);
+	return (written ? (int) event_count : -1);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include <atomic>
+
+// Probes on the hot paths of the image loaders. They are always compiled in and cost one relaxed
+// atomic load while tracing is off (see SetLoaderTracing). Probes are a pair of calls rather than
+// a scoped object because the readers leave their scanline loops with longjmp on errors.
+
+enum loader_probe {
+	PROBE_WRITE_SLOT_WAIT,	// producer waiting for a free slot of a synchronized_tile_buffer
+	PROBE_READ_SLOT_WAIT,	// consumer waiting for a tile of a synchronized_tile_buffer
+	PROBE_TILE_COMPRESSION,	// one 256x256 tile compressed to DXT1 or DXT5
+	PROBE_SCANLINE_DECODING,	// one scanline decoded by a JPEG or PNG reader
+	PROBE_INFLATING,	// bytes inflated from a zip entry by zzip_disk_fread or zzip_disk_fread_all
+	LOADER_PROBE_COUNT
+};
+
+enum LOADER_TRACING {
+	LOADER_TRACING_OFF = 0,
+	LOADER_TRACING_COUNTERS = 1,	// counts and total time of each probe
+	LOADER_TRACING_EVENTS = 2	// counters and one trace event per probe hit
+};
+
+// layout shared with ZunTzuLib.LoaderStats (C#)
+struct loader_stats {
+	unsigned long long counts[LOADER_PROBE_COUNT];
+	unsigned long long nanoseconds[LOADER_PROBE_COUNT];
+	unsigned long long trace_event_count;
+	unsigned long long dropped_trace_event_count;	// when the trace event buffer is full
+};
+
+extern std::atomic<int> loader_tracing;
+
+unsigned long long get_probe_time();	// nanoseconds, never 0
+void record_probe(loader_probe probe, unsigned long long start, unsigned long long end);
+
+// start of a probe, 0 if tracing is off
+inline unsigned long long begin_probe() {
+	return (loader_tracing.load(std::memory_order_relaxed) != LOADER_TRACING_OFF ? get_probe_time() : 0);
+}
+
+inline void end_probe(loader_probe probe, unsigned long long start) {
+	if(start != 0)
+		record_probe(probe, start, get_probe_time());
+}
@@ -0,0 +1,502 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include "ZunTzuLib.h"
+#include "mipmap_pipeline.h"
+#include "synchronized_tile_buffer.h"
+#include "downsample_kernels.h"
+
+static const size_t FIRST_LEVEL_BAND_MEMORY = 64 * 1024 * 1024;	// approximately, at least 3 bands are used
+static const size_t HELD_LOWER_LEVEL_MEMORY = 64 * 1024 * 1024;	// beyond it, the held bands are yielded regardless of the order
+
+mipmap_pipeline::mipmap_pipeline(
+	unsigned int width,
+	unsigned int height,
+	unsigned int texel_size,
+	unsigned int mipmap_level_count,
+	unsigned int skipped_mipmap_levels,
+	synchronized_tile_buffer * tile_buffer)
+:
+	texel_size(texel_size),
+	mipmap_level_count(mipmap_level_count),
+	skipped_mipmap_levels(skipped_mipmap_levels),
+	levels(new level[mipmap_level_count]),
+	tile_buffer(tile_buffer),
+	next_first_level_scanline(0),
+	thread_count(max(1, GetProcessorCoreCount())),
+	first_ready_band(0),
+	ready_band_count(0),
+	processing_task_count(0),
+	downsampling_band_count(0),
+	held_band_count(0),
+	yielding(false),
+	held_lower_level_memory(0),
+	first_level_band_wanted(false),
+	prioritizing(false),
+	priority_mipmap_level(0),
+	priority_left(0),
+	priority_top(0),
+	priority_right(0),
+	priority_bottom(0),
+	finished(false),
+	aborted(false),
+	stop(false)
+{
+	unsigned int band_count = 0;
+	unsigned int mipmap_width = width;
+	unsigned int mipmap_height = height;
+	for(unsigned int i = 0; i < mipmap_level_count; ++i) {
+		levels[i].width = mipmap_width;
+		levels[i].height = mipmap_height;
+		levels[i].stride = (mipmap_width + 2) * texel_size;	// add 2 for margin
+		levels[i].band_count = (mipmap_height + 253) / 254;
+		levels[i].bands = new std::atomic<band *>[levels[i].band_count];
+		for(unsigned int j = 0; j < levels[i].band_count; ++j)
+			levels[i].bands[j].store(0);
+		levels[i].unprocessed_band_count = levels[i].band_count;
+		band_count += levels[i].band_count;
+		mipmap_width = (mipmap_width + 1) / 2;
+		mipmap_height = (mipmap_height + 1) / 2;
+	}
+	unprocessed_band_count = band_count;
+	ready_band_capacity = band_count;
+	ready_bands = new band*[ready_band_capacity];
+	held_bands = new band*[band_count];
+
+	// the band being written, the next one and one being processed at least
+	free_first_level_band_count = (unsigned int) max((size_t) 3, min((size_t) thread_count + 2, FIRST_LEVEL_BAND_MEMORY / (256 * levels[0].stride)));
+}
+
+mipmap_pipeline::~mipmap_pipeline()
+{
+	// tasks finish the band they are processing
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	tasks.wait();
+
+	// bands left if aborted
+	for(unsigned int i = 0; i < mipmap_level_count; ++i) {
+		for(unsigned int j = 0; j < levels[i].band_count; ++j) {
+			band * b = levels[i].bands[j].load();
+			if(b != 0) {
+				delete [] b->scanlines;
+				delete b;
+			}
+		}
+		delete [] levels[i].bands;
+	}
+	delete [] levels;
+	delete [] ready_bands;
+	delete [] held_bands;
+}
+
+unsigned char * mipmap_pipeline::get_first_level_scanline()
+{
+	return get_scanline(0, next_first_level_scanline);
+}
+
+void mipmap_pipeline::commit_first_level_scanline()
+{
+	commit_scanline(0, next_first_level_scanline++);
+}
+
+void mipmap_pipeline::finish()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	blocking_wait(finished_or_aborted, lock, [this] { return finished; });
+}
+
+void mipmap_pipeline::prioritize(
+	unsigned int mipmap_level,
+	unsigned int left,
+	unsigned int top,
+	unsigned int right,
+	unsigned int bottom)
+{
+	if(left >= right || top >= bottom)
+		return;
+
+	// the held bands of the area are yielded by a new task, if none is running
+	bool new_task = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		prioritizing = true;
+		priority_mipmap_level = min(mipmap_level, mipmap_level_count - 1);
+		priority_left = left;
+		priority_top = top;
+		priority_right = right;
+		priority_bottom = bottom;
+		new_task = (held_band_count > 0 && processing_task_count < thread_count);
+		if(new_task)
+			++processing_task_count;
+	}
+	if(new_task)
+		submit_task(processing_task, this, &tasks);
+}
+
+mipmap_pipeline::band * mipmap_pipeline::get_band(
+	unsigned int mipmap_level,
+	unsigned int index)
+{
+	// bands of the first mipmap level are only created by the thread writing its scanlines
+	level & l = levels[mipmap_level];
+	std::unique_lock<std::mutex> lock(mutex);
+	if(mipmap_level == 0 && l.bands[index] == 0) {
+		// the held bands of the first mipmap level are yielded to free one
+		if(free_first_level_band_count == 0) {
+			first_level_band_wanted = true;
+			if(held_band_count > 0 && processing_task_count < thread_count) {
+				++processing_task_count;
+				submit_task(processing_task, this, &tasks);
+			}
+		}
+		blocking_wait(first_level_band_freed, lock, [this] { return free_first_level_band_count > 0 || aborted.load(); });
+		first_level_band_wanted = false;
+		if(aborted.load())
+			return 0;
+		--free_first_level_band_count;
+	}
+
+	band * b = l.bands[index];
+	if(b == 0) {
+		b = new band;
+		b->mipmap_level = mipmap_level;
+		b->index = index;
+		b->scanlines = new unsigned char[256 * l.stride];
+		const unsigned int first_scanline = (index == 0 ? 0 : 254 * index - 1);
+		b->missing_scanline_count.store(min(l.height, 254 * index + 255) - first_scanline);
+		b->first_priority_x = 0;
+		b->end_priority_x = 0;
+		if(index == 0)
+			ZeroMemory(b->scanlines, l.stride);	// above the image
+		l.bands[index] = b;
+	}
+	return b;
+}
+
+unsigned char * mipmap_pipeline::get_scanline(
+	unsigned int mipmap_level,
+	unsigned int y)
+{
+	// the last scanline of a band is also the first one of the next band, and conversely
+	// (scanlines of the lower mipmap levels are written in any order)
+	const level & l = levels[mipmap_level];
+	const unsigned int index = y / 254;
+	band * b = l.bands[index];
+	if(b == 0 && 0 == (b = get_band(mipmap_level, index)))
+		return 0;
+	if(y % 254 == 253 && index + 1 < l.band_count && l.bands[index + 1] == 0 && 0 == get_band(mipmap_level, index + 1))
+		return 0;
+	if(y % 254 == 0 && index > 0 && l.bands[index - 1] == 0)
+		get_band(mipmap_level, index - 1);
+	return b->scanlines + (y - 254 * index + 1) * l.stride + texel_size;
+}
+
+void mipmap_pipeline::commit_scanline(
+	unsigned int mipmap_level,
+	unsigned int y)
+{
+	level & l = levels[mipmap_level];
+	const unsigned int index = y / 254;
+	band * b = l.bands[index];
+	unsigned char * scanline = b->scanlines + (y - 254 * index + 1) * l.stride;
+
+	// guard bands
+	ZeroMemory(scanline, texel_size);
+	ZeroMemory(scanline + l.stride - texel_size, texel_size);
+
+	// the scanline is copied to the neighbouring band sharing it
+	band * neighbour = 0;
+	if(y % 254 == 253 && index + 1 < l.band_count) {
+		neighbour = l.bands[index + 1];
+		CopyMemory(neighbour->scanlines, scanline, l.stride);
+	} else if(y % 254 == 0 && index > 0) {
+		neighbour = l.bands[index - 1];
+		CopyMemory(neighbour->scanlines + 255 * l.stride, scanline, l.stride);
+	}
+
+	band * completed_bands[2];
+	unsigned int completed_band_count = 0;
+	if(1 == b->missing_scanline_count.fetch_sub(1))
+		completed_bands[completed_band_count++] = b;
+	if(neighbour != 0 && 1 == neighbour->missing_scanline_count.fetch_sub(1))
+		completed_bands[completed_band_count++] = neighbour;
+
+	if(completed_band_count > 0) {
+		// the running tasks take the ready bands in turn, a task is added if fewer than thread_count run
+		int new_task_count = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for(unsigned int i = 0; i < completed_band_count; ++i)
+				ready_bands[(first_ready_band + ready_band_count++) % ready_band_capacity] = completed_bands[i];
+			new_task_count = min((int) completed_band_count, thread_count - processing_task_count);
+			processing_task_count += new_task_count;
+		}
+		for(int i = 0; i < new_task_count; ++i)
+			submit_task(processing_task, this, &tasks);
+	}
+}
+
+void mipmap_pipeline::processing_task(
+	void * context)
+{
+	// downsamples the ready bands and yields the tiles of the held bands, until there are none left to process now
+	mipmap_pipeline * pipeline = static_cast<mipmap_pipeline*>(context);
+	while(true) {
+		band * b = 0;
+		bool ready;	// otherwise held
+		{
+			std::lock_guard<std::mutex> lock(pipeline->mutex);
+			ready = (pipeline->ready_band_count > 0);
+			if(pipeline->stop || (!ready && 0 == (b = pipeline->take_held_band()))) {
+				--pipeline->processing_task_count;
+				return;
+			}
+			if(ready) {
+				b = pipeline->ready_bands[pipeline->first_ready_band];
+				pipeline->first_ready_band = (pipeline->first_ready_band + 1) % pipeline->ready_band_capacity;
+				--pipeline->ready_band_count;
+				++pipeline->downsampling_band_count;
+			} else {
+				pipeline->yielding = true;
+			}
+		}
+
+		if(ready) {
+			if(pipeline->aborted.load()) {
+				pipeline->abort();
+				continue;
+			}
+			pipeline->downsample_band(b);
+
+			// the band is held until its tiles are yielded
+			const bool held = pipeline->has_tiles(b);
+			{
+				std::lock_guard<std::mutex> lock(pipeline->mutex);
+				--pipeline->downsampling_band_count;
+				if(held) {
+					pipeline->held_bands[pipeline->held_band_count++] = b;
+					if(b->mipmap_level > 0)
+						pipeline->held_lower_level_memory += 256 * pipeline->levels[b->mipmap_level].stride;
+				}
+			}
+			if(held)
+				continue;
+		} else {
+			const bool yielded = (!pipeline->aborted.load() && pipeline->yield_tiles(b));
+			{
+				std::lock_guard<std::mutex> lock(pipeline->mutex);
+				pipeline->yielding = false;
+			}
+			if(!yielded) {
+				pipeline->abort();
+				continue;
+			}
+		}
+
+		pipeline->free_band(b);
+	}
+}
+
+// the band is no longer needed
+void mipmap_pipeline::free_band(
+	band * b)
+{
+	bool all_processed;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		levels[b->mipmap_level].bands[b->index] = 0;
+		--levels[b->mipmap_level].unprocessed_band_count;
+		if(b->mipmap_level == 0)
+			++free_first_level_band_count;
+		all_processed = (0 == --unprocessed_band_count);
+		if(all_processed)
+			finished = true;
+	}
+	if(b->mipmap_level == 0)
+		first_level_band_freed.notify_one();
+	delete [] b->scanlines;
+	delete b;
+	if(all_processed)
+		finished_or_aborted.notify_all();
+}
+
+// a row of tiles ends with the band, except if the last scanline is the first one of the band
+bool mipmap_pipeline::has_tiles(
+	const band * b) const
+{
+	return b->mipmap_level >= skipped_mipmap_levels && (b->index == 0 || levels[b->mipmap_level].height > 254 * b->index + 1);
+}
+
+// the range of tiles of the priority area in the row of the band, if the row is in the area (called with the lock)
+bool mipmap_pipeline::is_in_priority_area(
+	const band * b,
+	unsigned int & first_x,
+	unsigned int & end_x) const
+{
+	const unsigned int mipmap_level = b->mipmap_level;
+	if(!prioritizing || mipmap_level < priority_mipmap_level)
+		return false;
+	const unsigned long long rounding = (1ULL << mipmap_level) - 1;
+	const unsigned int first_y = (priority_top >> mipmap_level) / 254;
+	const unsigned int end_y = (unsigned int) (((priority_bottom + rounding) >> mipmap_level) + 253) / 254;
+	first_x = (priority_left >> mipmap_level) / 254;
+	end_x = min((unsigned int) (((priority_right + rounding) >> mipmap_level) + 253) / 254, (levels[mipmap_level].width + 253) / 254);
+	return b->index >= first_y && b->index < end_y && first_x < end_x;
+}
+
+// Removes the held band whose tiles are yielded next, 0 if all of them are kept for now or if another task
+// is yielding tiles (called with the lock). A band is yielded once the coarser levels are all yielded and no band
+// that may come before it is being downsampled, or at once if its row is in the priority area.
+// The bands are also yielded earlier to free memory. The bands of the priority area come first, then the coarsest.
+mipmap_pipeline::band * mipmap_pipeline::take_held_band()
+{
+	if(aborted.load() || yielding)
+		return 0;
+
+	unsigned int coarsest_unprocessed_level = mipmap_level_count - 1;
+	while(coarsest_unprocessed_level > 0 && levels[coarsest_unprocessed_level].unprocessed_band_count == 0)
+		--coarsest_unprocessed_level;
+	const bool all_downsampled = (downsampling_band_count == 0);
+	const bool memory_wanted = (held_lower_level_memory > HELD_LOWER_LEVEL_MEMORY);
+
+	unsigned int best = held_band_count;
+	bool best_in_area = false;
+	for(unsigned int i = 0; i < held_band_count; ++i) {
+		const band * b = held_bands[i];
+		unsigned int first_x, end_x;
+		const bool in_area = is_in_priority_area(b, first_x, end_x);
+		if(!in_area && !memory_wanted && !(all_downsampled && b->mipmap_level >= coarsest_unprocessed_level) &&
+			!(b->mipmap_level == 0 && first_level_band_wanted))
+		{
+			continue;
+		}
+		if(best == held_band_count || (in_area && !best_in_area) || (in_area == best_in_area &&
+			(b->mipmap_level > held_bands[best]->mipmap_level ||
+			(b->mipmap_level == held_bands[best]->mipmap_level && b->index < held_bands[best]->index))))
+		{
+			best = i;
+			best_in_area = in_area;
+		}
+	}
+	if(best == held_band_count)
+		return 0;
+
+	band * b = held_bands[best];
+	held_bands[best] = held_bands[--held_band_count];
+	if(b->mipmap_level > 0)
+		held_lower_level_memory -= 256 * levels[b->mipmap_level].stride;
+	if(!is_in_priority_area(b, b->first_priority_x, b->end_priority_x)) {
+		b->first_priority_x = 0;
+		b->end_priority_x = 0;
+	}
+	return b;
+}
+
+void mipmap_pipeline::abort()
+{
+	// the thread writing the first mipmap level may be waiting for a band
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		aborted.store(true);
+		finished = true;
+	}
+	first_level_band_freed.notify_all();
+	finished_or_aborted.notify_all();
+}
+
+bool mipmap_pipeline::yield_tiles(
+	band * b)
+{
+	// the tiles of the priority area first
+	for(unsigned int tile_x = b->first_priority_x; tile_x < b->end_priority_x; ++tile_x) {
+		if(!yield_tile(b, tile_x))
+			return false;
+	}
+	const level & l = levels[b->mipmap_level];
+	for(unsigned int tile_x = 0; tile_x * 254 < l.width; ++tile_x) {
+		if((tile_x < b->first_priority_x || tile_x >= b->end_priority_x) && !yield_tile(b, tile_x))
+			return false;
+	}
+	return true;
+}
+
+bool mipmap_pipeline::yield_tile(
+	band * b,
+	unsigned int tile_x)
+{
+	const level & l = levels[b->mipmap_level];
+	const unsigned int y = b->index;
+	const size_t tile_stride = 256 * texel_size;
+	const unsigned int scanline_count = min(256U, l.height + 1 - 254 * y);
+
+	// last tile of the row?
+	bool last_tile_of_row = (tile_x * 254 + 254 > l.width);
+
+	// get write buffer
+	unsigned int slot_index = 0;
+	if(!tile_buffer->allocate_write_slot(slot_index)) {
+		// consumer loop has issued a "stop producer loop" command
+		return false;
+	}
+	tile_slot * slot = tile_buffer->get_slot(slot_index);
+	slot->mipmap_level = b->mipmap_level;
+	slot->x = tile_x;
+	slot->y = y;
+
+	// copy tile data to write buffer
+	unsigned int i;
+	for(i = 0; i < scanline_count; ++i) {
+		unsigned char * source = b->scanlines + l.stride * i + (254 * texel_size) * tile_x;
+		size_t bytes_to_copy = tile_stride;
+		if(last_tile_of_row) {
+			bytes_to_copy = l.stride - tile_x * (254 * texel_size);
+			ZeroMemory(slot->texels + tile_stride * i + bytes_to_copy, tile_stride - bytes_to_copy);
+		}
+		CopyMemory(
+			slot->texels + tile_stride * i,
+			source,
+			bytes_to_copy);
+	}
+	// area below the image is drawn black (if there is one)
+	for(; i < 256; ++i) {
+		ZeroMemory(
+			slot->texels + tile_stride * i,
+			tile_stride);
+	}
+
+	// yield tile
+	tile_buffer->free_write_slot(slot_index);
+	return true;
+}
+
+// downsamples the scanlines of the band to the next mipmap level
+void mipmap_pipeline::downsample_band(
+	band * b)
+{
+	const unsigned int mipmap_level = b->mipmap_level;
+	const level & l = levels[mipmap_level];
+	const unsigned int y = b->index;
+	if(mipmap_level + 1 < mipmap_level_count) {
+		const unsigned int lower_height = levels[mipmap_level + 1].height;
+		const unsigned int lower_width = levels[mipmap_level + 1].width;
+		const downsample_kernel downsample = (texel_size == 3 ?
+			get_downsample_kernels().downsample_rgb :
+			get_downsample_kernels().downsample_rgba);
+		for(unsigned int lower_y = 127 * y; lower_y < min(127 * y + 127, lower_height); ++lower_y) {
+			// a last odd scanline is averaged with the previous one
+			unsigned int first_y = 2 * lower_y;
+			if(first_y + 1 == l.height)
+				--first_y;
+			const unsigned char * source_odd = b->scanlines + l.stride * (first_y + 1 - 254 * y) + texel_size;
+			const unsigned char * source_even = source_odd + l.stride;
+			unsigned char * dest = get_scanline(mipmap_level + 1, lower_y);
+			downsample(source_odd, source_even, dest, lower_width);
+			commit_scanline(mipmap_level + 1, lower_y);
+		}
+	}
+}
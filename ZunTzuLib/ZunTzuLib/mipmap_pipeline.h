@@ -0,0 +1,106 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "thread_pool.h"
+
+class synchronized_tile_buffer;
+
+// Builds the mipmaps of an image and cuts them into tiles, on the workers of the thread pool.
+// The scanlines of each mipmap level are gathered by bands of 254 scanlines. A band is stored
+// with the last scanline of the previous band and the first scanline of the next band,
+// so that it holds a whole row of tiles (256 scanlines overlapping by 2).
+// Once complete, a band is processed by a task: its scanlines are downsampled into the bands
+// of the next mipmap level, then the band is held until its row of tiles is yielded to the
+// tile buffer. The coarsest mipmap levels are yielded first, and the rows of the priority area
+// as soon as they are complete (its tiles first); the finer bands are held meanwhile, as long
+// as the memory allows it.
+// Each scanline is bounded by two zeroed guard bands.
+class mipmap_pipeline {
+public:
+	mipmap_pipeline(unsigned int width, unsigned int height, unsigned int texel_size, unsigned int mipmap_level_count, unsigned int skipped_mipmap_levels, synchronized_tile_buffer * tile_buffer);
+	~mipmap_pipeline();	// waits for the tasks
+
+	// scanlines of the first mipmap level are written in order by a single thread
+	unsigned char * get_first_level_scanline();	// where to write the texels of the next scanline, 0 if aborted
+	void commit_first_level_scanline();
+
+	// returns once all tiles have been yielded, or if the consumer has stopped
+	void finish();
+
+	// see dxt_compressor::prioritize_tiles, from any thread
+	void prioritize(unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+
+private:
+	struct band {
+		unsigned int mipmap_level;
+		unsigned int index;	// band y covers scanlines 254 * y - 1 to 254 * y + 254
+		unsigned char * scanlines;	// 256 scanlines
+		std::atomic<unsigned int> missing_scanline_count;
+		unsigned int first_priority_x;	// tiles of the priority area, yielded first
+		unsigned int end_priority_x;
+	};
+
+	struct level {
+		unsigned int width;
+		unsigned int height;
+		size_t stride;	// size in bytes of each scanline, guard bands included
+		unsigned int band_count;
+		std::atomic<band *> * bands;	// 0 until the first scanline is written, and once processed (read without the lock)
+		unsigned int unprocessed_band_count;
+	};
+
+	static void processing_task(void * context);
+	unsigned char * get_scanline(unsigned int mipmap_level, unsigned int y);
+	void commit_scanline(unsigned int mipmap_level, unsigned int y);
+	band * get_band(unsigned int mipmap_level, unsigned int index);
+	bool has_tiles(const band * b) const;
+	bool is_in_priority_area(const band * b, unsigned int & first_x, unsigned int & end_x) const;
+	band * take_held_band();
+	void downsample_band(band * b);
+	bool yield_tiles(band * b);
+	bool yield_tile(band * b, unsigned int tile_x);
+	void free_band(band * b);
+	void abort();
+
+	unsigned int texel_size;
+	unsigned int mipmap_level_count;
+	unsigned int skipped_mipmap_levels;
+	level * levels;
+	synchronized_tile_buffer * tile_buffer;
+	unsigned int next_first_level_scanline;
+
+	// tasks processing the ready bands
+	int thread_count;	// bands processed at once, at most
+	task_group tasks;
+	std::mutex mutex;	// guards the fields below, and the bands of the levels
+	band ** ready_bands;	// circular queue, large enough for all bands
+	unsigned int ready_band_capacity;
+	unsigned int first_ready_band;
+	unsigned int ready_band_count;
+	int processing_task_count;	// submitted and not returned yet
+	unsigned int downsampling_band_count;	// taken from the ready bands and not held yet
+	band ** held_bands;	// downsampled, their tiles are not yielded yet
+	unsigned int held_band_count;
+	bool yielding;	// the tiles are yielded by a single task at once, in the order the held bands are taken
+	size_t held_lower_level_memory;	// used by the held bands of the lower mipmap levels
+	unsigned int free_first_level_band_count;	// bounds the memory used by bands of the first mipmap level
+	bool first_level_band_wanted;	// the thread writing the first mipmap level waits for a band
+	std::condition_variable first_level_band_freed;
+	bool prioritizing;
+	unsigned int priority_mipmap_level;
+	unsigned int priority_left;
+	unsigned int priority_top;
+	unsigned int priority_right;
+	unsigned int priority_bottom;
+	unsigned int unprocessed_band_count;
+	bool finished;	// once all bands are processed, or if aborted
+	std::condition_variable finished_or_aborted;
+	std::atomic<bool> aborted;
+	bool stop;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The few Windows definitions used by the image loaders, for the headless builds on POSIX systems (see CMakeLists.txt).
+// Included by stdafx.h instead of windows.h.
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#define __cdecl
+#define __fastcall
+#define __declspec(x)
+
+#define MAX_PATH 260
+
+typedef unsigned char byte;
+
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+#define CopyMemory(destination, source, length) memcpy((destination), (source), (length))
+
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE 10
+
+// SSE2 is the only feature queried
+inline bool IsProcessorFeaturePresent(int feature) {
+	return feature == PF_XMMI64_INSTRUCTIONS_AVAILABLE && __builtin_cpu_supports("sse2");
+}
+
+// functions, not macros: the standard headers use min and max as names.
+// Both arguments have the same type, a mix of signed and unsigned values must be cast at the call site.
+template<typename T>
+inline T min(T a, T b) {
+	return (b < a ? b : a);
+}
+
+template<typename T>
+inline T max(T a, T b) {
+	return (a < b ? b : a);
+}
+
+inline int _stricmp(const char * a, const char * b) {
+	return strcasecmp(a, b);
+}
+
+inline int _strnicmp(const char * a, const char * b, size_t count) {
+	return strncasecmp(a, b, count);
+}
+
+inline int _wcsicmp(const wchar_t * a, const wchar_t * b) {
+	for(; *a != 0 && towlower(*a) == towlower(*b); ++a, ++b) {}
+	return (int) towlower(*a) - (int) towlower(*b);
+}
+
+inline wchar_t * _wcsdup(const wchar_t * text) {
+	const size_t size = (wcslen(text) + 1) * sizeof(wchar_t);
+	wchar_t * copy = (wchar_t *) malloc(size);
+	if(copy != 0)
+		memcpy(copy, text, size);
+	return copy;
+}
+
+inline int _wtoi(const wchar_t * text) {
+	return (int) wcstol(text, 0, 10);
+}
+
+// bounded copies, the destination is left empty if the source does not fit
+template<size_t size>
+inline int strcpy_s(char (&destination)[size], const char * source) {
+	if(strlen(source) >= size) {
+		destination[0] = 0;
+		return ERANGE;
+	}
+	strcpy(destination, source);
+	return 0;
+}
+
+template<size_t size>
+inline int strcat_s(char (&destination)[size], const char * source) {
+	if(strlen(destination) + strlen(source) >= size) {
+		destination[0] = 0;
+		return ERANGE;
+	}
+	strcat(destination, source);
+	return 0;
+}
+
+template<size_t size>
+inline int wcscpy_s(wchar_t (&destination)[size], const wchar_t * source) {
+	if(wcslen(source) >= size) {
+		destination[0] = 0;
+		return ERANGE;
+	}
+	wcscpy(destination, source);
+	return 0;
+}
+
+#define swprintf_s swprintf
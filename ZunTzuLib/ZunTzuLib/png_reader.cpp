@@ -3,7 +3,9 @@
 ----------------------------------------------------------------------------- */
 
 #include "stdafx.h"
+#include "file_system.h"
 #include "image_reader.h"
+#include "loader_trace.h"
 #include "unzipper.h"
 #include "image_loader_error.h"
 
@@ -12,7 +14,7 @@
 static void PNGAPI user_error_fn(png_structp png_ptr, png_const_charp error_code) {
 	// return control to the setjmp point
 	jmp_buf* error_handler = static_cast<jmp_buf*>(png_get_error_ptr(png_ptr));
-	longjmp(*error_handler, PNG_ERRORS + reinterpret_cast<int>(error_code));
+	longjmp(*error_handler, PNG_ERRORS + (int) reinterpret_cast<intptr_t>(error_code));
 }
 
 // replacement function for png_read
@@ -31,7 +33,9 @@ png_reader::png_reader(
 	row_pointer(0),
 	unzipper(new simple_unzipper(archive_name, entry_name)),
 	current_scanline(0),
-	height(0)
+	height(0),
+	pass_count(1),
+	image(0)
 {
 	ZeroMemory(&this->error_handler, sizeof(jmp_buf));
 }
@@ -40,6 +44,7 @@ png_reader::~png_reader() {
 	png_free(png_ptr, row_pointer);
 	if(info_ptr) png_destroy_read_struct(&png_ptr, &info_ptr, 0);
 	delete unzipper;
+	delete image;
 }
 
 void png_reader::set_error_handler(const jmp_buf & error_handler) {
@@ -82,16 +87,14 @@ void png_reader::init_png() {
 	int interlace_type;
 	png_get_IHDR(png_ptr, info_ptr, reinterpret_cast<png_uint_32*>(&width), reinterpret_cast<png_uint_32*>(&height), &bit_depth, &color_type, &interlace_type, nullptr, nullptr);
 
-	// throw exception in case of progressive PNG
-	if(interlace_type != PNG_INTERLACE_NONE)
-		longjmp(error_handler, IMAGE_UNSUPPORTED_PROGRESSIVE);
-
 	// setup transform filters
 	png_set_strip_alpha(png_ptr);
 	png_set_palette_to_rgb(png_ptr);
 	png_set_gray_to_rgb(png_ptr);
 	png_set_strip_16(png_ptr);
 	png_set_bgr(png_ptr);
+	if(interlace_type != PNG_INTERLACE_NONE)
+		pass_count = png_set_interlace_handling(png_ptr);
 
 	// allocate a buffer to hold one row
 	row_pointer = (png_bytep) png_malloc(png_ptr, 3 * width);
@@ -109,8 +112,14 @@ char * png_reader::read_line() {
 	if(!row_pointer)
 		init_png();
 
-	if(current_scanline < height) {
+	if(current_scanline < height && pass_count > 1) {
+		if(image == 0)
+			read_interlaced_image();
+		return image->get_data() + (size_t) current_scanline++ * 3 * png_get_image_width(png_ptr, info_ptr);
+	} else if(current_scanline < height) {
+		const unsigned long long decoding_start = begin_probe();
 		png_read_row(png_ptr, row_pointer, 0);
+		end_probe(PROBE_SCANLINE_DECODING, decoding_start);
 		++current_scanline;
 		return reinterpret_cast<char*>(row_pointer);
 	} else {
@@ -118,3 +127,18 @@ char * png_reader::read_line() {
 		return 0;
 	}
 }
+
+// the first row of the image is only complete once the last pass is decoded:
+// all the passes are decoded over the whole image, then its rows are yielded in order
+void png_reader::read_interlaced_image() {
+	const size_t stride = 3 * png_get_image_width(png_ptr, info_ptr);
+	image = new scratch_mapping;
+	if(!image->map((unsigned long long) stride * height))
+		longjmp(error_handler, IMAGE_CANNOT_MAP_SCRATCH_IMAGE);
+
+	const unsigned long long decoding_start = begin_probe();
+	for(int pass = 0; pass < pass_count; ++pass)
+		for(unsigned int y = 0; y < height; ++y)
+			png_read_row(png_ptr, reinterpret_cast<png_bytep>(image->get_data() + y * stride), 0);
+	end_probe(PROBE_SCANLINE_DECODING, decoding_start);
+}
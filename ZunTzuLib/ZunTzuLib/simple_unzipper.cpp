@@ -4,34 +4,128 @@
 
 #include "stdafx.h"
 #include <malloc.h>
+#include "ZunTzuLib.h"
 #include "zlib.h"
 #include "unzipper.h"
+#include "loader_trace.h"
+
+static const size_t INFLATING_CHUNK_SIZE = 256 * 1024;	// bytes inflated between two notifications
 
 simple_unzipper::simple_unzipper(
 	const wchar_t * archive_name,
 	const char * entry_name) :
-	archive_name(_wcsdup(archive_name)),
-	entry_name(_strdup(entry_name)),
-	file(0),
-	mapped_file(0),
-	mapping(0),
-	zip_entry(0)
+	archive(0),
+	zip_entry(0),
+	open_error(0),
+	contents(0),
+	contents_size(0),
+	position(0),
+	inflating(false),
+	inflated_buffer(0),
+	inflated_capacity(0),
+	inflated_size(0),
+	inflating_done(false),
+	stop_inflating(false)
 {
 	ZeroMemory(& this->error_handler, sizeof(jmp_buf));
+
+	open_error = open_entry(archive_name, entry_name);
+	if(open_error != 0 || zip_entry->stored != 0 || zip_entry->avail == 0 || GetProcessorCoreCount() < 2)
+		return;
+
+	// inflate the whole entry while the previous images are decoded
+	inflated_buffer = archive->acquire_buffer(zip_entry->avail, inflated_capacity);
+	contents = inflated_buffer;
+	contents_size = zip_entry->avail;
+	inflating = true;
+	submit_task(inflating_task, this, &inflating_tasks);
 }
 
 simple_unzipper::~simple_unzipper() {
-	if(zip_entry) {
+	if(inflating) {
+		stop_inflating.store(true);
+		inflating_tasks.wait();
+	}
+	if(zip_entry)
 		zzip_disk_fclose(zip_entry);
+	if(archive) {
+		if(inflated_buffer)
+			archive->release_buffer(inflated_buffer, inflated_capacity);
+		archive->release();
+	}
+}
+
+error_code simple_unzipper::open_entry(
+	const wchar_t * archive_name,
+	const char * entry_name)
+{
+	error_code error;
+	archive = zip_archive::open(archive_name, error);
+	if(!archive)
+		return error;
 
-		if(!UnmapViewOfFile(mapping)) {
-			//_tprintf(_T("%u - Error: UnmapViewOfFile()\n"), GetLastError());
+	ZZIP_DISK_ENTRY * entry = archive->find_entry(entry_name);
+	if(entry)
+		zip_entry = zzip_disk_entry_fopen(archive->get_disk(), entry);
+	if(!zip_entry) {
+		//_tprintf(_T("Error: zzip_disk_entry_fopen()\n"));
+		return UNZIPPER_ENTRY_NOT_FOUND;
+	}
+
+	// stored entries are read straight from the mapping
+	if(zip_entry->stored != 0) {
+		contents = reinterpret_cast<const char*>(zip_entry->stored);
+		contents_size = zip_entry->avail;
+	}
+	return 0;
+}
+
+void simple_unzipper::inflating_task(
+	void * context)
+{
+	simple_unzipper * unzipper = static_cast<simple_unzipper*>(context);
+#ifdef ZZIP_INFLATE_LIBDEFLATE
+	// the whole-buffer backend cannot stream: the entry becomes readable once completely inflated
+	const unsigned long long inflating_start = begin_probe();
+	const size_t size = zzip_disk_fread_all(unzipper->inflated_buffer, unzipper->zip_entry);	// short if corrupted
+	end_probe(PROBE_INFLATING, inflating_start);
+#else
+	size_t size = 0;
+	while(size < unzipper->contents_size && !unzipper->stop_inflating.load(std::memory_order_relaxed)) {
+		const size_t bytes_to_inflate = min(INFLATING_CHUNK_SIZE, unzipper->contents_size - size);
+		const unsigned long long inflating_start = begin_probe();
+		const size_t bytes_inflated = zzip_disk_fread(unzipper->inflated_buffer + size, sizeof(char), bytes_to_inflate, unzipper->zip_entry);
+		end_probe(PROBE_INFLATING, inflating_start);
+		if(bytes_inflated == 0)
+			break;	// corrupted entry, it will be read short
+		size += bytes_inflated;
+		{
+			std::lock_guard<std::mutex> lock(unzipper->inflated_lock);
+			unzipper->inflated_size.store(size, std::memory_order_release);
 		}
-		CloseHandle(mapped_file);
-		CloseHandle(file);
+		unzipper->bytes_inflated.notify_all();
+	}
+#endif
+	{
+		std::lock_guard<std::mutex> lock(unzipper->inflated_lock);
+		unzipper->inflated_size.store(size, std::memory_order_release);
+		unzipper->inflating_done.store(true, std::memory_order_release);
+	}
+	unzipper->bytes_inflated.notify_all();
+}
+
+// number of bytes that can be read in place from the current position, waiting for them to be inflated if needed
+size_t simple_unzipper::get_readable_size(size_t bytes_to_read) {
+	const size_t end = (bytes_to_read < contents_size - position ? position + bytes_to_read : contents_size);
+	if(!inflating)
+		return end - position;
+
+	if(inflated_size.load(std::memory_order_acquire) < end && !inflating_done.load(std::memory_order_acquire)) {
+		std::unique_lock<std::mutex> lock(inflated_lock);
+		blocking_wait(bytes_inflated, lock, [&] { return inflated_size.load(std::memory_order_acquire) >= end || inflating_done.load(std::memory_order_acquire); });
 	}
-	free(entry_name);
-	free(archive_name);
+	const size_t size = inflated_size.load(std::memory_order_acquire);
+	return (size < end ? size : end) - position;
 }
 
 void simple_unzipper::set_error_handler(const jmp_buf & error_handler) {
@@ -39,58 +133,52 @@ void simple_unzipper::set_error_handler(const jmp_buf & error_handler) {
 }
 
 size_t simple_unzipper::read(char * buffer, size_t bytes_to_read) {
-	if(!zip_entry) {
-		file = CreateFile(archive_name, 
-			GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 
-			FILE_ATTRIBUTE_NORMAL, NULL);
-		if(file == INVALID_HANDLE_VALUE) {
-			//_tprintf(_T("File Not Opened!\n"));
-			longjmp(error_handler, UNZIPPER_CANNOT_OPEN_ARCHIVE_FILE);
-		}
+	if(open_error != 0)
+		longjmp(error_handler, open_error);
 
-		int file_size = GetFileSize(file, NULL);
-		if(file_size == 0xffffffff) {
-			//_tprintf(_T("%u - Error: GetFileSize()\n"), GetLastError());
-			longjmp(error_handler, UNZIPPER_CANNOT_READ_FILE_SIZE);
-		}
+	if(!contents) {
+		const unsigned long long inflating_start = begin_probe();
+		const size_t bytes_read = zzip_disk_fread(buffer, sizeof(char), bytes_to_read, zip_entry);
+		end_probe(PROBE_INFLATING, inflating_start);
+		return bytes_read;
+	}
 
-		mapped_file = CreateFileMapping(file, 
-			NULL, PAGE_READONLY, 0, 0, NULL);
-		if(mapped_file == NULL) {
-			//_tprintf(_T("%u - Error: CreateFileMapping()\n"), GetLastError());
-			CloseHandle(file);
-			longjmp(error_handler, UNZIPPER_CANNOT_CREATE_FILE_MAPPING);
-		}
+	const size_t bytes_read = get_readable_size(bytes_to_read);
+	CopyMemory(buffer, contents + position, bytes_read);
+	position += bytes_read;
+	return bytes_read;
+}
 
-		mapping = MapViewOfFile(mapped_file,
-			FILE_MAP_READ, 0, 0, 0); 
-		if(mapping == NULL)	{
-			//_tprintf(_T("%u - Error: MapViewOfFile()\n"), GetLastError());
-			CloseHandle(mapped_file);
-			CloseHandle(file);
-			longjmp(error_handler, UNZIPPER_CANNOT_MAP_FILE);
-		}
+const char * simple_unzipper::read_in_place(size_t bytes_to_read, size_t & bytes_read) {
+	if(open_error != 0)
+		longjmp(error_handler, open_error);
 
-		//_tprintf(_T("archive opened."));
-
-		ZZIP_DISK disk;
-		disk.buffer = (zzip_byte_t*) mapping;
-		disk.endbuf = disk.buffer + file_size;
-		disk.reserved = 0;
-		disk.flags = 0;
-		disk.mapped = 0;
-
-		zip_entry = zzip_disk_fopen(&disk, entry_name);
-		if(!zip_entry) {
-			//_tprintf(_T("Error: zzip_disk_fopen()\n"));
-			if(!UnmapViewOfFile(mapping)) {
-				//_tprintf(_T("%u - Error: UnmapViewOfFile()\n"), GetLastError());
-			}
-			CloseHandle(mapped_file);
-			CloseHandle(file);
-			longjmp(error_handler, UNZIPPER_ENTRY_NOT_FOUND);
-		}
-	}
+	bytes_read = 0;
+	if(!contents)
+		return 0;
+
+	const char * start = contents + position;
+	bytes_read = get_readable_size(bytes_to_read);
+	position += bytes_read;
+	return start;
+}
 
-	return zzip_disk_fread(buffer, sizeof(char), bytes_to_read, zip_entry);
+bool simple_unzipper::find_entry(
+	const wchar_t * archive_name,
+	const char * entry_name,
+	unsigned int & crc32)
+{
+	error_code error;
+	zip_archive * archive = zip_archive::open(archive_name, error);
+	if(!archive)
+		return false;
+
+	bool found = false;
+	ZZIP_DISK_ENTRY * entry = archive->find_entry(entry_name);
+	if(entry != 0) {
+		crc32 = (unsigned int) zzip_disk_entry_crc32(archive->get_disk(), entry);
+		found = true;
+	}
+	archive->release();
+	return found;
 }
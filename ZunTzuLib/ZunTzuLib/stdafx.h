@@ -8,6 +8,8 @@
 	  Copyright (c) 2006-2022 ZunTzu Software and contributors
 ----------------------------------------------------------------------------- */
 
+#ifdef _WIN32
+
 #ifndef VC_EXTRALEAN
 #define VC_EXTRALEAN		// Exclude rarely-used stuff from Windows headers
 #endif
@@ -39,3 +41,13 @@
 #include <stdio.h>
 #include <math.h>
 #include <d3d9.h>
+
+#else
+
+// headless builds of the image loaders (see CMakeLists.txt)
+#include "platform.h"
+#include <setjmp.h>
+#include <stdio.h>
+#include <math.h>
+
+#endif
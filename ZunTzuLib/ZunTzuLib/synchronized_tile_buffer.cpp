@@ -3,20 +3,26 @@
 ----------------------------------------------------------------------------- */
 
 #include "stdafx.h"
+#include <thread>
 #include "synchronized_tile_buffer.h"
+#include "loader_trace.h"
+#include "thread_pool.h"
+
+static const int SPIN_COUNT = 16;	// attempts before sleeping
 
 synchronized_tile_buffer::synchronized_tile_buffer(unsigned int tile_slot_count, size_t buffer_size) :
-	full_slots_semaphore(CreateSemaphore(0, 0, tile_slot_count, 0)),
-	empty_slots_semaphore(CreateSemaphore(0, tile_slot_count, tile_slot_count, 0)),
+	tile_slot_count(tile_slot_count),
+	cells(new ring_cell[tile_slot_count]),
+	slots(new tile_slot[tile_slot_count]),
+	write_position(0),
+	read_position(0),
 	stop(false),
 	error(0),
-	tile_slot_count(tile_slot_count),
-	slot_states(new tile_slot_state[tile_slot_count]),
-	slots(new tile_slot[tile_slot_count])
+	sleeping_thread_count(0)
 {
-	InitializeCriticalSection(&critical_section);
 	for(unsigned int i = 0; i < tile_slot_count; ++i) {
-		slot_states[i] = TILE_SLOT_READY_FOR_WRITING;
+		cells[i].sequence.store(2 * i, std::memory_order_relaxed);
+		cells[i].position = 0;
 		slots[i].texels = new char[buffer_size];
 	}
 }
@@ -25,74 +31,138 @@ synchronized_tile_buffer::~synchronized_tile_buffer() {
 	for(unsigned int i = 0; i < tile_slot_count; ++i) {
 		delete [] slots[i].texels;
 	}
-	DeleteCriticalSection(&critical_section);
 	delete [] slots;
-	delete [] slot_states;
-	CloseHandle(empty_slots_semaphore);
-	CloseHandle(full_slots_semaphore);
+	delete [] cells;
+}
+
+// claims the slot at the next position if it is ready (sequence == 2 * position + ready_offset)
+bool synchronized_tile_buffer::try_claim(std::atomic<size_t> & next_position, size_t ready_offset, unsigned int & index) {
+	size_t position = next_position.load(std::memory_order_relaxed);
+	while(true) {
+		ring_cell & cell = cells[position % tile_slot_count];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		const ptrdiff_t difference = (ptrdiff_t) sequence - (ptrdiff_t) (2 * position + ready_offset);
+		if(difference == 0) {
+			if(next_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				cell.position = position;
+				index = (unsigned int) (position % tile_slot_count);
+				return true;
+			}
+			// another thread claimed it, position has been reloaded
+		} else if(difference < 0) {
+			return false;	// ring full (writing) or empty (reading)
+		} else {
+			position = next_position.load(std::memory_order_relaxed);	// another thread claimed it
+		}
+	}
+}
+
+void synchronized_tile_buffer::release(unsigned int index, size_t sequence) {
+	cells[index].sequence.store(sequence, std::memory_order_release);
+	wake_sleeping_threads();
+}
+
+void synchronized_tile_buffer::wake_sleeping_threads() {
+	// a thread about to sleep either sees the released slot or is seen here
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(sleeping_thread_count.load(std::memory_order_relaxed) > 0) {
+		{ std::lock_guard<std::mutex> lock(mutex); }
+		slot_released.notify_all();
+	}
 }
 
 bool synchronized_tile_buffer::allocate_write_slot(unsigned int & index) {
-	WaitForSingleObject(empty_slots_semaphore, INFINITE);
-	EnterCriticalSection(&critical_section);
-	if(!stop) {
-		for(unsigned int i = 0; i < tile_slot_count; ++i) {
-			if(slot_states[i] == TILE_SLOT_READY_FOR_WRITING) {
-				slot_states[i] = TILE_SLOT_WRITING;
-				LeaveCriticalSection(&critical_section);
-				index = i;
+	if(!stop.load(std::memory_order_acquire) && try_claim(write_position, 0, index))
+		return true;
+
+	// the ring is full
+	const unsigned long long wait_start = begin_probe();
+	for(int attempt = 0; ; ++attempt) {
+		if(stop.load(std::memory_order_acquire)) {
+			end_probe(PROBE_WRITE_SLOT_WAIT, wait_start);
+			return false;
+		}
+		if(try_claim(write_position, 0, index)) {
+			end_probe(PROBE_WRITE_SLOT_WAIT, wait_start);
+			return true;
+		}
+		if(attempt < SPIN_COUNT) {
+			std::this_thread::yield();
+		} else {
+			// sleep until a slot is released
+			std::unique_lock<std::mutex> lock(mutex);
+			sleeping_thread_count.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			bool claimed = false;
+			if(!stop.load(std::memory_order_acquire) && !(claimed = try_claim(write_position, 0, index))) {
+				const bool worker = begin_blocking_wait();
+				slot_released.wait(lock);
+				if(worker)
+					end_blocking_wait();
+			}
+			sleeping_thread_count.fetch_sub(1);
+			if(claimed) {
+				end_probe(PROBE_WRITE_SLOT_WAIT, wait_start);
 				return true;
 			}
 		}
 	}
-	LeaveCriticalSection(&critical_section);
-	return false;
 }
 
 void synchronized_tile_buffer::free_write_slot(unsigned int index) {
-	EnterCriticalSection(&critical_section);
-		slot_states[index] = TILE_SLOT_READY_FOR_READING;
-	LeaveCriticalSection(&critical_section);
-	ReleaseSemaphore(full_slots_semaphore, 1, 0);
+	release(index, 2 * cells[index].position + 1);
 }
 
 void synchronized_tile_buffer::stop_consumer(error_code code) {
-	EnterCriticalSection(&critical_section);
-		error = code;
-	LeaveCriticalSection(&critical_section);
-	ReleaseSemaphore(full_slots_semaphore, tile_slot_count, 0);
+	error.store(code, std::memory_order_release);
+	wake_sleeping_threads();
 }
 
 error_code synchronized_tile_buffer::allocate_read_slot(unsigned int & index) {
-	WaitForSingleObject(full_slots_semaphore, INFINITE);
-	EnterCriticalSection(&critical_section);
-	error_code err = error;
-	if(err == 0) {
-		for(unsigned int i = 0; i < tile_slot_count; ++i) {
-			if(slot_states[i] == TILE_SLOT_READY_FOR_READING) {
-				slot_states[i] = TILE_SLOT_READING;
-				LeaveCriticalSection(&critical_section);
-				index = i;
-				return err;
+	if(error.load(std::memory_order_acquire) == 0 && try_claim(read_position, 1, index))
+		return 0;
+
+	// the ring is empty
+	const unsigned long long wait_start = begin_probe();
+	for(int attempt = 0; ; ++attempt) {
+		error_code err = error.load(std::memory_order_acquire);
+		if(err != 0) {
+			end_probe(PROBE_READ_SLOT_WAIT, wait_start);
+			return err;
+		}
+		if(try_claim(read_position, 1, index)) {
+			end_probe(PROBE_READ_SLOT_WAIT, wait_start);
+			return 0;
+		}
+		if(attempt < SPIN_COUNT) {
+			std::this_thread::yield();
+		} else {
+			// sleep until a slot is released
+			std::unique_lock<std::mutex> lock(mutex);
+			sleeping_thread_count.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			bool claimed = false;
+			if(error.load(std::memory_order_acquire) == 0 && !(claimed = try_claim(read_position, 1, index))) {
+				const bool worker = begin_blocking_wait();
+				slot_released.wait(lock);
+				if(worker)
+					end_blocking_wait();
+			}
+			sleeping_thread_count.fetch_sub(1);
+			if(claimed) {
+				end_probe(PROBE_READ_SLOT_WAIT, wait_start);
+				return 0;
 			}
 		}
 	}
-	LeaveCriticalSection(&critical_section);
-	return err;
 }
 
 void synchronized_tile_buffer::free_read_slot(unsigned int index) {
-	EnterCriticalSection(&critical_section);
-		slot_states[index] = TILE_SLOT_READY_FOR_WRITING;
-	LeaveCriticalSection(&critical_section);
-	ReleaseSemaphore(empty_slots_semaphore, 1, 0);
+	release(index, 2 * (cells[index].position + tile_slot_count));
 }
 
 void synchronized_tile_buffer::stop_producer() {
-	EnterCriticalSection(&critical_section);
-		stop = true;
-		error = -1;
-	LeaveCriticalSection(&critical_section);
-	ReleaseSemaphore(empty_slots_semaphore, tile_slot_count, 0);
-	ReleaseSemaphore(full_slots_semaphore, tile_slot_count, 0);
+	stop.store(true, std::memory_order_release);
+	error.store(-1, std::memory_order_release);
+	wake_sleeping_threads();
 }
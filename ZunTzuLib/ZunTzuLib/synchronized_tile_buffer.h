@@ -4,6 +4,10 @@
 	  Copyright (c) 2006-2022 ZunTzu Software and contributors
 ----------------------------------------------------------------------------- */
 
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
 const unsigned int TILE_SLOT_COUNT = 3;
 
 struct tile_slot {
@@ -15,6 +19,11 @@ struct tile_slot {
 
 typedef int error_code;	// no error if 0, otherwise abort
 
+// Bounded ring of tile slots between producer and consumer threads (any number of each).
+// Slots are claimed in FIFO order without locking: each slot has a sequence number telling
+// whether it is ready for writing or for reading at a given position of the ring.
+// A thread only sleeps when the ring stays full (producer) or empty (consumer), a worker of the
+// thread pool sleeping meanwhile is replaced by another one (see blocking_wait).
 class synchronized_tile_buffer {
 public:
 	synchronized_tile_buffer(unsigned int tile_slot_count, size_t buffer_size);
@@ -31,19 +40,25 @@ public:
 	tile_slot * get_slot(unsigned int index) { return &slots[index]; }
 
 private:
-	enum tile_slot_state {
-		TILE_SLOT_READY_FOR_WRITING,
-		TILE_SLOT_WRITING,
-		TILE_SLOT_READY_FOR_READING,
-		TILE_SLOT_READING,
+	struct ring_cell {
+		std::atomic<size_t> sequence;	// 2 * position: ready for writing, 2 * position + 1: ready for reading
+		size_t position;	// of the current claim, only used by the thread owning the slot
 	};
 
-	CRITICAL_SECTION critical_section;
-	HANDLE full_slots_semaphore;
-	HANDLE empty_slots_semaphore;
-	volatile bool stop;
-	volatile error_code error;
+	bool try_claim(std::atomic<size_t> & next_position, size_t ready_offset, unsigned int & index);
+	void release(unsigned int index, size_t sequence);
+	void wake_sleeping_threads();
+
 	unsigned int tile_slot_count;
-	tile_slot_state * slot_states;	// at least 3 slots
-	tile_slot * slots;	// at least 3 slots
+	ring_cell * cells;
+	tile_slot * slots;
+	std::atomic<size_t> write_position;
+	std::atomic<size_t> read_position;
+	std::atomic<bool> stop;
+	std::atomic<error_code> error;
+
+	// sleeping threads
+	std::mutex mutex;
+	std::condition_variable slot_released;
+	std::atomic<int> sleeping_thread_count;
 };
@@ -3,10 +3,19 @@
 ----------------------------------------------------------------------------- */
 
 #include "stdafx.h"
+#include <atomic>
 #include <thread>
 #include "ZunTzuLib.h"
 
+static std::atomic<int> processor_core_count(0);	// 0: all the cores of the processor
+
+extern "C" void __cdecl SetProcessorCoreCount(int count)
+{
+	processor_core_count.store(count > 0 ? count : 0);
+}
+
 extern "C" int __cdecl GetProcessorCoreCount()
 {
-	return (int)std::thread::hardware_concurrency();
+	const int count = processor_core_count.load();
+	return (count > 0 ? count : (int)std::thread::hardware_concurrency());
 }
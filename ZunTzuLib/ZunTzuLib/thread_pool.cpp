@@ -0,0 +1,222 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include <atomic>
+#include <deque>
+#include <thread>
+#include "ZunTzuLib.h"
+#include "thread_pool.h"
+
+static const int MAX_WORKER_COUNT = 1024;	// workers sleeping in blocking_wait included
+
+struct pool_task {
+	task_function function;
+	void * context;
+	task_group * group;
+};
+
+// tasks of a worker, or submitted from out of the pool
+struct task_deque {
+	std::mutex mutex;
+	std::deque<pool_task> tasks;
+};
+
+// Workers are created on demand and never destroyed: they sleep while there is nothing to run.
+// The pool itself is never destroyed either, workers may still be sleeping when the process exits.
+class thread_pool {
+public:
+	thread_pool();
+	void submit(const pool_task & task);
+	bool begin_blocking_wait();
+	void end_blocking_wait();
+
+private:
+	static void worker_loop(thread_pool * pool, task_deque * deque);
+	bool take_task(task_deque * deque, pool_task & task);
+	void wake_or_start_worker();
+	static int get_target_running_count() { return max(1, GetProcessorCoreCount()); }
+
+	// deques[0] holds the tasks submitted from out of the pool, deques[i] those of worker i
+	task_deque * deques[1 + MAX_WORKER_COUNT];
+	std::atomic<int> deque_count;	// published once the deque is allocated
+	std::atomic<int> queued_task_count;	// may be transiently off by the tasks being pushed or popped
+	std::atomic<unsigned int> next_victim;	// spreads the steals over the workers
+
+	std::mutex mutex;	// guards the counts below
+	std::condition_variable task_queued;
+	int worker_count;
+	int running_worker_count;	// neither idle nor sleeping in blocking_wait
+	int idle_worker_count;
+};
+
+static thread_pool * shared_pool = 0;
+static std::once_flag shared_pool_created;
+static thread_local task_deque * worker_deque = 0;	// deque of the calling thread, 0 if not a worker
+
+static thread_pool & get_pool() {
+	std::call_once(shared_pool_created, [] { shared_pool = new thread_pool(); });
+	return *shared_pool;
+}
+
+thread_pool::thread_pool() :
+	deque_count(1),
+	queued_task_count(0),
+	next_victim(0),
+	worker_count(0),
+	running_worker_count(0),
+	idle_worker_count(0)
+{
+	deques[0] = new task_deque;
+	for(int i = 1; i <= MAX_WORKER_COUNT; ++i)
+		deques[i] = 0;
+}
+
+void thread_pool::submit(
+	const pool_task & task)
+{
+	task_deque * deque = (worker_deque != 0 ? worker_deque : deques[0]);
+	{
+		std::lock_guard<std::mutex> lock(deque->mutex);
+		deque->tasks.push_back(task);
+	}
+	queued_task_count.fetch_add(1);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if(running_worker_count < get_target_running_count())
+		wake_or_start_worker();
+}
+
+void thread_pool::wake_or_start_worker()
+{
+	// the pool lock is held
+	if(idle_worker_count > 0) {
+		task_queued.notify_one();
+	} else if(worker_count < MAX_WORKER_COUNT) {
+		task_deque * deque = new task_deque;
+		deques[1 + worker_count] = deque;
+		++worker_count;
+		deque_count.store(1 + worker_count);
+		++running_worker_count;
+		std::thread(worker_loop, this, deque).detach();
+	}
+}
+
+bool thread_pool::take_task(
+	task_deque * deque,
+	pool_task & task)
+{
+	// own tasks first, newest first
+	{
+		std::lock_guard<std::mutex> lock(deque->mutex);
+		if(!deque->tasks.empty()) {
+			task = deque->tasks.back();
+			deque->tasks.pop_back();
+			queued_task_count.fetch_sub(1);
+			return true;
+		}
+	}
+
+	// otherwise steal the oldest task of another deque
+	const int count = deque_count.load();
+	const unsigned int first_victim = next_victim.fetch_add(1, std::memory_order_relaxed);
+	for(int i = 0; i < count; ++i) {
+		task_deque * victim = deques[(first_victim + i) % count];
+		if(victim == deque)
+			continue;
+		std::lock_guard<std::mutex> lock(victim->mutex);
+		if(!victim->tasks.empty()) {
+			task = victim->tasks.front();
+			victim->tasks.pop_front();
+			queued_task_count.fetch_sub(1);
+			return true;
+		}
+	}
+	return false;
+}
+
+void thread_pool::worker_loop(
+	thread_pool * pool,
+	task_deque * deque)
+{
+	worker_deque = deque;
+	while(true) {
+		{
+			// idle while there is nothing to run, or while too many workers run (after blocking waits)
+			std::unique_lock<std::mutex> lock(pool->mutex);
+			if(pool->queued_task_count.load() <= 0 || pool->running_worker_count > get_target_running_count()) {
+				--pool->running_worker_count;
+				++pool->idle_worker_count;
+				pool->task_queued.wait(lock, [pool] { return pool->queued_task_count.load() > 0 && pool->running_worker_count < get_target_running_count(); });
+				--pool->idle_worker_count;
+				++pool->running_worker_count;
+			}
+		}
+
+		pool_task task;
+		if(pool->take_task(deque, task)) {
+			task.function(task.context);
+			if(task.group != 0)
+				task.group->task_done();
+		}
+	}
+}
+
+bool thread_pool::begin_blocking_wait()
+{
+	if(worker_deque == 0)
+		return false;
+	std::lock_guard<std::mutex> lock(mutex);
+	--running_worker_count;
+	if(queued_task_count.load() > 0 && running_worker_count < get_target_running_count())
+		wake_or_start_worker();
+	return true;
+}
+
+void thread_pool::end_blocking_wait()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	++running_worker_count;
+}
+
+void submit_task(
+	task_function function,
+	void * context,
+	task_group * group)
+{
+	if(group != 0)
+		group->add_task();
+	pool_task task = { function, context, group };
+	get_pool().submit(task);
+}
+
+bool begin_blocking_wait()
+{
+	return get_pool().begin_blocking_wait();
+}
+
+void end_blocking_wait()
+{
+	get_pool().end_blocking_wait();
+}
+
+void task_group::add_task()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	++pending_task_count;
+}
+
+void task_group::task_done()
+{
+	// notified under the lock: the group may be deleted as soon as the lock is released
+	std::lock_guard<std::mutex> lock(mutex);
+	if(0 == --pending_task_count)
+		all_done.notify_all();
+}
+
+void task_group::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	blocking_wait(all_done, lock, [this] { return pending_task_count == 0; });
+}
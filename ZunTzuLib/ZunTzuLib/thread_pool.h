@@ -0,0 +1,55 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include <mutex>
+#include <condition_variable>
+
+// Process-wide pool of worker threads running the background work of all the image loaders:
+// decoding, inflating, mipmaps and compression. The tasks of all the images share the same workers,
+// so that no thread is created per image and an image is decoded while the previous one is compressed.
+// Each worker has its own deque of tasks: it runs the tasks it submitted last first, and once its deque
+// is empty it steals the oldest tasks of the other workers, or those submitted from out of the pool.
+// As many workers run at once as GetProcessorCoreCount(). A worker sleeping in blocking_wait does not
+// count: another worker is woken, or created, in its place, so that tasks waiting for each other always run.
+
+typedef void (*task_function)(void * context);
+
+class task_group;
+
+// function(context) is run on a worker, group (if any) counts it until it returns
+void submit_task(task_function function, void * context, task_group * group = 0);
+
+// called around a wait: if the calling thread is a worker, another worker runs the queued tasks meanwhile
+bool begin_blocking_wait();	// false if the calling thread is not a worker
+void end_blocking_wait();
+
+// condition.wait(lock, ready), from any thread
+template<typename predicate>
+void blocking_wait(std::condition_variable & condition, std::unique_lock<std::mutex> & lock, predicate ready) {
+	if(!ready()) {
+		const bool worker = begin_blocking_wait();
+		condition.wait(lock, ready);
+		if(worker)
+			end_blocking_wait();
+	}
+}
+
+// tasks waited for together, e.g. by their owner before deleting what they use
+class task_group {
+public:
+	task_group() : pending_task_count(0) {}
+	~task_group() { wait(); }
+	void wait();	// until all the tasks submitted have returned
+
+	// called by submit_task and by the workers
+	void add_task();
+	void task_done();
+
+private:
+	std::mutex mutex;
+	std::condition_variable all_done;
+	unsigned int pending_task_count;
+};
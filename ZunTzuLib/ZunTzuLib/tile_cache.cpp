@@ -0,0 +1,287 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include <stddef.h>
+#include <algorithm>
+#include <mutex>
+#include "ZunTzuLib.h"
+#include "dxt_compressor.h"
+#include "tile_cache.h"
+#include "ztt_file.h"
+#include "unzipper.h"
+
+static const unsigned int TILE_CACHE_VERSION = 3;
+
+static const unsigned long long DEFAULT_TILE_CACHE_MAX_SIZE = 2ULL << 30;	// 2 GiB, the tiles of a few dozen game boxes
+
+static std::mutex cache_directory_mutex;
+static wchar_t cache_directory[MAX_PATH];	// empty if caching is disabled
+static unsigned long long cache_max_size = DEFAULT_TILE_CACHE_MAX_SIZE;
+
+static std::mutex eviction_mutex;	// one eviction at a time
+
+extern "C" void __cdecl SetTileCacheDirectory(
+	const wchar_t * directory_name)
+{
+	std::lock_guard<std::mutex> lock(cache_directory_mutex);
+	cache_directory[0] = 0;
+	if(directory_name != 0 && wcslen(directory_name) > 0 && wcslen(directory_name) < MAX_PATH - 32) {
+		if(create_directory(directory_name))
+			wcscpy_s(cache_directory, directory_name);
+	}
+}
+
+extern "C" void __cdecl SetTileCacheMaxSize(
+	unsigned long long max_size)
+{
+	std::lock_guard<std::mutex> lock(cache_directory_mutex);
+	cache_max_size = (max_size > 0 ? max_size : DEFAULT_TILE_CACHE_MAX_SIZE);
+}
+
+static bool is_less_recently_used(const file_info & a, const file_info & b)
+{
+	return a.last_write_time < b.last_write_time;
+}
+
+// Deletes the least recently used tile sets (see open_cached_tiles) until the cache fits in its maximum size.
+// The most recent one is kept whatever its size.
+static void evict_tile_sets(
+	const wchar_t * directory,
+	unsigned long long max_size)
+{
+	std::lock_guard<std::mutex> lock(eviction_mutex);
+	std::vector<file_info> files;
+	if(!list_files(directory, L".ztt", files))
+		return;
+	unsigned long long total_size = 0;
+	for(size_t i = 0; i < files.size(); ++i)
+		total_size += files[i].size;
+	if(total_size <= max_size)
+		return;
+
+	std::sort(files.begin(), files.end(), is_less_recently_used);
+	for(size_t i = 0; i + 1 < files.size() && total_size > max_size; ++i) {
+		// fails harmlessly on Windows if a loader has the tile set open
+		if(delete_file(files[i].file_name))
+			total_size -= files[i].size;
+	}
+}
+
+tile_cache_key::tile_cache_key(
+	const wchar_t * archive_name,
+	const char * image_entry_name,
+	const char * mask_entry_name,
+	unsigned int skipped_mipmap_levels,
+	int options)
+:
+	skipped_mipmap_levels(skipped_mipmap_levels),
+	has_mask(mask_entry_name != 0 && *mask_entry_name != 0),
+	options(options),
+	metadata(0),
+	metadata_size(0),
+	file_name(0)
+{
+	wchar_t directory[MAX_PATH];
+	{
+		std::lock_guard<std::mutex> lock(cache_directory_mutex);
+		wcscpy_s(directory, cache_directory);
+	}
+	if(directory[0] == 0)
+		return;
+
+	if(mask_entry_name == 0)
+		mask_entry_name = "";
+
+	tile_cache_metadata header;
+	ZeroMemory(&header, sizeof(header));
+	CopyMemory(header.magic, "ZTTC", 4);
+	header.version = TILE_CACHE_VERSION;
+	if(!simple_unzipper::find_entry(archive_name, image_entry_name, header.image_crc32) ||
+		(*mask_entry_name != 0 && !simple_unzipper::find_entry(archive_name, mask_entry_name, header.mask_crc32)))
+		return;
+	header.skipped_mipmap_levels = skipped_mipmap_levels;
+	header.options = options;
+
+	// key: archive path, image entry name and mask entry name separated by line feeds
+	const size_t archive_name_length = wcslen(archive_name);
+	const size_t image_entry_name_length = strlen(image_entry_name);
+	const size_t mask_entry_name_length = strlen(mask_entry_name);
+	const size_t key_length = archive_name_length + 1 + image_entry_name_length + 1 + mask_entry_name_length;
+	if(sizeof(header) + key_length * sizeof(wchar_t) > ZTT_MAX_METADATA_SIZE)
+		return;
+	header.key_size = (unsigned int) (key_length * sizeof(wchar_t));
+
+	metadata_size = (unsigned int) sizeof(header) + header.key_size;
+	metadata = new char[metadata_size];
+	CopyMemory(metadata, &header, sizeof(header));
+	wchar_t * k = reinterpret_cast<wchar_t*>(metadata + sizeof(header));
+	for(size_t i = 0; i < archive_name_length; ++i)
+		*k++ = archive_name[i];
+	*k++ = L'\n';
+	for(size_t i = 0; i < image_entry_name_length; ++i)
+		*k++ = (unsigned char) image_entry_name[i];
+	*k++ = L'\n';
+	for(size_t i = 0; i < mask_entry_name_length; ++i)
+		*k++ = (unsigned char) mask_entry_name[i];
+
+	// file name: 64-bit FNV-1a hash of the metadata but the checksums,
+	// so that the tiles of a modified image replace the stale ones
+	const unsigned int checksums_begin = (unsigned int) offsetof(tile_cache_metadata, image_crc32);
+	const unsigned int checksums_end = (unsigned int) offsetof(tile_cache_metadata, skipped_mipmap_levels);
+	unsigned long long hash = 14695981039346656037ULL;
+	for(unsigned int i = 0; i < metadata_size; ++i) {
+		if(i < checksums_begin || i >= checksums_end)
+			hash = (hash ^ (unsigned char) metadata[i]) * 1099511628211ULL;
+	}
+
+	file_name = new wchar_t[MAX_PATH];
+	swprintf_s(file_name, MAX_PATH, L"%ls%lc%016llx.ztt", directory, PATH_SEPARATOR, hash);
+}
+
+tile_cache_key::~tile_cache_key()
+{
+	delete [] file_name;
+	delete [] metadata;
+}
+
+ztt_mapped_file * tile_cache_key::open_cached_tiles() const
+{
+	// the metadata must match (the file name is only a hash)
+	ztt_mapped_file * file = new ztt_mapped_file();
+	if(file->open(file_name) &&
+		file->get_index().header.metadata_size == metadata_size &&
+		0 == memcmp(file->get_metadata(), metadata, metadata_size))
+	{
+		touch_file(file_name);	// most recently used, see evict_tile_sets
+		return file;
+	}
+	delete file;
+	return 0;
+}
+
+bool tile_cache_key::create_temporary_file(
+	ztt_writer & writer,
+	unsigned int width,
+	unsigned int height) const
+{
+	// the temporary file is created in the cache directory so that it can be renamed
+	wchar_t directory[MAX_PATH];
+	wchar_t temporary_file_name[MAX_PATH];
+	wcscpy_s(directory, file_name);
+	*wcsrchr(directory, PATH_SEPARATOR) = 0;
+	if(!::create_temporary_file(directory, L"ztt", temporary_file_name))
+		return false;
+
+	ztt_index index;
+	index.init(width, height, skipped_mipmap_levels, has_mask, options, metadata_size);
+	if(!writer.create(temporary_file_name, index, metadata)) {
+		delete_file(temporary_file_name);
+		return false;
+	}
+	return true;
+}
+
+void tile_cache_key::commit_temporary_file(
+	ztt_writer & writer) const
+{
+	// fails harmlessly if another loader has the cached tiles open
+	if(!writer.close())
+		return;
+	if(!replace_file(writer.get_file_name(), file_name)) {
+		delete_file(writer.get_file_name());
+		return;
+	}
+
+	wchar_t directory[MAX_PATH];
+	unsigned long long max_size;
+	{
+		std::lock_guard<std::mutex> lock(cache_directory_mutex);
+		max_size = cache_max_size;
+	}
+	wcscpy_s(directory, file_name);
+	*wcsrchr(directory, PATH_SEPARATOR) = 0;
+	evict_tile_sets(directory, max_size);
+}
+
+tile_cache_recorder::tile_cache_recorder(
+	tile_cache_key * key,
+	dxt_compressor * compressor)
+:
+	key(key),
+	compressor(compressor),
+	writer(new ztt_writer()),
+	recording(false)
+{
+}
+
+tile_cache_recorder::~tile_cache_recorder()
+{
+	delete writer;	// an incomplete recording is discarded
+	delete compressor;
+	delete key;
+}
+
+error_code tile_cache_recorder::get_image_dimensions(
+	unsigned int & width,
+	unsigned int & height)
+{
+	error_code error = compressor->get_image_dimensions(width, height);
+	if(error == 0 && !recording)
+		recording = key->create_temporary_file(*writer, width, height);
+	return error;
+}
+
+error_code tile_cache_recorder::get_next_tile(
+	char * tile_data,
+	unsigned int & mipmap_level,
+	unsigned int & x,
+	unsigned int & y)
+{
+	error_code error = compressor->get_next_tile(tile_data, mipmap_level, x, y);
+	if(error == 0)
+		record_tile(mipmap_level, x, y, tile_data);
+	return error;
+}
+
+error_code tile_cache_recorder::get_next_tiles(
+	char ** tile_data,
+	unsigned int tile_count,
+	unsigned int * mipmap_levels,
+	unsigned int * xs,
+	unsigned int * ys)
+{
+	error_code error = compressor->get_next_tiles(tile_data, tile_count, mipmap_levels, xs, ys);
+	if(error == 0) {
+		for(unsigned int i = 0; i < tile_count; ++i)
+			record_tile(mipmap_levels[i], xs[i], ys[i], tile_data[i]);
+	}
+	return error;
+}
+
+void tile_cache_recorder::record_tile(
+	unsigned int mipmap_level,
+	unsigned int x,
+	unsigned int y,
+	const char * tile_data)
+{
+	if(recording && !writer->is_complete()) {
+		if(!writer->write_tile(mipmap_level, x, y, tile_data)) {
+			// stop recording (e.g. disk full), loading goes on
+			writer->close();
+		} else if(writer->is_complete()) {
+			key->commit_temporary_file(*writer);
+		}
+	}
+}
+
+void tile_cache_recorder::prioritize_tiles(
+	unsigned int mipmap_level,
+	unsigned int left,
+	unsigned int top,
+	unsigned int right,
+	unsigned int bottom)
+{
+	compressor->prioritize_tiles(mipmap_level, left, top, right, bottom);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+class ztt_mapped_file;
+class ztt_writer;
+
+// Cached tiles are stored as tile sets (see ztt_file.h). Their metadata is a tile_cache_metadata
+// followed by the key (archive path, image entry name and mask entry name, as wide characters).
+
+struct tile_cache_metadata {
+	char magic[4];	// "ZTTC"
+	unsigned int version;
+	unsigned int image_crc32;	// from the zip central directory
+	unsigned int mask_crc32;	// 0 if no mask
+	unsigned int skipped_mipmap_levels;
+	unsigned int options;
+	unsigned int key_size;	// size in bytes of the key
+};
+
+class tile_cache_key {
+public:
+	tile_cache_key(const wchar_t * archive_name, const char * image_entry_name, const char * mask_entry_name, unsigned int skipped_mipmap_levels, int options);
+	~tile_cache_key();
+
+	// false if there is no cache directory or if the entries cannot be found in the archive
+	bool is_valid() const { return file_name != 0; }
+
+	// returns 0 if the image is not cached
+	ztt_mapped_file * open_cached_tiles() const;
+
+	// the temporary file is published once all its tiles are written
+	bool create_temporary_file(ztt_writer & writer, unsigned int width, unsigned int height) const;
+	void commit_temporary_file(ztt_writer & writer) const;
+
+private:
+	unsigned int skipped_mipmap_levels;
+	bool has_mask;
+	int options;
+	char * metadata;	// tile_cache_metadata and key
+	unsigned int metadata_size;
+	wchar_t * file_name;	// cache directory + hash of the metadata (but the checksums)
+};
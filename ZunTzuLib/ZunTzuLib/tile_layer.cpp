@@ -0,0 +1,53 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include "tile_layer.h"
+#include "mipmap_pipeline.h"
+
+void tile_layer::prioritize_tiles(
+	unsigned int mipmap_level,
+	unsigned int left,
+	unsigned int top,
+	unsigned int right,
+	unsigned int bottom)
+{
+	// kept for the pipeline to come, if loading has not started yet
+	std::lock_guard<std::mutex> lock(pipeline_mutex);
+	prioritizing = true;
+	priority_area[0] = mipmap_level;
+	priority_area[1] = left;
+	priority_area[2] = top;
+	priority_area[3] = right;
+	priority_area[4] = bottom;
+	if(pipeline != 0)
+		pipeline->prioritize(mipmap_level, left, top, right, bottom);
+}
+
+mipmap_pipeline * tile_layer::create_pipeline(
+	unsigned int width,
+	unsigned int height,
+	unsigned int texel_size,
+	unsigned int mipmap_level_count,
+	unsigned int skipped_mipmap_levels,
+	synchronized_tile_buffer * tile_buffer)
+{
+	std::lock_guard<std::mutex> lock(pipeline_mutex);
+	pipeline = new mipmap_pipeline(width, height, texel_size, mipmap_level_count, skipped_mipmap_levels, tile_buffer);
+	if(prioritizing)
+		pipeline->prioritize(priority_area[0], priority_area[1], priority_area[2], priority_area[3], priority_area[4]);
+	return pipeline;
+}
+
+void tile_layer::delete_pipeline()
+{
+	// the tasks of the pipeline may wait for the consumer, which may be prioritizing tiles
+	mipmap_pipeline * deleted_pipeline;
+	{
+		std::lock_guard<std::mutex> lock(pipeline_mutex);
+		deleted_pipeline = pipeline;
+		pipeline = 0;
+	}
+	delete deleted_pipeline;
+}
@@ -4,23 +4,46 @@
 	  Copyright (c) 2006-2022 ZunTzu Software and contributors
 ----------------------------------------------------------------------------- */
 
+#include <mutex>
+
 typedef int error_code;	// no error if 0, otherwise abort
 
 class synchronized_tile_buffer;
+class mipmap_pipeline;
 
 class tile_layer {
 public:
-	virtual ~tile_layer() = 0 {}
+	virtual ~tile_layer() = 0;
 	virtual error_code get_image_dimensions(unsigned int & width, unsigned int & height) = 0;
 	virtual void get_all_tiles(synchronized_tile_buffer * tile_buffer) = 0;
+	// see dxt_compressor::prioritize_tiles, from any thread
+	void prioritize_tiles(unsigned int mipmap_level, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+
+	// at least 3 mipmap levels, the last one fitting in a single tile
+	static unsigned int get_mipmap_level_count(unsigned int width, unsigned int height) {
+		const double inv_log_two = 1.0 / log(2.0);
+		double mipmap_count_width = ceil(log((double)(width / 254)) * inv_log_two + 1);
+		double mipmap_count_height = ceil(log((double)(height / 254)) * inv_log_two + 1);
+		return max(3u, (unsigned int) max(mipmap_count_width, mipmap_count_height));
+	}
 protected:
-	tile_layer() {}
+	tile_layer() : pipeline(0), prioritizing(false) {}
+	// the pipeline of get_all_tiles, prioritized as the last call to prioritize_tiles
+	mipmap_pipeline * create_pipeline(unsigned int width, unsigned int height, unsigned int texel_size, unsigned int mipmap_level_count, unsigned int skipped_mipmap_levels, synchronized_tile_buffer * tile_buffer);
+	void delete_pipeline();
 	static bool is_png(const char * entry_name) {
 		size_t entry_name_length = strlen(entry_name);
 		return entry_name_length >= 4 && (0 == _strnicmp(".png", entry_name + (entry_name_length - 4), 4));
 	}
+private:
+	std::mutex pipeline_mutex;	// guards the fields below
+	mipmap_pipeline * pipeline;
+	bool prioritizing;
+	unsigned int priority_area[5];	// mipmap level, left, top, right, bottom
 };
 
+inline tile_layer::~tile_layer() {}
+
 class image_reader;
 
 class simple_tile_layer : public tile_layer {
@@ -36,14 +59,6 @@ private:
 
 	image_reader * reader;
 	unsigned int mipmap_level_count;
-	struct mipmap_data {
-		unsigned char * start; // start of the scanline data in the buffer
-		size_t stride; // size in bytes of each scanline
-		unsigned int next_tile_y; // y coordinate of the next tile
-		unsigned char next_scanline_index; // index of the next scanline in the buffer (from 0 to 256)
-		unsigned char scanlines_to_complete_tile; // number of scanlines to read to complete a tile (from 255 to 0)
-	};
-	mipmap_data * mipmaps;	// mipmap counters and pixels
 };
 
 class masked_tile_layer : public tile_layer {
@@ -60,12 +75,4 @@ private:
 	image_reader * main_image_reader;
 	image_reader * mask_reader;
 	unsigned int mipmap_level_count;
-	struct mipmap_data {
-		unsigned char * start; // start of the scanline data in the buffer
-		size_t stride; // size in bytes of each scanline
-		unsigned int next_tile_y; // y coordinate of the next tile
-		unsigned char next_scanline_index; // index of the next scanline in the buffer (from 0 to 256)
-		unsigned char scanlines_to_complete_tile; // number of scanlines to read to complete a tile (from 255 to 0)
-	};
-	mipmap_data * mipmaps;	// mipmap counters and pixels
 };
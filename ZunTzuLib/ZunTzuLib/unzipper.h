@@ -7,29 +7,99 @@
 #define _ZZIP_DISK_FILE_STRUCT 1
 #include "zzip/mmapped.h"
 
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "file_system.h"
 #include "image_loader_error.h"
+#include "thread_pool.h"
+
+typedef int error_code;	// no error if 0, otherwise abort
+
+// A zip archive mapped once and shared by all the readers of its entries (e.g. all the images of a game box).
+// Archives are reference counted: open() returns the archive already mapped under this name, if any.
+// The entry names of the central directory are indexed when the archive is mapped.
+class zip_archive {
+public:
+	static zip_archive * open(const wchar_t * archive_name, error_code & error);	// 0 if error
+	void release();
+
+	ZZIP_DISK * get_disk() { return &disk; }
+	ZZIP_DISK_ENTRY * find_entry(const char * entry_name) const;	// 0 if not found
+
+	// large buffers reused by the entries inflated as a whole, kept until the archive is unmapped
+	char * acquire_buffer(size_t size, size_t & capacity);
+	void release_buffer(char * buffer, size_t capacity);
+
+private:
+	static const int POOLED_BUFFER_COUNT = 2;	// e.g. an image and its mask
+
+	zip_archive(const wchar_t * archive_name);
+	~zip_archive();
+	error_code map();
+	void build_index();
+
+	wchar_t * archive_name;
+	mapped_file file;
+	ZZIP_DISK disk;
+	ZZIP_DISK_INDEX * index;	// 0 if the central directory cannot be read
+	int reference_count;	// guarded by the lock of the registry
+	zip_archive * next;	// in the registry
+	std::mutex buffer_lock;
+	char * pooled_buffers[POOLED_BUFFER_COUNT];
+	size_t pooled_capacities[POOLED_BUFFER_COUNT];
+};
 
 class unzipper {
 public:
-	virtual ~unzipper() = 0 {}
+	virtual ~unzipper() = 0;
 	virtual void set_error_handler(const jmp_buf & error_handler) = 0;
 	virtual size_t read(char * buffer, size_t bytes_to_read) = 0;
+	// zero-copy read: points to the next bytes of the entry (fewer than bytes_to_read at its end), valid until the unzipper is deleted
+	// successive reads in place are contiguous, returns 0 if the entry cannot be read in place (use read instead)
+	virtual const char * read_in_place(size_t bytes_to_read, size_t & bytes_read) = 0;
 protected:
 	unzipper() {}
 };
 
+inline unzipper::~unzipper() {}
+
+// Stored entries are read in place from the mapping. With several cores, deflated entries are inflated as a whole
+// by a task of the thread pool as soon as the unzipper is created, and read in place as they are inflated.
+// Otherwise they are inflated as they are read.
 class simple_unzipper : public unzipper {
 public:
 	simple_unzipper(const wchar_t * archive_name, const char * entry_name);
 	virtual ~simple_unzipper();
 	virtual void set_error_handler(const jmp_buf & error_handler);
 	virtual size_t read(char * buffer, size_t bytes_to_read);
+	virtual const char * read_in_place(size_t bytes_to_read, size_t & bytes_read);
+
+	// looks for an entry in the central directory, without reading it
+	static bool find_entry(const wchar_t * archive_name, const char * entry_name, unsigned int & crc32);
 private:
-	wchar_t * archive_name;
-	char * entry_name;
-	HANDLE file;
-	HANDLE mapped_file;
-	LPVOID mapping;
+	error_code open_entry(const wchar_t * archive_name, const char * entry_name);
+	size_t get_readable_size(size_t bytes_to_read);
+	static void inflating_task(void * context);
+
+	zip_archive * archive;
 	ZZIP_DISK_FILE * zip_entry;
+	error_code open_error;
 	jmp_buf error_handler;
+
+	// entry read in place
+	const char * contents;	// 0 if the entry is inflated as it is read
+	size_t contents_size;
+	size_t position;
+
+	// entry inflated by a task
+	bool inflating;	// false if the entry is not inflated by a task
+	task_group inflating_tasks;
+	char * inflated_buffer;
+	size_t inflated_capacity;
+	std::atomic<size_t> inflated_size;
+	std::atomic<bool> inflating_done;
+	std::atomic<bool> stop_inflating;
+	std::mutex inflated_lock;
+	std::condition_variable bytes_inflated;
 };
@@ -0,0 +1,146 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include <malloc.h>
+#include <mutex>
+#include <utility>
+#include "zlib.h"
+#include "unzipper.h"
+
+// archives currently open, in a list since a game box seldom needs more than one
+static std::mutex registry_lock;
+static zip_archive * registry = 0;
+
+zip_archive * zip_archive::open(
+	const wchar_t * archive_name,
+	error_code & error)
+{
+	std::lock_guard<std::mutex> lock(registry_lock);
+
+	for(zip_archive * archive = registry; archive != 0; archive = archive->next) {
+		if(0 == _wcsicmp(archive->archive_name, archive_name)) {
+			++archive->reference_count;
+			error = 0;
+			return archive;
+		}
+	}
+
+	zip_archive * archive = new zip_archive(archive_name);
+	error = archive->map();
+	if(error != 0) {
+		delete archive;
+		return 0;
+	}
+	archive->build_index();
+	archive->next = registry;
+	registry = archive;
+	return archive;
+}
+
+void zip_archive::release() {
+	std::lock_guard<std::mutex> lock(registry_lock);
+
+	if(--reference_count > 0)
+		return;
+
+	for(zip_archive ** link = &registry; *link != 0; link = &(*link)->next) {
+		if(*link == this) {
+			*link = next;
+			break;
+		}
+	}
+	delete this;
+}
+
+zip_archive::zip_archive(
+	const wchar_t * archive_name) :
+	archive_name(_wcsdup(archive_name)),
+	index(0),
+	reference_count(1),
+	next(0)
+{
+	ZeroMemory(&disk, sizeof(ZZIP_DISK));
+	for(int i = 0; i < POOLED_BUFFER_COUNT; ++i) {
+		pooled_buffers[i] = 0;
+		pooled_capacities[i] = 0;
+	}
+}
+
+zip_archive::~zip_archive() {
+	for(int i = 0; i < POOLED_BUFFER_COUNT; ++i)
+		delete [] pooled_buffers[i];
+	zzip_disk_index_free(index);
+	free(archive_name);
+}
+
+error_code zip_archive::map() {
+	const error_code error = file.map(archive_name);
+	if(error != 0)
+		return error;
+
+	disk.buffer = (zzip_byte_t*) file.get_data();
+	disk.endbuf = disk.buffer + file.get_size();
+	disk.reserved = 0;
+	disk.flags = 0;
+	disk.mapped = 0;
+	return 0;
+}
+
+// a single pass over the central directory, so that each lookup is a hash table lookup instead of a scan
+void zip_archive::build_index() {
+	index = zzip_disk_index_build(&disk);
+}
+
+ZZIP_DISK_ENTRY * zip_archive::find_entry(
+	const char * entry_name) const
+{
+	return (index != 0 ? zzip_disk_index_find(index, const_cast<char*>(entry_name)) : 0);
+}
+
+char * zip_archive::acquire_buffer(
+	size_t size,
+	size_t & capacity)
+{
+	{
+		std::lock_guard<std::mutex> lock(buffer_lock);
+
+		// the smallest pooled buffer large enough
+		int best = -1;
+		for(int i = 0; i < POOLED_BUFFER_COUNT; ++i) {
+			if(pooled_buffers[i] != 0 && pooled_capacities[i] >= size && (best < 0 || pooled_capacities[i] < pooled_capacities[best]))
+				best = i;
+		}
+		if(best >= 0) {
+			char * buffer = pooled_buffers[best];
+			capacity = pooled_capacities[best];
+			pooled_buffers[best] = 0;
+			pooled_capacities[best] = 0;
+			return buffer;
+		}
+	}
+	capacity = size;
+	return new char[size];
+}
+
+void zip_archive::release_buffer(
+	char * buffer,
+	size_t capacity)
+{
+	{
+		std::lock_guard<std::mutex> lock(buffer_lock);
+
+		// replaces a free slot or else the smallest pooled buffer, if smaller
+		int smallest = 0;
+		for(int i = 1; i < POOLED_BUFFER_COUNT; ++i) {
+			if(pooled_capacities[i] < pooled_capacities[smallest])
+				smallest = i;
+		}
+		if(pooled_capacities[smallest] < capacity) {
+			std::swap(buffer, pooled_buffers[smallest]);
+			std::swap(capacity, pooled_capacities[smallest]);
+		}
+	}
+	delete [] buffer;
+}
@@ -0,0 +1,174 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include "ztt_file.h"
+#include "tile_layer.h"
+
+void ztt_index::init(
+	unsigned int width,
+	unsigned int height,
+	unsigned int skipped_mipmap_levels,
+	bool has_mask,
+	int options,
+	unsigned int metadata_size)
+{
+	ZeroMemory(this, sizeof(ztt_index));
+	CopyMemory(header.magic, "ZTT1", 4);
+	header.version = ZTT_VERSION;
+	header.format = (!has_mask ? 1 : (options & 8) ? 7 : 5);
+	header.width = width;
+	header.height = height;
+	header.mipmap_level_count = min(ZTT_MAX_MIPMAP_LEVEL_COUNT, tile_layer::get_mipmap_level_count(width, height));
+	header.tile_size = (has_mask ? 64 * 64 * 16 : 64 * 64 * 8);
+	header.metadata_size = metadata_size;
+
+	// same tiles as tile_layer::get_all_tiles (see mipmap_pipeline::process_band): a column starts every 254 texels,
+	// a row every 254 scanlines except on the last scanline, which the row above already covers
+	for(unsigned int i = 0; i < header.mipmap_level_count; ++i) {
+		levels[i].first_tile = header.tile_count;
+		if(i >= skipped_mipmap_levels) {
+			levels[i].column_count = (width + 253) / 254;
+			levels[i].row_count = max(1u, (height + 252) / 254);
+			header.tile_count += levels[i].column_count * levels[i].row_count;
+		}
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+
+	header.data_offset = (unsigned int) ((get_size() + metadata_size + ZTT_ALIGNMENT - 1) / ZTT_ALIGNMENT * ZTT_ALIGNMENT);
+}
+
+bool ztt_index::is_consistent() const
+{
+	if(0 != memcmp(header.magic, "ZTT1", 4) ||
+		header.version != ZTT_VERSION ||
+		(header.format != 1 && header.format != 5 && header.format != 7) ||
+		header.width == 0 || header.height == 0 ||
+		header.mipmap_level_count > ZTT_MAX_MIPMAP_LEVEL_COUNT ||
+		header.metadata_size > ZTT_MAX_METADATA_SIZE)
+		return false;
+
+	// the skipped mipmap levels come first, they have no tiles
+	unsigned int skipped_mipmap_levels = 0;
+	while(skipped_mipmap_levels < header.mipmap_level_count && levels[skipped_mipmap_levels].column_count == 0)
+		++skipped_mipmap_levels;
+
+	// any value other than the ones of a new index of the same image is a corruption
+	ztt_index expected;
+	expected.init(header.width, header.height, skipped_mipmap_levels, header.format != 1, header.format == 7 ? 8 : 0, header.metadata_size);
+	if(header.mipmap_level_count != expected.header.mipmap_level_count ||
+		header.tile_size != expected.header.tile_size ||
+		header.tile_count != expected.header.tile_count ||
+		header.data_offset != expected.header.data_offset)
+		return false;
+
+	// the tile counts of init wrap around for images too large to be tiled
+	unsigned long long tile_count = 0;
+	for(unsigned int i = 0; i < header.mipmap_level_count; ++i) {
+		if(levels[i].column_count != expected.levels[i].column_count ||
+			levels[i].row_count != expected.levels[i].row_count ||
+			levels[i].first_tile != tile_count)
+			return false;
+		tile_count += (unsigned long long) levels[i].column_count * levels[i].row_count;
+	}
+	return tile_count == header.tile_count;
+}
+
+ztt_mapped_file::ztt_mapped_file()
+{
+}
+
+ztt_mapped_file::~ztt_mapped_file()
+{
+}
+
+bool ztt_mapped_file::open(
+	const wchar_t * file_name)
+{
+	if(0 != file.map(file_name) || file.get_size() < sizeof(ztt_header))
+		return false;
+
+	const char * view = file.get_data();
+	ZeroMemory(&index, sizeof(index));
+	CopyMemory(&index.header, view, sizeof(ztt_header));
+	if(index.header.mipmap_level_count > ZTT_MAX_MIPMAP_LEVEL_COUNT ||
+		file.get_size() < index.get_size())
+		return false;
+	CopyMemory(index.levels, view + sizeof(ztt_header), index.header.mipmap_level_count * sizeof(ztt_level));
+	return index.is_consistent() && index.get_file_size() == file.get_size();
+}
+
+ztt_writer::ztt_writer() :
+	written(0),
+	remaining_tile_count(0)
+{
+	file_name[0] = 0;
+}
+
+ztt_writer::~ztt_writer()
+{
+	close();
+	delete [] written;
+}
+
+bool ztt_writer::create(
+	const wchar_t * file_name,
+	const ztt_index & index,
+	const void * metadata)
+{
+	if(wcscpy_s(this->file_name, file_name) != 0)
+		return false;
+	this->index = index;
+	delete [] written;
+	written = new bool[index.header.tile_count]();
+	remaining_tile_count = index.header.tile_count;
+
+	// allocate the whole file at once, tiles are then written in place
+	if(!file.create(file_name, index.get_file_size()))
+		return false;
+	if(!file.write(0, &index, index.get_size()) ||
+		(index.header.metadata_size > 0 && !file.write(index.get_size(), metadata, index.header.metadata_size)))
+	{
+		file.close();
+		delete_file(file_name);
+		return false;
+	}
+	return true;
+}
+
+bool ztt_writer::write_tile(
+	unsigned int mipmap_level,
+	unsigned int x,
+	unsigned int y,
+	const char * tile_data)
+{
+	if(!file.is_open() || mipmap_level >= index.header.mipmap_level_count ||
+		x >= index.levels[mipmap_level].column_count || y >= index.levels[mipmap_level].row_count)
+		return false;
+
+	// e.g. a tile yielded again by a loader: already written and counted
+	const ztt_level & level = index.levels[mipmap_level];
+	bool & tile_written = written[level.first_tile + y * level.column_count + x];
+	if(tile_written)
+		return true;
+
+	if(!file.write(index.get_tile_offset(mipmap_level, x, y), tile_data, index.header.tile_size))
+		return false;
+	tile_written = true;
+	--remaining_tile_count;
+	return true;
+}
+
+bool ztt_writer::close()
+{
+	if(!file.is_open())
+		return false;
+	file.close();
+	if(remaining_tile_count > 0) {
+		delete_file(file_name);
+		return false;
+	}
+	return true;
+}
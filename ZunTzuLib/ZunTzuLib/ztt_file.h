@@ -0,0 +1,91 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "file_system.h"
+
+// ZunTzu tile set (.ztt): the DXT tiles of an image and of its mipmaps, ready to be copied to textures.
+//
+//	ztt_header
+//	ztt_level[mipmap_level_count]
+//	metadata (metadata_size bytes, free for the producer)
+//	padding up to data_offset (a multiple of ZTT_ALIGNMENT)
+//	tiles: level by level, row by row, column by column
+//
+// All values are little-endian. Tiles are 256x256 texels overlapping by 2 texels (see tile_layer)
+// and the DXT blocks of a tile are in texture order. Skipped mipmap levels have no tiles.
+// Tile (level, x, y) starts at data_offset + (levels[level].first_tile + y * levels[level].column_count + x) * tile_size.
+
+const unsigned int ZTT_VERSION = 1;
+const unsigned int ZTT_ALIGNMENT = 4096;	// tiles are page-aligned in a mapped file
+const unsigned int ZTT_MAX_MIPMAP_LEVEL_COUNT = 32;
+const unsigned int ZTT_MAX_METADATA_SIZE = 64 * 1024;
+
+struct ztt_header {
+	char magic[4];	// "ZTT1"
+	unsigned int version;
+	unsigned int format;	// 1: DXT1 (no mask), 5: DXT5, 7: BC7 (see bc7.cpp)
+	unsigned int width;	// of the first mipmap level
+	unsigned int height;
+	unsigned int mipmap_level_count;
+	unsigned int tile_size;	// size in bytes of the DXT blocks of a tile
+	unsigned int tile_count;
+	unsigned int metadata_size;
+	unsigned int data_offset;
+};
+
+struct ztt_level {
+	unsigned int column_count;	// 0 if the level is skipped
+	unsigned int row_count;
+	unsigned int first_tile;	// index of the tile (0, 0) of the level
+};
+
+// header and level table, as stored at the start of a .ztt file
+struct ztt_index {
+	ztt_header header;
+	ztt_level levels[ZTT_MAX_MIPMAP_LEVEL_COUNT];
+
+	// options as CreateImageLoader: BC7 (8) tiles replace the DXT5 tiles of a masked image
+	void init(unsigned int width, unsigned int height, unsigned int skipped_mipmap_levels, bool has_mask, int options, unsigned int metadata_size);
+	bool is_consistent() const;	// false if the file is corrupted
+	size_t get_size() const { return sizeof(ztt_header) + header.mipmap_level_count * sizeof(ztt_level); }
+	unsigned long long get_file_size() const { return header.data_offset + (unsigned long long) header.tile_count * header.tile_size; }
+	unsigned long long get_tile_offset(unsigned int mipmap_level, unsigned int x, unsigned int y) const {
+		const ztt_level & level = levels[mipmap_level];
+		return header.data_offset + ((unsigned long long) level.first_tile + (unsigned long long) y * level.column_count + x) * header.tile_size;
+	}
+};
+
+// read-only mapping of a .ztt file, any tile is available in place
+class ztt_mapped_file {
+public:
+	ztt_mapped_file();
+	~ztt_mapped_file();
+	bool open(const wchar_t * file_name);	// false if the file cannot be mapped or is corrupted
+	const ztt_index & get_index() const { return index; }
+	const char * get_metadata() const { return file.get_data() + index.get_size(); }
+	const char * get_tile(unsigned int mipmap_level, unsigned int x, unsigned int y) const { return file.get_data() + index.get_tile_offset(mipmap_level, x, y); }
+private:
+	mapped_file file;
+	ztt_index index;
+};
+
+// writes the tiles of a .ztt file in any order
+class ztt_writer {
+public:
+	ztt_writer();
+	~ztt_writer();	// an incomplete file is deleted
+	bool create(const wchar_t * file_name, const ztt_index & index, const void * metadata);
+	bool write_tile(unsigned int mipmap_level, unsigned int x, unsigned int y, const char * tile_data);
+	bool is_complete() const { return remaining_tile_count == 0; }
+	bool close();	// returns true if the file is complete
+	const wchar_t * get_file_name() const { return file_name; }
+private:
+	positioned_file file;
+	wchar_t file_name[MAX_PATH];
+	ztt_index index;
+	bool * written;	// per tile, a tile written twice is only counted once
+	unsigned int remaining_tile_count;
+};
@@ -0,0 +1,232 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+#include "stdafx.h"
+#include "dxt_compressor.h"
+#include "unzipper.h"
+
+ztt_tile_reader::ztt_tile_reader(
+	ztt_mapped_file * file)
+:
+	file(file),
+	unzipper(0),
+	expected_format(file->get_index().header.format),
+	index(file->get_index()),
+	index_read(true),
+	next_mipmap_level(index.header.mipmap_level_count > 0 ? index.header.mipmap_level_count - 1 : 0),
+	next_x(0),
+	next_y(0),
+	remaining_tile_count(index.header.tile_count),
+	yielded(new bool[index.header.tile_count]()),
+	prioritizing(false),
+	priority_mipmap_level(0),
+	priority_left(0),
+	priority_top(0),
+	priority_right(0),
+	priority_bottom(0)
+{
+	if(remaining_tile_count > 0)
+		find_next_mapped_tile();
+}
+
+ztt_tile_reader::ztt_tile_reader(
+	const wchar_t * archive_name,
+	const char * entry_name,
+	bool has_mask)
+:
+	file(0),
+	unzipper(new simple_unzipper(archive_name, entry_name)),
+	expected_format(has_mask ? 5 : 1),
+	index_read(false),
+	next_mipmap_level(0),
+	next_x(0),
+	next_y(0),
+	remaining_tile_count(0),
+	yielded(0),
+	prioritizing(false),
+	priority_mipmap_level(0),
+	priority_left(0),
+	priority_top(0),
+	priority_right(0),
+	priority_bottom(0)
+{
+}
+
+ztt_tile_reader::~ztt_tile_reader()
+{
+	delete [] yielded;
+	delete unzipper;
+	delete file;
+}
+
+error_code ztt_tile_reader::read_index()
+{
+	jmp_buf error_handler;
+	int error = setjmp(error_handler);
+	if(error != 0)
+		return error;
+	unzipper->set_error_handler(error_handler);
+
+	ZeroMemory(&index, sizeof(index));
+	if(unzipper->read((char *) &index.header, sizeof(ztt_header)) != sizeof(ztt_header) ||
+		index.header.mipmap_level_count > ZTT_MAX_MIPMAP_LEVEL_COUNT)
+		return ZTT_NOT_A_TILE_SET;
+	const size_t level_table_size = index.header.mipmap_level_count * sizeof(ztt_level);
+	if(unzipper->read((char *) index.levels, level_table_size) != level_table_size ||
+		!index.is_consistent() || index.header.format != expected_format)
+		return ZTT_NOT_A_TILE_SET;
+
+	// a tile set precompiled in an archive replaces the image at all its mipmap levels (see CreateImageLoader)
+	if(index.header.mipmap_level_count == 0 || index.levels[0].column_count == 0)
+		return ZTT_NOT_A_TILE_SET;
+
+	// skip the metadata and the padding, the tiles are then read in sequence
+	char skipped_bytes[ZTT_ALIGNMENT];
+	for(size_t bytes_to_skip = index.header.data_offset - index.get_size(); bytes_to_skip > 0; ) {
+		size_t bytes_to_read = min(bytes_to_skip, sizeof(skipped_bytes));
+		if(unzipper->read(skipped_bytes, bytes_to_read) != bytes_to_read)
+			return ZTT_NOT_A_TILE_SET;
+		bytes_to_skip -= bytes_to_read;
+	}
+
+	index_read = true;
+	remaining_tile_count = index.header.tile_count;
+	return 0;
+}
+
+error_code ztt_tile_reader::get_image_dimensions(
+	unsigned int & width,
+	unsigned int & height)
+{
+	error_code error = (index_read ? 0 : read_index());
+	width = (error == 0 ? index.header.width : 0);
+	height = (error == 0 ? index.header.height : 0);
+	return error;
+}
+
+error_code ztt_tile_reader::get_next_tile(
+	char * tile_data,
+	unsigned int & mipmap_level,
+	unsigned int & x,
+	unsigned int & y)
+{
+	if(!index_read) {
+		error_code error = read_index();
+		if(error != 0)
+			return error;
+	}
+	if(remaining_tile_count == 0)
+		return ZTT_READ_PAST_LAST_TILE;
+
+	if(file != 0) {
+		mipmap_level = next_mipmap_level;
+		x = next_x;
+		y = next_y;
+		CopyMemory(tile_data, file->get_tile(mipmap_level, x, y), index.header.tile_size);
+
+		const ztt_level & level = index.levels[mipmap_level];
+		yielded[level.first_tile + y * level.column_count + x] = true;
+		if(--remaining_tile_count > 0)
+			find_next_mapped_tile();
+		return 0;
+	}
+
+	// an archive entry is read in file order
+	mipmap_level = next_mipmap_level;
+	x = next_x;
+	y = next_y;
+
+	jmp_buf error_handler;
+	int error = setjmp(error_handler);
+	if(error != 0)
+		return error;
+	unzipper->set_error_handler(error_handler);
+
+	if(unzipper->read(tile_data, index.header.tile_size) != index.header.tile_size)
+		return ZTT_NOT_A_TILE_SET;
+
+	--remaining_tile_count;
+	if(++next_x == index.levels[next_mipmap_level].column_count) {
+		next_x = 0;
+		if(++next_y == index.levels[next_mipmap_level].row_count) {
+			next_y = 0;
+			++next_mipmap_level;
+		}
+	}
+	return 0;
+}
+
+void ztt_tile_reader::prioritize_tiles(
+	unsigned int mipmap_level,
+	unsigned int left,
+	unsigned int top,
+	unsigned int right,
+	unsigned int bottom)
+{
+	// an archive entry cannot be read out of order
+	if(file == 0 || remaining_tile_count == 0 || left >= right || top >= bottom)
+		return;
+
+	prioritizing = true;
+	priority_mipmap_level = min(mipmap_level, index.header.mipmap_level_count - 1);
+	priority_left = left;
+	priority_top = top;
+	priority_right = right;
+	priority_bottom = bottom;
+
+	// start over from the coarsest mipmap level, tiles already yielded are passed over
+	next_mipmap_level = index.header.mipmap_level_count - 1;
+	next_x = 0;
+	next_y = 0;
+	find_next_mapped_tile();
+}
+
+// Moves to the next tile not yielded yet. The tiles of the priority area come first, from the coarsest mipmap level
+// down to the priority level, then all the other tiles from the coarsest mipmap level down to the first one.
+// At least one tile must remain.
+void ztt_tile_reader::find_next_mapped_tile()
+{
+	for(;;) {
+		// range of tiles of this level in the current pass
+		const ztt_level & level = index.levels[next_mipmap_level];
+		unsigned int first_x = 0;
+		unsigned int first_y = 0;
+		unsigned int end_x = level.column_count;
+		unsigned int end_y = level.row_count;
+		if(prioritizing) {
+			const unsigned long long rounding = (1ULL << next_mipmap_level) - 1;
+			first_x = min(end_x, (priority_left >> next_mipmap_level) / 254);
+			first_y = min(end_y, (priority_top >> next_mipmap_level) / 254);
+			end_x = min(end_x, (unsigned int) (((priority_right + rounding) >> next_mipmap_level) + 253) / 254);
+			end_y = min(end_y, (unsigned int) (((priority_bottom + rounding) >> next_mipmap_level) + 253) / 254);
+		}
+
+		if(next_y < first_y) {
+			next_y = first_y;
+			next_x = first_x;
+		}
+		if(next_x < first_x)
+			next_x = first_x;
+		if(next_x >= end_x) {
+			next_x = first_x;
+			++next_y;
+		}
+		if(next_x < end_x && next_y < end_y) {
+			if(!yielded[level.first_tile + next_y * level.column_count + next_x])
+				return;
+			++next_x;
+			continue;
+		}
+
+		// this level is done, go on with the next finer level or with the next pass
+		if(next_mipmap_level > (prioritizing ? priority_mipmap_level : 0)) {
+			--next_mipmap_level;
+		} else {
+			prioritizing = false;
+			next_mipmap_level = index.header.mipmap_level_count - 1;
+		}
+		next_x = 0;
+		next_y = 0;
+	}
+}
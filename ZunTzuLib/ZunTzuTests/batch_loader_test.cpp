@@ -0,0 +1,107 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The batch loader must yield every tile of every image once and then report the end,
+// including for images whose last row of tiles starts on their last scanline (254k + 1 scanlines).
+// Each tile is compressed into a destination supplied for the format of its image.
+
+#include "stdafx.h"
+#include <map>
+#include <set>
+#include <tuple>
+#include "ZunTzuLib.h"
+#include "ztt_file.h"
+#include "test_archive.h"
+
+static const char * const ARCHIVE_NAME = "batch_loader_test.zip";
+static const wchar_t * const WIDE_ARCHIVE_NAME = L"batch_loader_test.zip";
+
+static const unsigned int SIZES[][2] = {
+	{ 255, 255 }, { 508, 508 }, { 509, 509 }, { 510, 510 }, { 300, 509 }, { 763, 255 }
+};
+static const unsigned int IMAGE_COUNT = 2 * sizeof(SIZES) / sizeof(SIZES[0]);	// each size with and without a mask
+
+int main()
+{
+	std::vector<test_entry> entries;
+	std::vector<std::string> image_names, mask_names;
+	for(unsigned int image = 0; image < IMAGE_COUNT; ++image) {
+		const unsigned int * size = SIZES[image / 2];
+		char name[64];
+		snprintf(name, sizeof(name), "%ux%u_%u.png", size[0], size[1], image);
+		image_names.push_back(name);
+		entries.push_back(make_png_entry(name, size[0], size[1], image));
+		if(image % 2 == 0) {
+			mask_names.push_back(std::string());
+		} else {
+			snprintf(name, sizeof(name), "%ux%u_%u_mask.png", size[0], size[1], image);
+			mask_names.push_back(name);
+			entries.push_back(make_png_entry(name, size[0], size[1], image + 100));
+		}
+	}
+	if(!write_test_archive(ARCHIVE_NAME, entries)) {
+		printf("FAILED: cannot write %s\n", ARCHIVE_NAME);
+		return 1;
+	}
+
+	std::vector<const wchar_t *> archive_names(IMAGE_COUNT, WIDE_ARCHIVE_NAME);
+	std::vector<const char *> image_entry_names, mask_entry_names;
+	for(unsigned int image = 0; image < IMAGE_COUNT; ++image) {
+		image_entry_names.push_back(image_names[image].c_str());
+		mask_entry_names.push_back(mask_names[image].c_str());
+	}
+
+	// a loader waiting for tiles that are never yielded does not return (ctest timeout)
+	void * loader = CreateBatchImageLoader(IMAGE_COUNT, archive_names.data(), image_entry_names.data(), mask_entry_names.data(), 0, 0);
+	const unsigned int batch_size = 8;
+	char * tiles[batch_size];
+	unsigned int images[batch_size], mipmap_levels[batch_size], xs[batch_size], ys[batch_size];
+	std::set<std::tuple<unsigned int, unsigned int, unsigned int, unsigned int>> loaded;
+	std::vector<unsigned int> tile_counts(IMAGE_COUNT, 0);
+	int failures = 0;
+
+	// a few destinations of each format to start with, each one yielded is supplied again
+	std::vector<std::vector<char>> memory(4 * batch_size, std::vector<char>(64 * 64 * 16));
+	std::map<char *, int> held_destinations;	// masked or not
+	char * destinations[4 * batch_size];
+	int masked[4 * batch_size];
+	unsigned int destination_count = 0;
+	for(; destination_count < 4 * batch_size; ++destination_count) {
+		destinations[destination_count] = memory[destination_count].data();
+		masked[destination_count] = destination_count % 2;
+		held_destinations[destinations[destination_count]] = masked[destination_count];
+	}
+	while(unsigned int tile_count = LoadNextBatchTiles(loader, destinations, masked, destination_count, tiles, batch_size, images, mipmap_levels, xs, ys)) {
+		destination_count = 0;
+		for(unsigned int i = 0; i < tile_count; ++i) {
+			std::map<char *, int>::iterator destination = held_destinations.find(tiles[i]);
+			if(images[i] >= IMAGE_COUNT || !loaded.insert(std::make_tuple(images[i], mipmap_levels[i], xs[i], ys[i])).second) {
+				printf("FAILED: unexpected tile (%u, %u, %u) of image %u\n", mipmap_levels[i], xs[i], ys[i], images[i]);
+				++failures;
+			} else if(destination == held_destinations.end() || destination->second != (int) (images[i] % 2)) {
+				printf("FAILED: tile (%u, %u, %u) of image %u is not in a destination of its format\n", mipmap_levels[i], xs[i], ys[i], images[i]);
+				++failures;
+			} else {
+				++tile_counts[images[i]];
+				destinations[destination_count] = destination->first;
+				masked[destination_count++] = destination->second;
+			}
+		}
+	}
+	for(unsigned int image = 0; image < IMAGE_COUNT; ++image) {
+		unsigned int width, height;
+		const int error = GetBatchImageDimensions(loader, image, &width, &height);
+		ztt_index index;
+		index.init(SIZES[image / 2][0], SIZES[image / 2][1], 0, image % 2 != 0, 0, 0);
+		if(error != 0 || tile_counts[image] != index.header.tile_count) {
+			printf("FAILED: %u of the %u tiles of %s are loaded (error %d)\n", tile_counts[image], index.header.tile_count, image_names[image].c_str(), error);
+			++failures;
+		}
+	}
+	FreeBatchImageLoader(loader);
+
+	if(failures == 0)
+		printf("all the tiles of all the images are yielded once\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The BC7 tiles of CompressBc7 must be valid mode 5 or mode 6 blocks, close to their source:
+// DecompressBc7 decodes them back to BGRA texels.
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "ZunTzuLib.h"
+
+static unsigned int random_state = 0x2545f491;
+
+static unsigned int next_random()
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+static const char * const KIND_NAMES[] = { "single color", "gradient", "transparent areas", "noise" };
+
+// BGRA texels, from the easiest to the hardest to encode (the gradients never wrap around, that would be an edge)
+static void fill_tile(std::vector<char> & tile, unsigned int kind)
+{
+	const unsigned int base = next_random();
+	for(unsigned int y = 0; y < 256; ++y) {
+		for(unsigned int x = 0; x < 256; ++x) {
+			char * texel = &tile[(y * 256 + x) * 4];
+			for(unsigned int c = 0; c < 4; ++c) {
+				unsigned int value;
+				switch(kind) {
+					case 0: value = base >> (8 * c); break;
+					case 1: value = (c == 3 ? 0xff : ((base >> (8 * c)) & 0x3f) + x / 4 * (c & 1) + y / 4 * (c / 2 + 1) / 2); break;
+					case 2: value = (c == 3 ? ((x / 16 + y / 16) & 1 ? 0xff : 0x00) : (base >> (8 * c)) + ((x ^ y) & 0x3f)); break;
+					default: value = next_random(); break;
+				}
+				texel[c] = (char) value;
+			}
+		}
+	}
+}
+
+int main()
+{
+	// largest mean and maximum error per channel for each kind of tile
+	static const double MAX_MEAN_ERRORS[] = { 1.0, 1.0, 1.0, 48.0 };
+	static const int MAX_ERRORS[] = { 2, 4, 8, 255 };
+
+	int failures = 0;
+	for(unsigned int kind = 0; kind < sizeof(KIND_NAMES) / sizeof(KIND_NAMES[0]); ++kind) {
+		std::vector<char> tile(256 * 256 * 4);
+		fill_tile(tile, kind);
+		std::vector<char> blocks(64 * 64 * 16);
+		CompressBc7(tile.data(), 0, 0, 256, 256, 256 * 4, blocks.data(), 8);
+		std::vector<char> decoded(256 * 256 * 4);
+		const int undecoded_block_count = DecompressBc7(blocks.data(), decoded.data(), 256 * 4);
+		if(undecoded_block_count != 0) {
+			printf("FAILED: %d BC7 blocks of the %s tile are not in mode 5 or 6\n", undecoded_block_count, KIND_NAMES[kind]);
+			++failures;
+			continue;
+		}
+
+		unsigned long long total_error = 0;
+		int max_error = 0;
+		for(size_t i = 0; i < tile.size(); ++i) {
+			const int error = abs((int) (unsigned char) decoded[i] - (int) (unsigned char) tile[i]);
+			total_error += error;
+			if(error > max_error)
+				max_error = error;
+		}
+		const double mean_error = (double) total_error / tile.size();
+		if(mean_error > MAX_MEAN_ERRORS[kind] || max_error > MAX_ERRORS[kind]) {
+			printf("FAILED: the %s tile decodes with a mean error of %.2f and a maximum error of %d\n", KIND_NAMES[kind], mean_error, max_error);
+			++failures;
+		} else {
+			printf("%s tile: mean error %.2f, maximum error %d\n", KIND_NAMES[kind], mean_error, max_error);
+		}
+	}
+
+	if(failures == 0)
+		printf("the BC7 tiles decode back to their source\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The SSE2 and AVX2 box filter kernels must build the same mipmaps as the scalar loops,
+// for any scanline width and without writing past the destination scanline.
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <vector>
+#include "ZunTzuLib.h"
+#include "downsample_kernels.h"
+
+static unsigned int random_state = 0x9e3779b9;
+
+static unsigned char next_random_byte()
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return (unsigned char) (random_state >> 11);
+}
+
+struct kernel_case {
+	const char * name;
+	downsample_kernel kernel;
+	downsample_kernel reference;
+	unsigned int texel_size;
+	int path;	// minimum DXT kernel path
+};
+
+static void __fastcall reference_rgb(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width)
+{
+	downsample_rgb_scalar(source_odd, source_even, dest, dest_width);
+}
+
+static void __fastcall reference_rgba(const unsigned char * source_odd, const unsigned char * source_even, unsigned char * dest, size_t dest_width)
+{
+	downsample_rgba_scalar(source_odd, source_even, dest, dest_width);
+}
+
+int main()
+{
+	const int widest_path = SetDxtKernelPath(-1);
+	static const kernel_case CASES[] = {
+		{ "downsample_rgb_simd", downsample_rgb_simd, reference_rgb, 3, 0 },
+		{ "downsample_rgba_simd", downsample_rgba_simd, reference_rgba, 4, 0 },
+		{ "downsample_rgb_avx2", downsample_rgb_avx2, reference_rgb, 3, 1 },
+		{ "downsample_rgba_avx2", downsample_rgba_avx2, reference_rgba, 4, 1 }
+	};
+
+	int failures = 0;
+	for(size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); ++c) {
+		const kernel_case & k = CASES[c];
+		if(k.path > widest_path) {
+			printf("%s: not supported by this processor\n", k.name);
+			continue;
+		}
+		// every width up to a few vectors, then a large scanline; random texels, then the extreme values (rounding, overflow)
+		for(size_t dest_width = 0; dest_width <= 4097; dest_width += (dest_width < 300 ? 1 : 3797)) {
+			for(int pattern = 0; pattern < 3; ++pattern) {
+				const size_t source_size = 2 * dest_width * k.texel_size;
+				std::vector<unsigned char> source_odd(source_size), source_even(source_size);
+				for(size_t i = 0; i < source_size; ++i) {
+					source_odd[i] = (pattern == 0 ? next_random_byte() : pattern == 1 ? 0xff : (unsigned char) ((i & 1) ? 0xff : 0x01));
+					source_even[i] = (pattern == 0 ? next_random_byte() : pattern == 1 ? 0xff : (unsigned char) ((i & 2) ? 0xfe : 0x00));
+				}
+				const size_t guard_size = 64;
+				std::vector<unsigned char> expected(dest_width * k.texel_size + guard_size, 0xcd);
+				std::vector<unsigned char> dest(dest_width * k.texel_size + guard_size, 0xcd);
+				k.reference(source_odd.data(), source_even.data(), expected.data(), dest_width);
+				k.kernel(source_odd.data(), source_even.data(), dest.data(), dest_width);
+				if(dest != expected) {
+					printf("FAILED: %s differs from the scalar loop (%zu texels, pattern %d)\n", k.name, dest_width, pattern);
+					++failures;
+				}
+			}
+		}
+	}
+
+	if(failures == 0)
+		printf("all kernels match the scalar loops\n");
+	return failures == 0 ? 0 : 1;
+}
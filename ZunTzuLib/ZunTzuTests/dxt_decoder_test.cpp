@@ -0,0 +1,163 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The SIMD DXT decoders must decode any block as the hardware does, in both modes of the color blocks
+// (4 colors, or 3 colors and transparent black) and of the DXT5 alpha blocks (8 alphas, or 6 alphas, 0 and 255).
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <vector>
+#include "ZunTzuLib.h"
+
+static const int WIDTH = 16;	// in blocks
+static const int HEIGHT = 8;
+static const int STRIDE = WIDTH * 16 + 12;	// in bytes, the padding of a row must be left untouched
+static const unsigned char PADDING = 0xcd;
+
+static unsigned int random_state = 0x2545f491;
+
+static unsigned int next_random()
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+// random blocks, a quarter of them in each mode, some of them with equal endpoints
+static void fill_block(unsigned char * block, int size, int index)
+{
+	for(int i = 0; i < size; ++i)
+		block[i] = (unsigned char) next_random();
+	unsigned char * color_block = block + size - 8;
+	unsigned char * alpha_block = (size == 16 ? block : 0);
+	const bool three_colors = (index & 1) != 0;
+	const bool six_alphas = (index & 2) != 0;
+	const bool equal_endpoints = (index % 7 == 0);
+
+	if(equal_endpoints) {
+		color_block[2] = color_block[0];
+		color_block[3] = color_block[1];
+	}
+	const unsigned int color0 = color_block[0] | (color_block[1] << 8);
+	const unsigned int color1 = color_block[2] | (color_block[3] << 8);
+	if((color0 > color1) == three_colors) {
+		for(int i = 0; i < 2; ++i) {
+			const unsigned char swapped = color_block[i];
+			color_block[i] = color_block[i + 2];
+			color_block[i + 2] = swapped;
+		}
+	}
+
+	if(alpha_block != 0) {
+		if(equal_endpoints)
+			alpha_block[1] = alpha_block[0];
+		if((alpha_block[0] > alpha_block[1]) == six_alphas) {
+			const unsigned char swapped = alpha_block[0];
+			alpha_block[0] = alpha_block[1];
+			alpha_block[1] = swapped;
+		}
+	}
+}
+
+// scalar reference, one texel at a time: 565 colors expanded by bit replication, B8G8R8A8 texels
+static void decode_reference_texel(const unsigned char * block, int size, int x, int y, unsigned char * texel)
+{
+	const unsigned char * color_block = block + size - 8;
+	const unsigned int color0 = color_block[0] | (color_block[1] << 8);
+	const unsigned int color1 = color_block[2] | (color_block[3] << 8);
+	const unsigned int colors[2] = { color0, color1 };
+	int endpoints[2][3];
+	for(int e = 0; e < 2; ++e) {
+		const int b = colors[e] & 0x1f, g = (colors[e] >> 5) & 0x3f, r = colors[e] >> 11;
+		endpoints[e][0] = (b << 3) | (b >> 2);
+		endpoints[e][1] = (g << 2) | (g >> 4);
+		endpoints[e][2] = (r << 3) | (r >> 2);
+	}
+
+	const int color_index = (color_block[4 + y] >> (2 * x)) & 3;
+	int alpha = 255;
+	for(int c = 0; c < 3; ++c) {
+		int value;
+		if(color_index < 2)
+			value = endpoints[color_index][c];
+		else if(size == 8 && color0 <= color1)
+			value = (color_index == 2 ? (endpoints[0][c] + endpoints[1][c]) / 2 : 0);
+		else if(color_index == 2)
+			value = (2 * endpoints[0][c] + endpoints[1][c]) / 3;
+		else
+			value = (endpoints[0][c] + 2 * endpoints[1][c]) / 3;
+		texel[c] = (unsigned char) value;
+	}
+	if(size == 8 && color0 <= color1 && color_index == 3)
+		alpha = 0;
+
+	if(size == 16) {
+		const int alpha0 = block[0], alpha1 = block[1];
+		const int bit = 3 * (4 * y + x);
+		unsigned long long indices = 0;
+		for(int i = 0; i < 6; ++i)
+			indices |= (unsigned long long) block[2 + i] << (8 * i);
+		const int alpha_index = (int) ((indices >> bit) & 7);
+		if(alpha_index == 0)
+			alpha = alpha0;
+		else if(alpha_index == 1)
+			alpha = alpha1;
+		else if(alpha0 > alpha1)
+			alpha = ((8 - alpha_index) * alpha0 + (alpha_index - 1) * alpha1) / 7;
+		else if(alpha_index < 6)
+			alpha = ((6 - alpha_index) * alpha0 + (alpha_index - 1) * alpha1) / 5;
+		else
+			alpha = (alpha_index == 6 ? 0 : 255);
+	}
+	texel[3] = (unsigned char) alpha;
+}
+
+static int check_decoder(int size)
+{
+	const char * const name = (size == 8 ? "DXT1" : "DXT5");
+	std::vector<unsigned char> blocks(WIDTH * HEIGHT * size);
+	for(int i = 0; i < WIDTH * HEIGHT; ++i)
+		fill_block(&blocks[i * size], size, i);
+
+	std::vector<char> texels(STRIDE * HEIGHT * 4, (char) PADDING);
+	(size == 8 ? DecodeDxt1Blocks : DecodeDxt5Blocks)(reinterpret_cast<const char *>(blocks.data()), WIDTH, HEIGHT, texels.data(), STRIDE);
+
+	int failures = 0;
+	for(int i = 0; i < WIDTH * HEIGHT && failures < 10; ++i) {
+		const int blockX = i % WIDTH, blockY = i / WIDTH;
+		for(int y = 0; y < 4; ++y) {
+			for(int x = 0; x < 4; ++x) {
+				unsigned char expected[4];
+				decode_reference_texel(&blocks[i * size], size, x, y, expected);
+				const unsigned char * texel = reinterpret_cast<const unsigned char *>(&texels[STRIDE * (4 * blockY + y) + 16 * blockX + 4 * x]);
+				if(texel[0] != expected[0] || texel[1] != expected[1] || texel[2] != expected[2] || texel[3] != expected[3]) {
+					printf("FAILED: %s block %d, texel (%d, %d) is %02x%02x%02x%02x instead of %02x%02x%02x%02x\n", name, i, x, y,
+						texel[0], texel[1], texel[2], texel[3], expected[0], expected[1], expected[2], expected[3]);
+					++failures;
+				}
+			}
+		}
+	}
+	for(int row = 0; row < HEIGHT * 4; ++row) {
+		for(int i = WIDTH * 16; i < STRIDE; ++i) {
+			if((unsigned char) texels[STRIDE * row + i] != PADDING) {
+				printf("FAILED: %s writes in the padding of row %d\n", name, row);
+				++failures;
+				break;
+			}
+		}
+	}
+	return failures;
+}
+
+int main()
+{
+	int failures = check_decoder(8);
+	failures += check_decoder(16);
+
+	if(failures == 0)
+		printf("the DXT1 and DXT5 blocks decode as the reference\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The SSE2, AVX2 and AVX-512 execution paths must produce bit-identical tiles:
+// tiles cached or compiled on one processor are read back on any other.
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <vector>
+#include "ZunTzuLib.h"
+#include "dxt_kernels.h"
+
+unsigned int __fastcall set_mxcsr();
+void __fastcall restore_mxcsr(unsigned int mxcsr);
+
+static unsigned int random_state = 0x2545f491;
+
+static unsigned int next_random()
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+// noise, gradients, few colors, a single color and transparent areas: the kernels take different branches
+static void fill_tile(std::vector<char> & tile, unsigned int texel_size, unsigned int kind)
+{
+	const unsigned int base = next_random();
+	for(unsigned int y = 0; y < 256; ++y) {
+		for(unsigned int x = 0; x < 256; ++x) {
+			char * texel = &tile[(y * 256 + x) * texel_size];
+			for(unsigned int c = 0; c < texel_size; ++c) {
+				unsigned int value;
+				switch(kind) {
+					case 0: value = next_random(); break;
+					case 1: value = (base >> (8 * c)) + x * (c + 1) + y * (3 - c); break;
+					case 2: value = ((next_random() & 3) == 0 ? base >> (8 * c) : base >> (8 * c + 3)); break;
+					case 3: value = base >> (8 * c); break;
+					default: value = (c == 3 ? ((x / 16 + y / 16) & 1 ? 0xff : 0x00) : (base >> (8 * c)) + ((x ^ y) & 0x3f)); break;
+				}
+				texel[c] = (char) value;
+			}
+		}
+	}
+}
+
+// exported entry points
+enum ENTRY_POINT { DXT1, DXT1_FROM_RGBA, DXT5 };
+
+static std::vector<char> compress(const std::vector<char> & tile, ENTRY_POINT entry_point, int option)
+{
+	std::vector<char> blocks(64 * 64 * 16);
+	switch(entry_point) {
+		case DXT1: CompressDxt1(tile.data(), 0, 0, 256, 256, 256 * 3, blocks.data(), option); break;
+		case DXT1_FROM_RGBA: CompressDxt1FromRgba(tile.data(), 0, 0, 256, 256, 256 * 4, blocks.data(), option); break;
+		case DXT5: CompressDxt5(tile.data(), 0, 0, 256, 256, 256 * 4, blocks.data(), option); break;
+	}
+	return blocks;
+}
+
+int main()
+{
+	const int widest_path = SetDxtKernelPath(DXT_KERNEL_PATH_AUTO);
+	printf("widest DXT kernel path: %d\n", widest_path);
+	int failures = 0;
+
+	// whole tiles, with every SIMD option (2: fast, 3: quality, 6 and 7: cluster fit)
+	static const int OPTIONS[] = { 2, 3, 6, 7 };
+	for(unsigned int kind = 0; kind < 5; ++kind) {
+		for(int entry_point = DXT1; entry_point <= DXT5; ++entry_point) {
+			const unsigned int texel_size = (entry_point == DXT1 ? 3 : 4);
+			std::vector<char> tile(256 * 256 * texel_size);
+			fill_tile(tile, texel_size, kind);
+			for(size_t i = 0; i < sizeof(OPTIONS) / sizeof(OPTIONS[0]); ++i) {
+				const int option = OPTIONS[i];
+				SetDxtKernelPath(DXT_KERNEL_PATH_SSE2);
+				const std::vector<char> expected = compress(tile, (ENTRY_POINT) entry_point, option);
+
+				// cluster fit implies FAVOR_QUALITY, on the float path too (4 as 5)
+				if((option & 4) != 0 && (option & 1) == 0 && (
+					compress(tile, (ENTRY_POINT) entry_point, option) != compress(tile, (ENTRY_POINT) entry_point, option | 1) ||
+					compress(tile, (ENTRY_POINT) entry_point, option & ~2) != compress(tile, (ENTRY_POINT) entry_point, (option & ~2) | 1)))
+				{
+					printf("FAILED: tile kind %u, entry point %d, option %d differs from option %d\n", kind, entry_point, option, option | 1);
+					++failures;
+				}
+				for(int path = DXT_KERNEL_PATH_AVX2; path <= widest_path; ++path) {
+					SetDxtKernelPath(path);
+					if(compress(tile, (ENTRY_POINT) entry_point, option) != expected) {
+						printf("FAILED: tile kind %u, entry point %d, option %d, path %d differs from SSE2\n", kind, entry_point, option, path);
+						++failures;
+					}
+				}
+			}
+		}
+	}
+
+	// many more blocks straight through the kernels that have wide versions
+	static const struct {
+		const char * name;
+		dxt_blocks_kernel paths[3];	// SSE2, AVX2, AVX-512
+	} WIDE_KERNELS[] = {
+		{ "fast DXT1", { encodeDxt1Blocks_fast_simd, encodeDxt1Blocks_fast_avx2, encodeDxt1Blocks_fast_avx512 } },
+		{ "quality DXT1", { encodeDxt1Blocks_quality_simd, encodeDxt1Blocks_quality_avx2, encodeDxt1Blocks_quality_avx512 } },
+		{ "DXT5 alpha", { encodeDxt5AlphaBlocks_simd, encodeDxt5AlphaBlocks_avx2, encodeDxt5AlphaBlocks_avx2 } }
+	};
+	const size_t block_count = 64 * 1024;
+	std::vector<unsigned char> rgba(block_count * 64);
+	for(size_t i = 0; i < block_count; ++i) {
+		const unsigned int kind = i % 4;
+		const unsigned int alpha_kind = (i / 4) % 4;	// opaque, noise, 0 and 255 among others (6 alphas mode), narrow range
+		const unsigned int base = next_random();
+		for(unsigned int t = 0; t < 64; ++t) {
+			const unsigned int c = t & 3;
+			rgba[i * 64 + t] = (unsigned char) (
+				c == 3 ? (
+					alpha_kind == 0 ? 0xff :
+					alpha_kind == 1 ? next_random() :
+					alpha_kind == 2 ? ((next_random() & 3) == 0 ? 0 : (next_random() & 3) == 0 ? 0xff : next_random()) :
+					(base >> 24) + (next_random() & 7)) :
+				kind == 0 ? next_random() :
+				kind == 1 ? (base >> (8 * c)) + (t / 4) * (next_random() & 7) :
+				kind == 2 ? ((next_random() & 1) ? base >> (8 * c) : base >> (8 * c + 2)) :
+				(base >> (8 * c)) + (next_random() & 1));
+		}
+	}
+	const unsigned int mxcsr = set_mxcsr();	// as in CompressDxt1
+	for(size_t k = 0; k < sizeof(WIDE_KERNELS) / sizeof(WIDE_KERNELS[0]); ++k) {
+		std::vector<unsigned char> expected(block_count * 8);
+		WIDE_KERNELS[k].paths[DXT_KERNEL_PATH_SSE2](rgba.data(), expected.data(), 8, block_count);
+		for(int path = DXT_KERNEL_PATH_AVX2; path <= widest_path; ++path) {
+			std::vector<unsigned char> blocks(block_count * 8);
+			WIDE_KERNELS[k].paths[path](rgba.data(), blocks.data(), 8, block_count);
+			size_t mismatches = 0;
+			for(size_t i = 0; i < block_count; ++i)
+				mismatches += (0 != memcmp(&blocks[i * 8], &expected[i * 8], 8));
+			if(mismatches > 0) {
+				printf("FAILED: %zu of %zu blocks of the %s kernel differ between path %d and SSE2\n", mismatches, block_count, WIDE_KERNELS[k].name, path);
+				++failures;
+			}
+		}
+	}
+
+	restore_mxcsr(mxcsr);
+
+	SetDxtKernelPath(DXT_KERNEL_PATH_AUTO);
+	if(failures == 0)
+		printf("all execution paths are bit-identical\n");
+	return failures == 0 ? 0 : 1;
+}
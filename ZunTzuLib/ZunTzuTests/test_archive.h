@@ -0,0 +1,124 @@
+#pragma once
+
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// Zip archives of generated PNG images, for the tests of the image loaders.
+// The entries are stored (not deflated), as most images of the game boxes.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <png.h>
+#include <zlib.h>
+
+struct test_entry {
+	std::string name;
+	std::vector<unsigned char> data;
+};
+
+static void append_png_data(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	std::vector<unsigned char> * png = static_cast<std::vector<unsigned char> *>(png_get_io_ptr(png_ptr));
+	png->insert(png->end(), data, data + length);
+}
+
+// an RGB image with gradients and noise (no uniform tiles), the seed makes images and masks differ
+static test_entry make_png_entry(const char * name, unsigned int width, unsigned int height, unsigned int seed)
+{
+	test_entry entry;
+	entry.name = name;
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	png_set_write_fn(png_ptr, &entry.data, append_png_data, nullptr);
+	png_set_compression_level(png_ptr, 1);
+	png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+	std::vector<unsigned char> scanline(width * 3);
+	unsigned int noise = seed * 2654435761u + 1;
+	for(unsigned int y = 0; y < height; ++y) {
+		for(unsigned int x = 0; x < width; ++x) {
+			noise = noise * 1103515245u + 12345u;
+			scanline[3 * x + 0] = (unsigned char) (x + seed);
+			scanline[3 * x + 1] = (unsigned char) (y * 3);
+			scanline[3 * x + 2] = (unsigned char) (noise >> 24);
+		}
+		png_write_row(png_ptr, scanline.data());
+	}
+	png_write_end(png_ptr, nullptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	return entry;
+}
+
+static void put_16(std::vector<unsigned char> & zip, unsigned int value)
+{
+	zip.push_back((unsigned char) value);
+	zip.push_back((unsigned char) (value >> 8));
+}
+
+static void put_32(std::vector<unsigned char> & zip, unsigned int value)
+{
+	put_16(zip, value & 0xffff);
+	put_16(zip, value >> 16);
+}
+
+// returns false if the archive cannot be written
+static bool write_test_archive(const char * file_name, const std::vector<test_entry> & entries)
+{
+	std::vector<unsigned char> zip;
+	std::vector<unsigned char> central_directory;
+	for(size_t i = 0; i < entries.size(); ++i) {
+		const test_entry & entry = entries[i];
+		const unsigned int crc = (unsigned int) crc32(0, entry.data.data(), (uInt) entry.data.size());
+		const unsigned int offset = (unsigned int) zip.size();
+
+		put_32(zip, 0x04034b50);	// local file header
+		put_16(zip, 10);	// version needed
+		put_16(zip, 0);	// flags
+		put_16(zip, 0);	// stored
+		put_32(zip, 0);	// time and date
+		put_32(zip, crc);
+		put_32(zip, (unsigned int) entry.data.size());
+		put_32(zip, (unsigned int) entry.data.size());
+		put_16(zip, (unsigned int) entry.name.size());
+		put_16(zip, 0);	// extra field
+		zip.insert(zip.end(), entry.name.begin(), entry.name.end());
+		zip.insert(zip.end(), entry.data.begin(), entry.data.end());
+
+		put_32(central_directory, 0x02014b50);	// central file header
+		put_16(central_directory, 20);	// version made by
+		put_16(central_directory, 10);	// version needed
+		put_16(central_directory, 0);	// flags
+		put_16(central_directory, 0);	// stored
+		put_32(central_directory, 0);	// time and date
+		put_32(central_directory, crc);
+		put_32(central_directory, (unsigned int) entry.data.size());
+		put_32(central_directory, (unsigned int) entry.data.size());
+		put_16(central_directory, (unsigned int) entry.name.size());
+		put_16(central_directory, 0);	// extra field
+		put_16(central_directory, 0);	// comment
+		put_16(central_directory, 0);	// disk number
+		put_16(central_directory, 0);	// internal attributes
+		put_32(central_directory, 0);	// external attributes
+		put_32(central_directory, offset);
+		central_directory.insert(central_directory.end(), entry.name.begin(), entry.name.end());
+	}
+	const unsigned int central_directory_offset = (unsigned int) zip.size();
+	zip.insert(zip.end(), central_directory.begin(), central_directory.end());
+	put_32(zip, 0x06054b50);	// end of central directory
+	put_16(zip, 0);
+	put_16(zip, 0);
+	put_16(zip, (unsigned int) entries.size());
+	put_16(zip, (unsigned int) entries.size());
+	put_32(zip, (unsigned int) central_directory.size());
+	put_32(zip, central_directory_offset);
+	put_16(zip, 0);	// comment
+
+	FILE * file = fopen(file_name, "wb");
+	if(file == 0)
+		return false;
+	const bool written = (fwrite(zip.data(), 1, zip.size(), file) == zip.size());
+	return fclose(file) == 0 && written;
+}
@@ -0,0 +1,131 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// Stress test of the ring of tile slots: producers and consumers contending for a few slots
+// must hand over every tile once, intact, in FIFO order, and must all wake up when stopped.
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "synchronized_tile_buffer.h"
+
+static const size_t TEXELS_SIZE = 64;
+
+// producer_count threads write tile_count tiles, consumer_count threads read them, then stop the producers
+static int check_handover(unsigned int slot_count, unsigned int producer_count, unsigned int consumer_count, unsigned int tile_count)
+{
+	synchronized_tile_buffer buffer(slot_count, TEXELS_SIZE);
+	std::atomic<unsigned int> next_tile(0);
+	std::atomic<unsigned int> read_tile_count(0);
+	std::atomic<int> errors(0);
+	std::vector<std::atomic<unsigned char>> read_counts(tile_count);
+	for(unsigned int i = 0; i < tile_count; ++i)
+		read_counts[i].store(0);
+
+	std::vector<std::thread> threads;
+	for(unsigned int p = 0; p < producer_count; ++p) {
+		threads.emplace_back([&]() {
+			for(unsigned int tile = next_tile.fetch_add(1); tile < tile_count; tile = next_tile.fetch_add(1)) {
+				unsigned int index;
+				if(!buffer.allocate_write_slot(index)) {
+					++errors;	// stopped before all the tiles were read
+					return;
+				}
+				tile_slot * slot = buffer.get_slot(index);
+				slot->x = tile;
+				memset(slot->texels, (int) (tile & 0xff), TEXELS_SIZE);
+				buffer.free_write_slot(index);
+			}
+		});
+	}
+	for(unsigned int c = 0; c < consumer_count; ++c) {
+		threads.emplace_back([&]() {
+			unsigned int previous_tile = 0;
+			for(bool first = true; ; first = false) {
+				unsigned int index;
+				if(buffer.allocate_read_slot(index) != 0)
+					return;
+				const tile_slot * slot = buffer.get_slot(index);
+				const unsigned int tile = slot->x;
+				for(size_t i = 0; i < TEXELS_SIZE; ++i) {
+					if((unsigned char) slot->texels[i] != (tile & 0xff)) {
+						++errors;	// overwritten while being read
+						break;
+					}
+				}
+				// with a single producer and a single consumer, tiles are read in the order they are written
+				if(producer_count == 1 && consumer_count == 1 && !first && tile != previous_tile + 1)
+					++errors;
+				previous_tile = tile;
+				buffer.free_read_slot(index);
+				if(tile >= tile_count || read_counts[tile].fetch_add(1) != 0)
+					++errors;
+				if(read_tile_count.fetch_add(1) + 1 == tile_count)
+					buffer.stop_producer();
+			}
+		});
+	}
+	for(size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	if(errors.load() != 0 || read_tile_count.load() != tile_count) {
+		printf("FAILED: %u slots, %u producers, %u consumers: %u of %u tiles read, %d errors\n",
+			slot_count, producer_count, consumer_count, read_tile_count.load(), tile_count, errors.load());
+		return 1;
+	}
+	return 0;
+}
+
+// threads sleeping on a full or empty ring must wake up when stopped
+static int check_stops()
+{
+	int failures = 0;
+	{
+		synchronized_tile_buffer buffer(2, TEXELS_SIZE);
+		unsigned int index;
+		buffer.allocate_write_slot(index);
+		buffer.allocate_write_slot(index);
+		bool allocated = true;
+		std::thread producer([&]() { unsigned int i; allocated = buffer.allocate_write_slot(i); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		buffer.stop_producer();
+		producer.join();
+		if(allocated) {
+			printf("FAILED: a producer waiting for a slot is not stopped\n");
+			++failures;
+		}
+	}
+	{
+		synchronized_tile_buffer buffer(2, TEXELS_SIZE);
+		error_code error = 0;
+		std::thread consumer([&]() { unsigned int i; error = buffer.allocate_read_slot(i); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		buffer.stop_consumer(42);
+		consumer.join();
+		if(error != 42) {
+			printf("FAILED: a consumer waiting for a tile gets error %d instead of 42\n", error);
+			++failures;
+		}
+	}
+	return failures;
+}
+
+int main()
+{
+	static const unsigned int SLOT_COUNTS[] = { 1, 3, 9 };
+	static const unsigned int THREAD_COUNTS[][2] = { { 1, 1 }, { 1, 4 }, { 4, 1 }, { 4, 6 }, { 8, 8 } };
+	int failures = 0;
+	for(size_t s = 0; s < sizeof(SLOT_COUNTS) / sizeof(SLOT_COUNTS[0]); ++s) {
+		for(size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); ++t)
+			failures += check_handover(SLOT_COUNTS[s], THREAD_COUNTS[t][0], THREAD_COUNTS[t][1], 20000);
+	}
+	failures += check_stops();
+
+	if(failures == 0)
+		printf("all the tiles are handed over once\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The tile cache must stay within its maximum size by evicting the least recently used tile sets,
+// and the tiles of a modified image must replace the stale ones rather than add up.
+
+#include "stdafx.h"
+#include <dirent.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include "ZunTzuLib.h"
+#include "ztt_file.h"
+#include "tile_cache.h"
+#include "test_archive.h"
+
+static const char * const ARCHIVE_NAME = "tile_cache_test.zip";
+static const wchar_t * const WIDE_ARCHIVE_NAME = L"tile_cache_test.zip";
+static const char * const CACHE_DIRECTORY = "tile_cache_test_cache";
+static const wchar_t * const WIDE_CACHE_DIRECTORY = L"tile_cache_test_cache";
+static const unsigned int IMAGE_COUNT = 4;
+static const unsigned int WIDTH = 509;
+static const unsigned int HEIGHT = 300;
+
+static std::string get_entry_name(unsigned int image)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "image_%u.png", image);
+	return name;
+}
+
+static bool write_archive(const unsigned int (&seeds)[IMAGE_COUNT])
+{
+	std::vector<test_entry> entries;
+	for(unsigned int image = 0; image < IMAGE_COUNT; ++image)
+		entries.push_back(make_png_entry(get_entry_name(image).c_str(), WIDTH, HEIGHT, seeds[image]));
+
+	// replaced as a whole, the loaders of the previous archive may still have it mapped
+	return write_test_archive("tile_cache_test.tmp", entries) && 0 == rename("tile_cache_test.tmp", ARCHIVE_NAME);
+}
+
+// loads all the tiles of an image, as ZunTzu does: the dimensions first, then the tiles
+static int load_image(unsigned int image)
+{
+	ztt_index index;
+	index.init(WIDTH, HEIGHT, 0, false, 0, 0);
+	void * loader = CreateImageLoader(WIDE_ARCHIVE_NAME, get_entry_name(image).c_str(), "", 0, 0);
+	unsigned int width, height;
+	int error = GetImageDimensions(loader, &width, &height);
+	std::vector<char> tile(64 * 64 * 8);
+	for(unsigned int i = 0; error == 0 && i < index.header.tile_count; ++i) {
+		unsigned int mipmap_level, x, y;
+		error = LoadNextTile(loader, tile.data(), &mipmap_level, &x, &y);
+	}
+	FreeImageLoader(loader);
+	if(error != 0)
+		printf("FAILED: image %u cannot be loaded (error %d)\n", image, error);
+
+	// the last write times order the tile sets, some file systems only update them every few milliseconds
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	return error == 0 ? 0 : 1;
+}
+
+static bool is_cached(unsigned int image)
+{
+	const int options = (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? 2 : 0);	// as CreateImageLoader
+	tile_cache_key key(WIDE_ARCHIVE_NAME, get_entry_name(image).c_str(), "", 0, options);
+	ztt_mapped_file * cached = key.open_cached_tiles();
+	delete cached;
+	return cached != 0;
+}
+
+// number and total size of the tile sets in the cache directory
+static unsigned int count_tile_sets(unsigned long long & total_size)
+{
+	unsigned int count = 0;
+	total_size = 0;
+	DIR * directory = opendir(CACHE_DIRECTORY);
+	if(directory == 0)
+		return 0;
+	while(dirent * entry = readdir(directory)) {
+		const std::string name = entry->d_name;
+		if(name.size() > 4 && name.compare(name.size() - 4, 4, ".ztt") == 0) {
+			FILE * file = fopen((std::string(CACHE_DIRECTORY) + "/" + name).c_str(), "rb");
+			if(file != 0) {
+				fseek(file, 0, SEEK_END);
+				total_size += (unsigned long long) ftell(file);
+				fclose(file);
+				++count;
+			}
+		}
+	}
+	closedir(directory);
+	return count;
+}
+
+static int check_cached_images(const char * step, const bool (&expected)[IMAGE_COUNT])
+{
+	int failures = 0;
+	for(unsigned int image = 0; image < IMAGE_COUNT; ++image) {
+		if(is_cached(image) != expected[image]) {
+			printf("FAILED: %s, image %u is %s\n", step, image, expected[image] ? "not cached" : "still cached");
+			++failures;
+		}
+	}
+	return failures;
+}
+
+// the tiles cached by a previous run would change the order of the evictions
+static void empty_directory(const char * directory_name)
+{
+	DIR * directory = opendir(directory_name);
+	if(directory == 0)
+		return;
+	while(dirent * entry = readdir(directory)) {
+		if(entry->d_name[0] != '.')
+			unlink((std::string(directory_name) + "/" + entry->d_name).c_str());
+	}
+	closedir(directory);
+}
+
+int main()
+{
+	unsigned int seeds[IMAGE_COUNT] = { 1, 2, 3, 4 };
+	if(!write_archive(seeds)) {
+		printf("FAILED: cannot write %s\n", ARCHIVE_NAME);
+		return 1;
+	}
+	empty_directory(CACHE_DIRECTORY);
+	SetTileCacheDirectory(WIDE_CACHE_DIRECTORY);
+	SetTileCacheMaxSize(0);
+
+	// the size of a tile set, all images have the same size
+	int failures = load_image(0);
+	unsigned long long tile_set_size;
+	if(count_tile_sets(tile_set_size) != 1) {
+		printf("FAILED: the tiles of image 0 are not cached\n");
+		return 1;
+	}
+
+	// room for two tile sets and a half: the least recently used one is evicted
+	SetTileCacheMaxSize(tile_set_size * 5 / 2);
+	failures += load_image(1);
+	failures += load_image(2);
+	const bool after_2[IMAGE_COUNT] = { false, true, true, false };
+	failures += check_cached_images("once image 2 is loaded", after_2);
+
+	// image 1, read from the cache, becomes more recent than image 2
+	failures += load_image(1);
+	failures += load_image(3);
+	const bool after_3[IMAGE_COUNT] = { false, true, false, true };
+	failures += check_cached_images("once image 3 is loaded", after_3);
+
+	unsigned long long total_size;
+	unsigned int count = count_tile_sets(total_size);
+	if(count != 2 || total_size > tile_set_size * 5 / 2) {
+		printf("FAILED: %u tile sets (%llu bytes) are cached, for a maximum of %llu bytes\n", count, total_size, tile_set_size * 5 / 2);
+		++failures;
+	}
+
+	// a modified image replaces its stale tiles, even with room left for them in the cache
+	SetTileCacheMaxSize(0);
+	seeds[3] = 5;
+	if(!write_archive(seeds)) {
+		printf("FAILED: cannot write %s\n", ARCHIVE_NAME);
+		return 1;
+	}
+	failures += load_image(3);
+	failures += check_cached_images("once image 3 is modified", after_3);
+	count = count_tile_sets(total_size);
+	if(count != 2) {
+		printf("FAILED: %u tile sets are cached once image 3 is modified, instead of 2\n", count);
+		++failures;
+	}
+
+	SetTileCacheDirectory(0);
+	if(failures == 0)
+		printf("the tile cache keeps the most recently used tiles within its maximum size\n");
+	return failures == 0 ? 0 : 1;
+}
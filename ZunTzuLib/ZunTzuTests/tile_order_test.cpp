@@ -0,0 +1,117 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The image loaders must yield the coarsest mipmap levels first, so that the whole image shows early,
+// and the tiles of the area given to PrioritizeTiles ahead of the other tiles of their level.
+
+#include "stdafx.h"
+#include <tuple>
+#include "ZunTzuLib.h"
+#include "ztt_file.h"
+#include "test_archive.h"
+
+static const char * const ARCHIVE_NAME = "tile_order_test.zip";
+static const wchar_t * const WIDE_ARCHIVE_NAME = L"tile_order_test.zip";
+static const unsigned int WIDTH = 1000;	// 4 x 3 tiles, all the bands of the first mipmap level fit in memory
+static const unsigned int HEIGHT = 700;
+
+// inside tile (1, 1) of the first mipmap level
+static const unsigned int PRIORITY_LEFT = 300;
+static const unsigned int PRIORITY_TOP = 300;
+static const unsigned int PRIORITY_RIGHT = 400;
+static const unsigned int PRIORITY_BOTTOM = 400;
+
+typedef std::tuple<unsigned int, unsigned int, unsigned int> tile_location;	// mipmap level, x, y
+
+// whether the row of the tile crosses the area, and the tile itself
+static bool is_in_priority_area(const tile_location & tile, bool & in_priority_rows)
+{
+	const unsigned int mipmap_level = std::get<0>(tile);
+	const unsigned int texel_x = (std::get<1>(tile) * 254) << mipmap_level;
+	const unsigned int texel_y = (std::get<2>(tile) * 254) << mipmap_level;
+	const unsigned int tile_size = 254 << mipmap_level;
+	in_priority_rows = (texel_y < PRIORITY_BOTTOM && texel_y + tile_size > PRIORITY_TOP);
+	return in_priority_rows && texel_x < PRIORITY_RIGHT && texel_x + tile_size > PRIORITY_LEFT;
+}
+
+// the tiles in the order they are yielded, as ZunTzu loads them: the dimensions first, then the tiles
+static bool load_tiles(bool masked, bool prioritized, std::vector<tile_location> & tiles)
+{
+	ztt_index index;
+	index.init(WIDTH, HEIGHT, 0, masked, 0, 0);
+	void * loader = CreateImageLoader(WIDE_ARCHIVE_NAME, "image.png", masked ? "mask.png" : "", 0, 0);
+	if(prioritized)
+		PrioritizeTiles(loader, 0, PRIORITY_LEFT, PRIORITY_TOP, PRIORITY_RIGHT, PRIORITY_BOTTOM);
+	unsigned int width, height;
+	int error = GetImageDimensions(loader, &width, &height);
+	std::vector<char> tile(64 * 64 * 16);
+	for(unsigned int i = 0; error == 0 && i < index.header.tile_count; ++i) {
+		unsigned int mipmap_level, x, y;
+		error = LoadNextTile(loader, tile.data(), &mipmap_level, &x, &y);
+		tiles.push_back(std::make_tuple(mipmap_level, x, y));
+	}
+	FreeImageLoader(loader);
+	if(error != 0)
+		printf("FAILED: the image%s cannot be loaded (error %d)\n", masked ? " (masked)" : "", error);
+	return error == 0;
+}
+
+static int check_coarsest_levels_first(bool masked)
+{
+	std::vector<tile_location> tiles;
+	if(!load_tiles(masked, false, tiles))
+		return 1;
+	for(size_t i = 1; i < tiles.size(); ++i) {
+		if(std::get<0>(tiles[i]) > std::get<0>(tiles[i - 1])) {
+			printf("FAILED: the image%s yields tile (%u, %u, %u) after a tile of mipmap level %u\n", masked ? " (masked)" : "",
+				std::get<0>(tiles[i]), std::get<1>(tiles[i]), std::get<2>(tiles[i]), std::get<0>(tiles[i - 1]));
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int check_priority_area_first(bool masked)
+{
+	std::vector<tile_location> tiles;
+	if(!load_tiles(masked, true, tiles))
+		return 1;
+
+	// the tiles of the area come first at all levels, even before the coarser tiles out of the area (their rows are yielded meanwhile)
+	bool other_tile_yielded = false;
+	for(size_t i = 0; i < tiles.size(); ++i) {
+		bool in_priority_rows;
+		if(!is_in_priority_area(tiles[i], in_priority_rows)) {
+			if(!in_priority_rows)
+				other_tile_yielded = true;
+		} else if(other_tile_yielded) {
+			printf("FAILED: the prioritized image%s yields tile (%u, %u, %u) after tiles out of the area\n", masked ? " (masked)" : "",
+				std::get<0>(tiles[i]), std::get<1>(tiles[i]), std::get<2>(tiles[i]));
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main()
+{
+	std::vector<test_entry> entries;
+	entries.push_back(make_png_entry("image.png", WIDTH, HEIGHT, 1));
+	entries.push_back(make_png_entry("mask.png", WIDTH, HEIGHT, 2));
+	if(!write_test_archive(ARCHIVE_NAME, entries)) {
+		printf("FAILED: cannot write %s\n", ARCHIVE_NAME);
+		return 1;
+	}
+
+	int failures = 0;
+	for(int masked = 0; masked < 2; ++masked) {
+		failures += check_coarsest_levels_first(masked != 0);
+		failures += check_priority_area_first(masked != 0);
+	}
+
+	if(failures == 0)
+		printf("the coarsest mipmap levels and the priority area are yielded first\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// The index of a tile set (ztt_index::init) must describe exactly the tiles yielded by the loaders:
+// CompileTileSet, the tile cache and the batch loader count on it to know when an image is complete.
+// A tile set precompiled in the archive must only replace the images it fits.
+
+#include "stdafx.h"
+#include <dirent.h>
+#include <unistd.h>
+#include <set>
+#include <tuple>
+#include "ZunTzuLib.h"
+#include "ztt_file.h"
+#include "tile_cache.h"
+#include "test_archive.h"
+
+static const char * const ARCHIVE_NAME = "ztt_index_test.zip";
+static const wchar_t * const WIDE_ARCHIVE_NAME = L"ztt_index_test.zip";
+static const char * const TILE_SET_ARCHIVE_NAME = "ztt_index_test_tile_set.zip";	// with a precompiled tile set
+static const wchar_t * const WIDE_TILE_SET_ARCHIVE_NAME = L"ztt_index_test_tile_set.zip";
+static const char * const SKIPPED_TILE_SET_ARCHIVE_NAME = "ztt_index_test_skipped.zip";	// with a tile set that lacks the first mipmap level
+static const wchar_t * const WIDE_SKIPPED_TILE_SET_ARCHIVE_NAME = L"ztt_index_test_skipped.zip";
+
+// sizes around the 254 texel steps of the tiles, at the first or at a lower mipmap level
+static const unsigned int SIZES[][2] = {
+	{ 255, 255 }, { 508, 508 }, { 509, 509 }, { 510, 510 }, { 509, 300 }, { 300, 510 }, { 763, 200 }, { 1018, 1018 }
+};
+static const size_t SIZE_COUNT = sizeof(SIZES) / sizeof(SIZES[0]);
+
+static std::string get_entry_name(size_t size, bool mask)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "%ux%u%s.png", SIZES[size][0], SIZES[size][1], mask ? "_mask" : "");
+	return name;
+}
+
+// loads all the tiles of the index, each one must be inside its level and yielded once
+static int check_loaded_tiles(const wchar_t * archive_name, size_t size, bool masked, unsigned int skipped_mipmap_levels, const ztt_mapped_file * expected_tiles = 0)
+{
+	const std::string image = get_entry_name(size, false);
+	const std::string mask = (masked ? get_entry_name(size, true) : std::string());
+	ztt_index index;
+	index.init(SIZES[size][0], SIZES[size][1], skipped_mipmap_levels, masked, 0, 0);
+
+	// as ZunTzu: the dimensions first, then the tiles
+	void * loader = CreateImageLoader(archive_name, image.c_str(), mask.c_str(), skipped_mipmap_levels, 0);
+	unsigned int width, height;
+	int error = GetImageDimensions(loader, &width, &height);
+	std::vector<char> tile(64 * 64 * 16);
+	std::set<std::tuple<unsigned int, unsigned int, unsigned int>> loaded;
+	for(unsigned int i = 0; error == 0 && i < index.header.tile_count; ++i) {
+		unsigned int mipmap_level, x, y;
+		error = LoadNextTile(loader, tile.data(), &mipmap_level, &x, &y);
+		if(error == 0 && (mipmap_level >= index.header.mipmap_level_count ||
+			x >= index.levels[mipmap_level].column_count || y >= index.levels[mipmap_level].row_count ||
+			!loaded.insert(std::make_tuple(mipmap_level, x, y)).second))
+		{
+			printf("FAILED: %s%s yields the unexpected tile (%u, %u, %u)\n", image.c_str(), masked ? " (masked)" : "", mipmap_level, x, y);
+			error = -1;
+		} else if(error == 0 && expected_tiles != 0 && 0 != memcmp(tile.data(), expected_tiles->get_tile(mipmap_level, x, y), index.header.tile_size)) {
+			printf("FAILED: %s%s is not read from its tile set\n", image.c_str(), masked ? " (masked)" : "");
+			error = -1;
+		}
+	}
+	FreeImageLoader(loader);
+	if(error > 0)
+		printf("FAILED: %s%s cannot be loaded (error %d)\n", image.c_str(), masked ? " (masked)" : "", error);
+	return error == 0 ? 0 : 1;
+}
+
+// corrupted or crafted indices must not pass, their tiles would be read outside of the file
+static int check_index_validation()
+{
+	int failures = 0;
+	ztt_index index;
+	index.init(509, 509, 1, true, 0, 100);
+	if(!index.is_consistent()) {
+		printf("FAILED: a new index is not consistent\n");
+		++failures;
+	}
+
+	// levels that are consistent with each other but not with the dimensions of the image
+	ztt_index resized = index;
+	resized.header.width = 2000;
+	ztt_index grown = index;
+	grown.levels[1].column_count += 1;
+	for(unsigned int i = 2; i < grown.header.mipmap_level_count; ++i)
+		grown.levels[i].first_tile += grown.levels[1].row_count;
+	grown.header.tile_count += grown.levels[1].row_count;
+	ztt_index shifted = index;
+	shifted.levels[2].first_tile += 1;
+
+	// tile counts wrapping around 32 bits
+	ztt_index huge;
+	huge.init(65535 * 254, 65535 * 254, 0, false, 0, 0);
+
+	// BC7 tiles have a format of their own, for masked images only
+	ztt_index bc7;
+	bc7.init(509, 509, 1, true, 8, 100);
+	if(bc7.header.format != 7 || !bc7.is_consistent()) {
+		printf("FAILED: a new BC7 index has format %u%s\n", bc7.header.format, bc7.is_consistent() ? "" : " and is not consistent");
+		++failures;
+	}
+	ztt_index opaque_bc7 = bc7;
+	opaque_bc7.header.tile_size = 64 * 64 * 8;
+
+	const ztt_index * const corrupted[] = { &resized, &grown, &shifted, &huge, &opaque_bc7 };
+	for(size_t i = 0; i < sizeof(corrupted) / sizeof(corrupted[0]); ++i) {
+		if(corrupted[i]->is_consistent()) {
+			printf("FAILED: corrupted index %zu is consistent\n", i);
+			++failures;
+		}
+	}
+	return failures;
+}
+
+// a tile written twice must not stand for another one, the file would be published with a hole
+static int check_duplicate_tiles()
+{
+	ztt_index index;
+	index.init(509, 509, 0, false, 0, 0);
+	ztt_writer writer;
+	if(!writer.create(L"ztt_index_test_duplicates.ztt", index, 0)) {
+		printf("FAILED: cannot create ztt_index_test_duplicates.ztt\n");
+		return 1;
+	}
+	std::vector<char> tile(index.header.tile_size);
+	int failures = 0;
+	for(unsigned int i = 0; i < index.header.tile_count; ++i)
+		writer.write_tile(0, 0, 0, tile.data());
+	if(writer.is_complete()) {
+		printf("FAILED: a tile set is complete once its first tile is written %u times\n", index.header.tile_count);
+		++failures;
+	}
+	for(unsigned int level = 0; level < index.header.mipmap_level_count; ++level) {
+		for(unsigned int y = 0; y < index.levels[level].row_count; ++y) {
+			for(unsigned int x = 0; x < index.levels[level].column_count; ++x)
+				writer.write_tile(level, x, y, tile.data());
+		}
+	}
+	if(!writer.is_complete() || !writer.close()) {
+		printf("FAILED: a tile set is not complete once all its tiles are written\n");
+		++failures;
+	}
+	delete_file(L"ztt_index_test_duplicates.ztt");
+	return failures;
+}
+
+// the tiles cached by a previous run would hide an incomplete recording
+static void empty_directory(const char * directory_name)
+{
+	DIR * directory = opendir(directory_name);
+	if(directory == 0)
+		return;
+	while(dirent * entry = readdir(directory)) {
+		if(entry->d_name[0] != '.')
+			unlink((std::string(directory_name) + "/" + entry->d_name).c_str());
+	}
+	closedir(directory);
+}
+
+int main()
+{
+	std::vector<test_entry> entries;
+	for(size_t size = 0; size < SIZE_COUNT; ++size) {
+		entries.push_back(make_png_entry(get_entry_name(size, false).c_str(), SIZES[size][0], SIZES[size][1], 1));
+		entries.push_back(make_png_entry(get_entry_name(size, true).c_str(), SIZES[size][0], SIZES[size][1], 2));
+	}
+	if(!write_test_archive(ARCHIVE_NAME, entries)) {
+		printf("FAILED: cannot write %s\n", ARCHIVE_NAME);
+		return 1;
+	}
+
+	// a loader that yields fewer tiles than indexed never returns (ctest timeout)
+	int failures = check_index_validation();
+	failures += check_duplicate_tiles();
+	for(size_t size = 0; size < SIZE_COUNT; ++size) {
+		failures += check_loaded_tiles(WIDE_ARCHIVE_NAME, size, false, 0);
+		failures += check_loaded_tiles(WIDE_ARCHIVE_NAME, size, true, 0);
+		failures += check_loaded_tiles(WIDE_ARCHIVE_NAME, size, true, 1);
+	}
+
+	// a compiled tile set is complete and consistent
+	const std::string image = get_entry_name(2, false);
+	int error = CompileTileSet(WIDE_ARCHIVE_NAME, image.c_str(), "", L"ztt_index_test.ztt");
+	ztt_mapped_file compiled;
+	if(error != 0 || !compiled.open(L"ztt_index_test.ztt")) {
+		printf("FAILED: the tile set of %s cannot be compiled (error %d)\n", image.c_str(), error);
+		++failures;
+	} else {
+		// once in the archive, the tile set replaces the image, except if mipmap levels are skipped or if the image is masked
+		FILE * file = fopen("ztt_index_test.ztt", "rb");
+		test_entry tile_set;
+		tile_set.name = image + ".ztt";
+		tile_set.data.resize((size_t) compiled.get_index().get_file_size());
+		const bool read = (file != 0 && fread(tile_set.data.data(), 1, tile_set.data.size(), file) == tile_set.data.size());
+		if(file != 0)
+			fclose(file);
+		entries.push_back(tile_set);
+		if(!read || !write_test_archive(TILE_SET_ARCHIVE_NAME, entries)) {
+			printf("FAILED: cannot write %s\n", TILE_SET_ARCHIVE_NAME);
+			return 1;
+		}
+		failures += check_loaded_tiles(WIDE_TILE_SET_ARCHIVE_NAME, 2, false, 0, &compiled);
+		failures += check_loaded_tiles(WIDE_TILE_SET_ARCHIVE_NAME, 2, false, 1);
+		failures += check_loaded_tiles(WIDE_TILE_SET_ARCHIVE_NAME, 2, true, 0);
+	}
+
+	// a consistent tile set without the first mipmap level is not used in place of the image
+	{
+		ztt_index index;
+		index.init(SIZES[2][0], SIZES[2][1], 1, false, 0, 0);
+		ztt_writer writer;
+		std::vector<char> tile(index.header.tile_size);
+		bool written = writer.create(L"ztt_index_test_skipped.ztt", index, 0);
+		for(unsigned int level = 1; written && level < index.header.mipmap_level_count; ++level) {
+			for(unsigned int y = 0; y < index.levels[level].row_count; ++y) {
+				for(unsigned int x = 0; x < index.levels[level].column_count; ++x)
+					written = written && writer.write_tile(level, x, y, tile.data());
+			}
+		}
+		test_entry tile_set;
+		tile_set.name = image + ".ztt";
+		tile_set.data.resize((size_t) index.get_file_size());
+		FILE * file = (written && writer.close() ? fopen("ztt_index_test_skipped.ztt", "rb") : 0);
+		const bool read = (file != 0 && fread(tile_set.data.data(), 1, tile_set.data.size(), file) == tile_set.data.size());
+		if(file != 0)
+			fclose(file);
+		std::vector<test_entry> skipped_entries;
+		skipped_entries.push_back(make_png_entry(image.c_str(), SIZES[2][0], SIZES[2][1], 1));
+		skipped_entries.push_back(tile_set);
+		if(!read || !write_test_archive(SKIPPED_TILE_SET_ARCHIVE_NAME, skipped_entries)) {
+			printf("FAILED: cannot write %s\n", SKIPPED_TILE_SET_ARCHIVE_NAME);
+			return 1;
+		}
+		failures += check_loaded_tiles(WIDE_SKIPPED_TILE_SET_ARCHIVE_NAME, 2, false, 0);
+	}
+
+	// so is a cached one, once all its tiles have been loaded
+	empty_directory("ztt_index_test_cache");
+	SetTileCacheDirectory(L"ztt_index_test_cache");
+	const int options = (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? 2 : 0);	// as CreateImageLoader
+	tile_cache_key key(WIDE_ARCHIVE_NAME, image.c_str(), "", 0, options);
+	failures += check_loaded_tiles(WIDE_ARCHIVE_NAME, 2, false, 0);
+	ztt_mapped_file * cached = key.open_cached_tiles();
+	if(cached == 0) {
+		printf("FAILED: the tiles of %s are not cached\n", image.c_str());
+		++failures;
+	}
+	delete cached;
+
+	// cached BC7 tiles are labeled as such
+	const std::string mask = get_entry_name(2, true);
+	tile_cache_key bc7_key(WIDE_ARCHIVE_NAME, image.c_str(), mask.c_str(), 0, options | 8);
+	void * loader = CreateImageLoader(WIDE_ARCHIVE_NAME, image.c_str(), mask.c_str(), 0, 8);
+	unsigned int width, height;
+	error = GetImageDimensions(loader, &width, &height);
+	ztt_index bc7_index;
+	bc7_index.init(width, height, 0, true, 8, 0);
+	std::vector<char> tile(bc7_index.header.tile_size);
+	for(unsigned int i = 0; error == 0 && i < bc7_index.header.tile_count; ++i) {
+		unsigned int mipmap_level, x, y;
+		error = LoadNextTile(loader, tile.data(), &mipmap_level, &x, &y);
+	}
+	FreeImageLoader(loader);
+	cached = bc7_key.open_cached_tiles();
+	if(error != 0 || cached == 0 || cached->get_index().header.format != 7) {
+		printf("FAILED: the BC7 tiles of %s are not cached as BC7 (error %d, format %u)\n", image.c_str(), error, cached != 0 ? cached->get_index().header.format : 0);
+		++failures;
+	}
+	delete cached;
+	SetTileCacheDirectory(0);
+
+	if(failures == 0)
+		printf("all the indexed tiles are yielded once\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -51,6 +51,13 @@
 #include <strings.h>
 #endif
 
+/* inflate backend of zzip_disk_fread_all: zlib (default) or libdeflate,
+ * a whole-buffer decompressor that needs neither sliding window nor
+ * streaming state (build with ZZIP_INFLATE_LIBDEFLATE) */
+#ifdef ZZIP_INFLATE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
 
 #if __STDC_VERSION__+0 > 199900L
 #define ___
@@ -379,6 +386,24 @@ zzip_disk_entry_strdup_comment(ZZIP_DISK * disk, struct zzip_disk_entry *entry)
     ____;
 }
 
+/** => zzip_disk_entry_to_data
+ * This function returns the crc32 checksum of the uncompressed data as it
+ * is recorded in the zip central directory entry. The data itself is not
+ * checked, so this is a cheap way to tell whether an entry has changed.
+ *
+ * This function returns zero on error (errno = EINVAL).
+ */
+unsigned long
+zzip_disk_entry_crc32(ZZIP_DISK * disk, struct zzip_disk_entry *entry)
+{
+    if (! disk || ! entry)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    return zzip_disk_entry_get_crc32(entry);
+}
+
 /* ====================================================================== */
 
 /** => zzip_disk_findfile
@@ -622,6 +647,220 @@ zzip_disk_findmatch(ZZIP_DISK * disk, char *filespec,
 
 /* ====================================================================== */
 
+/*
+ * The index is an open-addressing hash table (linear probing) of the
+ * entry names, hashed with FNV-1a. Names are not copied: the slots point
+ * into the mmapped central directory, so the index must be freed before
+ * the disk is unmapped. The table is doubled when it gets half full.
+ */
+
+struct zzip_disk_index_slot
+{
+    char* name;                        /* in the mmapped area, not null-terminated */
+    zzip_size_t namlen;
+    unsigned long hash;
+    struct zzip_disk_entry* entry;     /* null if the slot is free */
+};
+
+struct zzip_disk_index
+{
+    ZZIP_DISK* disk;
+    int nocase;                        /* ZZIP_DISK_FLAGS_MATCH_NOCASE at build time */
+    zzip_size_t size;                  /* number of slots, a power of 2 */
+    zzip_size_t count;                 /* number of entries */
+    struct zzip_disk_index_slot* slots;
+};
+
+#define ZZIP_DISK_INDEX_MIN_SIZE 256
+#define zzip_disk_index_fold(index, c) \
+    ((index)->nocase && (c) >= 'A' && (c) <= 'Z' ? (c) - 'A' + 'a' : (c))
+
+static unsigned long
+zzip_disk_index_hash(ZZIP_DISK_INDEX * index, char *name, zzip_size_t namlen)
+{
+    unsigned long hash = 2166136261UL;
+    zzip_size_t i;
+    for (i = 0; i < namlen; ++i)
+    {
+        hash ^= (unsigned long) zzip_disk_index_fold(index, (unsigned char) name[i]);
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+static int
+zzip_disk_index_equal(ZZIP_DISK_INDEX * index, struct zzip_disk_index_slot *slot,
+                      char *name, zzip_size_t namlen, unsigned long hash)
+{
+    zzip_size_t i;
+    if (slot->hash != hash || slot->namlen != namlen)
+        return 0;
+    for (i = 0; i < namlen; ++i)
+    {
+        if (zzip_disk_index_fold(index, (unsigned char) slot->name[i]) !=
+            zzip_disk_index_fold(index, (unsigned char) name[i]))
+            return 0;
+    }
+    return 1;
+}
+
+/* the slot holding this name, or else the free slot where it belongs */
+static struct zzip_disk_index_slot *
+zzip_disk_index_probe(ZZIP_DISK_INDEX * index, char *name, zzip_size_t namlen,
+                      unsigned long hash)
+{
+    zzip_size_t mask = index->size - 1;
+    zzip_size_t i = hash & mask;
+    while (index->slots[i].entry &&
+           ! zzip_disk_index_equal(index, &index->slots[i], name, namlen, hash))
+        i = (i + 1) & mask;
+    return &index->slots[i];
+}
+
+static int
+zzip_disk_index_grow(ZZIP_DISK_INDEX * index)
+{
+    struct zzip_disk_index_slot *old_slots = index->slots;
+    zzip_size_t old_size = index->size;
+    zzip_size_t i;
+    index->slots = calloc(2 * old_size, sizeof(struct zzip_disk_index_slot));
+    if (! index->slots)
+    {
+        index->slots = old_slots;
+        return 0; /* ENOMEM */
+    }
+    index->size = 2 * old_size;
+    for (i = 0; i < old_size; ++i)
+    {
+        if (old_slots[i].entry)
+            *zzip_disk_index_probe(index, old_slots[i].name, old_slots[i].namlen,
+                                   old_slots[i].hash) = old_slots[i];
+    }
+    free(old_slots);
+    return 1;
+}
+
+/** build a hash index of the (mmapped) zip central directory
+ *
+ * This function walks the central directory once, like zzip_disk_findfile
+ * would do for each lookup, and returns an index where entries are found
+ * by name in constant time with zzip_disk_index_find. Names are compared
+ * as with zzip_disk_findfile and a null compare function: case-insensitive
+ * if ZZIP_DISK_FLAGS_MATCH_NOCASE is set, and the first of duplicated
+ * names is found. The index refers to the mmapped area of the disk and must
+ * be released with zzip_disk_index_free.
+ *
+ * This function may return null on error. (errno = ENOMEM|EBADMSG)
+ */
+zzip__new__ ZZIP_DISK_INDEX *
+zzip_disk_index_build(ZZIP_DISK * disk)
+{
+    ZZIP_DISK_INDEX *index;
+    struct zzip_disk_entry *entry;
+    if (! disk)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    index = malloc(sizeof(ZZIP_DISK_INDEX));
+    if (! index)
+        return 0; /* ENOMEM */
+    index->disk = disk;
+    index->nocase = (disk->flags & ZZIP_DISK_FLAGS_MATCH_NOCASE) != 0;
+    index->size = ZZIP_DISK_INDEX_MIN_SIZE;
+    index->count = 0;
+    index->slots = calloc(index->size, sizeof(struct zzip_disk_index_slot));
+    if (! index->slots)
+    {
+        free(index);
+        return 0; /* ENOMEM */
+    }
+
+    for (entry = zzip_disk_findfirst(disk); entry;
+         entry = zzip_disk_findnext(disk, entry))
+    {
+        /* same name as zzip_disk_entry_strdup_name, without the copy */
+        char *name;
+        zzip_size_t namlen = zzip_disk_entry_namlen(entry);
+        if (namlen)
+        {
+            name = zzip_disk_entry_to_filename(entry);
+        } else
+        {
+            struct zzip_file_header *file = zzip_disk_entry_to_file_header(disk, entry);
+            if (! file)
+                goto error; /* EBADMSG */
+            namlen = zzip_file_header_namlen(file);
+            name = zzip_file_header_to_filename(file);
+        }
+        if ((zzip_byte_t *) name < disk->buffer ||
+            (zzip_byte_t *) name + namlen > disk->endbuf)
+        {
+            errno = EBADMSG;
+            goto error;
+        }
+
+        if (2 * (index->count + 1) > index->size && ! zzip_disk_index_grow(index))
+            goto error; /* ENOMEM */
+
+        ___ unsigned long hash = zzip_disk_index_hash(index, name, namlen);
+        struct zzip_disk_index_slot *slot =
+            zzip_disk_index_probe(index, name, namlen, hash);
+        if (! slot->entry)
+        {
+            slot->name = name;
+            slot->namlen = namlen;
+            slot->hash = hash;
+            slot->entry = entry;
+            ++index->count;
+        } ____;
+    }
+    return index;
+
+  error:
+    zzip_disk_index_free(index);
+    return 0;
+}
+
+/** => zzip_disk_index_build
+ *
+ * This function returns the entry of the central directory with this
+ * name, or null if there is none. (errno = ENOENT)
+ */
+struct zzip_disk_entry *
+zzip_disk_index_find(ZZIP_DISK_INDEX * index, char *filename)
+{
+    zzip_size_t namlen;
+    unsigned long hash;
+    struct zzip_disk_index_slot *slot;
+    if (! index || ! filename)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    namlen = strlen(filename);
+    hash = zzip_disk_index_hash(index, filename, namlen);
+    slot = zzip_disk_index_probe(index, filename, namlen, hash);
+    if (! slot->entry)
+        errno = ENOENT;
+    return slot->entry;
+}
+
+/** => zzip_disk_index_build
+ *
+ * This function releases the index, not the disk.
+ */
+void
+zzip_disk_index_free(ZZIP_DISK_INDEX * index)
+{
+    if (! index)
+        return;
+    free(index->slots);
+    free(index);
+}
+
+/* ====================================================================== */
+
 /** => zzip_disk_fopen
  *
  * the ZZIP_DISK_FILE* is rather simple in just encapsulating the
@@ -766,6 +1005,72 @@ zzip_disk_fread(void *ptr, zzip_size_t sized, zzip_size_t nmemb,
     ____;
 }
 
+/** => zzip_disk_fopen
+ *
+ * This function reads a whole file into a buffer of its uncompressed
+ * size, in a single pass of the inflate backend. Unlike a series of
+ * => zzip_disk_fread the backend writes straight into the buffer, without
+ * copies into a sliding window. The file must not have been read yet.
+ *
+ * The return value is the number of bytes read, it is less than the
+ * uncompressed size if the file is corrupted.
+ */
+zzip_size_t
+zzip_disk_fread_all(void *ptr, ZZIP_DISK_FILE * file)
+{
+    if (! ptr || ! file)
+        return 0;
+    if (file->stored)
+        return zzip_disk_fread(ptr, 1, file->avail, file);
+
+    ___ zzip_size_t size = file->avail;
+    if (file->zlib.total_out != 0)
+    {
+        DBG1("file already read");
+        return 0;
+    }
+#ifdef ZZIP_INFLATE_LIBDEFLATE
+    ___ struct libdeflate_decompressor *decompressor =
+        libdeflate_alloc_decompressor();
+    size_t bytes_out = 0;
+    if (! decompressor)
+        return 0; /* ENOMEM */
+    if (libdeflate_deflate_decompress(decompressor, file->zlib.next_in,
+                                      file->zlib.avail_in, ptr, size,
+                                      &bytes_out) != LIBDEFLATE_SUCCESS)
+        bytes_out = 0;
+    libdeflate_free_decompressor(decompressor);
+    file->zlib.next_in += file->zlib.avail_in;
+    file->zlib.avail_in = 0;
+    file->zlib.total_out = bytes_out;
+    file->avail = 0;
+    return bytes_out;
+    ____;
+#else
+    file->zlib.avail_out = size;
+    file->zlib.next_out = ptr;
+    ___ int err = inflate(&file->zlib, Z_FINISH);
+    file->avail = (err == Z_STREAM_END ? 0 : size - file->zlib.total_out);
+    return file->zlib.total_out;
+    ____;
+#endif
+    ____;
+}
+
+/** => zzip_disk_fread_all
+ *
+ * This function returns the name of the inflate backend.
+ */
+const char *
+zzip_disk_inflate_backend(void)
+{
+#ifdef ZZIP_INFLATE_LIBDEFLATE
+    return "libdeflate";
+#else
+    return "zlib";
+#endif
+}
+
 /** => zzip_disk_fopen
  * This function releases any zlib decoder info needed for decompression
  * and dumps the ZZIP_DISK_FILE* then.
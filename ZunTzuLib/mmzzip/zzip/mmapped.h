@@ -87,6 +87,8 @@ zzip_disk_extern struct zzip_file_header*
 zzip_disk_entry_to_file_header(ZZIP_DISK* disk, ZZIP_DISK_ENTRY* entry);
 zzip_disk_extern zzip_byte_t*
 zzip_disk_entry_to_data(ZZIP_DISK* disk, ZZIP_DISK_ENTRY* entry);
+zzip_disk_extern unsigned long
+zzip_disk_entry_crc32(ZZIP_DISK* disk, ZZIP_DISK_ENTRY* entry);
 
 zzip_disk_extern ZZIP_DISK_ENTRY*
 zzip_disk_findfile(ZZIP_DISK* disk,
@@ -97,6 +99,16 @@ zzip_disk_findmatch(ZZIP_DISK* disk,
 		    char* filespec, ZZIP_DISK_ENTRY* after,
 		    zzip_fnmatch_fn_t compare, int flags);
 
+/* hash index of the central directory, for O(1) lookups by entry name */
+typedef struct zzip_disk_index ZZIP_DISK_INDEX;
+
+zzip_disk_extern zzip__new__ ZZIP_DISK_INDEX*
+zzip_disk_index_build(ZZIP_DISK* disk);
+zzip_disk_extern ZZIP_DISK_ENTRY*
+zzip_disk_index_find(ZZIP_DISK_INDEX* index, char* filename);
+zzip_disk_extern void
+zzip_disk_index_free(ZZIP_DISK_INDEX* index);
+
 
 zzip_disk_extern zzip__new__ ZZIP_DISK_FILE*
 zzip_disk_entry_fopen (ZZIP_DISK* disk, ZZIP_DISK_ENTRY* entry);
@@ -107,6 +119,11 @@ zzip_disk_fopen (ZZIP_DISK* disk, char* filename);
 zzip_disk_extern _zzip_size_t
 zzip_disk_fread (void* ptr, _zzip_size_t size, _zzip_size_t nmemb,
 		 ZZIP_DISK_FILE* file);
+/* the whole (unread) file at once, with the inflate backend of the build */
+zzip_disk_extern _zzip_size_t
+zzip_disk_fread_all (void* ptr, ZZIP_DISK_FILE* file);
+zzip_disk_extern const char*
+zzip_disk_inflate_backend (void);
 zzip_disk_extern int
 zzip_disk_fclose (ZZIP_DISK_FILE* file);
 int
@@ -0,0 +1,232 @@
+/* -----------------------------------------------------------------------------
+	  Copyright (c) 2006-2022 ZunTzu Software and contributors
+----------------------------------------------------------------------------- */
+
+// Inflate benchmark over game box archives.
+//
+//   zzipbench [-n repetitions] archive.zip...
+//
+// For each deflated entry, times the two ways ZunTzuLib inflates it (see simple_unzipper.cpp):
+// in chunks with zzip_disk_fread, and whole with zzip_disk_fread_all (the inflate backend of the build).
+// For each PNG entry, also times the inflating of its IDAT chunks, as libpng does it with zlib.
+// The best time of the repetitions is kept. Inflated data is checked against the CRC of the entry.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define _ZZIP_DISK_FILE_STRUCT 1
+#include "zzip/mmapped.h"
+#include "zlib.h"
+
+static const size_t INFLATING_CHUNK_SIZE = 256 * 1024;	// as in simple_unzipper.cpp
+static const size_t PNG_ROWS_SIZE = 64 * 1024;	// libpng inflates a few rows at a time
+
+static double get_time() {
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double) now.tv_sec + 1e-9 * (double) now.tv_nsec;
+#endif
+}
+
+struct timing {
+	size_t compressed_size;
+	size_t inflated_size;
+	double seconds;
+};
+
+static void add(timing & total, const timing & entry) {
+	total.compressed_size += entry.compressed_size;
+	total.inflated_size += entry.inflated_size;
+	total.seconds += entry.seconds;
+}
+
+static void print(const char * label, const timing & t) {
+	printf("  %-18s %10.2f MB -> %10.2f MB %10.2f ms %10.1f MB/s\n",
+		label,
+		t.compressed_size / 1048576.0,
+		t.inflated_size / 1048576.0,
+		1000.0 * t.seconds,
+		(t.seconds > 0.0 ? t.inflated_size / 1048576.0 / t.seconds : 0.0));
+}
+
+// inflates an entry in chunks or whole, returns false if the inflated data is corrupted
+static bool inflate_entry(ZZIP_DISK * disk, ZZIP_DISK_ENTRY * entry, bool whole, char * buffer, timing & t) {
+	ZZIP_DISK_FILE * file = zzip_disk_entry_fopen(disk, entry);
+	if(!file)
+		return false;
+	const size_t size = file->avail;
+	t.compressed_size = file->zlib.avail_in;
+	t.inflated_size = 0;
+
+	const double start = get_time();
+	if(whole) {
+		t.inflated_size = zzip_disk_fread_all(buffer, file);
+	} else {
+		while(t.inflated_size < size) {
+			const size_t bytes_to_inflate = (INFLATING_CHUNK_SIZE < size - t.inflated_size ? INFLATING_CHUNK_SIZE : size - t.inflated_size);
+			const size_t bytes_inflated = zzip_disk_fread(buffer + t.inflated_size, 1, bytes_to_inflate, file);
+			if(bytes_inflated == 0)
+				break;
+			t.inflated_size += bytes_inflated;
+		}
+	}
+	t.seconds = get_time() - start;
+	zzip_disk_fclose(file);
+
+	return t.inflated_size == size && crc32(0, reinterpret_cast<Bytef*>(buffer), (uInt) size) == zzip_disk_entry_crc32(disk, entry);
+}
+
+static unsigned int get_big_endian(const unsigned char * bytes) {
+	return ((unsigned int) bytes[0] << 24) | ((unsigned int) bytes[1] << 16) | ((unsigned int) bytes[2] << 8) | (unsigned int) bytes[3];
+}
+
+// inflates the IDAT chunks of a PNG image, returns false if it is not a PNG image or if it is corrupted
+static bool inflate_png_rows(const unsigned char * png, size_t png_size, timing & t) {
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if(png_size < 8 || memcmp(png, signature, 8) != 0)
+		return false;
+
+	// gather the IDAT chunks, as the zlib stream may be split across several of them
+	unsigned char * idat = static_cast<unsigned char*>(malloc(png_size));
+	size_t idat_size = 0;
+	for(size_t offset = 8; offset + 12 <= png_size; ) {
+		const size_t length = get_big_endian(png + offset);
+		if(length > png_size - offset - 12)
+			break;
+		if(memcmp(png + offset + 4, "IDAT", 4) == 0) {
+			memcpy(idat + idat_size, png + offset + 8, length);
+			idat_size += length;
+		}
+		offset += length + 12;
+	}
+
+	unsigned char * rows = static_cast<unsigned char*>(malloc(PNG_ROWS_SIZE));
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	bool ok = (inflateInit(&stream) == Z_OK);
+	t.compressed_size = idat_size;
+	t.inflated_size = 0;
+
+	const double start = get_time();
+	if(ok) {
+		stream.next_in = idat;
+		stream.avail_in = (uInt) idat_size;
+		int err = Z_OK;
+		while(err == Z_OK) {
+			stream.next_out = rows;
+			stream.avail_out = (uInt) PNG_ROWS_SIZE;
+			err = inflate(&stream, Z_NO_FLUSH);
+		}
+		ok = (err == Z_STREAM_END);
+		t.inflated_size = stream.total_out;
+		inflateEnd(&stream);
+	}
+	t.seconds = get_time() - start;
+
+	free(rows);
+	free(idat);
+	return ok;
+}
+
+static bool is_png(const char * name) {
+	const size_t length = strlen(name);
+	return length >= 4 && (strcmp(name + length - 4, ".png") == 0 || strcmp(name + length - 4, ".PNG") == 0);
+}
+
+static void keep_best(timing & best, const timing & t, int repetition) {
+	if(repetition == 0 || t.seconds < best.seconds)
+		best = t;
+}
+
+static bool benchmark_archive(char * archive_name, int repetitions) {
+	ZZIP_DISK * disk = zzip_disk_open(archive_name);
+	if(!disk) {
+		fprintf(stderr, "%s: cannot open archive\n", archive_name);
+		return false;
+	}
+
+	bool ok = true;
+	int entry_count = 0;
+	int png_count = 0;
+	timing chunked_total = {};
+	timing whole_total = {};
+	timing png_total = {};
+	for(ZZIP_DISK_ENTRY * entry = zzip_disk_findfirst(disk); entry; entry = zzip_disk_findnext(disk, entry)) {
+		ZZIP_DISK_FILE * file = zzip_disk_entry_fopen(disk, entry);
+		if(!file)
+			continue;
+		const bool deflated = (file->stored == 0);
+		const size_t size = file->avail;
+		zzip_disk_fclose(file);
+		if(!deflated)
+			continue;
+
+		char * name = zzip_disk_entry_strdup_name(disk, entry);
+		char * buffer = static_cast<char*>(malloc(size > 0 ? size : 1));
+		timing chunked = {}, whole = {}, png = {};
+		bool png_inflated = is_png(name);
+		for(int repetition = 0; repetition < repetitions; ++repetition) {
+			timing t;
+			if(!inflate_entry(disk, entry, false, buffer, t)) {
+				fprintf(stderr, "%s: %s: corrupted entry (chunks)\n", archive_name, name);
+				ok = false;
+			}
+			keep_best(chunked, t, repetition);
+			if(!inflate_entry(disk, entry, true, buffer, t)) {
+				fprintf(stderr, "%s: %s: corrupted entry (whole)\n", archive_name, name);
+				ok = false;
+			}
+			keep_best(whole, t, repetition);
+			if(png_inflated) {
+				png_inflated = inflate_png_rows(reinterpret_cast<unsigned char*>(buffer), size, t);
+				keep_best(png, t, repetition);
+			}
+		}
+		add(chunked_total, chunked);
+		add(whole_total, whole);
+		if(png_inflated) {
+			add(png_total, png);
+			++png_count;
+		}
+		++entry_count;
+		free(buffer);
+		free(name);
+	}
+	zzip_disk_close(disk);
+
+	printf("%s: %d deflated entries, %d PNG images\n", archive_name, entry_count, png_count);
+	print("entries, chunks", chunked_total);
+	print("entries, whole", whole_total);
+	print("PNG rows (zlib)", png_total);
+	return ok;
+}
+
+int main(int argc, char * argv[]) {
+	int repetitions = 3;
+	int first_archive = 1;
+	if(argc > 2 && strcmp(argv[1], "-n") == 0) {
+		repetitions = atoi(argv[2]);
+		first_archive = 3;
+	}
+	if(first_archive >= argc || repetitions < 1) {
+		fprintf(stderr, "usage: zzipbench [-n repetitions] archive.zip...\n");
+		return 2;
+	}
+
+	printf("inflate backend: %s, zlib %s\n", zzip_disk_inflate_backend(), zlibVersion());
+	bool ok = true;
+	for(int i = first_archive; i < argc; ++i)
+		ok = benchmark_archive(argv[i], repetitions) && ok;
+	return ok ? 0 : 1;
+}